@@ -5,19 +5,20 @@
  */
 
 #include <AltSoftSerial.h>    // For UART communication with HC-06 (uses hardware timers instead of being purely software-based)
-#include <Wire.h>             // For I2C communication with sensors and 1U
 #include <avr/pgmspace.h>     // For storing constants in flash memory
 
 #include "src/Blueboy.h"
 #include "src/Messages.h"
 #include "src/CommandProcessor.h"
 #include "src/BlueboyTelemetry.h"
+#include "src/util/Log.h"
+#include "src/util/LoopMonitor.h"
+#include "src/sensor/I2CEngine.h"  // For I2C communication with sensors and 1U
 
 const int RX_PIN = 8;    // RX pin required by AltSoftSerial
 const int TX_PIN = 9;    // TX pin required by AltSoftSerial
 const int RST_PIN = 4;   // gpio pin tied to reset, pull low to reset
 
-char strbuf[64];         // general-purpose string buffer
 char message[32];        // stored message to be echoed on command
 
 AltSoftSerial bt(RX_PIN, TX_PIN);
@@ -27,6 +28,8 @@ BlueboyPeripherals peripherals;
 CommandProcessor commands(bt, SYNC_PATTERN);
 BlueboyTelemetry telemetry(bt, peripherals, SYNC_PATTERN);
 
+LoopMonitor monitor;
+
 /*!
  * @brief Callback to be invoked on a reset command.
  * @param cmd The ID of the command that invoked this callback
@@ -43,7 +46,7 @@ bool ResetCommand(CommandID cmd, const char *data, uint16_t len) {
   telemetry.SendMessage(RESET_MSG);
   delay(100);   // delay to allow message to be sent asynchronously
   
-  telemetry.oneU.Reset();
+  peripherals.oneU.Reset();
   
   digitalWrite(RST_PIN, LOW);  // pull pin low for reset
   
@@ -74,16 +77,36 @@ bool MessageCommand(CommandID cmd, const char *data, uint16_t len) {
   return true;
 }
 
+/*!
+ * @brief Callback to be invoked on a link statistics command.
+ * @param cmd The ID of the command that invoked this callback
+ * @param data Byte buffer containing data that may have been passed by the command
+ * @param len Length of the byte buffer
+ * @return True
+ *
+ * Sends the command link's error counters over telemetry: packets and bytes received, bytes dropped, lost syncs
+ * and oversized lengths.
+ */
+bool LinkStatsCommand(CommandID cmd, const char *data, uint16_t len) {
+  telemetry.SendLinkStats(commands.LinkStats());
+  return true;
+}
+
 /*!
  * @brief Callback to be invoked on a begin log command.
  * @param cmd The ID of the command that invoked this callback
  * @param data Byte buffer containing data that may have been passed by the command
  * @param len Length of the byte buffer
- * @return True iff the command was properly formed and Blueboy is not currently calibrating any sensors.
+ * @return True iff the command was properly formed, the device supports the attitude mode, the link has room for
+ *         it, and Blueboy is not currently calibrating any sensors.
  * 
  * Starts logging data from Blueboy or the test system depending on the command ID, accepting an unsigned
- * 16-bit short as the collection period and an optional byte representing the attitude mode (orientation
- * data as raw sensor data, euler angles, or a quaternion).
+ * 16-bit short as the collection period in ms, an optional byte representing the attitude mode (orientation
+ * data as raw sensor data, euler angles, a quaternion, or raw sensor counts), an optional byte giving the number of
+ * samples to batch into each telemetry packet, an optional unsigned 32-bit period in us that overrides the
+ * first when nonzero, for periods under a millisecond or between whole ones, and an optional byte giving how
+ * Blueboy's samples are acquired: read on deadlines (0), drained from its IMU's FIFO (1), or read on its sensors'
+ * data-ready edges (2).
  * 
  * Sends messages over telemetry reporting successful beginning or failure due to current calibration.
  */
@@ -97,21 +120,49 @@ bool BeginLogCommand(CommandID cmd, const char *data, uint16_t len) {
   telemetry.SendMessage(BEGIN_LOG_MSG);
   uint8_t dev = ((uint8_t) cmd) >> 4;
   uint8_t mode = 0;
+  uint8_t batch = 1;
+  uint8_t acquisition = (uint8_t) Acquisition::Deadline;
   uint16_t period;
 
   if (len >= 2) {
     period = *((uint16_t *) (data));  // interpret data as a pointer to a short, then dereference it
-    telemetry.SetLogPeriod((Device) dev, (unsigned long) period);
+    telemetry.SetLogPeriod((Device) dev, period * 1000UL);
   } else {
     return false;
   }
 
+  if (len >= 2 + 1 + 1 + 4) {
+    // optional period in us
+    uint32_t periodUs = *((uint32_t *) (data + 4));
+    if (periodUs != 0) {
+      telemetry.SetLogPeriod((Device) dev, periodUs);
+    }
+  }
+
   if (len >= 2 + 1) {
     // optional mode
     mode = *((uint8_t *) (data + 2));  // interpret (data + 2) as a pointer to a byte, then dereference it
   }
+
+  if (len >= 2 + 1 + 1) {
+    // optional batch depth
+    batch = *((uint8_t *) (data + 3));
+  }
+
+  if (len >= 2 + 1 + 1 + 4 + 1) {
+    // optional acquisition
+    acquisition = *((uint8_t *) (data + 8));
+    if (acquisition > (uint8_t) Acquisition::DataReady) {
+      return false;
+    }
+  }
   
-  telemetry.BeginLogging((Device) dev, (AttitudeMode) mode);
+  if (!telemetry.BeginLogging((Device) dev, (AttitudeMode) mode, batch, (Acquisition) acquisition)) {
+    // the device can't send data in this mode, e.g. counts from the test system, or the link has no room for it,
+    // which its log rate packet tells
+    telemetry.SendMessage(CANT_LOG_MODE_MSG);
+    return false;
+  }
   return true;
 }
 
@@ -142,8 +193,10 @@ bool EndLogCommand(CommandID cmd, const char *data, uint16_t len) {
  * Sends a message over telemetry reporting the command ID that was not recognized.
  */
 bool InvalidCommand(CommandID cmd, const char *data, uint16_t len) {
-  sprintf(strbuf, "%s: %02x", UNRECOGNIZED_MSG, cmd);
-  telemetry.SendMessage(strbuf);
+  char str[PacketSender::MaxDataSize];
+  strcpy_P(str, (const char *) UNRECOGNIZED_MSG);
+  sprintf(str + strlen(str), ": %02x", (uint8_t) cmd);
+  telemetry.SendMessage(str);
   return true;
 }
 
@@ -152,9 +205,11 @@ bool InvalidCommand(CommandID cmd, const char *data, uint16_t len) {
  * @param cmd The ID of the command that invoked this callback
  * @param data Byte buffer containing data that may have been passed by the command
  * @param len Length of the byte buffer
- * @return True iff neither Blueboy nor the test system are currently logging.
+ * @return True iff neither Blueboy nor the test system are currently logging, and none of Blueboy's sensors is
+ *         already calibrating either.
  *
  * Starts calibrating the sensor associated with the command ID on Blueboy and the test system simultaneously.
+ * BeginCalibGyro's optional data byte, if nonzero, makes Blueboy's a temperature sweep, running until ended.
  *
  * Sends a message over telemetry reporting that calibration has begun.
  */
@@ -164,6 +219,11 @@ bool BeginCalibrateCommand(CommandID cmd, const char *data, uint16_t len) {
     telemetry.SendMessage(CANT_CALIB_MSG);
     return false;
   }
+  if (peripherals.Calibrating()) {
+    // the sensors calibrate one at a time, sharing their scratch, and beginning again would discard the samples
+    telemetry.SendMessage(BUSY_CALIB_MSG);
+    return false;
+  }
   
   switch (cmd) {
     case CommandID::BeginCalibMag:
@@ -171,10 +231,16 @@ bool BeginCalibrateCommand(CommandID cmd, const char *data, uint16_t len) {
       peripherals.oneU.BeginCalibration(SENSOR_TYPE_MAGNETIC_FIELD);
       break;
     case CommandID::BeginCalibAcc:
+      peripherals.lsm6ds33.BeginCalibration(SENSOR_TYPE_ACCELEROMETER);
       peripherals.oneU.BeginCalibration(SENSOR_TYPE_ACCELEROMETER);
       break;
     case CommandID::BeginCalibGyro:
-      peripherals.lsm6ds33.BeginCalibration(SENSOR_TYPE_GYROSCOPE);
+      if (len >= 1 && data[0]) {
+        // optional sweep
+        peripherals.lsm6ds33.BeginSweep();
+      } else {
+        peripherals.lsm6ds33.BeginCalibration(SENSOR_TYPE_GYROSCOPE);
+      }
       peripherals.oneU.BeginCalibration(SENSOR_TYPE_GYROSCOPE);
       break;
   }
@@ -194,22 +260,58 @@ bool BeginCalibrateCommand(CommandID cmd, const char *data, uint16_t len) {
  * Stops calibrating the sensor associated with the command ID on Blueboy and the test system simultaneously,
  * stores new calibration constants in persistent memory, and reports the new constants to a connected serial monitor.
  *
- * Sends a message over telemetry reporting that calibration has ended.
+ * Sends a message over telemetry reporting that calibration has ended; for the magnetometer, with how closely its
+ * samples fit an ellipsoid, or that they didn't and the calibration before it was kept; for the accelerometer, or
+ * that a position was missed and the calibration before it was kept; or, for any of them, that it wasn't
+ * calibrating.
  */
 bool EndCalibrateCommand(CommandID cmd, const char *data, uint16_t len) {
   struct AxisOffsets off;
   switch (cmd) {
-    case CommandID::EndCalibMag:
-      peripherals.lis2mdl.EndCalibration();
+    case CommandID::EndCalibMag: {
       peripherals.oneU.EndCalibration();
+      if (!peripherals.lis2mdl.Calibrating()) {
+        // no fit to report, whatever FitResidual holds
+        telemetry.SendMessage(NOT_CALIB_MSG);
+        return true;
+      }
+      peripherals.lis2mdl.EndCalibration();
       peripherals.lis2mdl.GetCalibration(&off);
-      break;
+
+      float residual = peripherals.lis2mdl.FitResidual();
+      if (residual < 0) {
+        telemetry.SendMessage(NO_FIT_CALIB_MSG);
+        return true;
+      }
+      uint16_t hundredths = (uint16_t) min(residual * 10000 + 0.5f, 65535.0f);   // of a percent
+      char str[PacketSender::MaxDataSize];
+      sprintf_P(str, FIT_CALIB_MSG, hundredths / 100, hundredths % 100);
+      telemetry.SendMessage(str);
+      LOG_INFO(F("Calibration complete! Offsets: "), LogFloat(off.xOff, 5), F(", "), LogFloat(off.yOff, 5), F(", "),
+               LogFloat(off.zOff, 5));
+      return true;
+    }
     case CommandID::EndCalibAcc:
       peripherals.oneU.EndCalibration();
+      if (peripherals.lsm6ds33.Calibrating() != SENSOR_TYPE_ACCELEROMETER) {
+        telemetry.SendMessage(NOT_CALIB_MSG);
+        return true;
+      }
+      peripherals.lsm6ds33.EndCalibration();
+      if (!peripherals.lsm6ds33.AccelFitted()) {
+        telemetry.SendMessage(NO_POS_CALIB_MSG);
+        return true;
+      }
+      peripherals.lsm6ds33.GetCalibration(&off, SENSOR_TYPE_ACCELEROMETER);
       break;
     case CommandID::EndCalibGyro:
-      peripherals.lsm6ds33.EndCalibration();
       peripherals.oneU.EndCalibration();
+      if (peripherals.lsm6ds33.Calibrating() != SENSOR_TYPE_GYROSCOPE) {
+        // ended itself once the bias settled, or never began
+        telemetry.SendMessage(NOT_CALIB_MSG);
+        return true;
+      }
+      peripherals.lsm6ds33.EndCalibration();
       peripherals.lsm6ds33.GetCalibration(&off);
       break;
     default:
@@ -217,13 +319,8 @@ bool EndCalibrateCommand(CommandID cmd, const char *data, uint16_t len) {
   }
   telemetry.SendMessage(END_CALIB_MSG);
   
-  Serial.println(F("Calibration complete! Offsets: "));
-  Serial.print(F("  x: "));
-  Serial.println(off.xOff, 5);
-  Serial.print(F("  y: "));
-  Serial.println(off.yOff, 5);
-  Serial.print(F("  z: "));
-  Serial.println(off.zOff, 5);
+  LOG_INFO(F("Calibration complete! Offsets: "), LogFloat(off.xOff, 5), F(", "), LogFloat(off.yOff, 5), F(", "),
+           LogFloat(off.zOff, 5));
   return true;
 }
 
@@ -244,6 +341,7 @@ bool ClearCalibrateCommand(CommandID cmd, const char *data, uint16_t len) {
       peripherals.lis2mdl.ClearCalibration();
       break;
     case CommandID::ClearCalibAcc:
+      peripherals.lsm6ds33.ClearCalibration(SENSOR_TYPE_ACCELEROMETER);
       break;
     case CommandID::ClearCalibGyro:
       peripherals.lsm6ds33.ClearCalibration();
@@ -265,9 +363,9 @@ void setup() {
   pinMode(RST_PIN, OUTPUT);
   
   // begin serial communications over serial monitor, bluetooth, and i2c bus
-  Serial.begin(9600);
-  bt.begin(57600);
-  Wire.begin();
+  Log().Begin(9600);
+  bt.begin(LINK_BAUD);
+  I2CEngine::Begin();
   
   // copy the default message from flash memory to a buffer, to be echoed on an empty message command
   strcpy_P(message, (const char *) DEFAULT_MSG);
@@ -279,11 +377,13 @@ void setup() {
   commands.Bind(CommandID::BeginTestAttitude, &BeginLogCommand);
   commands.Bind(CommandID::EndTestAttitude,   &EndLogCommand);
   commands.Bind(CommandID::Echo,              &MessageCommand);
+  commands.Bind(CommandID::LinkStats,         &LinkStatsCommand);
   commands.Bind(CommandID::BeginCalibMag,     &BeginCalibrateCommand);
   commands.Bind(CommandID::EndCalibMag,       &EndCalibrateCommand);
   commands.Bind(CommandID::ClearCalibMag,     &ClearCalibrateCommand);
   
   telemetry.InitializePeripherals();
+  Log().Flush();  // the loop drains the log without waiting, but nothing is waiting on setup yet
 
   // report that we've started over telemetry
   telemetry.SendMessage(SETUP_MSG);
@@ -293,6 +393,17 @@ void setup() {
  * @brief Arduino Loop function
  */
 void loop() {
+  monitor.Tick();
+  I2CEngine::Tick();  // reads that landed while the last loop parsed commands and wrote telemetry
+  peripherals.oneU.Tick();  // its health, every so often, in the background
+  peripherals.lsm6ds33.Tick();  // its temperature, likewise
   commands.Tick();
   telemetry.Tick();
+
+  if (monitor.Elapsed(STATUS_PERIOD)) {
+    // if the link is busy, tried again next loop
+    telemetry.SendStatus(monitor, commands.LinkStats());
+  }
+
+  Log().Drain();  // only what the console's USART can take, never waiting on it
 }
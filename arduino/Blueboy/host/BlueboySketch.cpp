@@ -0,0 +1,10 @@
+/*!
+ * @file BlueboySketch.cpp
+ * @author Sebastian S.
+ * @brief Compiles the unmodified Blueboy sketch as an ordinary translation unit for the host build.
+ *
+ * The Arduino IDE prepends Arduino.h to .ino files and otherwise compiles them as C++, so this does the same.
+ */
+
+#include <Arduino.h>
+#include "../Blueboy.ino"
@@ -0,0 +1,70 @@
+/*!
+ * @file GroundLink.cpp
+ * @author Sebastian S.
+ * @brief Implementation of GroundLink.h
+ */
+
+#include "GroundLink.h"
+#include <string.h>
+
+namespace host {
+
+std::vector<uint8_t> GroundLink::Frame(uint32_t sync, uint8_t id, const void *data, size_t len) {
+  std::vector<uint8_t> frame;
+  uint16_t plen = (uint16_t) (len + 1);
+
+  frame.reserve(7 + len);
+  for (int i = 0; i < 4; i++) {
+    frame.push_back((sync >> (8 * i)) & 0xFF);
+  }
+  frame.push_back(plen & 0xFF);
+  frame.push_back(plen >> 8);
+  frame.push_back(id);
+  if (len) {
+    const uint8_t *bytes = (const uint8_t *) data;
+    frame.insert(frame.end(), bytes, bytes + len);
+  }
+  return frame;
+}
+
+void GroundLink::SendCommand(uint8_t id, const void *data, size_t len) {
+  std::vector<uint8_t> frame = Frame(_sync, id, data, len);
+  _link.Inject(frame.data(), frame.size());
+}
+
+size_t GroundLink::Poll(std::vector<TelemetryPacket> *out) {
+  // move newly transmitted bytes out of the link so long runs don't accumulate the whole capture
+  const std::vector<uint8_t>& sent = _link.Sent();
+  _pending.insert(_pending.end(), sent.begin(), sent.end());
+  _link.ClearSent();
+
+  size_t decoded = 0;
+  size_t pos = 0;
+  while (_pending.size() - pos >= 7) {
+    uint32_t pattern;
+    memcpy(&pattern, &_pending[pos], sizeof(pattern));
+    uint16_t plen = _pending[pos + 4] | (_pending[pos + 5] << 8);
+    if (pattern != _sync || plen == 0) {
+      pos++;
+      _syncLosses++;
+      continue;
+    }
+    if (_pending.size() - pos < 6u + plen) {
+      break;  // packet not complete yet
+    }
+
+    if (out) {
+      TelemetryPacket packet;
+      packet.id = _pending[pos + 6];
+      packet.data.assign(_pending.begin() + pos + 7, _pending.begin() + pos + 6 + plen);
+      out->push_back(packet);
+    }
+    decoded++;
+    pos += 6 + plen;
+  }
+
+  _pending.erase(_pending.begin(), _pending.begin() + pos);
+  return decoded;
+}
+
+}  // namespace host
@@ -0,0 +1,78 @@
+/*!
+ * @file GroundLink.h
+ * @author Sebastian S.
+ * @brief Ground-side end of the Bluetooth link for host harnesses: frames commands and decodes telemetry.
+ */
+
+#ifndef HOST_GROUND_LINK_H_
+#define HOST_GROUND_LINK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "SerialLink.h"
+
+namespace host {
+
+/*!
+ * @struct TelemetryPacket
+ * @brief A decoded telemetry packet.
+ */
+struct TelemetryPacket {
+  uint8_t id;                   //!< telemetry ID
+  std::vector<uint8_t> data;    //!< payload after the ID
+};
+
+/*!
+ * @class GroundLink
+ * @brief Speaks the same framing as COSMOS: [Sync: 4] | [Length: 2] | [ID: 1] | [Data: Length - 1].
+ */
+class GroundLink {
+ public:
+  /*!
+   * @brief Constructs a GroundLink
+   * @param link Firmware serial link to inject commands into and decode telemetry from
+   * @param sync 32-bit sync pattern, sent little endian
+   */
+  GroundLink(SerialLink& link, uint32_t sync) : _link(link), _sync(sync), _syncLosses(0) { }
+
+  /*!
+   * @brief Frames a packet
+   * @param sync 32-bit sync pattern
+   * @param id Packet ID
+   * @param data Payload bytes, may be null if len is 0
+   * @param len Payload length
+   * @return The framed bytes
+   */
+  static std::vector<uint8_t> Frame(uint32_t sync, uint8_t id, const void *data, size_t len);
+
+  /*!
+   * @brief Frames a command and makes it available to the firmware
+   * @param id Command ID
+   * @param data Command data, may be null if len is 0
+   * @param len Length of the command data
+   */
+  void SendCommand(uint8_t id, const void *data = nullptr, size_t len = 0);
+
+  /*!
+   * @brief Decodes every complete packet transmitted by the firmware since the last call
+   * @param out Vector to append decoded packets to, or null to only count them
+   * @return Number of packets decoded
+   */
+  size_t Poll(std::vector<TelemetryPacket> *out);
+
+  /*!
+   * @return Number of bytes skipped while searching for a sync pattern
+   */
+  uint32_t SyncLosses() const { return _syncLosses; }
+ private:
+  SerialLink& _link;
+  uint32_t _sync;
+  std::vector<uint8_t> _pending;   // transmitted bytes not yet decoded
+  uint32_t _syncLosses;
+};
+
+}  // namespace host
+
+#endif
@@ -0,0 +1,100 @@
+/*!
+ * @file Bench.h
+ * @author Sebastian S.
+ * @brief Minimal timing harness for the host benchmarks.
+ */
+
+#ifndef HOST_BENCH_H_
+#define HOST_BENCH_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace bench {
+
+/*!
+ * @return A free-running cycle counter where the host has one, otherwise nanoseconds
+ */
+inline uint64_t Cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/*!
+ * @struct Result
+ * @brief Timing of one benchmark.
+ */
+struct Result {
+  const char *name;
+  uint64_t iterations;
+  double nsPerOp;
+  double cyclesPerOp;
+};
+
+/*!
+ * @brief Keeps the compiler from discarding a computed value
+ */
+template <class T>
+inline void DoNotOptimize(const T& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/*!
+ * @brief Runs fn repeatedly until at least minSeconds of wall time have passed
+ * @param name Name to report
+ * @param fn Callable to time; one call is one operation
+ * @param minSeconds Minimum wall time to spend measuring
+ * @return Averaged timings
+ */
+template <class F>
+Result Run(const char *name, F fn, double minSeconds = 0.25) {
+  typedef std::chrono::steady_clock clock;
+
+  // warm up caches and branch predictors
+  for (int i = 0; i < 100; i++) {
+    fn();
+  }
+
+  uint64_t iterations = 0;
+  uint64_t batch = 64;
+  clock::time_point start = clock::now();
+  uint64_t startCycles = Cycles();
+  double elapsed = 0;
+  while (elapsed < minSeconds) {
+    for (uint64_t i = 0; i < batch; i++) {
+      fn();
+    }
+    iterations += batch;
+    batch *= 2;
+    elapsed = std::chrono::duration<double>(clock::now() - start).count();
+  }
+  uint64_t cycles = Cycles() - startCycles;
+
+  Result result;
+  result.name = name;
+  result.iterations = iterations;
+  result.nsPerOp = elapsed * 1e9 / iterations;
+  result.cyclesPerOp = (double) cycles / iterations;
+  return result;
+}
+
+/*!
+ * @brief Prints a result as one aligned row
+ */
+inline void Print(const Result& result) {
+  printf("%-44s %12.1f ns/op %12.1f cycles/op %12llu iterations\n", result.name, result.nsPerOp,
+         result.cyclesPerOp, (unsigned long long) result.iterations);
+}
+
+}  // namespace bench
+
+#endif
@@ -0,0 +1,222 @@
+/*!
+ * @file bench_calibration.cpp
+ * @author Sebastian S.
+ * @brief Checks Blueboy's own sensor calibrations against the simulated sensors' known errors, failing if any
+ *        result falls outside the bounds the calibrations are meant to hold.
+ *
+ * Each calibration runs through BlueboyPeripherals as the sketch drives it, one sample call per 100 us of
+ * virtual time, while the simulated board is turned or held still. The bounds are the accuracy each calibration
+ * was accepted with; a change that loosens one shows up here as a failure rather than as a drifting number.
+ */
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <math.h>
+#include <algorithm>
+
+#include "../sim/SimBoard.h"
+#include "../../src/Blueboy.h"
+#include "../../src/BlueboyPeripherals.h"
+
+namespace {
+
+const double G = 9.80665;
+
+host::SimBoard board;
+BlueboyPeripherals peripherals;
+int failures = 0;
+
+// prints a checked quantity against its bound and counts it if out of bounds
+void Check(const char *what, double value, double bound) {
+  bool pass = value <= bound;
+  printf("  %-52s %10.5f  bound %10.5f  %s\n", what, value, bound, pass ? "ok" : "FAIL");
+  if (!pass) {
+    failures++;
+  }
+}
+
+void CheckTrue(const char *what, bool value) {
+  printf("  %-52s %10s  %s\n", what, value ? "yes" : "no", value ? "ok" : "FAIL");
+  if (!value) {
+    failures++;
+  }
+}
+
+// advances virtual time, calling the calibrating sensors' sample hooks as the sketch's loop does and setting the
+// simulated sensors from the time into the run before each
+template <class F>
+void Run(double seconds, F set) {
+  uint64_t start = host::Clock::Now();
+  while (host::Clock::Now() - start < seconds * 1e6) {
+    set((host::Clock::Now() - start) / 1e6);
+    if (peripherals.lsm6ds33.Calibrating()) {
+      peripherals.lsm6ds33.AddCalibrationSample();
+    }
+    if (peripherals.lis2mdl.Calibrating()) {
+      peripherals.lis2mdl.AddCalibrationSample();
+    }
+    host::Clock::Advance(100);
+  }
+}
+
+// the Earth's field, seen from a board turned to the given yaw, pitch and roll
+void TurnedField(double yaw, double pitch, double roll, double field[3]) {
+  const double earth[3] = { 24, 0, 41.6 };
+  double cy = cos(yaw), sy = sin(yaw), cp = cos(pitch), sp = sin(pitch), cr = cos(roll), sr = sin(roll);
+  double r[3][3] = { { cy * cp, cy * sp * sr - sy * cr, cy * sp * cr + sy * sr },
+                     { sy * cp, sy * sp * sr + cy * cr, sy * sp * cr - cy * sr },
+                     { -sp, cp * sr, cp * cr } };
+  for (int i = 0; i < 3; i++) {
+    field[i] = r[0][i] * earth[0] + r[1][i] * earth[1] + r[2][i] * earth[2];
+  }
+}
+
+// calibrates the magnetometer while the board turns as given, returning false if the fit was refused
+template <class F>
+bool CalibrateMagnetometer(double seconds, F turn) {
+  struct AxisOffsets before;
+  peripherals.lis2mdl.GetCalibration(&before);
+  peripherals.lis2mdl.BeginCalibration(SENSOR_TYPE_MAGNETIC_FIELD);
+  Run(seconds, [&](double t) {
+    double field[3];
+    turn(t, field);
+    board.lis2mdl.SetField(field[0], field[1], field[2]);
+  });
+  peripherals.lis2mdl.EndCalibration();
+
+  struct AxisOffsets after;
+  peripherals.lis2mdl.GetCalibration(&after);
+  return memcmp(&before, &after, sizeof(before)) != 0;
+}
+
+void CheckMagnetometer() {
+  const float hard[3] = { 22, -15, 35 };
+  const float soft[9] = { 1.08, 0.05, -0.03, 0.05, 0.93, 0.04, -0.03, 0.04, 1.01 };
+  board.lis2mdl.SetHardIron(hard[0], hard[1], hard[2]);
+  board.lis2mdl.SetSoftIron(soft);
+  board.lis2mdl.SetNoise(0.3);
+
+  printf("== magnetometer: hard iron 22, -15, 35 uT, soft iron up to 8%%, 0.3 uT noise, 30 s tumbling ==\n");
+  bool fitted = CalibrateMagnetometer(30, [](double t, double field[3]) {
+    TurnedField(t * 1.3, M_PI * sin(t * 0.37), M_PI * sin(t * 0.51 + 1), field);
+  });
+  CheckTrue("fitted", fitted);
+
+  // the offsets are in the board's axes, which CalibratedLIS2MDL::AlignCounts takes from the sensor's
+  struct AxisOffsets offsets;
+  peripherals.lis2mdl.GetCalibration(&offsets);
+  double offsetError = std::max(std::max(fabs(offsets.xOff + hard[1]), fabs(offsets.yOff + hard[0])),
+                                fabs(offsets.zOff - hard[2]));
+  Check("worst hard-iron offset error (uT)", offsetError, 0.15);
+  Check("fit residual (fraction of the field)", peripherals.lis2mdl.FitResidual(), 0.01);
+
+  // the corrected field's magnitude should hold to the true field's whichever way the board points; each
+  // orientation's readings are averaged so the check is of the correction, not of the noise
+  double truth = sqrt(24 * 24 + 41.6 * 41.6), worst = 0;
+  for (int k = 0; k < 200; k++) {
+    double field[3];
+    TurnedField(k * 0.1, k * 0.03, k * 0.07, field);
+    board.lis2mdl.SetField(field[0], field[1], field[2]);
+    double sum[3] = { 0, 0, 0 };
+    for (int n = 0; n < 16; n++) {
+      host::Clock::Advance(LIS2MDL::Period);
+      float corrected[3];
+      peripherals.lis2mdl.GetMagnetic(corrected);
+      for (int i = 0; i < 3; i++) {
+        sum[i] += corrected[i] / 16;
+      }
+    }
+    double magnitude = sqrt(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2]);
+    worst = std::max(worst, fabs(magnitude / truth - 1));
+  }
+  Check("worst corrected magnitude error (fraction)", worst, 0.015);
+
+  // turns that don't cover the sphere can't pin the ellipsoid down, so the calibration is kept
+  CheckTrue("tilting only +-10 degrees refused", !CalibrateMagnetometer(20, [](double t, double field[3]) {
+    TurnedField(t * 1.3, 0.17 * sin(t * 0.37), 0.17 * sin(t * 0.51 + 1), field);
+  }));
+  CheckTrue("turning only in yaw refused", !CalibrateMagnetometer(20, [](double t, double field[3]) {
+    TurnedField(t * 1.3, 0, 0, field);
+  }));
+}
+
+void CheckGyroscope() {
+  const float bias[3] = { 0.0123, -0.0234, 0.0057 };
+  board.lsm6ds33.SetAcceleration(0, 0, G);
+  board.lsm6ds33.SetNoise(0.05, 0.0005);
+
+  printf("== gyroscope: bias 12.3, -23.4, 5.7 mrad/s, 0.5 mrad/s noise, 50 ms knock at 1 s ==\n");
+  peripherals.lsm6ds33.BeginCalibration(SENSOR_TYPE_GYROSCOPE);
+  double ended = -1;
+  Run(10, [&](double t) {
+    if (t > 1.0 && t < 1.05) {
+      board.lsm6ds33.SetAngularRate(1.5, -0.8, 0.3);
+    } else {
+      board.lsm6ds33.SetAngularRate(bias[0], bias[1], bias[2]);
+    }
+    if (ended < 0 && !peripherals.lsm6ds33.Calibrating()) {
+      ended = t;
+    }
+  });
+  CheckTrue("ended itself", ended >= 0);
+  Check("seconds to settle", ended, 3);
+  CheckTrue("took at least 200 samples", peripherals.lsm6ds33.BiasSamples() >= 200);
+
+  struct AxisOffsets offsets;
+  peripherals.lsm6ds33.GetCalibration(&offsets, SENSOR_TYPE_GYROSCOPE);
+  double biasError = std::max(std::max(fabs(offsets.xOff - bias[0]), fabs(offsets.yOff - bias[1])),
+                              fabs(offsets.zOff - bias[2]));
+  Check("worst bias error (mrad/s)", biasError * 1000, 0.1);
+}
+
+void CheckAccelerometer() {
+  const double bias[3] = { 0.3, -0.2, 0.4 }, scale[3] = { 1.03, 0.97, 1.01 }, tilt = 0.08;
+  board.lsm6ds33.SetAngularRate(0, 0, 0);
+  board.lsm6ds33.SetNoise(0.02, 0.001);
+  auto put = [&](double x, double y, double z) {
+    board.lsm6ds33.SetAcceleration(scale[0] * x + bias[0], scale[1] * y + bias[1], scale[2] * z + bias[2]);
+  };
+
+  printf("== accelerometer: bias 0.3, -0.2, 0.4 m/s^2, scale 1.03, 0.97, 1.01, six positions tilted 4.6 deg ==\n");
+  peripherals.lsm6ds33.BeginCalibration(SENSOR_TYPE_ACCELEROMETER);
+  for (int p = 0; p < 6; p++) {
+    int axis = p / 2;
+    double down[3] = { 0, 0, 0 };
+    down[axis] = (p & 1 ? -G : G) * cos(tilt);
+    down[(axis + 1) % 3] = G * sin(tilt) * 0.6;
+    down[(axis + 2) % 3] = G * sin(tilt) * 0.8;
+
+    // handled into place, then held
+    Run(0.5, [&](double t) { put(down[0] + 3 * sin(t * 40), down[1] + 3 * cos(t * 33), down[2]); });
+    Run(1.5, [&](double) { put(down[0], down[1], down[2]); });
+  }
+  CheckTrue("all six positions held", peripherals.lsm6ds33.AccelPositions() == 0x3F);
+  peripherals.lsm6ds33.EndCalibration();
+  CheckTrue("fitted", peripherals.lsm6ds33.AccelFitted());
+
+  struct AxisOffsets offsets;
+  float fitted[3];
+  peripherals.lsm6ds33.GetCalibration(&offsets, SENSOR_TYPE_ACCELEROMETER);
+  peripherals.lsm6ds33.GetAccelScale(fitted);
+  double biasError = std::max(std::max(fabs(offsets.xOff - bias[0]), fabs(offsets.yOff - bias[1])),
+                              fabs(offsets.zOff - bias[2]));
+  double scaleError = std::max(std::max(fabs(fitted[0] - scale[0]), fabs(fitted[1] - scale[1])),
+                               fabs(fitted[2] - scale[2]));
+  Check("worst bias error (m/s^2)", biasError, 0.01);
+  Check("worst scale error", scaleError, 0.002);
+}
+
+}  // namespace
+
+int main() {
+  board.Attach(Wire);
+  I2CEngine::Begin();
+  peripherals.Initialize();
+
+  CheckMagnetometer();
+  CheckGyroscope();
+  CheckAccelerometer();
+
+  printf("%s: %d check%s out of bounds\n", failures ? "FAIL" : "PASS", failures, failures == 1 ? "" : "s");
+  return failures ? 1 : 0;
+}
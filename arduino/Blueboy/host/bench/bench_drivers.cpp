@@ -0,0 +1,83 @@
+/*!
+ * @file bench_drivers.cpp
+ * @author Sebastian S.
+ * @brief Host benchmark of Blueboy's sensor reads through the Adafruit unified sensor drivers against the
+ *        register-level drivers, on the simulated bus.
+ *
+ * The Adafruit path is what ReadOwnRaw used to do: one getEvent for the magnetometer, then one each for the
+ * accelerometer and gyroscope, every one a separate burst into a sensors_event_t copied into our vectors.
+ */
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <Adafruit_LSM6DS33.h>
+#include <Adafruit_LIS2MDL.h>
+
+#include "Bench.h"
+#include "../sim/SimBoard.h"
+#include "../../src/Blueboy.h"
+#include "../../src/BlueboyPeripherals.h"
+
+// runs one read per call and prints its timing with the bus traffic it caused
+template <class F>
+static void Measure(const char *name, F read) {
+  Wire.ResetStats();
+  bench::Result result = bench::Run(name, read);
+  bench::Print(result);
+
+  const host::I2CStats& stats = Wire.Stats();
+  double calls = result.iterations + 100;   // including the warm-up
+  printf("  %.1f i2c transactions, %.1f bytes written, %.1f bytes read, %.1f us bus time per call\n",
+         stats.transactions / calls, stats.bytesWritten / calls, stats.bytesRead / calls,
+         stats.busMicros / calls);
+}
+
+int main() {
+  host::SimBoard board;
+  board.Attach(Wire);
+  Wire.begin();         // the Adafruit drivers'
+  I2CEngine::Begin();   // ours
+
+  Adafruit_LSM6DS33 adafruitImu;
+  Adafruit_LIS2MDL adafruitMag;
+  adafruitImu.begin_I2C();
+  adafruitMag.begin();
+
+  BlueboyPeripherals peripherals;
+  peripherals.Initialize();
+
+  printf("== own sensor reads, virtual time frozen except for bus transfers ==\n");
+
+  struct AttitudeData data;
+  Measure("Adafruit getEvent x3 (raw)", [&]() {
+    sensors_event_t event;
+    adafruitMag.getEvent(&event);
+    data.raw.magnetic = *(struct Vector *)&event.magnetic;
+    adafruitImu.getAccelerometerSensor()->getEvent(&event);
+    data.raw.acceleration = *(struct Vector *)&event.acceleration;
+    adafruitImu.getGyroSensor()->getEvent(&event);
+    data.raw.gyro = *(struct Vector *)&event.gyro;
+    bench::DoNotOptimize(data);
+  });
+
+  Measure("BlueboyPeripherals::ReadOwnRaw", [&]() {
+    peripherals.ReadOwnRaw(&data);
+    bench::DoNotOptimize(data);
+  });
+
+  Measure("GetCountsRaw x3 (counts)", [&]() {
+    peripherals.lis2mdl.GetCountsRaw(data.counts.magnetic);
+    peripherals.lsm6ds33.GetCountsRaw(data.counts.acceleration, SENSOR_TYPE_ACCELEROMETER);
+    peripherals.lsm6ds33.GetCountsRaw(data.counts.gyro, SENSOR_TYPE_GYROSCOPE);
+    bench::DoNotOptimize(data);
+  });
+
+  Measure("BlueboyPeripherals::ReadOwnCounts", [&]() {
+    peripherals.ReadOwnCounts(&data);
+    bench::DoNotOptimize(data);
+  });
+
+  printf("sensors_event_t: %u bytes of stack per read on the Adafruit path\n",
+         (unsigned) sizeof(sensors_event_t));
+  return 0;
+}
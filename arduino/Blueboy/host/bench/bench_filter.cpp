@@ -0,0 +1,58 @@
+/*!
+ * @file bench_filter.cpp
+ * @author Sebastian S.
+ * @brief Times an update of Blueboy's attitude filter, and turning its orientation into telemetry.
+ *
+ * Host cycles only rank the paths against each other; on the ATmega328P the status packet's fusionCycles is
+ * the figure to go by.
+ */
+
+#include <Arduino.h>
+
+#include "Bench.h"
+#include "../../src/Blueboy.h"
+#include "../../src/sensor/MadgwickFilter.h"
+
+int main() {
+  // a slow turn, level but for a little tilt, in a field pointing north and down
+  const float gyro[3] = { 0.01f, -0.02f, 0.3f };
+  const float acceleration[3] = { 0.3f, -0.2f, 9.8f };
+  const float magnetic[3] = { 18.0f, 1.5f, -42.0f };
+  const float none[3] = { 0, 0, 0 };
+  const float dt = 0.01f;
+
+  printf("== one update of the Madgwick filter at 100 Hz ==\n");
+
+  MadgwickFilter filter;
+  bench::Print(bench::Run("Update, gyroscope, accelerometer, magnetometer", [&]() {
+    filter.Update(gyro, acceleration, magnetic, dt);
+    bench::DoNotOptimize(filter);
+  }));
+
+  filter.Reset();
+  bench::Print(bench::Run("Update, gyroscope and accelerometer", [&]() {
+    filter.Update(gyro, acceleration, none, dt);
+    bench::DoNotOptimize(filter);
+  }));
+
+  filter.Reset();
+  bench::Print(bench::Run("Update, gyroscope alone", [&]() {
+    filter.Update(gyro, none, none, dt);
+    bench::DoNotOptimize(filter);
+  }));
+
+  printf("== reading the orientation out ==\n");
+
+  struct Quaternion quaternion;
+  bench::Print(bench::Run("GetQuaternion", [&]() {
+    filter.GetQuaternion(&quaternion);
+    bench::DoNotOptimize(quaternion);
+  }));
+
+  struct Vector euler;
+  bench::Print(bench::Run("GetEuler", [&]() {
+    filter.GetEuler(&euler);
+    bench::DoNotOptimize(euler);
+  }));
+  return 0;
+}
@@ -0,0 +1,198 @@
+/*!
+ * @file bench_fixed.cpp
+ * @author Sebastian S.
+ * @brief Checks Fixed.h's vector and quaternion operations against double precision, then times them against
+ *        the float ones they stand in for.
+ *
+ * Accuracy is the largest error over random unit inputs, in units of the format's last place. Host cycles only
+ * rank the paths: the host has an FPU, so float is far cheaper here than on the ATmega, where each float
+ * operation is a library call.
+ */
+
+#include <Arduino.h>
+#include <math.h>
+#include <random>
+
+#include "Bench.h"
+#include "../../src/Blueboy.h"
+#include "../../src/util/Fixed.h"
+
+namespace {
+
+struct Vec {
+  double x, y, z;
+};
+
+struct Quat {
+  double w, x, y, z;
+};
+
+std::mt19937 rng(20260101);
+
+double uniform(double lo, double hi) {
+  return std::uniform_real_distribution<double>(lo, hi)(rng);
+}
+
+Vec randomUnitVector(double length) {
+  Vec v;
+  double norm;
+  do {
+    v = { uniform(-1, 1), uniform(-1, 1), uniform(-1, 1) };
+    norm = sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+  } while (norm < 0.1 || norm > 1);
+  return { v.x / norm * length, v.y / norm * length, v.z / norm * length };
+}
+
+Quat randomUnitQuaternion() {
+  Quat q;
+  double norm;
+  do {
+    q = { uniform(-1, 1), uniform(-1, 1), uniform(-1, 1), uniform(-1, 1) };
+    norm = sqrt(q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z);
+  } while (norm < 0.1 || norm > 1);
+  return { q.w / norm, q.x / norm, q.y / norm, q.z / norm };
+}
+
+Quat multiply(const Quat& a, const Quat& b) {
+  return { a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z,
+           a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+           a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+           a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w };
+}
+
+Vec rotate(const Quat& q, const Vec& v) {
+  Quat p = multiply(multiply(q, { 0, v.x, v.y, v.z }), { q.w, -q.x, -q.y, -q.z });
+  return { p.x, p.y, p.z };
+}
+
+template <class T>
+FixedVector<T> toFixed(const Vec& v) {
+  FixedVector<T> fixed = { T::FromFloat(v.x), T::FromFloat(v.y), T::FromFloat(v.z) };
+  return fixed;
+}
+
+template <class T>
+FixedQuaternion<T> toFixed(const Quat& q) {
+  FixedQuaternion<T> fixed = { T::FromFloat(q.w), T::FromFloat(q.x), T::FromFloat(q.y), T::FromFloat(q.z) };
+  return fixed;
+}
+
+// largest error over the components, in units of T's last place
+template <class T>
+double ulps(const FixedVector<T>& fixed, const Vec& exact) {
+  double lsb = 1.0 / (1L << T::FracBits);
+  return std::max(std::max(fabs(fixed.x.raw * lsb - exact.x), fabs(fixed.y.raw * lsb - exact.y)),
+                  fabs(fixed.z.raw * lsb - exact.z)) / lsb;
+}
+
+template <class T>
+double ulps(const FixedQuaternion<T>& fixed, const Quat& exact) {
+  double lsb = 1.0 / (1L << T::FracBits);
+  FixedVector<T> vector = { fixed.x, fixed.y, fixed.z };
+  return std::max(fabs(fixed.w.raw * lsb - exact.w) / lsb, ulps(vector, { exact.x, exact.y, exact.z }));
+}
+
+template <class T>
+void checkAccuracy(const char *format, double length) {
+  const int trials = 100000;
+  double dot = 0, cross = 0, normalize = 0, rotation = 0, product = 0, qNormalize = 0;
+  for (int i = 0; i < trials; i++) {
+    // inputs as the format holds them, so only the operation's own error is measured
+    FixedVector<T> a = toFixed<T>(randomUnitVector(length)), b = toFixed<T>(randomUnitVector(length));
+    FixedQuaternion<T> p = toFixed<T>(randomUnitQuaternion()), q = toFixed<T>(randomUnitQuaternion());
+    double lsb = 1.0 / (1L << T::FracBits);
+    Vec da = { a.x.raw * lsb, a.y.raw * lsb, a.z.raw * lsb }, db = { b.x.raw * lsb, b.y.raw * lsb, b.z.raw * lsb };
+    Quat dp = { p.w.raw * lsb, p.x.raw * lsb, p.y.raw * lsb, p.z.raw * lsb };
+    Quat dq = { q.w.raw * lsb, q.x.raw * lsb, q.y.raw * lsb, q.z.raw * lsb };
+
+    dot = std::max(dot, fabs(a.Dot(b).raw * lsb - (da.x * db.x + da.y * db.y + da.z * db.z)) / lsb);
+    cross = std::max(cross, ulps(a.Cross(b), { da.y * db.z - da.z * db.y, da.z * db.x - da.x * db.z,
+                                                da.x * db.y - da.y * db.x }));
+    product = std::max(product, ulps(p * q, multiply(dp, dq)));
+    rotation = std::max(rotation, ulps(p.Rotate(a), rotate(dp, da)));
+
+    // shorter than unit, so the result is representable in Q15
+    FixedVector<T> shortened = a * T::FromFloat(0.3);
+    Vec ds = { shortened.x.raw * lsb, shortened.y.raw * lsb, shortened.z.raw * lsb };
+    double norm = sqrt(ds.x * ds.x + ds.y * ds.y + ds.z * ds.z);
+    shortened.Normalize();
+    normalize = std::max(normalize, ulps(shortened, { ds.x / norm, ds.y / norm, ds.z / norm }));
+
+    FixedQuaternion<T> drifted = { p.w * T::FromFloat(0.9), p.x * T::FromFloat(0.9), p.y * T::FromFloat(0.9),
+                                   p.z * T::FromFloat(0.9) };
+    Quat dd = { drifted.w.raw * lsb, drifted.x.raw * lsb, drifted.y.raw * lsb, drifted.z.raw * lsb };
+    double qNorm = sqrt(dd.w * dd.w + dd.x * dd.x + dd.y * dd.y + dd.z * dd.z);
+    drifted.Normalize();
+    qNormalize = std::max(qNormalize, ulps(drifted, { dd.w / qNorm, dd.x / qNorm, dd.y / qNorm, dd.z / qNorm }));
+  }
+
+  printf("%-8s worst error in last places over %d trials: dot %.2f, cross %.2f, normalize %.2f, "
+         "quaternion product %.2f, quaternion normalize %.2f, rotate %.2f\n", format, trials, dot, cross,
+         normalize, product, qNormalize, rotation);
+}
+
+}  // namespace
+
+int main() {
+  printf("== accuracy against double precision, unit inputs ==\n");
+  checkAccuracy<Q15>("Q15", 0.999);
+  checkAccuracy<Q16_16>("Q16_16", 1.0);
+
+  struct Vector fa = { { { 0.48f, -0.6f, 0.64f } } }, fb = { { { -0.36f, 0.8f, 0.48f } } };
+  struct Quaternion fq = { 0.1826f, 0.3651f, 0.5477f, 0.7303f };
+  FixedVector<Q15> qa = FixedVector<Q15>::FromVector(fa), qb = FixedVector<Q15>::FromVector(fb);
+  FixedVector<Q16_16> la = FixedVector<Q16_16>::FromVector(fa), lb = FixedVector<Q16_16>::FromVector(fb);
+  FixedQuaternion<Q15> qq = FixedQuaternion<Q15>::FromQuaternion(fq);
+  FixedQuaternion<Q16_16> lq = FixedQuaternion<Q16_16>::FromQuaternion(fq);
+
+  printf("== dot product ==\n");
+  bench::Print(bench::Run("float", [&]() {
+    bench::DoNotOptimize(fa.x * fb.x + fa.y * fb.y + fa.z * fb.z);
+  }));
+  bench::Print(bench::Run("Q15", [&]() { bench::DoNotOptimize(qa.Dot(qb)); }));
+  bench::Print(bench::Run("Q16_16", [&]() { bench::DoNotOptimize(la.Dot(lb)); }));
+
+  printf("== cross product ==\n");
+  bench::Print(bench::Run("float", [&]() {
+    struct Vector c = { { { fa.y * fb.z - fa.z * fb.y, fa.z * fb.x - fa.x * fb.z, fa.x * fb.y - fa.y * fb.x } } };
+    bench::DoNotOptimize(c);
+  }));
+  bench::Print(bench::Run("Q15", [&]() { bench::DoNotOptimize(qa.Cross(qb)); }));
+  bench::Print(bench::Run("Q16_16", [&]() { bench::DoNotOptimize(la.Cross(lb)); }));
+
+  printf("== normalize a vector ==\n");
+  bench::Print(bench::Run("float, 1 / sqrtf", [&]() {
+    struct Vector v = fa;
+    float scale = 1.0f / sqrtf(v.x * v.x + v.y * v.y + v.z * v.z);
+    v.x *= scale;
+    v.y *= scale;
+    v.z *= scale;
+    bench::DoNotOptimize(v);
+  }));
+  bench::Print(bench::Run("Q15", [&]() {
+    FixedVector<Q15> v = qa;
+    v.Normalize();
+    bench::DoNotOptimize(v);
+  }));
+  bench::Print(bench::Run("Q16_16", [&]() {
+    FixedVector<Q16_16> v = la;
+    v.Normalize();
+    bench::DoNotOptimize(v);
+  }));
+
+  printf("== quaternion product ==\n");
+  bench::Print(bench::Run("float", [&]() {
+    struct Quaternion p = { fq.w * fq.x + fq.x * fq.w + fq.y * fq.z - fq.z * fq.y,
+                            fq.w * fq.y - fq.x * fq.z + fq.y * fq.w + fq.z * fq.x,
+                            fq.w * fq.z + fq.x * fq.y - fq.y * fq.x + fq.z * fq.w,
+                            fq.w * fq.w - fq.x * fq.x - fq.y * fq.y - fq.z * fq.z };
+    bench::DoNotOptimize(p);
+  }));
+  bench::Print(bench::Run("Q15", [&]() { bench::DoNotOptimize(qq * qq); }));
+  bench::Print(bench::Run("Q16_16", [&]() { bench::DoNotOptimize(lq * lq); }));
+
+  printf("== rotate a vector by a quaternion ==\n");
+  bench::Print(bench::Run("Q15", [&]() { bench::DoNotOptimize(qq.Rotate(qa)); }));
+  bench::Print(bench::Run("Q16_16", [&]() { bench::DoNotOptimize(lq.Rotate(la)); }));
+  return 0;
+}
@@ -0,0 +1,101 @@
+/*!
+ * @file bench_loop.cpp
+ * @author Sebastian S.
+ * @brief Host benchmarks of the pieces of loop(): command dispatch, telemetry ticks and sensor reads.
+ */
+
+#include <Arduino.h>
+#include <AltSoftSerial.h>
+#include <Wire.h>
+
+#include "Bench.h"
+#include "../GroundLink.h"
+#include "../sim/SimBoard.h"
+#include "../../src/Blueboy.h"
+#include "../../src/CommandProcessor.h"
+#include "../../src/BlueboyTelemetry.h"
+#include "../../src/BlueboyPeripherals.h"
+
+static uint32_t dispatched = 0;
+
+static bool countCommand(CommandID cmd, const char *data, uint16_t len) {
+  dispatched++;
+  return true;
+}
+
+int main() {
+  host::SimBoard board;
+  board.Attach(Wire);
+  I2CEngine::Begin();
+
+  AltSoftSerial bt(8, 9);
+  bt.begin(57600);
+  bt.Link().SetCapture(false);
+  host::GroundLink ground(bt.Link(), SYNC_PATTERN);
+
+  BlueboyPeripherals peripherals;
+  CommandProcessor commands(bt, SYNC_PATTERN);
+  BlueboyTelemetry telemetry(bt, peripherals, SYNC_PATTERN);
+  commands.Bind(CommandID::Echo, &countCommand);
+  telemetry.InitializePeripherals();
+
+  printf("== loop() components, virtual time frozen except for bus and link transfers ==\n");
+
+  // one framed echo command with a short payload per call, as in normal operation
+  const char payload[] = "ping";
+  std::vector<uint8_t> frame = host::GroundLink::Frame(SYNC_PATTERN, (uint8_t) CommandID::Echo,
+                                                       payload, sizeof(payload) - 1);
+  bench::Print(bench::Run("CommandProcessor::Tick (1 echo packet)", [&]() {
+    bt.Link().Inject(frame.data(), frame.size());
+    commands.Tick();
+  }));
+
+  bench::Print(bench::Run("CommandProcessor::Tick (idle)", [&]() {
+    commands.Tick();
+  }));
+
+  struct AttitudeData data;
+  Wire.ResetStats();
+  bench::Result read = bench::Run("BlueboyPeripherals::ReadOwnRaw", [&]() {
+    peripherals.ReadOwnRaw(&data);
+    bench::DoNotOptimize(data);
+  });
+  bench::Print(read);
+  printf("  %.1f i2c transactions, %.1f bytes read per call\n",
+         (double) Wire.Stats().transactions / (read.iterations + 100),
+         (double) Wire.Stats().bytesRead / (read.iterations + 100));
+
+  struct AttitudeData counts;
+  Wire.ResetStats();
+  bench::Result readCounts = bench::Run("BlueboyPeripherals::ReadOwnCounts", [&]() {
+    peripherals.ReadOwnCounts(&counts);
+    bench::DoNotOptimize(counts);
+  });
+  bench::Print(readCounts);
+  printf("  %.1f i2c transactions, %.1f bytes read per call\n",
+         (double) Wire.Stats().transactions / (readCounts.iterations + 100),
+         (double) Wire.Stats().bytesRead / (readCounts.iterations + 100));
+
+  bench::Print(bench::Run("BlueboyTelemetry::SendAttitude (raw)", [&]() {
+    telemetry.SendAttitude(Device::Own, AttitudeMode::Raw, data, micros());
+  }));
+
+  bench::Print(bench::Run("BlueboyTelemetry::SendAttitude (counts)", [&]() {
+    telemetry.SendAttitude(Device::Own, AttitudeMode::Counts, counts, micros());
+  }));
+
+  // a zero period makes every tick read and send
+  telemetry.SetLogPeriod(Device::Own, 0);
+  telemetry.BeginLogging(Device::Own, AttitudeMode::Raw);
+  bench::Print(bench::Run("BlueboyTelemetry::Tick (own raw, every tick)", [&]() {
+    telemetry.Tick();
+  }));
+  telemetry.EndLogging(Device::Own);
+
+  bench::Print(bench::Run("BlueboyTelemetry::Tick (idle)", [&]() {
+    telemetry.Tick();
+  }));
+
+  printf("dispatched %u echo commands\n", dispatched);
+  return 0;
+}
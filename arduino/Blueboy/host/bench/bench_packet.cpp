@@ -0,0 +1,79 @@
+/*!
+ * @file bench_packet.cpp
+ * @author Sebastian S.
+ * @brief Compares ways of building a raw attitude packet in PacketSender.
+ *
+ * The byte-at-a-time path reproduces the original AddBuf, which called AddByte once per byte, so the
+ * comparison stays meaningful after AddBuf itself moved to memcpy.
+ */
+
+#include <Arduino.h>
+
+#include "Bench.h"
+#include "../../src/Blueboy.h"
+#include "../../src/util/PacketSender.h"
+
+// the original AddFloat: four out-of-line AddByte calls
+static void addFloatBytewise(PacketSender& sender, float value) {
+  const char *bytes = (const char *) &value;
+  for (unsigned i = 0; i < sizeof(float); i++) {
+    sender.AddByte(bytes[i]);
+  }
+}
+
+int main() {
+  char buf[PacketSender::BufferSize];
+  PacketSender sender(buf, SYNC_PATTERN);
+
+  struct AttitudeData data;
+  float values[9] = { 18.1, -0.4, -50.2, 0.01, -0.02, 9.81, 0.001, -0.002, 0.003 };
+  memcpy(&data.raw.magnetic, &values[0], 3 * sizeof(float));
+  memcpy(&data.raw.acceleration, &values[3], 3 * sizeof(float));
+  memcpy(&data.raw.gyro, &values[6], 3 * sizeof(float));
+
+  char reference[PacketSender::BufferSize];
+
+  printf("== building one raw attitude packet (36 data bytes) ==\n");
+
+  bench::Print(bench::Run("AddByte per byte (original path)", [&]() {
+    sender.Begin(0x10);
+    const struct Vector *vectors[3] = { &data.raw.magnetic, &data.raw.acceleration, &data.raw.gyro };
+    for (int v = 0; v < 3; v++) {
+      addFloatBytewise(sender, vectors[v]->x);
+      addFloatBytewise(sender, vectors[v]->y);
+      addFloatBytewise(sender, vectors[v]->z);
+    }
+    bench::DoNotOptimize(buf);
+  }));
+  memcpy(reference, buf, sizeof(buf));
+
+  bench::Print(bench::Run("AddFloat x9", [&]() {
+    sender.Begin(0x10);
+    sender.AddFloat(data.raw.magnetic.x);
+    sender.AddFloat(data.raw.magnetic.y);
+    sender.AddFloat(data.raw.magnetic.z);
+    sender.AddFloat(data.raw.acceleration.x);
+    sender.AddFloat(data.raw.acceleration.y);
+    sender.AddFloat(data.raw.acceleration.z);
+    sender.AddFloat(data.raw.gyro.x);
+    sender.AddFloat(data.raw.gyro.y);
+    sender.AddFloat(data.raw.gyro.z);
+    bench::DoNotOptimize(buf);
+  }));
+  bool floatsMatch = memcmp(reference, buf, PacketSender::HeaderSize + sizeof(RawAttitudePayload)) == 0;
+
+  bench::Print(bench::Run("Add<RawAttitudePayload>", [&]() {
+    sender.Begin(0x10);
+    struct RawAttitudePayload raw;
+    memcpy(raw.magnetic, &data.raw.magnetic, sizeof(raw.magnetic));
+    memcpy(raw.acceleration, &data.raw.acceleration, sizeof(raw.acceleration));
+    memcpy(raw.gyro, &data.raw.gyro, sizeof(raw.gyro));
+    sender.Add(raw);
+    bench::DoNotOptimize(buf);
+  }));
+  bool structMatches = memcmp(reference, buf, PacketSender::HeaderSize + sizeof(RawAttitudePayload)) == 0;
+
+  printf("payloads identical to original path: AddFloat %s, Add<T> %s\n", floatsMatch ? "yes" : "NO",
+         structMatches ? "yes" : "NO");
+  return floatsMatch && structMatches ? 0 : 1;
+}
@@ -0,0 +1,373 @@
+/*!
+ * @file bench_receiver.cpp
+ * @author Sebastian S.
+ * @brief Throughput of PacketReceiver over recorded command traffic and over the same traffic buried in noise,
+ *        and how many commands it recovers from traffic with corrupt lengths.
+ *
+ * LegacyReceiver reproduces the original byte-at-a-time receiver, which shifted every byte through a 32-bit
+ * pattern while syncing, so the comparison stays meaningful after PacketReceiver itself changed. It is kept
+ * out of line like the library code it stands in for.
+ */
+
+#include <Arduino.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "Bench.h"
+#include "../GroundLink.h"
+#include "../../src/Blueboy.h"
+#include "../../src/util/PacketReceiver.h"
+
+class LegacyReceiver {
+ public:
+  LegacyReceiver(char *buf, uint32_t sync) : _dataBuf(buf), _sync(sync), _pattern(0), _plen(0), _id(0),
+                                             _toRead(0), _offset(0), _mode(Syncing) { }
+
+  void Begin() {
+    _offset = 0;
+    _plen = 0;
+    _id = 0;
+    _mode = Syncing;
+  }
+
+  __attribute__((noinline)) bool AddByte(uint8_t readbyte) {
+    if (_toRead == 0 && _mode != Syncing) {
+      return false;
+    }
+    switch (_mode) {
+      case Syncing:
+        _pattern = ((uint32_t) readbyte << 24) | (_pattern >> 8);
+        if (_pattern == _sync) {
+          _mode = Length;
+          _toRead = sizeof(_plen);
+        }
+        break;
+      case Length:
+        _plen = ((uint16_t) readbyte << 8) | (_plen >> 8);
+        _toRead--;
+        if (_toRead == 0) {
+          if (_plen == 0) {
+            _mode = Syncing;
+          } else {
+            _toRead = _plen;
+            _mode = ID;
+          }
+        }
+        break;
+      case ID:
+        _id = readbyte;
+        _toRead--;
+        if (_toRead == 0) {
+          return true;
+        }
+        _mode = Data;
+        break;
+      case Data:
+        _dataBuf[_offset++] = readbyte;
+        _toRead--;
+        if (_toRead == 0) {
+          return true;
+        }
+        break;
+    }
+    return false;
+  }
+
+  uint8_t GetPacketID() { return _id; }
+  uint16_t GetPacketDataLength() { return _plen - sizeof(_id); }
+ private:
+  enum ReadMode { Syncing, Length, ID, Data };
+  char *_dataBuf;
+  uint32_t _sync;
+  uint32_t _pattern;
+  uint16_t _plen;
+  uint8_t _id;
+  uint16_t _toRead;
+  uint16_t _offset;
+  ReadMode _mode;
+};
+
+/*!
+ * @struct Tally
+ * @brief What a receiver recognized in one pass over a stream, to check the receivers agree.
+ */
+struct Tally {
+  uint32_t packets;
+  uint32_t checksum;
+
+  void Add(uint8_t id, uint16_t len, const char *data) {
+    packets++;
+    checksum = checksum * 31 + id;
+    checksum = checksum * 31 + len;
+    for (uint16_t i = 0; i < len; i++) {
+      checksum = checksum * 31 + (uint8_t) data[i];
+    }
+  }
+
+  bool operator==(const Tally& other) const { return packets == other.packets && checksum == other.checksum; }
+};
+
+// a ground session's worth of commands, framed as the COSMOS interface sends them
+static std::vector<uint8_t> recordedStream(size_t minBytes) {
+  const char message[] = "see how the brain plays around";
+  const uint8_t beginOwn[] = { 20, 0, 0, 3 };
+  const uint8_t beginTest[] = { 100, 0, 1, 1 };
+
+  std::vector<std::vector<uint8_t>> session;
+  session.push_back(host::GroundLink::Frame(SYNC_PATTERN, (uint8_t) CommandID::Echo, message, sizeof(message) - 1));
+  session.push_back(host::GroundLink::Frame(SYNC_PATTERN, (uint8_t) CommandID::Echo, nullptr, 0));
+  session.push_back(host::GroundLink::Frame(SYNC_PATTERN, (uint8_t) CommandID::BeginOwnAttitude, beginOwn,
+                                            sizeof(beginOwn)));
+  session.push_back(host::GroundLink::Frame(SYNC_PATTERN, (uint8_t) CommandID::BeginTestAttitude, beginTest,
+                                            sizeof(beginTest)));
+  session.push_back(host::GroundLink::Frame(SYNC_PATTERN, (uint8_t) CommandID::EndOwnAttitude, nullptr, 0));
+  session.push_back(host::GroundLink::Frame(SYNC_PATTERN, (uint8_t) CommandID::EndTestAttitude, nullptr, 0));
+  session.push_back(host::GroundLink::Frame(SYNC_PATTERN, (uint8_t) CommandID::BeginCalibGyro, nullptr, 0));
+  session.push_back(host::GroundLink::Frame(SYNC_PATTERN, (uint8_t) CommandID::EndCalibGyro, nullptr, 0));
+
+  std::vector<uint8_t> stream;
+  while (stream.size() < minBytes) {
+    for (const std::vector<uint8_t>& frame : session) {
+      stream.insert(stream.end(), frame.begin(), frame.end());
+    }
+  }
+  return stream;
+}
+
+// the recorded stream with runs of line noise between frames, including stray partial sync patterns
+static std::vector<uint8_t> noisyStream(size_t minBytes) {
+  std::vector<uint8_t> recorded = recordedStream(minBytes / 4);
+  std::mt19937 rng(0xB1EB0);
+  std::uniform_int_distribution<int> gap(0, 96);
+  std::uniform_int_distribution<int> byte(0, 255);
+  std::uniform_int_distribution<int> partial(1, 3);
+
+  uint8_t sync[4];
+  memcpy(sync, &SYNC_PATTERN, sizeof(sync));
+
+  std::vector<uint8_t> stream;
+  size_t i = 0;
+  while (i < recorded.size()) {
+    // noise, sometimes ending in the start of a sync pattern that never completes
+    int noise = gap(rng);
+    for (int n = 0; n < noise; n++) {
+      uint8_t b = byte(rng);
+      stream.push_back(b == sync[0] ? 0 : b);   // no accidental sync patterns
+    }
+    if (noise % 4 == 0) {
+      stream.insert(stream.end(), sync, sync + partial(rng));
+    }
+
+    // the next whole frame: sync, length, then the rest
+    uint16_t plen;
+    memcpy(&plen, &recorded[i + 4], sizeof(plen));
+    size_t frameLen = 4 + 2 + plen;
+    stream.insert(stream.end(), recorded.begin() + i, recorded.begin() + i + frameLen);
+    i += frameLen;
+  }
+  return stream;
+}
+
+static void runStream(const char *label, const std::vector<uint8_t>& stream) {
+  char buf[64];
+  char name[64];
+  printf("== %s: %zu bytes ==\n", label, stream.size());
+
+  Tally legacyTally = { 0, 0 };
+  LegacyReceiver legacy(buf, SYNC_PATTERN);
+  legacy.Begin();
+  bench::Result legacyResult = bench::Run("original AddByte per byte", [&]() {
+    legacyTally = { 0, 0 };
+    for (size_t i = 0; i < stream.size(); i++) {
+      if (legacy.AddByte(stream[i])) {
+        legacyTally.Add(legacy.GetPacketID(), legacy.GetPacketDataLength(), buf);
+        legacy.Begin();
+      }
+    }
+  });
+
+  Tally byteTally = { 0, 0 };
+  PacketReceiver receiver(buf, SYNC_PATTERN, sizeof(buf));
+  receiver.Begin();
+  bench::Result byteResult = bench::Run("AddByte per byte", [&]() {
+    byteTally = { 0, 0 };
+    for (size_t i = 0; i < stream.size(); i++) {
+      if (receiver.AddByte(stream[i])) {
+        byteTally.Add(receiver.GetPacketID(), receiver.GetPacketDataLength(), receiver.GetPacketData());
+        receiver.Begin();
+      }
+    }
+  });
+
+  printf("%-44s %12s %12s %12s\n", "", "ns/byte", "MB/s", "packets");
+  printf("%-44s %12.2f %12.1f %12u\n", legacyResult.name, legacyResult.nsPerOp / stream.size(),
+         stream.size() * 1e3 / legacyResult.nsPerOp, legacyTally.packets);
+  printf("%-44s %12.2f %12.1f %12u\n", byteResult.name, byteResult.nsPerOp / stream.size(),
+         stream.size() * 1e3 / byteResult.nsPerOp, byteTally.packets);
+
+  bool agree = legacyTally == byteTally;
+  const size_t chunks[] = { 16, 64, 0 };
+  for (size_t chunk : chunks) {
+    size_t step = chunk ? chunk : stream.size();
+    Tally chunkTally = { 0, 0 };
+    snprintf(name, sizeof(name), chunk ? "AddBytes, %zu-byte chunks" : "AddBytes, whole stream", chunk);
+    bench::Result result = bench::Run(name, [&]() {
+      chunkTally = { 0, 0 };
+      for (size_t start = 0; start < stream.size(); start += step) {
+        const uint8_t *next = stream.data() + start;
+        size_t len = min(step, stream.size() - start);
+        while (len > 0) {
+          size_t consumed = receiver.AddBytes(next, len);
+          next += consumed;
+          len -= consumed;
+          if (receiver.Completed()) {
+            chunkTally.Add(receiver.GetPacketID(), receiver.GetPacketDataLength(), receiver.GetPacketData());
+            receiver.Begin();
+          }
+        }
+      }
+    });
+    printf("%-44s %12.2f %12.1f %12u\n", result.name, result.nsPerOp / stream.size(),
+           stream.size() * 1e3 / result.nsPerOp, chunkTally.packets);
+    agree = agree && chunkTally == legacyTally;
+  }
+  printf("all receivers recognized the same packets: %s\n\n", agree ? "yes" : "NO");
+  if (!agree) {
+    exit(1);
+  }
+}
+
+// the recorded session split back into frames, each with one bit of its length flipped at the given odds
+static std::vector<std::vector<uint8_t>> corruptFrames(size_t minBytes, int oneIn, std::vector<bool> *intact) {
+  std::vector<uint8_t> recorded = recordedStream(minBytes);
+  std::mt19937 rng(0xC0FFEE);
+  std::uniform_int_distribution<int> odds(0, oneIn - 1);
+  std::uniform_int_distribution<int> bit(0, 15);
+
+  std::vector<std::vector<uint8_t>> frames;
+  size_t i = 0;
+  while (i < recorded.size()) {
+    uint16_t plen;
+    memcpy(&plen, &recorded[i + 4], sizeof(plen));
+    size_t frameLen = 4 + 2 + plen;
+    frames.emplace_back(recorded.begin() + i, recorded.begin() + i + frameLen);
+    i += frameLen;
+
+    bool corrupt = odds(rng) == 0;
+    if (corrupt) {
+      plen ^= 1 << bit(rng);
+      memcpy(&frames.back()[4], &plen, sizeof(plen));
+    }
+    intact->push_back(!corrupt);
+  }
+  return frames;
+}
+
+// packets matching the intact frames, in order
+static uint32_t recovered(const std::vector<std::vector<uint8_t>>& frames, const std::vector<bool>& intact,
+                          const std::vector<std::vector<uint8_t>>& packets) {
+  size_t next = 0;
+  uint32_t count = 0;
+  for (const std::vector<uint8_t>& packet : packets) {
+    while (next < frames.size() && !intact[next]) {
+      next++;
+    }
+    for (size_t k = next; k < frames.size(); k++) {
+      if (intact[k] && std::vector<uint8_t>(frames[k].begin() + 6, frames[k].end()) == packet) {
+        count++;
+        next = k + 1;
+        break;
+      }
+    }
+  }
+  return count;
+}
+
+// commands sent in bursts with idle gaps between them, one in every oneIn with a corrupt length
+static void runCorrupted(int oneIn, size_t burst) {
+  std::vector<bool> intact;
+  std::vector<std::vector<uint8_t>> frames = corruptFrames(1 << 14, oneIn, &intact);
+  uint32_t intactCount = 0;
+  for (bool ok : intact) {
+    intactCount += ok;
+  }
+  printf("== corrupt lengths, one frame in %d, bursts of %zu: %zu frames, %u intact ==\n", oneIn, burst,
+         frames.size(), intactCount);
+
+  // the original receiver never bounded its writes, so give it room for any length
+  static char legacyBuf[1 << 16];
+  LegacyReceiver legacy(legacyBuf, SYNC_PATTERN);
+  legacy.Begin();
+  std::vector<std::vector<uint8_t>> legacyPackets;
+  for (const std::vector<uint8_t>& frame : frames) {
+    for (uint8_t b : frame) {
+      if (legacy.AddByte(b)) {
+        size_t length = std::min(sizeof(legacyBuf), (size_t) legacy.GetPacketDataLength());
+        std::vector<uint8_t> packet(1 + length, legacy.GetPacketID());
+        std::copy(legacyBuf, legacyBuf + length, packet.begin() + 1);
+        legacyPackets.push_back(packet);
+        legacy.Begin();
+      }
+    }
+  }
+
+  // an idle gap is where CommandProcessor's receive timeout abandons a stalled frame
+  char buf[64];
+  PacketReceiver receiver(buf, SYNC_PATTERN, sizeof(buf));
+  receiver.Begin();
+  std::vector<std::vector<uint8_t>> packets;
+  for (size_t f = 0; f < frames.size(); f++) {
+    const uint8_t *next = frames[f].data();
+    size_t len = frames[f].size();
+    bool gap = (f + 1) % burst == 0;
+    while (len > 0 || receiver.Completed() || (gap && receiver.InProgress())) {
+      if (len == 0 && !receiver.Completed()) {
+        receiver.Abort();
+        continue;
+      }
+      size_t consumed = receiver.AddBytes(next, len);
+      next += consumed;
+      len -= consumed;
+      if (receiver.Completed()) {
+        std::vector<uint8_t> packet(1, receiver.GetPacketID());
+        const char *data = receiver.GetPacketData();
+        packet.insert(packet.end(), data, data + receiver.GetPacketDataLength());
+        packets.push_back(packet);
+        receiver.Begin();
+      }
+    }
+  }
+
+  uint32_t legacyRecovered = recovered(frames, intact, legacyPackets);
+  uint32_t newRecovered = recovered(frames, intact, packets);
+  const ReceiverStats& stats = receiver.Stats();
+  uint32_t delivered = 0;   // sync, length, ID and data of every packet
+  for (const std::vector<uint8_t>& packet : packets) {
+    delivered += 4 + 2 + packet.size();
+  }
+  printf("%-44s %12s %12s\n", "", "packets", "intact");
+  printf("%-44s %12zu %12u\n", "original receiver", legacyPackets.size(), legacyRecovered);
+  printf("%-44s %12zu %12u\n", "resynchronizing receiver", packets.size(), newRecovered);
+  printf("receiver stats: %u packets, %u bytes, %u dropped, %u sync losses, %u oversize lengths\n\n",
+         stats.packets, stats.bytes, stats.droppedBytes, stats.syncLosses, stats.oversizeLengths);
+  // without a checksum, an in-range corrupt length that runs out within a burst completes a packet holding
+  // the commands it swallowed; only a gap after every frame guarantees each intact command is recovered
+  if (stats.bytes != delivered + stats.droppedBytes) {
+    printf("dropped bytes don't account for the bytes in no packet\n");
+    exit(1);
+  }
+  if (newRecovered < legacyRecovered || (burst == 1 && newRecovered != intactCount)) {
+    printf("resynchronizing receiver lost intact commands\n");
+    exit(1);
+  }
+}
+
+int main() {
+  runStream("recorded command stream", recordedStream(1 << 16));
+  runStream("noisy command stream", noisyStream(1 << 16));
+  runCorrupted(8, 1);
+  runCorrupted(8, 4);
+  runCorrupted(2, 8);
+  return 0;
+}
@@ -0,0 +1,100 @@
+/*!
+ * @file bench_trig.cpp
+ * @author Sebastian S.
+ * @brief Measures FastTrig's worst error against double precision, and times it against the float library.
+ *
+ * Host cycles only rank the paths: the host's libm is far quicker than avr-libc's, so the speedup on the
+ * ATmega is larger than the one shown here.
+ */
+
+#include <Arduino.h>
+#include <math.h>
+
+#include "Bench.h"
+#include "../../src/Blueboy.h"
+#include "../../src/sensor/MadgwickFilter.h"
+#include "../../src/util/FastTrig.h"
+
+namespace {
+
+const int Inputs = 256;
+
+// worst error of fast against exact, over steps points from lo to hi
+template <class Fast, class Exact>
+double worstError(Fast fast, Exact exact, double lo, double hi, long steps) {
+  double worst = 0;
+  for (long i = 0; i <= steps; i++) {
+    double x = lo + (hi - lo) * i / steps;
+    worst = std::max(worst, fabs(fast((float)x) - exact((double)(float)x)));
+  }
+  return worst;
+}
+
+void report(const char *name, double worst) {
+  printf("%-36s worst error %.2e (%.5f degrees)\n", name, worst, worst * 180 / PI);
+}
+
+}  // namespace
+
+int main() {
+  printf("== worst error against double precision ==\n");
+
+  // every direction round the circle, at a few lengths
+  double atan2Worst = 0;
+  const long directions = 1000000;
+  for (long i = 0; i < directions; i++) {
+    double angle = -PI + TWO_PI * i / directions;
+    for (double length = 0.001; length < 2000; length *= 10) {
+      float y = (float)(sin(angle) * length), x = (float)(cos(angle) * length);
+      double error = fabs(FastAtan2(y, x) - atan2((double)y, (double)x));
+      atan2Worst = std::max(atan2Worst, std::min(error, TWO_PI - error));   // +-pi are the same direction
+    }
+  }
+  report("FastAtan2, all directions", atan2Worst);
+  report("FastAsin, -1 to 1", worstError(FastAsin, [](double x) { return asin(x); }, -1, 1, 2000000));
+  report("FastSin, -2 pi to 2 pi", worstError(FastSin, [](double x) { return sin(x); }, -TWO_PI, TWO_PI, 2000000));
+  report("FastCos, -2 pi to 2 pi", worstError(FastCos, [](double x) { return cos(x); }, -TWO_PI, TWO_PI, 2000000));
+
+  float xs[Inputs], ys[Inputs], sines[Inputs], angles[Inputs];
+  for (int i = 0; i < Inputs; i++) {
+    angles[i] = (float)(-PI + TWO_PI * i / Inputs);
+    ys[i] = sinf(angles[i]) * 40;
+    xs[i] = cosf(angles[i]) * 40;
+    sines[i] = sinf(angles[i] / 2);
+  }
+
+  int i = 0;
+  printf("== atan2 ==\n");
+  bench::Print(bench::Run("atan2f", [&]() { bench::DoNotOptimize(atan2f(ys[i], xs[i])); i = (i + 1) % Inputs; }));
+  bench::Print(bench::Run("FastAtan2", [&]() { bench::DoNotOptimize(FastAtan2(ys[i], xs[i])); i = (i + 1) % Inputs; }));
+
+  printf("== asin ==\n");
+  bench::Print(bench::Run("asinf", [&]() { bench::DoNotOptimize(asinf(sines[i])); i = (i + 1) % Inputs; }));
+  bench::Print(bench::Run("FastAsin", [&]() { bench::DoNotOptimize(FastAsin(sines[i])); i = (i + 1) % Inputs; }));
+
+  printf("== sin ==\n");
+  bench::Print(bench::Run("sinf", [&]() { bench::DoNotOptimize(sinf(angles[i])); i = (i + 1) % Inputs; }));
+  bench::Print(bench::Run("FastSin", [&]() { bench::DoNotOptimize(FastSin(angles[i])); i = (i + 1) % Inputs; }));
+
+  printf("== quaternion to Euler angles ==\n");
+  MadgwickFilter filter;
+  const float gyro[3] = { 0.4f, -0.3f, 0.5f };
+  const float none[3] = { 0, 0, 0 };
+  for (int j = 0; j < 50; j++) {
+    filter.Update(gyro, none, none, 0.1f);
+  }
+  struct Quaternion q;
+  filter.GetQuaternion(&q);
+  struct Vector euler;
+  bench::Print(bench::Run("atan2f and asinf", [&]() {
+    euler.roll = atan2f(q.w * q.x + q.y * q.z, 0.5f - q.x * q.x - q.y * q.y);
+    euler.pitch = asinf(2 * (q.w * q.y - q.x * q.z));
+    euler.heading = atan2f(q.x * q.y + q.w * q.z, 0.5f - q.y * q.y - q.z * q.z);
+    bench::DoNotOptimize(euler);
+  }));
+  bench::Print(bench::Run("MadgwickFilter::GetEuler", [&]() {
+    filter.GetEuler(&euler);
+    bench::DoNotOptimize(euler);
+  }));
+  return 0;
+}
@@ -0,0 +1,248 @@
+/*!
+ * @file main.cpp
+ * @author Sebastian S.
+ * @brief Host runner for the Blueboy sketch: runs setup() and loop() against simulated peripherals on a
+ *        virtual clock and reports what went over the link.
+ *
+ * Periods are in milliseconds and may be fractional; they're commanded in microseconds.
+ *
+ * Usage: blueboy_host [--seconds S] [--own PERIOD_MS] [--test PERIOD_MS] [--mode M] [--batch N] [--loop-us US]
+ *                     [--echo] [--fifo | --drdy]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stddef.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+
+#include <Arduino.h>
+#include <AltSoftSerial.h>
+#include <Wire.h>
+
+#include "GroundLink.h"
+#include "sim/SimBoard.h"
+#include "../src/Blueboy.h"
+#include "../src/BlueboyTelemetry.h"
+
+extern AltSoftSerial bt;
+extern BlueboyTelemetry telemetry;
+void setup();
+void loop();
+
+static bool resetRequested = false;
+
+static void onReset() {
+  resetRequested = true;
+}
+
+static void beginLog(host::GroundLink& ground, uint8_t cmd, double periodMs, uint8_t mode, uint8_t batch,
+                     Acquisition acquisition) {
+  uint16_t period = (uint16_t) periodMs;
+  uint32_t periodUs = (uint32_t) (periodMs * 1000 + 0.5);
+  uint8_t data[9] = { (uint8_t) (period & 0xFF), (uint8_t) (period >> 8), mode, batch,
+                      (uint8_t) periodUs, (uint8_t) (periodUs >> 8), (uint8_t) (periodUs >> 16),
+                      (uint8_t) (periodUs >> 24), (uint8_t) acquisition };
+  ground.SendCommand(cmd, data, sizeof(data));
+}
+
+// attitude samples carried by a packet: the count leading a batched packet, one for a single sample,
+// none for a counts scale or correction descriptor
+static uint32_t attitudeSamples(const host::TelemetryPacket& packet) {
+  if (packet.id < 0x10 || packet.id >= 0x30 || (packet.id & 0x0F) == 0x06 || (packet.id & 0x0F) == 0x07) {
+    return 0;
+  }
+  if ((packet.id & ATTITUDE_BATCH_BIT) && !packet.data.empty()) {
+    return packet.data[0];
+  }
+  return 1;
+}
+
+// time the first attitude sample in a packet was taken: the batch header's, or the one trailing a single sample
+static uint32_t attitudeTimestamp(const host::TelemetryPacket& packet) {
+  uint32_t timestamp;
+  if (packet.id & ATTITUDE_BATCH_BIT) {
+    memcpy(&timestamp, &packet.data[offsetof(AttitudeBatchHeader, timestamp)], sizeof(timestamp));
+  } else {
+    memcpy(&timestamp, &packet.data[packet.data.size() - sizeof(timestamp)], sizeof(timestamp));
+  }
+  return timestamp;
+}
+
+/*
+ * Intervals between one device's samples, from the timestamps on its packets. A batch only carries the time of
+ * its first sample, so the interval up to the next packet is spread evenly over the samples in the batch.
+ */
+struct SampleIntervals {
+  bool started = false;
+  uint32_t last = 0;
+  uint32_t lastCount = 0;
+  uint32_t intervals = 0;
+  double sum = 0;
+  double sumSquares = 0;
+  uint32_t shortest = UINT32_MAX;
+  uint32_t longest = 0;
+
+  void Add(uint32_t timestamp, uint32_t count) {
+    if (started) {
+      uint32_t interval = (timestamp - last) / lastCount;
+      intervals++;
+      sum += interval;
+      sumSquares += (double) interval * interval;
+      shortest = std::min(shortest, interval);
+      longest = std::max(longest, interval);
+    }
+    started = true;
+    last = timestamp;
+    lastCount = count;
+  }
+};
+
+int main(int argc, char **argv) {
+  double seconds = 10.0;
+  double ownPeriod = -1;
+  double testPeriod = -1;
+  int mode = 0;
+  int batch = 1;
+  unsigned long loopUs = 50;   // virtual cost of one loop() beyond the time it spends blocked
+  bool echo = false;
+  Acquisition acquisition = Acquisition::Deadline;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--seconds") && i + 1 < argc) {
+      seconds = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "--own") && i + 1 < argc) {
+      ownPeriod = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "--test") && i + 1 < argc) {
+      testPeriod = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "--mode") && i + 1 < argc) {
+      mode = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--batch") && i + 1 < argc) {
+      batch = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--loop-us") && i + 1 < argc) {
+      loopUs = strtoul(argv[++i], nullptr, 10);
+    } else if (!strcmp(argv[i], "--echo")) {
+      echo = true;
+    } else if (!strcmp(argv[i], "--fifo")) {
+      acquisition = Acquisition::Fifo;
+    } else if (!strcmp(argv[i], "--drdy")) {
+      acquisition = Acquisition::DataReady;
+    } else {
+      fprintf(stderr, "usage: %s [--seconds S] [--own PERIOD_MS] [--test PERIOD_MS] [--mode M] [--batch N] "
+                      "[--loop-us US] [--echo] [--fifo | --drdy]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  host::SimBoard board;
+  board.Attach(Wire);
+  host::SetConsoleEcho(echo);
+  host::OnPinLow(4, &onReset);
+
+  host::GroundLink ground(bt.Link(), SYNC_PATTERN);
+
+  std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+  setup();
+
+  if (ownPeriod >= 0) {
+    beginLog(ground, (uint8_t) CommandID::BeginOwnAttitude, ownPeriod, mode, batch, acquisition);
+  }
+  if (testPeriod >= 0) {
+    beginLog(ground, (uint8_t) CommandID::BeginTestAttitude, testPeriod, mode, batch, acquisition);
+  }
+
+  std::map<uint8_t, uint32_t> packets;
+  std::map<uint8_t, uint32_t> samples;
+  std::map<uint8_t, SampleIntervals> intervals;   // by device
+  struct StatusPayload status;
+  uint32_t statuses = 0;
+  uint32_t worstReported = 0;
+  std::vector<host::TelemetryPacket> received;
+  auto countPacket = [&](const host::TelemetryPacket& packet) {
+    uint32_t count = attitudeSamples(packet);
+    packets[packet.id]++;
+    samples[packet.id] += count;
+    if (count > 0) {
+      intervals[packet.id >> 4].Add(attitudeTimestamp(packet), count);
+    }
+    if (packet.id == (uint8_t) TelemetryID::Status && packet.data.size() == sizeof(status)) {
+      memcpy(&status, packet.data.data(), sizeof(status));
+      worstReported = std::max(worstReported, status.worstLoop);
+      statuses++;
+    }
+  };
+  uint64_t loops = 0;
+  uint64_t worstLoop = 0;
+  uint64_t start = host::Clock::Now();
+  uint64_t end = start + (uint64_t) (seconds * 1e6);
+  Wire.ResetStats();
+
+  while (host::Clock::Now() < end && !resetRequested) {
+    uint64_t before = host::Clock::Now();
+    loop();
+    host::Clock::Advance(loopUs);
+    uint64_t took = host::Clock::Now() - before;
+    if (took > worstLoop) {
+      worstLoop = took;
+    }
+    loops++;
+
+    if ((loops & 0xFF) == 0) {
+      received.clear();
+      ground.Poll(&received);
+      for (const host::TelemetryPacket& packet : received) {
+        countPacket(packet);
+      }
+    }
+  }
+  received.clear();
+  ground.Poll(&received);
+  for (const host::TelemetryPacket& packet : received) {
+    countPacket(packet);
+  }
+
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+  double simulated = host::Clock::Now() / 1e6;
+  double logged = (host::Clock::Now() - start) / 1e6;
+  const host::I2CStats& i2c = Wire.Stats();
+
+  printf("simulated %.3f s in %.3f s of wall time (%.0fx real time)%s\n", simulated, wall,
+         wall > 0 ? simulated / wall : 0.0, resetRequested ? ", stopped by reset" : "");
+  printf("loop(): %llu iterations, %.0f per second, worst %llu us\n", (unsigned long long) loops,
+         loops / logged, (unsigned long long) worstLoop);
+  printf("link: %llu bytes sent, %.1f ms blocked on a full transmit buffer\n",
+         (unsigned long long) bt.Link().BytesWritten(), bt.Link().BlockedMicros() / 1000.0);
+  printf("console: %llu bytes sent, %.1f ms blocked on a full transmit buffer\n",
+         (unsigned long long) host::Console().BytesWritten(), host::Console().BlockedMicros() / 1000.0);
+  printf("i2c: %u transactions, %u bytes written, %u bytes read, %.1f ms bus time, %u nacks\n",
+         i2c.transactions, i2c.bytesWritten, i2c.bytesRead, i2c.busMicros / 1000.0, i2c.nacks);
+  for (const std::pair<const uint8_t, uint32_t>& entry : packets) {
+    printf("telemetry 0x%02X: %u packets (%.1f per second)", entry.first, entry.second, entry.second / logged);
+    if (samples[entry.first] > 0) {
+      printf(", %u samples (%.1f per second)", samples[entry.first], samples[entry.first] / logged);
+    }
+    printf("\n");
+  }
+  if (statuses > 0) {
+    printf("last status: %u loops/s, worst loop %u us (%u us worst reported), %u us reading sensors, "
+           "tx backlog %u bytes, %u samples queued, %u missed, %u dropped, %u sync losses, %u oversize\n",
+           status.loopsPerSecond, status.worstLoop, worstReported, status.readTime, status.txBacklog,
+           status.sampleQueue, status.missedSamples, status.droppedBytes, status.syncLosses,
+           status.oversizeLengths);
+  }
+  for (const std::pair<const uint8_t, SampleIntervals>& entry : intervals) {
+    const SampleIntervals& device = entry.second;
+    if (device.intervals == 0) {
+      continue;
+    }
+    double mean = device.sum / device.intervals;
+    double deviation = sqrt(std::max(0.0, device.sumSquares / device.intervals - mean * mean));
+    printf("device %u sample interval: granted %lu us, mean %.1f us, deviation %.1f us, shortest %u us, "
+           "longest %u us, %u missed\n", entry.first, telemetry.LogPeriod((Device) entry.first), mean, deviation,
+           device.shortest, device.longest, telemetry.MissedSamples((Device) entry.first));
+  }
+  return 0;
+}
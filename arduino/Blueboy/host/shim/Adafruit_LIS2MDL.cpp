@@ -0,0 +1,107 @@
+/*!
+ * @file Adafruit_LIS2MDL.cpp
+ * @author Sebastian S.
+ * @brief Implementation of Adafruit_LIS2MDL.h
+ */
+
+#include "Adafruit_LIS2MDL.h"
+
+static constexpr uint8_t LIS2MDL_WHO_AM_I = 0x4F;
+static constexpr uint8_t LIS2MDL_CFG_REG_A = 0x60;
+static constexpr uint8_t LIS2MDL_CFG_REG_C = 0x62;
+static constexpr uint8_t LIS2MDL_OUTX_L_REG = 0x68;
+
+uint8_t Adafruit_LIS2MDL::readRegister(uint8_t reg) {
+  _wire->beginTransmission(_addr);
+  _wire->write(reg);
+  if (_wire->endTransmission(false) != 0) {
+    return 0;
+  }
+  if (_wire->requestFrom(_addr, (uint8_t) 1) != 1) {
+    return 0;
+  }
+  return _wire->read();
+}
+
+void Adafruit_LIS2MDL::writeRegister(uint8_t reg, uint8_t value) {
+  _wire->beginTransmission(_addr);
+  _wire->write(reg);
+  _wire->write(value);
+  _wire->endTransmission();
+}
+
+bool Adafruit_LIS2MDL::begin(uint8_t i2c_addr, TwoWire *wire) {
+  _wire = wire;
+  _addr = i2c_addr;
+
+  if (readRegister(LIS2MDL_WHO_AM_I) != _CHIP_ID) {
+    return false;
+  }
+
+  reset();
+  return true;
+}
+
+void Adafruit_LIS2MDL::reset() {
+  // soft reset and reboot, then continuous mode at 100 Hz with block data update
+  writeRegister(LIS2MDL_CFG_REG_A, 0x60);
+  delay(100);
+  writeRegister(LIS2MDL_CFG_REG_A, 0x00);
+  setDataRate(LIS2MDL_RATE_100_HZ);
+  writeRegister(LIS2MDL_CFG_REG_C, readRegister(LIS2MDL_CFG_REG_C) | 0x10);
+}
+
+lis2mdl_rate_t Adafruit_LIS2MDL::getDataRate() {
+  return (lis2mdl_rate_t) ((readRegister(LIS2MDL_CFG_REG_A) >> 2) & 0x03);
+}
+
+void Adafruit_LIS2MDL::setDataRate(lis2mdl_rate_t rate) {
+  uint8_t ctrl = readRegister(LIS2MDL_CFG_REG_A);
+  writeRegister(LIS2MDL_CFG_REG_A, (ctrl & ~0x0C) | (rate << 2));
+}
+
+bool Adafruit_LIS2MDL::read() {
+  uint8_t buffer[6];
+
+  _wire->beginTransmission(_addr);
+  _wire->write(LIS2MDL_OUTX_L_REG);
+  if (_wire->endTransmission(false) != 0) {
+    return false;
+  }
+  if (_wire->requestFrom(_addr, (uint8_t) sizeof(buffer)) != sizeof(buffer)) {
+    return false;
+  }
+  for (uint8_t i = 0; i < sizeof(buffer); i++) {
+    buffer[i] = _wire->read();
+  }
+
+  raw[0] = buffer[1] << 8 | buffer[0];
+  raw[1] = buffer[3] << 8 | buffer[2];
+  raw[2] = buffer[5] << 8 | buffer[4];
+  return true;
+}
+
+bool Adafruit_LIS2MDL::getEvent(sensors_event_t *event) {
+  memset(event, 0, sizeof(sensors_event_t));
+
+  if (!read()) {
+    return false;
+  }
+
+  event->version = sizeof(sensors_event_t);
+  event->sensor_id = _sensorID;
+  event->type = SENSOR_TYPE_MAGNETIC_FIELD;
+  event->timestamp = millis();
+  event->magnetic.x = raw[0] * LIS2MDL_MAG_LSB * LIS2MDL_MILLIGAUSS_TO_MICROTESLA;
+  event->magnetic.y = raw[1] * LIS2MDL_MAG_LSB * LIS2MDL_MILLIGAUSS_TO_MICROTESLA;
+  event->magnetic.z = raw[2] * LIS2MDL_MAG_LSB * LIS2MDL_MILLIGAUSS_TO_MICROTESLA;
+  return true;
+}
+
+void Adafruit_LIS2MDL::getSensor(sensor_t *sensor) {
+  memset(sensor, 0, sizeof(sensor_t));
+  strncpy(sensor->name, "LIS2MDL", sizeof(sensor->name) - 1);
+  sensor->version = 1;
+  sensor->sensor_id = _sensorID;
+  sensor->type = SENSOR_TYPE_MAGNETIC_FIELD;
+}
@@ -0,0 +1,56 @@
+/*!
+ * @file Adafruit_LIS2MDL.h
+ * @author Sebastian S.
+ * @brief Host stand-in for the Adafruit LIS2MDL driver.
+ *
+ * Mirrors the I2C traffic of the real library: one 6-byte burst read per getEvent().
+ */
+
+#ifndef HOST_ADAFRUIT_LIS2MDL_H_
+#define HOST_ADAFRUIT_LIS2MDL_H_
+
+#include <Wire.h>
+#include <Adafruit_Sensor.h>
+
+#define LIS2MDL_I2CADDR_DEFAULT (0x1E)
+#define _CHIP_ID (0x40)
+#define LIS2MDL_MAG_LSB (1.5)
+#define LIS2MDL_MILLIGAUSS_TO_MICROTESLA (0.1)
+
+typedef enum {
+  LIS2MDL_RATE_10_HZ,
+  LIS2MDL_RATE_20_HZ,
+  LIS2MDL_RATE_50_HZ,
+  LIS2MDL_RATE_100_HZ,
+} lis2mdl_rate_t;
+
+/*!
+ * @class Adafruit_LIS2MDL
+ * @brief LIS2MDL 3-axis magnetometer.
+ */
+class Adafruit_LIS2MDL : public Adafruit_Sensor {
+ public:
+  Adafruit_LIS2MDL(int32_t sensorID = -1) : _wire(&Wire), _addr(LIS2MDL_I2CADDR_DEFAULT), _sensorID(sensorID) { }
+
+  bool begin(uint8_t i2c_addr = LIS2MDL_I2CADDR_DEFAULT, TwoWire *wire = &Wire);
+  bool begin_I2C(uint8_t i2c_addr = LIS2MDL_I2CADDR_DEFAULT, TwoWire *wire = &Wire) { return begin(i2c_addr, wire); }
+  void reset();
+
+  lis2mdl_rate_t getDataRate();
+  void setDataRate(lis2mdl_rate_t rate);
+
+  bool getEvent(sensors_event_t *event) override;
+  void getSensor(sensor_t *sensor) override;
+
+  int16_t raw[3];
+ private:
+  TwoWire *_wire;
+  uint8_t _addr;
+  int32_t _sensorID;
+
+  bool read();
+  uint8_t readRegister(uint8_t reg);
+  void writeRegister(uint8_t reg, uint8_t value);
+};
+
+#endif
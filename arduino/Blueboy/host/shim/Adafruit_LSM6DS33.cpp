@@ -0,0 +1,214 @@
+/*!
+ * @file Adafruit_LSM6DS33.cpp
+ * @author Sebastian S.
+ * @brief Implementation of Adafruit_LSM6DS33.h
+ */
+
+#include "Adafruit_LSM6DS33.h"
+
+static constexpr uint8_t LSM6DS_WHOAMI = 0x0F;
+static constexpr uint8_t LSM6DS_CTRL1_XL = 0x10;
+static constexpr uint8_t LSM6DS_CTRL2_G = 0x11;
+static constexpr uint8_t LSM6DS_CTRL3_C = 0x12;
+static constexpr uint8_t LSM6DS_OUT_TEMP_L = 0x20;
+
+Adafruit_LSM6DS33::Adafruit_LSM6DS33() : _wire(&Wire), _addr(LSM6DS_I2CADDR_DEFAULT), _sensorID(0),
+                                         _accelScale(0.122), _gyroScale(70.0),
+                                         _temp(this, SENSOR_TYPE_AMBIENT_TEMPERATURE),
+                                         _accel(this, SENSOR_TYPE_ACCELEROMETER),
+                                         _gyro(this, SENSOR_TYPE_GYROSCOPE) { }
+
+Adafruit_LSM6DS33::Adafruit_LSM6DS33(const Adafruit_LSM6DS33& other) : Adafruit_LSM6DS33() {
+  _wire = other._wire;
+  _addr = other._addr;
+  _sensorID = other._sensorID;
+  _accelScale = other._accelScale;
+  _gyroScale = other._gyroScale;
+}
+
+uint8_t Adafruit_LSM6DS33::readRegister(uint8_t reg) {
+  _wire->beginTransmission(_addr);
+  _wire->write(reg);
+  if (_wire->endTransmission(false) != 0) {
+    return 0;
+  }
+  if (_wire->requestFrom(_addr, (uint8_t) 1) != 1) {
+    return 0;
+  }
+  return _wire->read();
+}
+
+void Adafruit_LSM6DS33::writeRegister(uint8_t reg, uint8_t value) {
+  _wire->beginTransmission(_addr);
+  _wire->write(reg);
+  _wire->write(value);
+  _wire->endTransmission();
+}
+
+bool Adafruit_LSM6DS33::begin_I2C(uint8_t i2c_addr, TwoWire *wire, int32_t sensorID) {
+  _wire = wire;
+  _addr = i2c_addr;
+  _sensorID = sensorID;
+
+  if (readRegister(LSM6DS_WHOAMI) != LSM6DS33_CHIP_ID) {
+    return false;
+  }
+
+  reset();
+
+  // block data update and register auto-increment
+  writeRegister(LSM6DS_CTRL3_C, 0x44);
+
+  setAccelDataRate(LSM6DS_RATE_104_HZ);
+  setAccelRange(LSM6DS_ACCEL_RANGE_4_G);
+  setGyroDataRate(LSM6DS_RATE_104_HZ);
+  setGyroRange(LSM6DS_GYRO_RANGE_2000_DPS);
+
+  delay(10);
+  return true;
+}
+
+void Adafruit_LSM6DS33::reset() {
+  writeRegister(LSM6DS_CTRL3_C, 0x01);
+  delay(1);
+}
+
+lsm6ds_data_rate_t Adafruit_LSM6DS33::getAccelDataRate() {
+  return (lsm6ds_data_rate_t) (readRegister(LSM6DS_CTRL1_XL) >> 4);
+}
+
+void Adafruit_LSM6DS33::setAccelDataRate(lsm6ds_data_rate_t data_rate) {
+  uint8_t ctrl = readRegister(LSM6DS_CTRL1_XL);
+  writeRegister(LSM6DS_CTRL1_XL, (ctrl & 0x0F) | (data_rate << 4));
+}
+
+lsm6ds_accel_range_t Adafruit_LSM6DS33::getAccelRange() {
+  return (lsm6ds_accel_range_t) ((readRegister(LSM6DS_CTRL1_XL) >> 2) & 0x03);
+}
+
+void Adafruit_LSM6DS33::setAccelRange(lsm6ds_accel_range_t new_range) {
+  uint8_t ctrl = readRegister(LSM6DS_CTRL1_XL);
+  writeRegister(LSM6DS_CTRL1_XL, (ctrl & ~0x0C) | (new_range << 2));
+
+  switch (new_range) {
+    case LSM6DS_ACCEL_RANGE_2_G:  _accelScale = 0.061; break;
+    case LSM6DS_ACCEL_RANGE_4_G:  _accelScale = 0.122; break;
+    case LSM6DS_ACCEL_RANGE_8_G:  _accelScale = 0.244; break;
+    case LSM6DS_ACCEL_RANGE_16_G: _accelScale = 0.488; break;
+  }
+}
+
+lsm6ds_data_rate_t Adafruit_LSM6DS33::getGyroDataRate() {
+  return (lsm6ds_data_rate_t) (readRegister(LSM6DS_CTRL2_G) >> 4);
+}
+
+void Adafruit_LSM6DS33::setGyroDataRate(lsm6ds_data_rate_t data_rate) {
+  uint8_t ctrl = readRegister(LSM6DS_CTRL2_G);
+  writeRegister(LSM6DS_CTRL2_G, (ctrl & 0x0F) | (data_rate << 4));
+}
+
+lsm6ds_gyro_range_t Adafruit_LSM6DS33::getGyroRange() {
+  return (lsm6ds_gyro_range_t) (readRegister(LSM6DS_CTRL2_G) & 0x0E);
+}
+
+void Adafruit_LSM6DS33::setGyroRange(lsm6ds_gyro_range_t new_range) {
+  uint8_t ctrl = readRegister(LSM6DS_CTRL2_G);
+  writeRegister(LSM6DS_CTRL2_G, (ctrl & ~0x0E) | new_range);
+
+  switch (new_range) {
+    case LSM6DS_GYRO_RANGE_125_DPS:  _gyroScale = 4.375; break;
+    case LSM6DS_GYRO_RANGE_250_DPS:  _gyroScale = 8.75; break;
+    case LSM6DS_GYRO_RANGE_500_DPS:  _gyroScale = 17.50; break;
+    case LSM6DS_GYRO_RANGE_1000_DPS: _gyroScale = 35.0; break;
+    case LSM6DS_GYRO_RANGE_2000_DPS: _gyroScale = 70.0; break;
+  }
+}
+
+bool Adafruit_LSM6DS33::_read() {
+  // one burst of temperature, gyro and accel, exactly as the Adafruit driver does
+  uint8_t buffer[14];
+
+  _wire->beginTransmission(_addr);
+  _wire->write(LSM6DS_OUT_TEMP_L);
+  if (_wire->endTransmission(false) != 0) {
+    return false;
+  }
+  if (_wire->requestFrom(_addr, (uint8_t) sizeof(buffer)) != sizeof(buffer)) {
+    return false;
+  }
+  for (uint8_t i = 0; i < sizeof(buffer); i++) {
+    buffer[i] = _wire->read();
+  }
+
+  rawTemp  = buffer[1] << 8 | buffer[0];
+  rawGyroX = buffer[3] << 8 | buffer[2];
+  rawGyroY = buffer[5] << 8 | buffer[4];
+  rawGyroZ = buffer[7] << 8 | buffer[6];
+  rawAccX  = buffer[9] << 8 | buffer[8];
+  rawAccY  = buffer[11] << 8 | buffer[10];
+  rawAccZ  = buffer[13] << 8 | buffer[12];
+
+  temperature = (rawTemp / 16.0) + 25.0;
+
+  gyroX = rawGyroX * _gyroScale * SENSORS_DPS_TO_RADS / 1000.0;
+  gyroY = rawGyroY * _gyroScale * SENSORS_DPS_TO_RADS / 1000.0;
+  gyroZ = rawGyroZ * _gyroScale * SENSORS_DPS_TO_RADS / 1000.0;
+
+  accX = rawAccX * _accelScale * SENSORS_GRAVITY_STANDARD / 1000;
+  accY = rawAccY * _accelScale * SENSORS_GRAVITY_STANDARD / 1000;
+  accZ = rawAccZ * _accelScale * SENSORS_GRAVITY_STANDARD / 1000;
+
+  return true;
+}
+
+void Adafruit_LSM6DS33::fillEvent(sensors_event_t *event, sensors_type_t type) {
+  memset(event, 0, sizeof(sensors_event_t));
+  event->version = sizeof(sensors_event_t);
+  event->sensor_id = _sensorID;
+  event->type = type;
+  event->timestamp = millis();
+
+  switch (type) {
+    case SENSOR_TYPE_ACCELEROMETER:
+      event->acceleration.x = accX;
+      event->acceleration.y = accY;
+      event->acceleration.z = accZ;
+      break;
+    case SENSOR_TYPE_GYROSCOPE:
+      event->gyro.x = gyroX;
+      event->gyro.y = gyroY;
+      event->gyro.z = gyroZ;
+      break;
+    case SENSOR_TYPE_AMBIENT_TEMPERATURE:
+      event->temperature = temperature;
+      break;
+    default:
+      break;
+  }
+}
+
+bool Adafruit_LSM6DS33::getEvent(sensors_event_t *accel, sensors_event_t *gyro, sensors_event_t *temp) {
+  if (!_read()) {
+    return false;
+  }
+  fillEvent(accel, SENSOR_TYPE_ACCELEROMETER);
+  fillEvent(gyro, SENSOR_TYPE_GYROSCOPE);
+  fillEvent(temp, SENSOR_TYPE_AMBIENT_TEMPERATURE);
+  return true;
+}
+
+bool Adafruit_LSM6DS_Sensor::getEvent(sensors_event_t *event) {
+  if (!_parent->_read()) {
+    return false;
+  }
+  _parent->fillEvent(event, _type);
+  return true;
+}
+
+void Adafruit_LSM6DS_Sensor::getSensor(sensor_t *sensor) {
+  memset(sensor, 0, sizeof(sensor_t));
+  strncpy(sensor->name, "LSM6DS", sizeof(sensor->name) - 1);
+  sensor->version = 1;
+  sensor->sensor_id = _parent->_sensorID;
+  sensor->type = _type;
+}
@@ -0,0 +1,113 @@
+/*!
+ * @file Adafruit_LSM6DS33.h
+ * @author Sebastian S.
+ * @brief Host stand-in for the Adafruit LSM6DS33 driver.
+ *
+ * Mirrors the I2C traffic of the real library: every getEvent() on a sub-sensor re-reads the full
+ * 14-byte temperature/gyro/accel block, so transaction counts on the simulated bus match the board.
+ */
+
+#ifndef HOST_ADAFRUIT_LSM6DS33_H_
+#define HOST_ADAFRUIT_LSM6DS33_H_
+
+#include <Wire.h>
+#include <Adafruit_Sensor.h>
+
+#define LSM6DS_I2CADDR_DEFAULT 0x6A
+#define LSM6DS33_CHIP_ID 0x69
+
+typedef enum data_rate {
+  LSM6DS_RATE_SHUTDOWN,
+  LSM6DS_RATE_12_5_HZ,
+  LSM6DS_RATE_26_HZ,
+  LSM6DS_RATE_52_HZ,
+  LSM6DS_RATE_104_HZ,
+  LSM6DS_RATE_208_HZ,
+  LSM6DS_RATE_416_HZ,
+  LSM6DS_RATE_833_HZ,
+  LSM6DS_RATE_1_66K_HZ,
+  LSM6DS_RATE_3_33K_HZ,
+  LSM6DS_RATE_6_66K_HZ,
+} lsm6ds_data_rate_t;
+
+typedef enum accel_range {
+  LSM6DS_ACCEL_RANGE_2_G,
+  LSM6DS_ACCEL_RANGE_16_G,
+  LSM6DS_ACCEL_RANGE_4_G,
+  LSM6DS_ACCEL_RANGE_8_G
+} lsm6ds_accel_range_t;
+
+typedef enum gyro_range {
+  LSM6DS_GYRO_RANGE_125_DPS = 0b0010,
+  LSM6DS_GYRO_RANGE_250_DPS = 0b0000,
+  LSM6DS_GYRO_RANGE_500_DPS = 0b0100,
+  LSM6DS_GYRO_RANGE_1000_DPS = 0b1000,
+  LSM6DS_GYRO_RANGE_2000_DPS = 0b1100,
+} lsm6ds_gyro_range_t;
+
+class Adafruit_LSM6DS33;
+
+/*!
+ * @class Adafruit_LSM6DS_Sensor
+ * @brief One unified-sensor view (accelerometer, gyroscope or temperature) of the IMU.
+ */
+class Adafruit_LSM6DS_Sensor : public Adafruit_Sensor {
+ public:
+  Adafruit_LSM6DS_Sensor(Adafruit_LSM6DS33 *parent, sensors_type_t type) : _parent(parent), _type(type) { }
+  bool getEvent(sensors_event_t *event) override;
+  void getSensor(sensor_t *sensor) override;
+ private:
+  Adafruit_LSM6DS33 *_parent;
+  sensors_type_t _type;
+};
+
+/*!
+ * @class Adafruit_LSM6DS33
+ * @brief LSM6DS33 6-dof IMU.
+ */
+class Adafruit_LSM6DS33 {
+ public:
+  Adafruit_LSM6DS33();
+  Adafruit_LSM6DS33(const Adafruit_LSM6DS33& other);
+
+  bool begin_I2C(uint8_t i2c_addr = LSM6DS_I2CADDR_DEFAULT, TwoWire *wire = &Wire, int32_t sensorID = 0);
+  void reset();
+
+  bool getEvent(sensors_event_t *accel, sensors_event_t *gyro, sensors_event_t *temp);
+
+  lsm6ds_data_rate_t getAccelDataRate();
+  void setAccelDataRate(lsm6ds_data_rate_t data_rate);
+  lsm6ds_accel_range_t getAccelRange();
+  void setAccelRange(lsm6ds_accel_range_t new_range);
+
+  lsm6ds_data_rate_t getGyroDataRate();
+  void setGyroDataRate(lsm6ds_data_rate_t data_rate);
+  lsm6ds_gyro_range_t getGyroRange();
+  void setGyroRange(lsm6ds_gyro_range_t new_range);
+
+  Adafruit_Sensor *getTemperatureSensor() { return &_temp; }
+  Adafruit_Sensor *getAccelerometerSensor() { return &_accel; }
+  Adafruit_Sensor *getGyroSensor() { return &_gyro; }
+
+  int16_t rawAccX, rawAccY, rawAccZ, rawTemp, rawGyroX, rawGyroY, rawGyroZ;
+  float temperature, accX, accY, accZ, gyroX, gyroY, gyroZ;
+ private:
+  friend class Adafruit_LSM6DS_Sensor;
+
+  TwoWire *_wire;
+  uint8_t _addr;
+  int32_t _sensorID;
+  float _accelScale;    // mg per LSB
+  float _gyroScale;     // mdps per LSB
+
+  Adafruit_LSM6DS_Sensor _temp;
+  Adafruit_LSM6DS_Sensor _accel;
+  Adafruit_LSM6DS_Sensor _gyro;
+
+  bool _read();
+  void fillEvent(sensors_event_t *event, sensors_type_t type);
+  uint8_t readRegister(uint8_t reg);
+  void writeRegister(uint8_t reg, uint8_t value);
+};
+
+#endif
@@ -0,0 +1,45 @@
+/*!
+ * @file AltSoftSerial.h
+ * @author Sebastian S.
+ * @brief Host stand-in for the AltSoftSerial library driving the HC-06 Bluetooth module.
+ */
+
+#ifndef HOST_ALTSOFTSERIAL_H_
+#define HOST_ALTSOFTSERIAL_H_
+
+#include "Arduino.h"
+
+/*!
+ * @class AltSoftSerial
+ * @brief Timer-driven software UART, modelled with the library's 68-byte transmit buffer.
+ *
+ * Transmitted bytes are captured on the link so host harnesses can decode telemetry; commands are
+ * injected through Link().Inject().
+ */
+class AltSoftSerial : public Stream {
+ public:
+  AltSoftSerial() : _link(68) { }
+  AltSoftSerial(uint8_t rxPin, uint8_t txPin, bool inverse = false) : _link(68) { }
+
+  void begin(uint32_t baud) { _link.Begin(baud); }
+  void end() { }
+
+  int available() override { return (int) _link.Available(); }
+  int read() override { return _link.Read(); }
+  int peek() override { return _link.Peek(); }
+  int availableForWrite() { return (int) _link.TxFree(); }
+
+  size_t write(uint8_t b) override { _link.Write(b); return 1; }
+  using Print::write;
+
+  operator bool() { return true; }
+
+  /*!
+   * @return The modelled link, for host harnesses to inject and inspect bytes
+   */
+  host::SerialLink& Link() { return _link; }
+ private:
+  host::SerialLink _link;
+};
+
+#endif
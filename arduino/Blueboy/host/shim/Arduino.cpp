@@ -0,0 +1,97 @@
+/*!
+ * @file Arduino.cpp
+ * @author Sebastian S.
+ * @brief Implementation of Arduino.h and HardwareSerial.h
+ */
+
+#include "Arduino.h"
+
+// defined by firmware that handles pin-change interrupts
+extern "C" void host_pcint2_vect() __attribute__((weak));
+
+volatile uint8_t PCICR = 0;
+volatile uint8_t PCMSK2 = 0;
+
+namespace host {
+
+uint64_t Clock::_now = 0;
+ClockListener *Clock::_listeners[Clock::MaxListeners] = { nullptr };
+
+static uint8_t pinStates[32];
+static void (*pinLowCallbacks[32])() = { nullptr };
+
+void OnPinLow(uint8_t pin, void (*callback)()) {
+  if (pin < 32) {
+    pinLowCallbacks[pin] = callback;
+  }
+}
+
+uint8_t PortD() {
+  uint8_t levels = 0;
+  for (uint8_t pin = 0; pin < 8; pin++) {
+    levels |= (pinStates[pin] ? 1 : 0) << pin;
+  }
+  return levels;
+}
+
+void SetPin(uint8_t pin, uint8_t level) {
+  if (pin >= 32 || pinStates[pin] == level) {
+    return;
+  }
+  pinStates[pin] = level;
+  if (pin < 8 && (PCICR & (1 << PCIE2)) && (PCMSK2 & (1 << pin)) && host_pcint2_vect) {
+    host_pcint2_vect();
+  }
+}
+
+}  // namespace host
+
+HardwareSerial Serial;
+
+size_t HardwareSerial::write(uint8_t b) {
+  _link.Write(b);
+  if (_echo) {
+    fputc(b, stdout);
+  }
+  return 1;
+}
+
+unsigned long millis() {
+  return (unsigned long) (host::Clock::Now() / 1000);
+}
+
+unsigned long micros() {
+  return (unsigned long) host::Clock::Now();
+}
+
+void delay(unsigned long ms) {
+  host::Clock::Advance((uint64_t) ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+  host::Clock::Advance(us);
+}
+
+void yield() {
+  host::Clock::AdvanceToNextEvent();
+}
+
+void pinMode(uint8_t pin, uint8_t mode) { }
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  if (pin >= 32) {
+    return;
+  }
+  host::pinStates[pin] = val;
+  if (val == LOW && host::pinLowCallbacks[pin]) {
+    host::pinLowCallbacks[pin]();
+  }
+}
+
+int digitalRead(uint8_t pin) {
+  return pin < 32 ? host::pinStates[pin] : LOW;
+}
+
+void noInterrupts() { }
+
+void interrupts() { }
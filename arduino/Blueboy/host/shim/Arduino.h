@@ -0,0 +1,114 @@
+/*!
+ * @file Arduino.h
+ * @author Sebastian S.
+ * @brief Host stand-in for the Arduino AVR core, enough to compile and run the Blueboy sketch on Linux.
+ *
+ * Timing functions read the virtual clock in HostClock.h, so delay() returns immediately after moving
+ * virtual time forward. Pin functions only record the last written state, except that simulated devices can
+ * drive pins with host::SetPin and raise pin-change interrupts.
+ */
+
+#ifndef HOST_ARDUINO_H_
+#define HOST_ARDUINO_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+#include "HostClock.h"
+#include "Print.h"
+#include "Stream.h"
+#include "HardwareSerial.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT         0x0
+#define OUTPUT        0x1
+#define INPUT_PULLUP  0x2
+
+static const uint8_t SDA = 18;
+static const uint8_t SCL = 19;
+
+#define PI          3.1415926535897932384626433832795
+#define HALF_PI     1.5707963267948966192313216916398
+#define TWO_PI      6.283185307179586476925286766559
+#define DEG_TO_RAD  0.017453292519943295769236907684886
+#define RAD_TO_DEG  57.295779513082320876798154814105
+
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(PSTR(string_literal)))
+
+// the AVR core defines these as macros; templates keep the same mixed-type behaviour without clobbering <algorithm>
+template <class T, class U>
+auto min(const T& a, const U& b) -> decltype(a < b ? a : b) { return (b < a) ? b : a; }
+
+template <class T, class U>
+auto max(const T& a, const U& b) -> decltype(a < b ? a : b) { return (a < b) ? b : a; }
+
+template <class T, class L, class H>
+auto constrain(const T& x, const L& low, const H& high) -> decltype(x < low ? low : x) {
+  return (x < low) ? low : ((x > high) ? high : x);
+}
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+/*!
+ * @brief Called by code spinning until something happens; moves virtual time on to the next event, since
+ *        nothing else would while it spins
+ */
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+void noInterrupts();
+void interrupts();
+
+namespace host {
+
+/*!
+ * @brief Registers a function to be called whenever the given pin is driven low with digitalWrite
+ * @param pin Pin number to watch
+ * @param callback Function to call, or nullptr to clear
+ *
+ * The sketch resets itself by pulling a pin tied to RESET low; host runners use this to notice.
+ */
+void OnPinLow(uint8_t pin, void (*callback)());
+
+/*!
+ * @brief Drives an input pin from outside, as a device wired to it would
+ * @param pin Pin number
+ * @param level HIGH or LOW
+ *
+ * A change on a port D pin enabled in PCMSK2, with PCIE2 set in PCICR, runs ISR(PCINT2_vect) if the firmware
+ * defines one.
+ */
+void SetPin(uint8_t pin, uint8_t level);
+
+/*!
+ * @return The console USART0 transmits on, for host runners to count and time its output
+ */
+SerialLink& Console();
+
+/*!
+ * @brief Enables or disables echoing what USART0 transmits to the host's stdout
+ * @param echo True to echo
+ */
+void SetConsoleEcho(bool echo);
+
+}  // namespace host
+
+#endif
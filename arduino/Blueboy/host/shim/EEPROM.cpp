@@ -0,0 +1,10 @@
+/*!
+ * @file EEPROM.cpp
+ * @author Sebastian S.
+ * @brief Storage for the EEPROM.h stand-in
+ */
+
+#include "EEPROM.h"
+
+// no constructor, so this is zero-initialized before any dynamic initialization that might read it
+EEPROMClass EEPROM;
@@ -0,0 +1,63 @@
+/*!
+ * @file EEPROM.h
+ * @author Sebastian S.
+ * @brief Host stand-in for the Arduino EEPROM library, backed by a 1 KB array like the ATmega328P.
+ */
+
+#ifndef HOST_EEPROM_H_
+#define HOST_EEPROM_H_
+
+#include <stdint.h>
+#include <string.h>
+
+/*!
+ * @class EEPROMClass
+ * @brief Byte-addressable persistent storage.
+ *
+ * The array is zero-initialized rather than erased to 0xFF so that it is valid before any other static
+ * constructor runs; either way no stored calibration carries a valid canary.
+ */
+class EEPROMClass {
+ public:
+  uint8_t read(int idx) { return _data[idx & (Size - 1)]; }
+  void write(int idx, uint8_t val) { _data[idx & (Size - 1)] = val; _writes++; }
+  void update(int idx, uint8_t val) { if (read(idx) != val) write(idx, val); }
+  uint16_t length() { return Size; }
+
+  template <class T>
+  T& get(int idx, T& t) {
+    uint8_t *ptr = (uint8_t *) &t;
+    for (size_t i = 0; i < sizeof(T); i++) {
+      ptr[i] = read(idx + i);
+    }
+    return t;
+  }
+
+  template <class T>
+  const T& put(int idx, const T& t) {
+    const uint8_t *ptr = (const uint8_t *) &t;
+    for (size_t i = 0; i < sizeof(T); i++) {
+      update(idx + i, ptr[i]);
+    }
+    return t;
+  }
+
+  /*!
+   * @return Number of bytes physically written, for checking wear on the host
+   */
+  uint32_t Writes() const { return _writes; }
+
+  /*!
+   * @brief Erases the whole array back to zero
+   */
+  void Erase() { memset(_data, 0, sizeof(_data)); }
+
+  static constexpr uint16_t Size = 1024;
+ private:
+  uint8_t _data[Size];
+  uint32_t _writes;
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
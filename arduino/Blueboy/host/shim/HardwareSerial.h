@@ -0,0 +1,53 @@
+/*!
+ * @file HardwareSerial.h
+ * @author Sebastian S.
+ * @brief Host stand-in for the Arduino core's USB/UART Serial port.
+ */
+
+#ifndef HOST_HARDWARE_SERIAL_H_
+#define HOST_HARDWARE_SERIAL_H_
+
+#include "Stream.h"
+#include "SerialLink.h"
+
+/*!
+ * @class HardwareSerial
+ * @brief The debug console, modelled with the 64-byte transmit buffer of the AVR core.
+ *
+ * Output is timed by the underlying link and optionally echoed to the host's stdout; capture is off by default.
+ */
+class HardwareSerial : public Stream {
+ public:
+  HardwareSerial() : _link(64), _echo(false) { _link.SetCapture(false); }
+
+  void begin(unsigned long baud) { _link.Begin(baud); }
+  void end() { }
+
+  int available() override { return (int) _link.Available(); }
+  int read() override { return _link.Read(); }
+  int peek() override { return _link.Peek(); }
+  int availableForWrite() { return (int) _link.TxFree(); }
+
+  size_t write(uint8_t b) override;
+  using Print::write;
+
+  operator bool() { return true; }
+
+  /*!
+   * @return The modelled link, for host harnesses to inject and inspect bytes
+   */
+  host::SerialLink& Link() { return _link; }
+
+  /*!
+   * @brief Enables or disables echoing console output to the host's stdout
+   * @param echo True to echo
+   */
+  void SetEcho(bool echo) { _echo = echo; }
+ private:
+  host::SerialLink _link;
+  bool _echo;
+};
+
+extern HardwareSerial Serial;
+
+#endif
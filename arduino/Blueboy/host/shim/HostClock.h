@@ -0,0 +1,146 @@
+/*!
+ * @file HostClock.h
+ * @author Sebastian S.
+ * @brief Virtual clock backing millis(), micros() and delay() in the host build.
+ *
+ * Time only moves when something advances it: delays, simulated bus and serial transfers, or the host
+ * runner stepping between loop() calls. Firmware therefore runs as fast as the host CPU allows while still
+ * seeing consistent timing. Simulated devices that act on their own time, rather than when polled, listen for
+ * the clock to pass their events.
+ */
+
+#ifndef HOST_CLOCK_H_
+#define HOST_CLOCK_H_
+
+#include <stdint.h>
+
+namespace host {
+
+/*!
+ * @class ClockListener
+ * @brief Something that acts at set virtual times, such as a simulated device raising a pin.
+ */
+class ClockListener {
+ public:
+  /*!
+   * @return Virtual time of the listener's next event, UINT64_MAX if none is pending
+   */
+  virtual uint64_t NextEvent() = 0;
+
+  /*!
+   * @brief Called with virtual time at the event's time; must move NextEvent on
+   */
+  virtual void OnEvent() = 0;
+};
+
+/*!
+ * @class Clock
+ * @brief Monotonic virtual time in microseconds, shared by all shims and simulated devices.
+ *
+ * Advancing past a listener's next event stops at the event's time to run it, so whatever it interrupts sees
+ * the time the event happened, then carries on to the target.
+ */
+class Clock {
+ public:
+  /*!
+   * @var uint8_t MaxListeners
+   * Number of listeners that can be attached at once
+   */
+  static constexpr uint8_t MaxListeners = 4;
+
+  /*!
+   * @return Current virtual time in microseconds
+   */
+  static uint64_t Now() { return _now; }
+
+  /*!
+   * @brief Moves virtual time forward
+   * @param us Number of microseconds to advance by
+   */
+  static void Advance(uint64_t us) { AdvanceTo(_now + us); }
+
+  /*!
+   * @brief Moves virtual time forward to the given time, if it is in the future, running events on the way
+   * @param us Absolute virtual time in microseconds to advance to
+   */
+  static void AdvanceTo(uint64_t us) {
+    while (ClockListener *next = due(us)) {
+      uint64_t when = next->NextEvent();
+      if (when > _now) {
+        _now = when;
+      }
+      next->OnEvent();
+    }
+    if (us > _now) {
+      _now = us;
+    }
+  }
+
+  /*!
+   * @brief Moves virtual time forward to the earliest listener's next event and runs it, or by a microsecond if
+   *        none is pending
+   */
+  static void AdvanceToNextEvent() {
+    ClockListener *next = due(UINT64_MAX - 1);
+    AdvanceTo(next != nullptr ? next->NextEvent() : _now + 1);
+  }
+
+  /*!
+   * @brief Runs the given listener's events as time passes them, until removed
+   * @param listener Listener to add; adding one twice has no effect
+   */
+  static void Listen(ClockListener *listener) {
+    for (ClockListener *&slot : _listeners) {
+      if (slot == listener) {
+        return;
+      }
+    }
+    for (ClockListener *&slot : _listeners) {
+      if (slot == nullptr) {
+        slot = listener;
+        return;
+      }
+    }
+  }
+
+  /*!
+   * @brief Stops running the given listener's events
+   */
+  static void Unlisten(ClockListener *listener) {
+    for (ClockListener *&slot : _listeners) {
+      if (slot == listener) {
+        slot = nullptr;
+      }
+    }
+  }
+
+  /*!
+   * @brief Resets virtual time to zero
+   */
+  static void Reset() { _now = 0; }
+
+  Clock() = delete;
+ private:
+  static uint64_t _now;
+  static ClockListener *_listeners[MaxListeners];
+
+  // the listener with the earliest event no later than the given time, if any
+  static ClockListener *due(uint64_t until) {
+    ClockListener *next = nullptr;
+    uint64_t earliest = until;
+    for (ClockListener *listener : _listeners) {
+      if (listener != nullptr) {
+        uint64_t when = listener->NextEvent();
+        if (when <= earliest) {
+          earliest = when;
+          next = listener;
+        }
+      }
+    }
+    return next;
+  }
+};
+
+}  // namespace host
+
+#endif
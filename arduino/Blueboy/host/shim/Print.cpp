@@ -0,0 +1,113 @@
+/*!
+ * @file Print.cpp
+ * @author Sebastian S.
+ * @brief Implementation of Print.h, following the formatting rules of the Arduino core.
+ */
+
+#include "Print.h"
+#include <math.h>
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  size_t n = 0;
+  while (size--) {
+    if (write(*buffer++)) {
+      n++;
+    } else {
+      break;
+    }
+  }
+  return n;
+}
+
+size_t Print::print(const __FlashStringHelper *str) { return write((const char *) str); }
+size_t Print::print(const char str[]) { return write(str); }
+size_t Print::print(char c) { return write((uint8_t) c); }
+size_t Print::print(unsigned char n, int base) { return print((unsigned long) n, base); }
+size_t Print::print(int n, int base) { return print((long) n, base); }
+size_t Print::print(unsigned int n, int base) { return print((unsigned long) n, base); }
+
+size_t Print::print(long n, int base) {
+  if (base == 0) {
+    return write((uint8_t) n);
+  } else if (base == 10 && n < 0) {
+    size_t t = print('-');
+    return printNumber(-(unsigned long) n, 10) + t;
+  }
+  // AVR longs are 32 bits, so non-decimal negatives print as their 32-bit pattern
+  return printNumber((uint32_t) n, base);
+}
+
+size_t Print::print(unsigned long n, int base) {
+  if (base == 0) {
+    return write((uint8_t) n);
+  }
+  return printNumber(n, base);
+}
+
+size_t Print::print(double n, int digits) { return printFloat(n, digits); }
+
+size_t Print::println(const __FlashStringHelper *str) { size_t n = print(str); return n + println(); }
+size_t Print::println(const char str[]) { size_t n = print(str); return n + println(); }
+size_t Print::println(char c) { size_t n = print(c); return n + println(); }
+size_t Print::println(unsigned char b, int base) { size_t n = print(b, base); return n + println(); }
+size_t Print::println(int num, int base) { size_t n = print(num, base); return n + println(); }
+size_t Print::println(unsigned int num, int base) { size_t n = print(num, base); return n + println(); }
+size_t Print::println(long num, int base) { size_t n = print(num, base); return n + println(); }
+size_t Print::println(unsigned long num, int base) { size_t n = print(num, base); return n + println(); }
+size_t Print::println(double num, int digits) { size_t n = print(num, digits); return n + println(); }
+size_t Print::println() { return write("\r\n"); }
+
+size_t Print::printNumber(unsigned long n, int base) {
+  char buf[8 * sizeof(long) + 1];
+  char *str = &buf[sizeof(buf) - 1];
+  *str = '\0';
+
+  if (base < 2) {
+    base = 10;
+  }
+
+  do {
+    char c = n % base;
+    n /= base;
+    *--str = c < 10 ? c + '0' : c + 'A' - 10;
+  } while (n);
+
+  return write(str);
+}
+
+size_t Print::printFloat(double number, int digits) {
+  if (isnan(number)) return print("nan");
+  if (isinf(number)) return print("inf");
+  if (number > 4294967040.0) return print("ovf");
+  if (number < -4294967040.0) return print("ovf");
+
+  size_t n = 0;
+  if (number < 0.0) {
+    n += print('-');
+    number = -number;
+  }
+
+  // round correctly so that print(1.999, 2) prints as "2.00"
+  double rounding = 0.5;
+  for (int i = 0; i < digits; i++) {
+    rounding /= 10.0;
+  }
+  number += rounding;
+
+  unsigned long intPart = (unsigned long) number;
+  double remainder = number - (double) intPart;
+  n += print(intPart);
+
+  if (digits > 0) {
+    n += print('.');
+  }
+
+  while (digits-- > 0) {
+    remainder *= 10.0;
+    unsigned int toPrint = (unsigned int) remainder;
+    n += print(toPrint);
+    remainder -= toPrint;
+  }
+
+  return n;
+}
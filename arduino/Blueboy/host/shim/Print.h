@@ -0,0 +1,59 @@
+/*!
+ * @file Print.h
+ * @author Sebastian S.
+ * @brief Host stand-in for the Arduino core's Print class.
+ */
+
+#ifndef HOST_PRINT_H_
+#define HOST_PRINT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+class __FlashStringHelper;
+
+/*!
+ * @class Print
+ * @brief Formats numbers and strings onto a byte sink, with the same overloads as the Arduino core.
+ */
+class Print {
+ public:
+  virtual ~Print() = default;
+
+  virtual size_t write(uint8_t b) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size);
+  size_t write(const char *str) { return str ? write((const uint8_t *) str, strlen(str)) : 0; }
+  size_t write(const char *buffer, size_t size) { return write((const uint8_t *) buffer, size); }
+
+  size_t print(const __FlashStringHelper *str);
+  size_t print(const char str[]);
+  size_t print(char c);
+  size_t print(unsigned char n, int base = DEC);
+  size_t print(int n, int base = DEC);
+  size_t print(unsigned int n, int base = DEC);
+  size_t print(long n, int base = DEC);
+  size_t print(unsigned long n, int base = DEC);
+  size_t print(double n, int digits = 2);
+
+  size_t println(const __FlashStringHelper *str);
+  size_t println(const char str[]);
+  size_t println(char c);
+  size_t println(unsigned char n, int base = DEC);
+  size_t println(int n, int base = DEC);
+  size_t println(unsigned int n, int base = DEC);
+  size_t println(long n, int base = DEC);
+  size_t println(unsigned long n, int base = DEC);
+  size_t println(double n, int digits = 2);
+  size_t println();
+ private:
+  size_t printNumber(unsigned long n, int base);
+  size_t printFloat(double n, int digits);
+};
+
+#endif
@@ -0,0 +1,74 @@
+/*!
+ * @file SerialLink.cpp
+ * @author Sebastian S.
+ * @brief Implementation of SerialLink.h
+ */
+
+#include "SerialLink.h"
+#include "HostClock.h"
+
+namespace host {
+
+SerialLink::SerialLink(size_t txCapacity) : _txCapacity(txCapacity), _txQueued(0), _usPerByte(0),
+                                            _lastDrain(0), _blockedUs(0), _written(0), _capture(true) { }
+
+void SerialLink::Begin(unsigned long baud) {
+  // 8N1 framing puts 10 bits on the wire for every byte
+  _usPerByte = baud ? (10000000UL + baud - 1) / baud : 0;
+  _txQueued = 0;
+  _lastDrain = Clock::Now();
+}
+
+void SerialLink::drain() {
+  uint64_t now = Clock::Now();
+  if (_usPerByte == 0) {
+    _txQueued = 0;
+    _lastDrain = now;
+    return;
+  }
+
+  uint64_t drained = (now - _lastDrain) / _usPerByte;
+  if (drained >= _txQueued) {
+    _txQueued = 0;
+    _lastDrain = now;
+  } else {
+    _txQueued -= drained;
+    _lastDrain += drained * _usPerByte;
+  }
+}
+
+size_t SerialLink::TxFree() {
+  drain();
+  return _txCapacity - _txQueued;
+}
+
+void SerialLink::Write(uint8_t b) {
+  drain();
+  if (_txQueued >= _txCapacity) {
+    // block until the oldest byte has left the shift register
+    uint64_t until = _lastDrain + _usPerByte;
+    _blockedUs += until - Clock::Now();
+    Clock::AdvanceTo(until);
+    drain();
+  }
+  _txQueued++;
+  _written++;
+  if (_capture) {
+    _sent.push_back(b);
+  }
+}
+
+int SerialLink::Read() {
+  if (_rx.empty()) {
+    return -1;
+  }
+  uint8_t b = _rx.front();
+  _rx.pop_front();
+  return b;
+}
+
+void SerialLink::Inject(const uint8_t *buf, size_t len) {
+  _rx.insert(_rx.end(), buf, buf + len);
+}
+
+}  // namespace host
@@ -0,0 +1,114 @@
+/*!
+ * @file SerialLink.h
+ * @author Sebastian S.
+ * @brief Timing model of a buffered UART transmitter and receiver for the host build.
+ */
+
+#ifndef HOST_SERIAL_LINK_H_
+#define HOST_SERIAL_LINK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <vector>
+
+namespace host {
+
+/*!
+ * @class SerialLink
+ * @brief Models a UART with a fixed-size transmit buffer draining at the configured baud rate.
+ *
+ * Writing into a full transmit buffer blocks, exactly like the AVR cores do, by advancing the virtual clock
+ * until enough bytes have drained. Every byte written is also captured so a host harness can decode it.
+ * Received bytes are injected by the harness and are immediately available to the firmware.
+ */
+class SerialLink {
+ public:
+  /*!
+   * @brief Constructs a SerialLink
+   * @param txCapacity Size in bytes of the modelled transmit buffer
+   */
+  explicit SerialLink(size_t txCapacity);
+
+  /*!
+   * @brief Sets the baud rate, assuming 10 bits on the wire per byte
+   * @param baud Bits per second
+   */
+  void Begin(unsigned long baud);
+
+  /*!
+   * @brief Queues a byte for transmission, blocking on the virtual clock if the buffer is full
+   * @param b Byte to transmit
+   */
+  void Write(uint8_t b);
+
+  /*!
+   * @return Number of bytes that can be written without blocking
+   */
+  size_t TxFree();
+
+  /*!
+   * @return Number of bytes received and not yet read
+   */
+  size_t Available() const { return _rx.size(); }
+
+  /*!
+   * @return The next received byte, or -1 if none are available
+   */
+  int Read();
+
+  /*!
+   * @return The next received byte without consuming it, or -1 if none are available
+   */
+  int Peek() const { return _rx.empty() ? -1 : _rx.front(); }
+
+  /*!
+   * @brief Makes bytes available to the firmware as if they had been received
+   * @param buf Bytes to receive
+   * @param len Number of bytes
+   */
+  void Inject(const uint8_t *buf, size_t len);
+
+  /*!
+   * @return Every byte written since the last call to ClearSent()
+   */
+  const std::vector<uint8_t>& Sent() const { return _sent; }
+
+  /*!
+   * @brief Discards captured transmitted bytes
+   */
+  void ClearSent() { _sent.clear(); }
+
+  /*!
+   * @brief Enables or disables capture of transmitted bytes
+   * @param capture True to keep transmitted bytes for Sent()
+   */
+  void SetCapture(bool capture) { _capture = capture; }
+
+  /*!
+   * @return Total microseconds of virtual time spent blocked in Write()
+   */
+  uint64_t BlockedMicros() const { return _blockedUs; }
+
+  /*!
+   * @return Total number of bytes written
+   */
+  uint64_t BytesWritten() const { return _written; }
+ private:
+  size_t _txCapacity;           // modelled transmit buffer size
+  size_t _txQueued;             // bytes in the modelled transmit buffer
+  uint64_t _usPerByte;          // time on the wire per byte
+  uint64_t _lastDrain;          // virtual time the transmit buffer was last drained up to
+  uint64_t _blockedUs;          // time spent blocked on a full buffer
+  uint64_t _written;            // total bytes written
+  bool _capture;                // whether written bytes are captured
+  std::vector<uint8_t> _sent;   // captured transmitted bytes
+  std::deque<uint8_t> _rx;      // received bytes not yet read
+
+  // drains the transmit buffer up to the current virtual time
+  void drain();
+};
+
+}  // namespace host
+
+#endif
@@ -0,0 +1,24 @@
+/*!
+ * @file Stream.h
+ * @author Sebastian S.
+ * @brief Host stand-in for the Arduino core's Stream class.
+ */
+
+#ifndef HOST_STREAM_H_
+#define HOST_STREAM_H_
+
+#include "Print.h"
+
+/*!
+ * @class Stream
+ * @brief A readable Print.
+ */
+class Stream : public Print {
+ public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  virtual void flush() { }
+};
+
+#endif
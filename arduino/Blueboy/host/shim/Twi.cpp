@@ -0,0 +1,199 @@
+/*!
+ * @file Twi.cpp
+ * @author Sebastian S.
+ * @brief The TWI model behind the TWI registers in avr/io.h.
+ *
+ * Only master operation is modelled, on a bus with no other master: arbitration is never lost and the slave
+ * address register is unused. Bytes written to a device are delivered to it as one write when the transaction
+ * ends, by a stop or a repeated start; reads take its bytes one at a time as each is clocked in.
+ */
+
+#include <vector>
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <util/twi.h>
+
+// defined by firmware that handles TWI interrupts
+extern "C" void host_twi_vect() __attribute__((weak));
+
+volatile uint8_t TWBR = 0;
+volatile uint8_t TWSR = 0;
+volatile uint8_t TWDR = 0;
+volatile uint8_t TWAR = 0;
+
+namespace host {
+
+namespace {
+
+/*!
+ * @enum TwiState
+ * Where the master is within a transaction
+ */
+enum class TwiState : uint8_t {
+  Idle,       // bus released, or a transaction abandoned after a NACK
+  Started,    // after a start or repeated start, the address goes next
+  Writing,    // master transmitter, addressed device acknowledged
+  Reading     // master receiver, addressed device acknowledged
+};
+
+class TwiModel : public ClockListener {
+ public:
+  TwiModel() : _control(0), _interrupt(false), _stopping(false), _startAfterStop(false), _state(TwiState::Idle),
+               _owned(false), _device(nullptr), _status(TW_NO_INFO), _received(0), _doneAt(UINT64_MAX) { }
+
+  void Write(uint8_t value) {
+    _control = (value & ~_BV(TWINT)) | (_stopping ? _BV(TWSTO) : 0);
+    if (!(value & _BV(TWEN))) {
+      // disabling the TWI abandons whatever it was doing
+      _interrupt = false;
+      _stopping = false;
+      _state = TwiState::Idle;
+      _owned = false;
+      _doneAt = UINT64_MAX;
+      _written.clear();
+      return;
+    }
+    if (!(value & _BV(TWINT)) || _doneAt != UINT64_MAX) {
+      return;   // TWINT written as 0 starts nothing, and an action under way can't be interrupted
+    }
+    _interrupt = false;
+
+    if (value & _BV(TWSTO)) {
+      endWrite();
+      _state = TwiState::Idle;
+      _owned = false;
+      _stopping = true;
+      _startAfterStop = (value & _BV(TWSTA)) != 0;
+      _control |= _BV(TWSTO);
+      schedule(1, TW_NO_INFO);
+    } else if (value & _BV(TWSTA)) {
+      endWrite();
+      start();
+    } else {
+      switch (_state) {
+        case TwiState::Started:
+          address(TWDR);
+          break;
+        case TwiState::Writing:
+          _written.push_back((uint8_t) TWDR);
+          Bus().stats.bytesWritten++;
+          schedule(9, TW_MT_DATA_ACK);
+          break;
+        case TwiState::Reading:
+          _received = _device->RequestByte();
+          Bus().stats.bytesRead++;
+          schedule(9, (value & _BV(TWEA)) ? TW_MR_DATA_ACK : TW_MR_DATA_NACK);
+          break;
+        case TwiState::Idle:
+          break;
+      }
+    }
+  }
+
+  uint8_t Read() const {
+    return _control | (_interrupt ? _BV(TWINT) : 0);
+  }
+
+  uint64_t NextEvent() override { return _doneAt; }
+
+  void OnEvent() override {
+    _doneAt = UINT64_MAX;
+    if (_stopping) {
+      // a stop sets no flag; the TWI just lets go of the bus, then starts again if asked to
+      _stopping = false;
+      _control &= ~_BV(TWSTO);
+      if (_startAfterStop) {
+        _startAfterStop = false;
+        start();
+      }
+      return;
+    }
+
+    if (_state == TwiState::Reading && (_status == TW_MR_DATA_ACK || _status == TW_MR_DATA_NACK)) {
+      TWDR = _received;
+    }
+    TWSR = (TWSR & ~TW_STATUS_MASK) | _status;
+    _interrupt = true;
+    if ((_control & _BV(TWIE)) && host_twi_vect) {
+      host_twi_vect();
+    }
+  }
+ private:
+  uint8_t _control;         // TWCR bits as last written, besides TWINT
+  bool _interrupt;          // TWINT
+  bool _stopping;           // a stop is going out
+  bool _startAfterStop;     // a start follows the stop going out
+  TwiState _state;
+  bool _owned;              // the bus is held since a start, so the next start is a repeated one
+  I2CDevice *_device;       // device addressed in the current transaction
+  std::vector<uint8_t> _written;  // bytes written to it in the current transaction
+  uint8_t _status;          // TWSR status the action under way completes with
+  uint8_t _received;        // byte the read under way clocks in
+  uint64_t _doneAt;         // virtual time the action under way completes, UINT64_MAX if none
+
+  void start() {
+    uint8_t status = _owned ? TW_REP_START : TW_START;
+    _owned = true;
+    _state = TwiState::Started;
+    schedule(1, status);
+  }
+
+  void address(uint8_t sla) {
+    Bus().stats.transactions++;
+    _device = Bus().devices[sla >> 1];
+    bool read = (sla & 0x01) == TW_READ;
+    if (_device == nullptr) {
+      Bus().stats.nacks++;
+      _state = TwiState::Idle;
+      schedule(9, read ? TW_MR_SLA_NACK : TW_MT_SLA_NACK);
+    } else if (read) {
+      _device->BeginRequest();
+      _state = TwiState::Reading;
+      schedule(9, TW_MR_SLA_ACK);
+    } else {
+      _written.clear();
+      _state = TwiState::Writing;
+      schedule(9, TW_MT_SLA_ACK);
+    }
+  }
+
+  // delivers the bytes written in the transaction that's ending
+  void endWrite() {
+    if (_state == TwiState::Writing && !_written.empty()) {
+      _device->Receive(_written.data(), _written.size());
+    }
+    _written.clear();
+  }
+
+  // completes the action started now after the given number of bit times
+  void schedule(uint8_t bits, uint8_t status) {
+    static const uint8_t prescalers[] = { 1, 4, 16, 64 };
+    uint32_t divider = 16 + 2 * (uint32_t) TWBR * prescalers[TWSR & 0x03];
+    uint64_t us = ((uint64_t) bits * divider * 1000000 + F_CPU - 1) / F_CPU;
+    Bus().stats.busMicros += us;
+    _status = status;
+    _doneAt = Clock::Now() + us;
+    Clock::Listen(this);
+  }
+};
+
+TwiModel twi;
+
+}  // namespace
+
+TwiControl& TwiControl::operator=(uint8_t value) {
+  twi.Write(value);
+  return *this;
+}
+
+TwiControl::operator uint8_t() const {
+  return twi.Read();
+}
+
+TwiControl& Twcr() {
+  static TwiControl twcr;
+  return twcr;
+}
+
+}  // namespace host
@@ -0,0 +1,94 @@
+/*!
+ * @file Usart.cpp
+ * @author Sebastian S.
+ * @brief The USART0 model behind the USART registers in avr/io.h.
+ *
+ * Only the transmitter is modelled. The data register and the shift register behind it hold a byte each, so a
+ * byte written while both are full would be lost on the AVR; here the write waits on the virtual clock instead.
+ */
+
+#include <Arduino.h>
+
+volatile uint16_t UBRR0 = 0;
+volatile uint8_t UCSR0B = 0;
+volatile uint8_t UCSR0C = 0;
+
+namespace host {
+
+namespace {
+
+class UsartModel {
+ public:
+  UsartModel() : _link(2), _doubleSpeed(false), _baud(0), _echo(false) { _link.SetCapture(false); }
+
+  void Write(uint8_t value) {
+    if (!(UCSR0B & _BV(TXEN0))) {
+      return;   // the transmitter is off, so the pin is an ordinary port pin
+    }
+    unsigned long baud = F_CPU / ((_doubleSpeed ? 8UL : 16UL) * (UBRR0 + 1UL));
+    if (baud != _baud) {
+      _link.Begin(baud);
+      _baud = baud;
+    }
+    _link.Write(value);
+    if (_echo) {
+      fputc(value, stdout);
+    }
+  }
+
+  void SetStatus(uint8_t value) {
+    _doubleSpeed = value & _BV(U2X0);
+  }
+
+  uint8_t Status() {
+    size_t free = _link.TxFree();
+    return (_doubleSpeed ? _BV(U2X0) : 0) | (free > 0 ? _BV(UDRE0) : 0) | (free == 2 ? _BV(TXC0) : 0);
+  }
+
+  SerialLink& Link() { return _link; }
+
+  void SetEcho(bool echo) { _echo = echo; }
+ private:
+  SerialLink _link;         // the data register and shift register, a byte each
+  bool _doubleSpeed;        // U2X0 as last written
+  unsigned long _baud;      // rate the link was last begun at
+  bool _echo;               // whether transmitted bytes go to stdout too
+};
+
+UsartModel usart;
+
+}  // namespace
+
+UsartData& UsartData::operator=(uint8_t value) {
+  usart.Write(value);
+  return *this;
+}
+
+UsartStatus& UsartStatus::operator=(uint8_t value) {
+  usart.SetStatus(value);
+  return *this;
+}
+
+UsartStatus::operator uint8_t() const {
+  return usart.Status();
+}
+
+UsartData& Udr0() {
+  static UsartData udr0;
+  return udr0;
+}
+
+UsartStatus& Ucsr0a() {
+  static UsartStatus ucsr0a;
+  return ucsr0a;
+}
+
+SerialLink& Console() {
+  return usart.Link();
+}
+
+void SetConsoleEcho(bool echo) {
+  usart.SetEcho(echo);
+}
+
+}  // namespace host
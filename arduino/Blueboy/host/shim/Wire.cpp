@@ -0,0 +1,98 @@
+/*!
+ * @file Wire.cpp
+ * @author Sebastian S.
+ * @brief Implementation of Wire.h
+ */
+
+#include "Wire.h"
+
+namespace host {
+
+I2CBus& Bus() {
+  static I2CBus bus = {};
+  return bus;
+}
+
+}  // namespace host
+
+TwoWire Wire;
+
+TwoWire::TwoWire() : _rxIndex(0), _rxLength(0), _txAddress(0), _txLength(0), _transmitting(false), _clock(100000) { }
+
+void TwoWire::begin() {
+  _rxIndex = _rxLength = 0;
+  _txLength = 0;
+  _clock = 100000;
+}
+
+void TwoWire::busTime(size_t bytes, bool stop) {
+  // start, address + r/w, then 9 clocks (8 data + ack) per byte, plus a stop condition if sent
+  uint64_t bits = 1 + 9 + 9 * bytes + (stop ? 1 : 0);
+  uint64_t us = (bits * 1000000 + _clock - 1) / _clock;
+  host::Bus().stats.transactions++;
+  host::Bus().stats.busMicros += us;
+  host::Clock::Advance(us);
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+  _transmitting = true;
+  _txAddress = address;
+  _txLength = 0;
+}
+
+size_t TwoWire::write(uint8_t data) {
+  if (!_transmitting || _txLength >= BUFFER_LENGTH) {
+    return 0;
+  }
+  _txBuffer[_txLength++] = data;
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t quantity) {
+  size_t i;
+  for (i = 0; i < quantity; i++) {
+    if (!write(data[i])) {
+      break;
+    }
+  }
+  return i;
+}
+
+uint8_t TwoWire::endTransmission(uint8_t sendStop) {
+  _transmitting = false;
+  host::I2CDevice *device = host::Bus().devices[_txAddress & 0x7F];
+
+  if (!device) {
+    busTime(0, sendStop);
+    host::Bus().stats.nacks++;
+    return 2;  // address NACK, same code as the AVR twi driver
+  }
+
+  busTime(_txLength, sendStop);
+  host::Bus().stats.bytesWritten += _txLength;
+  device->Receive(_txBuffer, _txLength);
+  return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, uint8_t sendStop) {
+  if (quantity > BUFFER_LENGTH) {
+    quantity = BUFFER_LENGTH;
+  }
+
+  _rxIndex = 0;
+  _rxLength = 0;
+
+  host::I2CDevice *device = host::Bus().devices[address & 0x7F];
+  if (!device) {
+    busTime(0, sendStop);
+    host::Bus().stats.nacks++;
+    return 0;
+  }
+
+  // the device shifts out what it holds as the read starts, not once the bus time has passed
+  device->Request(_rxBuffer, quantity);
+  busTime(quantity, sendStop);
+  host::Bus().stats.bytesRead += quantity;
+  _rxLength = quantity;
+  return quantity;
+}
@@ -0,0 +1,151 @@
+/*!
+ * @file Wire.h
+ * @author Sebastian S.
+ * @brief Host stand-in for the Arduino Wire library, routing transactions to simulated I2C devices.
+ */
+
+#ifndef HOST_WIRE_H_
+#define HOST_WIRE_H_
+
+#include "Arduino.h"
+
+#define BUFFER_LENGTH 32
+
+namespace host {
+
+/*!
+ * @class I2CDevice
+ * @brief A simulated slave on the host I2C bus.
+ *
+ * Wire moves whole transactions; the TWI model moves bytes, so reads are also offered a byte at a time.
+ */
+class I2CDevice {
+ public:
+  virtual ~I2CDevice() = default;
+
+  /*!
+   * @brief Called when the master completes a write transaction to this device
+   * @param buf Bytes written by the master
+   * @param len Number of bytes written
+   */
+  virtual void Receive(const uint8_t *buf, size_t len) = 0;
+
+  /*!
+   * @brief Called when the master reads from this device
+   * @param buf Buffer to fill with the bytes to return to the master
+   * @param len Number of bytes requested
+   */
+  virtual void Request(uint8_t *buf, size_t len) = 0;
+
+  /*!
+   * @brief Called when the master starts a read from this device that it will take a byte at a time
+   */
+  virtual void BeginRequest() { }
+
+  /*!
+   * @return The next byte of a read begun with BeginRequest
+   */
+  virtual uint8_t RequestByte() {
+    uint8_t byte;
+    Request(&byte, 1);
+    return byte;
+  }
+};
+
+/*!
+ * @struct I2CStats
+ * @brief Counters of traffic on the simulated bus.
+ */
+struct I2CStats {
+  uint32_t transactions;    //!< number of address phases (writes and reads)
+  uint32_t bytesWritten;    //!< data bytes written by the master
+  uint32_t bytesRead;       //!< data bytes read by the master
+  uint32_t nacks;           //!< transactions addressed to no device
+  uint64_t busMicros;       //!< virtual time the bus was busy
+};
+
+/*!
+ * @struct I2CBus
+ * @brief The simulated devices on the bus and its traffic, shared by Wire and the TWI model.
+ */
+struct I2CBus {
+  I2CDevice *devices[128];  //!< device at each 7-bit address, nullptr where none answers
+  I2CStats stats;           //!< traffic since the last reset
+};
+
+/*!
+ * @return The one simulated bus
+ */
+I2CBus& Bus();
+
+}  // namespace host
+
+/*!
+ * @class TwoWire
+ * @brief Master-side I2C with the Arduino Wire API and its 32-byte buffers.
+ *
+ * Every transaction advances the virtual clock by its time on the wire at the configured clock rate.
+ */
+class TwoWire : public Stream {
+ public:
+  TwoWire();
+
+  void begin();
+  void end() { }
+  void setClock(uint32_t clock) { _clock = clock; }
+
+  void beginTransmission(uint8_t address);
+  void beginTransmission(int address) { beginTransmission((uint8_t) address); }
+  uint8_t endTransmission(uint8_t sendStop);
+  uint8_t endTransmission() { return endTransmission((uint8_t) true); }
+
+  uint8_t requestFrom(uint8_t address, uint8_t quantity, uint8_t sendStop);
+  uint8_t requestFrom(uint8_t address, uint8_t quantity) { return requestFrom(address, quantity, (uint8_t) true); }
+  uint8_t requestFrom(int address, int quantity) { return requestFrom((uint8_t) address, (uint8_t) quantity, (uint8_t) true); }
+  uint8_t requestFrom(int address, int quantity, int sendStop) {
+    return requestFrom((uint8_t) address, (uint8_t) quantity, (uint8_t) sendStop);
+  }
+
+  size_t write(uint8_t data) override;
+  size_t write(const uint8_t *data, size_t quantity) override;
+  using Print::write;
+
+  int available() override { return _rxLength - _rxIndex; }
+  int read() override { return _rxIndex < _rxLength ? _rxBuffer[_rxIndex++] : -1; }
+  int peek() override { return _rxIndex < _rxLength ? _rxBuffer[_rxIndex] : -1; }
+
+  /*!
+   * @brief Attaches a simulated device to the bus
+   * @param address 7-bit address the device responds to
+   * @param device Device to attach, or nullptr to detach
+   */
+  void Attach(uint8_t address, host::I2CDevice *device) { host::Bus().devices[address & 0x7F] = device; }
+
+  /*!
+   * @return Traffic counters since the last ResetStats()
+   */
+  const host::I2CStats& Stats() const { return host::Bus().stats; }
+
+  /*!
+   * @brief Clears the traffic counters
+   */
+  void ResetStats() { memset(&host::Bus().stats, 0, sizeof(host::I2CStats)); }
+ private:
+  uint8_t _rxBuffer[BUFFER_LENGTH];
+  uint8_t _rxIndex;
+  uint8_t _rxLength;
+
+  uint8_t _txAddress;
+  uint8_t _txBuffer[BUFFER_LENGTH];
+  uint8_t _txLength;
+  bool _transmitting;
+
+  uint32_t _clock;
+
+  // advances the clock by the time taken to move the given number of data bytes in one transaction
+  void busTime(size_t bytes, bool stop);
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,21 @@
+/*!
+ * @file interrupt.h
+ * @author Sebastian S.
+ * @brief Host stand-in for avr-libc's interrupt handler declarations.
+ *
+ * A handler is an ordinary function the shim calls from inside whatever firmware code is running when its
+ * simulated event fires, much as the AVR would interrupt it. Only the pin-change vector for port D and the TWI
+ * vector are wired up.
+ */
+
+#ifndef HOST_AVR_INTERRUPT_H_
+#define HOST_AVR_INTERRUPT_H_
+
+#define ISR(vector) extern "C" void vector()
+#define PCINT2_vect host_pcint2_vect
+#define TWI_vect host_twi_vect
+
+#define cli() ((void) 0)
+#define sei() ((void) 0)
+
+#endif
@@ -0,0 +1,138 @@
+/*!
+ * @file io.h
+ * @author Sebastian S.
+ * @brief Host stand-in for the ATmega328P's I/O registers, only those the sketch touches.
+ *
+ * PIND reads the levels simulated devices drive onto port D through host::SetPin. Writing PCICR and PCMSK2
+ * enables pin-change interrupts as on the AVR, delivered to ISR(PCINT2_vect) when a masked pin changes.
+ *
+ * The TWI registers drive a model of the two-wire interface in master mode, moving bytes to and from the
+ * simulated devices on the bus in virtual time at the bit rate TWBR sets. Writing TWCR with TWINT set starts
+ * the next action as on the AVR; when it completes, TWINT and TWSR are set and ISR(TWI_vect) runs if TWIE is.
+ *
+ * The USART0 registers drive a model of its transmitter, putting bytes written to UDR0 out on the console at the
+ * baud rate UBRR0 and U2X0 set. UDRE0 reads clear while the data register and the shift register both hold a byte.
+ */
+
+#ifndef HOST_AVR_IO_H_
+#define HOST_AVR_IO_H_
+
+#include <stdint.h>
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+#define _BV(bit) (1 << (bit))
+
+namespace host {
+
+/*!
+ * @return The levels of digital pins 0 to 7, one bit each
+ */
+uint8_t PortD();
+
+/*!
+ * @class TwiControl
+ * @brief TWCR, which acts on the simulated bus when written, as the TWI does.
+ */
+class TwiControl {
+ public:
+  TwiControl& operator=(uint8_t value);
+  TwiControl& operator|=(uint8_t bits) { return *this = (uint8_t) (*this | bits); }
+  TwiControl& operator&=(uint8_t bits) { return *this = (uint8_t) (*this & bits); }
+
+  /*!
+   * @return The control bits as last written, TWINT if an action completed since, and TWSTO while a stop is
+   *         going out
+   */
+  operator uint8_t() const;
+};
+
+/*!
+ * @return The TWI control register
+ */
+TwiControl& Twcr();
+
+/*!
+ * @class UsartData
+ * @brief UDR0, which puts the byte written out on the simulated console, as USART0 does.
+ */
+class UsartData {
+ public:
+  UsartData& operator=(uint8_t value);
+};
+
+/*!
+ * @class UsartStatus
+ * @brief UCSR0A, whose UDRE0 and TXC0 follow the simulated console's transmitter.
+ */
+class UsartStatus {
+ public:
+  UsartStatus& operator=(uint8_t value);
+  UsartStatus& operator|=(uint8_t bits) { return *this = (uint8_t) (*this | bits); }
+  UsartStatus& operator&=(uint8_t bits) { return *this = (uint8_t) (*this & bits); }
+
+  /*!
+   * @return U2X0 as last written, UDRE0 if the data register can take a byte, and TXC0 if every byte is out
+   */
+  operator uint8_t() const;
+};
+
+/*!
+ * @return USART0's data register
+ */
+UsartData& Udr0();
+
+/*!
+ * @return USART0's control and status register A
+ */
+UsartStatus& Ucsr0a();
+
+}  // namespace host
+
+extern volatile uint8_t PCICR;
+extern volatile uint8_t PCMSK2;
+#define PIND (host::PortD())
+
+#define PCIE2 2
+
+extern volatile uint8_t TWBR;
+extern volatile uint8_t TWSR;
+extern volatile uint8_t TWDR;
+extern volatile uint8_t TWAR;
+#define TWCR (host::Twcr())
+
+#define TWINT 7
+#define TWEA  6
+#define TWSTA 5
+#define TWSTO 4
+#define TWWC  3
+#define TWEN  2
+#define TWIE  0
+#define TWPS1 1
+#define TWPS0 0
+
+extern volatile uint16_t UBRR0;
+extern volatile uint8_t UCSR0B;
+extern volatile uint8_t UCSR0C;
+#define UDR0   (host::Udr0())
+#define UCSR0A (host::Ucsr0a())
+
+#define TXC0   6
+#define UDRE0  5
+#define U2X0   1
+#define TXEN0  3
+#define UCSZ01 2
+#define UCSZ00 1
+
+#define PD0 0
+#define PD1 1
+#define PD2 2
+#define PD3 3
+#define PD4 4
+#define PD5 5
+#define PD6 6
+#define PD7 7
+
+#endif
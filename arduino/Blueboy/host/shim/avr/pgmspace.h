@@ -0,0 +1,32 @@
+/*!
+ * @file pgmspace.h
+ * @author Sebastian S.
+ * @brief Host stand-in for avr-libc's program memory helpers.
+ *
+ * The host has a single address space, so flash data is ordinary const data and the _P functions are
+ * their plain counterparts.
+ */
+
+#ifndef HOST_AVR_PGMSPACE_H_
+#define HOST_AVR_PGMSPACE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+
+#define pgm_read_byte(addr)   (*(const uint8_t *)(addr))
+#define pgm_read_word(addr)   (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr)  (*(const uint32_t *)(addr))
+#define pgm_read_float(addr)  (*(const float *)(addr))
+
+#define strcpy_P(dst, src)        strcpy((dst), (src))
+#define strncpy_P(dst, src, n)    strncpy((dst), (src), (n))
+#define strlen_P(src)             strlen((src))
+#define memcpy_P(dst, src, n)     memcpy((dst), (src), (n))
+#define sprintf_P                 sprintf
+
+#endif
@@ -0,0 +1,142 @@
+/*!
+ * @file RegisterDevice.h
+ * @author Sebastian S.
+ * @brief Base class for simulated I2C devices with an 8-bit register map.
+ */
+
+#ifndef HOST_REGISTER_DEVICE_H_
+#define HOST_REGISTER_DEVICE_H_
+
+#include <Wire.h>
+
+namespace host {
+
+/*!
+ * @class RegisterDevice
+ * @brief An I2C slave where the first written byte selects a register and further bytes read or write
+ *        consecutive registers.
+ *
+ * Subclasses hook register reads and writes to model live data and control side effects.
+ */
+class RegisterDevice : public I2CDevice {
+ public:
+  RegisterDevice() : _ptr(0) { memset(_regs, 0, sizeof(_regs)); }
+
+  void Receive(const uint8_t *buf, size_t len) override {
+    if (len == 0) {
+      return;
+    }
+    _ptr = buf[0];
+    for (size_t i = 1; i < len; i++) {
+      WriteRegister(_ptr, buf[i]);
+      _ptr = NextRegister(_ptr);
+    }
+  }
+
+  void Request(uint8_t *buf, size_t len) override {
+    BeginRequest();
+    for (size_t i = 0; i < len; i++) {
+      buf[i] = RequestByte();
+    }
+  }
+
+  void BeginRequest() override { BeginRead(_ptr); }
+
+  uint8_t RequestByte() override {
+    uint8_t value = ReadRegister(_ptr);
+    _ptr = NextRegister(_ptr);
+    return value;
+  }
+
+  /*!
+   * @return The current value of a register, without read side effects
+   */
+  uint8_t Peek(uint8_t reg) const { return _regs[reg]; }
+ protected:
+  uint8_t _regs[256];   // register map
+  uint8_t _ptr;         // register pointer
+
+  /*!
+   * @brief Called once at the start of every read transaction, before any register is read
+   * @param reg First register that will be read
+   */
+  virtual void BeginRead(uint8_t reg) { }
+
+  /*!
+   * @brief Reads a register on behalf of the master
+   */
+  virtual uint8_t ReadRegister(uint8_t reg) { return _regs[reg]; }
+
+  /*!
+   * @brief Writes a register on behalf of the master
+   */
+  virtual void WriteRegister(uint8_t reg, uint8_t value) { _regs[reg] = value; }
+
+  /*!
+   * @return The register accessed after the given one within a burst
+   */
+  virtual uint8_t NextRegister(uint8_t reg) { return reg + 1; }
+
+  /*!
+   * @brief Stores a little-endian 16-bit value across two registers
+   */
+  void SetShort(uint8_t reg, int16_t value) {
+    _regs[reg] = value & 0xFF;
+    _regs[(uint8_t) (reg + 1)] = (value >> 8) & 0xFF;
+  }
+};
+
+/*!
+ * @var uint8_t NoPin
+ * Pin number for an output left unconnected
+ */
+constexpr uint8_t NoPin = 0xFF;
+
+/*!
+ * @class SimNoise
+ * @brief Deterministic, approximately Gaussian noise so host runs are repeatable.
+ */
+class SimNoise {
+ public:
+  explicit SimNoise(uint32_t seed = 0x1234567) : _state(seed ? seed : 1) { }
+
+  /*!
+   * @return A sample with zero mean and the given standard deviation
+   */
+  float Gaussian(float stddev) {
+    if (stddev == 0) {
+      return 0;
+    }
+    // Irwin-Hall with four uniforms has variance 1/3, close enough to normal for sensor noise
+    float sum = 0;
+    for (int i = 0; i < 4; i++) {
+      sum += uniform();
+    }
+    return (sum - 2.0f) * 1.7320508f * stddev;
+  }
+ private:
+  uint32_t _state;
+
+  float uniform() {
+    _state ^= _state << 13;
+    _state ^= _state >> 17;
+    _state ^= _state << 5;
+    return (_state >> 8) * (1.0f / 16777216.0f);
+  }
+};
+
+/*!
+ * @brief Converts a physical value to saturated int16 sensor counts
+ * @param value Physical value
+ * @param lsb Physical value of one count
+ */
+inline int16_t ToCounts(float value, float lsb) {
+  float counts = value / lsb;
+  if (counts > 32767.0f) return 32767;
+  if (counts < -32768.0f) return -32768;
+  return (int16_t) lroundf(counts);
+}
+
+}  // namespace host
+
+#endif
@@ -0,0 +1,65 @@
+/*!
+ * @file SimBoard.h
+ * @author Sebastian S.
+ * @brief The set of simulated peripherals wired to Blueboy's I2C bus.
+ */
+
+#ifndef HOST_SIM_BOARD_H_
+#define HOST_SIM_BOARD_H_
+
+#include "SimLSM6DS33.h"
+#include "SimLIS2MDL.h"
+#include "SimOneU.h"
+
+namespace host {
+
+/*!
+ * @struct SimBoard
+ * @brief Owns one of each simulated peripheral and attaches them to a bus at their real addresses, with the
+ *        sensors' data-ready outputs wired to the pins the firmware watches.
+ */
+struct SimBoard {
+  /*!
+   * @var uint8_t ImuDataReadyPin
+   * Pin the IMU's INT1 is wired to, the firmware's IMU_DRDY_PIN
+   */
+  static constexpr uint8_t ImuDataReadyPin = 6;
+
+  /*!
+   * @var uint8_t MagDataReadyPin
+   * Pin the magnetometer's INT/DRDY is wired to, the firmware's MAG_DRDY_PIN
+   */
+  static constexpr uint8_t MagDataReadyPin = 7;
+
+  SimLSM6DS33 lsm6ds33;
+  SimLIS2MDL lis2mdl;
+  SimOneU oneU;
+
+  /*!
+   * @brief Attaches every device to the given bus
+   * @param wire Bus to attach to
+   */
+  void Attach(TwoWire& wire) {
+    wire.Attach(SimLSM6DS33::Address, &lsm6ds33);
+    wire.Attach(SimLIS2MDL::Address, &lis2mdl);
+    wire.Attach(SimOneU::Address, &oneU);
+    lsm6ds33.SetDataReadyPin(ImuDataReadyPin);
+    lis2mdl.SetDataReadyPin(MagDataReadyPin);
+  }
+
+  /*!
+   * @brief Detaches every device from the given bus
+   * @param wire Bus to detach from
+   */
+  void Detach(TwoWire& wire) {
+    wire.Attach(SimLSM6DS33::Address, nullptr);
+    wire.Attach(SimLIS2MDL::Address, nullptr);
+    wire.Attach(SimOneU::Address, nullptr);
+    lsm6ds33.SetDataReadyPin(NoPin);
+    lis2mdl.SetDataReadyPin(NoPin);
+  }
+};
+
+}  // namespace host
+
+#endif
@@ -0,0 +1,134 @@
+/*!
+ * @file SimLIS2MDL.cpp
+ * @author Sebastian S.
+ * @brief Implementation of SimLIS2MDL.h
+ */
+
+#include "SimLIS2MDL.h"
+
+namespace host {
+
+static constexpr uint8_t WHO_AM_I = 0x4F;
+static constexpr uint8_t CFG_REG_A = 0x60;
+static constexpr uint8_t CFG_REG_C = 0x62;
+static constexpr uint8_t STATUS_REG = 0x67;
+static constexpr uint8_t OUTX_L_REG = 0x68;
+static constexpr uint8_t OUTZ_H_REG = 0x6D;
+
+static constexpr uint8_t ZYXDA = 1 << 3;
+static constexpr uint8_t DRDY_ON_PIN = 1 << 0;
+
+static constexpr float MAG_LSB = 0.15f;  // uT per count
+
+SimLIS2MDL::SimLIS2MDL() : _magNoise(0.3), _noise(0x2468ACE), _index(0), _count(0), _drdyPin(NoPin) {
+  // roughly the field in Seattle, pointing north and down
+  _field[0] = 18.0; _field[1] = 0.0; _field[2] = -50.0;
+  _hard[0] = _hard[1] = _hard[2] = 0;
+  static const float identity[9] = { 1, 0, 0, 0, 1, 0, 0, 0, 1 };
+  memcpy(_soft, identity, sizeof(_soft));
+  reset();
+}
+
+void SimLIS2MDL::reset() {
+  memset(_regs, 0, sizeof(_regs));
+  _regs[WHO_AM_I] = 0x40;
+  _regs[CFG_REG_A] = 0x03;  // idle mode
+  refreshPin();
+}
+
+SimLIS2MDL::~SimLIS2MDL() {
+  Clock::Unlisten(this);
+}
+
+void SimLIS2MDL::SetDataReadyPin(uint8_t pin) {
+  _drdyPin = pin;
+  if (pin == NoPin) {
+    Clock::Unlisten(this);
+  } else {
+    Clock::Listen(this);
+    refreshPin();
+  }
+}
+
+uint32_t SimLIS2MDL::odr() {
+  if ((_regs[CFG_REG_A] & 0x03) != 0) {
+    return 0;  // only continuous mode is modelled
+  }
+  static const uint32_t rates[] = { 10, 20, 50, 100 };
+  return rates[(_regs[CFG_REG_A] >> 2) & 0x03];
+}
+
+uint64_t SimLIS2MDL::NextEvent() {
+  uint32_t rate = odr();
+  if (!(_regs[CFG_REG_C] & DRDY_ON_PIN) || rate == 0) {
+    return UINT64_MAX;
+  }
+  uint64_t now = Clock::Now();
+  uint64_t index = now * rate / 1000000ULL;
+  if (index != _index) {
+    return now;   // already due, e.g. after the data rate changed
+  }
+  return ((index + 1) * 1000000ULL + rate - 1) / rate;
+}
+
+void SimLIS2MDL::OnEvent() {
+  Update();
+}
+
+void SimLIS2MDL::refreshPin() {
+  if (_drdyPin != NoPin) {
+    SetPin(_drdyPin, (_regs[CFG_REG_C] & DRDY_ON_PIN) && (_regs[STATUS_REG] & ZYXDA) ? HIGH : LOW);
+  }
+}
+
+void SimLIS2MDL::Update() {
+  uint32_t rate = odr();
+  if (rate == 0) {
+    return;
+  }
+
+  uint64_t index = Clock::Now() * rate / 1000000ULL;
+  if (index == _index) {
+    return;
+  }
+  _index = index;
+
+  for (int i = 0; i < 3; i++) {
+    float value = _hard[i];
+    for (int j = 0; j < 3; j++) {
+      value += _soft[3 * i + j] * _field[j];
+    }
+    SetShort(OUTX_L_REG + 2 * i, ToCounts(value + _noise.Gaussian(_magNoise), MAG_LSB));
+  }
+  _regs[STATUS_REG] |= ZYXDA;
+  _count++;
+  refreshPin();
+  OnSample();
+}
+
+void SimLIS2MDL::BeginRead(uint8_t reg) {
+  Update();
+}
+
+uint8_t SimLIS2MDL::ReadRegister(uint8_t reg) {
+  uint8_t value = _regs[reg];
+  if (reg == OUTZ_H_REG) {
+    _regs[STATUS_REG] &= ~ZYXDA;
+    refreshPin();
+  }
+  return value;
+}
+
+void SimLIS2MDL::WriteRegister(uint8_t reg, uint8_t value) {
+  if (reg == WHO_AM_I || reg == STATUS_REG || (reg >= OUTX_L_REG && reg <= OUTZ_H_REG)) {
+    return;  // read-only
+  }
+  if (reg == CFG_REG_A && (value & 0x20)) {
+    reset();
+    return;
+  }
+  _regs[reg] = value;
+  refreshPin();
+}
+
+}  // namespace host
@@ -0,0 +1,99 @@
+/*!
+ * @file SimLIS2MDL.h
+ * @author Sebastian S.
+ * @brief Simulated LIS2MDL magnetometer for the host build.
+ */
+
+#ifndef HOST_SIM_LIS2MDL_H_
+#define HOST_SIM_LIS2MDL_H_
+
+#include "RegisterDevice.h"
+
+namespace host {
+
+/*!
+ * @class SimLIS2MDL
+ * @brief Register-level model of the LIS2MDL with hard- and soft-iron distortion.
+ *
+ * The reported field is softIron * field + hardIron, quantized to 1.5 mG counts on the configured output
+ * data rate grid of the virtual clock.
+ *
+ * INT/DRDY can be wired to a pin, which follows the data-ready flag while CFG_REG_C routes it there, latched until
+ * the sample is read. Samples are produced on the clock's time while it is wired, so the pin rises on time.
+ */
+class SimLIS2MDL : public RegisterDevice, public ClockListener {
+ public:
+  SimLIS2MDL();
+  ~SimLIS2MDL();
+
+  /*!
+   * @brief Sets the true magnetic field in the sensor frame
+   * @param x,y,z Field in uT
+   */
+  void SetField(float x, float y, float z) { _field[0] = x; _field[1] = y; _field[2] = z; }
+
+  /*!
+   * @brief Sets the hard-iron offset added to every reading
+   * @param x,y,z Offset in uT
+   */
+  void SetHardIron(float x, float y, float z) { _hard[0] = x; _hard[1] = y; _hard[2] = z; }
+
+  /*!
+   * @brief Sets the soft-iron matrix applied to the true field
+   * @param m Row-major 3x3 matrix
+   */
+  void SetSoftIron(const float m[9]) { memcpy(_soft, m, sizeof(_soft)); }
+
+  /*!
+   * @brief Sets the per-axis noise standard deviation
+   * @param noise Noise in uT
+   */
+  void SetNoise(float noise) { _magNoise = noise; }
+
+  /*!
+   * @return Number of samples produced so far
+   */
+  uint32_t Samples() const { return _count; }
+
+  /*!
+   * @brief Wires INT/DRDY to the given pin
+   * @param pin Pin to drive with SetPin, NoPin to leave INT/DRDY unconnected
+   */
+  void SetDataReadyPin(uint8_t pin);
+
+  /*!
+   * @brief Produces a sample if one is due at the current virtual time
+   */
+  void Update();
+
+  uint64_t NextEvent() override;
+  void OnEvent() override;
+
+  static constexpr uint8_t Address = 0x1E;
+ protected:
+  void BeginRead(uint8_t reg) override;
+  uint8_t ReadRegister(uint8_t reg) override;
+  void WriteRegister(uint8_t reg, uint8_t value) override;
+
+  /*!
+   * @brief Called for every new sample, after output registers are updated
+   */
+  virtual void OnSample() { }
+
+  float _field[3];
+  float _hard[3];
+  float _soft[9];
+  float _magNoise;
+  SimNoise _noise;
+  uint64_t _index;
+  uint32_t _count;
+  uint8_t _drdyPin;   // pin INT/DRDY is wired to, NoPin if none
+
+  void reset();
+  uint32_t odr();     // samples per second, 0 unless converting continuously
+  void refreshPin();  // drives INT/DRDY to match the data-ready flag, if routed there
+};
+
+}  // namespace host
+
+#endif
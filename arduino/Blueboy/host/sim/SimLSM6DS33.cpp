@@ -0,0 +1,315 @@
+/*!
+ * @file SimLSM6DS33.cpp
+ * @author Sebastian S.
+ * @brief Implementation of SimLSM6DS33.h
+ */
+
+#include "SimLSM6DS33.h"
+#include <Adafruit_Sensor.h>
+
+namespace host {
+
+static constexpr uint8_t FIFO_CTRL3 = 0x08;
+static constexpr uint8_t INT1_CTRL = 0x0D;
+static constexpr uint8_t FIFO_CTRL5 = 0x0A;
+static constexpr uint8_t WHO_AM_I = 0x0F;
+static constexpr uint8_t CTRL1_XL = 0x10;
+static constexpr uint8_t CTRL2_G = 0x11;
+static constexpr uint8_t CTRL3_C = 0x12;
+static constexpr uint8_t STATUS_REG = 0x1E;
+static constexpr uint8_t OUT_TEMP_L = 0x20;
+static constexpr uint8_t OUTX_L_G = 0x22;
+static constexpr uint8_t OUTX_L_XL = 0x28;
+static constexpr uint8_t OUTZ_H_XL = 0x2D;
+static constexpr uint8_t OUTZ_H_G = 0x27;
+static constexpr uint8_t OUT_TEMP_H = 0x21;
+static constexpr uint8_t FIFO_STATUS1 = 0x3A;
+static constexpr uint8_t FIFO_STATUS4 = 0x3D;
+static constexpr uint8_t FIFO_DATA_OUT_L = 0x3E;
+static constexpr uint8_t FIFO_DATA_OUT_H = 0x3F;
+static constexpr uint8_t TIMESTAMP0_REG = 0x40;
+static constexpr uint8_t TIMESTAMP2_REG = 0x42;
+static constexpr uint8_t TAP_CFG = 0x58;
+static constexpr uint8_t WAKE_UP_DUR = 0x5C;
+
+static constexpr uint8_t FIFO_MODE_FIFO = 0x01;         // stops when full
+static constexpr uint8_t FIFO_MODE_CONTINUOUS = 0x06;   // overwrites the oldest data when full
+static constexpr uint8_t TIMER_EN = 1 << 7;
+static constexpr uint8_t TIMER_HR = 1 << 4;
+static constexpr uint8_t TIMESTAMP_RESET = 0xAA;
+
+static constexpr uint8_t XLDA = 1 << 0;
+static constexpr uint8_t GDA = 1 << 1;
+static constexpr uint8_t TDA = 1 << 2;
+static constexpr uint8_t INT1_DRDY_G = 1 << 1;
+
+SimLSM6DS33::SimLSM6DS33() : _temp(25.0), _accNoise(0.02), _gyroNoise(0.002), _accIndex(0), _gyroIndex(0),
+                             _accCount(0), _gyroCount(0), _drdyPin(NoPin) {
+  _acc[0] = 0; _acc[1] = 0; _acc[2] = SENSORS_GRAVITY_STANDARD;
+  _gyro[0] = _gyro[1] = _gyro[2] = 0;
+  reset();
+}
+
+SimLSM6DS33::~SimLSM6DS33() {
+  Clock::Unlisten(this);
+}
+
+void SimLSM6DS33::SetDataReadyPin(uint8_t pin) {
+  _drdyPin = pin;
+  if (pin == NoPin) {
+    Clock::Unlisten(this);
+  } else {
+    Clock::Listen(this);
+    refreshPin();
+  }
+}
+
+uint64_t SimLSM6DS33::NextEvent() {
+  uint32_t gyroOdr = odrMilliHz(_regs[CTRL2_G] >> 4);
+  if (!(_regs[INT1_CTRL] & INT1_DRDY_G) || gyroOdr == 0) {
+    return UINT64_MAX;
+  }
+  uint64_t now = Clock::Now();
+  uint64_t index = now * gyroOdr / 1000000000ULL;
+  if (index != _gyroIndex) {
+    return now;   // already due, e.g. after the data rate changed
+  }
+  return ((index + 1) * 1000000000ULL + gyroOdr - 1) / gyroOdr;
+}
+
+void SimLSM6DS33::OnEvent() {
+  Update();
+}
+
+void SimLSM6DS33::refreshPin() {
+  if (_drdyPin != NoPin) {
+    SetPin(_drdyPin, (_regs[INT1_CTRL] & INT1_DRDY_G) && (_regs[STATUS_REG] & GDA) ? HIGH : LOW);
+  }
+}
+
+void SimLSM6DS33::reset() {
+  memset(_regs, 0, sizeof(_regs));
+  _regs[WHO_AM_I] = 0x69;
+  _regs[CTRL3_C] = 0x04;  // IF_INC set by default
+  _fifo.clear();
+  _fifoPattern = 0;
+  _fifoOverrun = false;
+  _timerStart = Clock::Now();
+  _fifoFrom = _timerStart;
+  refreshPin();
+}
+
+uint32_t SimLSM6DS33::timestamp(uint64_t when) {
+  if (!(_regs[TAP_CFG] & TIMER_EN) || when < _timerStart) {
+    return 0;
+  }
+  uint64_t tick = (_regs[WAKE_UP_DUR] & TIMER_HR) ? 25 : 6400;   // us
+  return ((when - _timerStart) / tick) & 0xFFFFFF;
+}
+
+void SimLSM6DS33::pushFifo(uint64_t when) {
+  uint8_t mode = _regs[FIFO_CTRL5] & 0x07;
+  if (_fifo.size() + FifoSetWords > FifoCapacity) {
+    if (mode != FIFO_MODE_CONTINUOUS) {
+      return;
+    }
+    // whole data sets are dropped, so the pattern stays where it was
+    for (size_t i = 0; i < FifoSetWords; i++) {
+      _fifo.pop_front();
+    }
+    _fifoOverrun = true;
+  }
+
+  float gyro = gyroLsb();
+  float acc = accelLsb();
+  for (int i = 0; i < 3; i++) {
+    _fifo.push_back((uint16_t) ToCounts(_gyro[i] + _noise.Gaussian(_gyroNoise), gyro));
+  }
+  for (int i = 0; i < 3; i++) {
+    _fifo.push_back((uint16_t) ToCounts(_acc[i] + _noise.Gaussian(_accNoise), acc));
+  }
+
+  // fourth data set: TIMESTAMP[15:8], TIMESTAMP[23:16], unused, TIMESTAMP[7:0], then the step counter
+  uint32_t ts = timestamp(when);
+  _fifo.push_back(((ts >> 8) & 0xFF) | (((ts >> 16) & 0xFF) << 8));
+  _fifo.push_back((ts & 0xFF) << 8);
+  _fifo.push_back(0);
+}
+
+uint8_t SimLSM6DS33::fifoStatus(uint8_t reg) {
+  size_t words = _fifo.size();
+  switch (reg - FIFO_STATUS1) {
+    case 0:
+      return words & 0xFF;
+    case 1:
+      return ((words >> 8) & 0x0F) | (words == 0 ? 0x10 : 0) | (words + FifoSetWords > FifoCapacity ? 0x20 : 0) |
+             (_fifoOverrun ? 0x40 : 0);
+    case 2:
+      return _fifoPattern;
+    default:
+      return 0;
+  }
+}
+
+uint32_t SimLSM6DS33::odrMilliHz(uint8_t odrBits) {
+  static const uint32_t rates[] = { 0, 12500, 26000, 52000, 104000, 208000, 416000, 833000,
+                                    1660000, 3330000, 6660000 };
+  return odrBits < sizeof(rates) / sizeof(rates[0]) ? rates[odrBits] : 0;
+}
+
+float SimLSM6DS33::accelLsb() {
+  static const float mg[] = { 0.061, 0.488, 0.122, 0.244 };  // FS_XL: 2g, 16g, 4g, 8g
+  return mg[(_regs[CTRL1_XL] >> 2) & 0x03] * SENSORS_GRAVITY_STANDARD / 1000.0f;
+}
+
+float SimLSM6DS33::gyroLsb() {
+  float mdps;
+  if (_regs[CTRL2_G] & 0x02) {
+    mdps = 4.375;
+  } else {
+    static const float fs[] = { 8.75, 17.5, 35.0, 70.0 };  // FS_G: 245, 500, 1000, 2000 dps
+    mdps = fs[(_regs[CTRL2_G] >> 2) & 0x03];
+  }
+  return mdps * SENSORS_DPS_TO_RADS / 1000.0f;
+}
+
+void SimLSM6DS33::Update() {
+  uint64_t now = Clock::Now();
+  bool produced = false;
+
+  uint32_t accOdr = odrMilliHz(_regs[CTRL1_XL] >> 4);
+  if (accOdr) {
+    uint64_t index = now * accOdr / 1000000000ULL;
+    if (index != _accIndex) {
+      _accIndex = index;
+      float lsb = accelLsb();
+      for (int i = 0; i < 3; i++) {
+        SetShort(OUTX_L_XL + 2 * i, ToCounts(_acc[i] + _noise.Gaussian(_accNoise), lsb));
+      }
+      SetShort(OUT_TEMP_L, (int16_t) lroundf((_temp - 25.0f) * 16.0f));
+      _regs[STATUS_REG] |= XLDA | TDA;
+      _accCount++;
+      produced = true;
+    }
+  }
+
+  uint32_t gyroOdr = odrMilliHz(_regs[CTRL2_G] >> 4);
+  if (gyroOdr) {
+    uint64_t index = now * gyroOdr / 1000000000ULL;
+    if (index != _gyroIndex) {
+      uint8_t mode = _regs[FIFO_CTRL5] & 0x07;
+      if ((mode == FIFO_MODE_FIFO || mode == FIFO_MODE_CONTINUOUS) && (_regs[FIFO_CTRL5] & 0x78) &&
+          (_regs[FIFO_CTRL3] & 0x3F)) {
+        // every sample since the last update goes in, not just the latest; more than the FIFO holds would only
+        // be overwritten; nothing from before the FIFO or the data rate was configured
+        uint64_t first = _gyroIndex + 1;
+        uint64_t configured = _fifoFrom * gyroOdr / 1000000000ULL + 1;
+        if (first < configured) {
+          first = configured;
+        }
+        if (first <= index && index - first > FifoCapacity / FifoSetWords) {
+          first = index - FifoCapacity / FifoSetWords;
+        }
+        for (uint64_t i = first; i <= index; i++) {
+          pushFifo(i * 1000000000ULL / gyroOdr);
+        }
+      }
+      _gyroIndex = index;
+      float lsb = gyroLsb();
+      for (int i = 0; i < 3; i++) {
+        SetShort(OUTX_L_G + 2 * i, ToCounts(_gyro[i] + _noise.Gaussian(_gyroNoise), lsb));
+      }
+      _regs[STATUS_REG] |= GDA;
+      _gyroCount++;
+      produced = true;
+    }
+  }
+
+  if (produced) {
+    refreshPin();
+    OnSample();
+  }
+}
+
+void SimLSM6DS33::BeginRead(uint8_t reg) {
+  Update();
+}
+
+uint8_t SimLSM6DS33::ReadRegister(uint8_t reg) {
+  if (reg >= FIFO_STATUS1 && reg <= FIFO_STATUS4) {
+    return fifoStatus(reg);
+  }
+  if (reg == FIFO_DATA_OUT_L) {
+    return _fifo.empty() ? 0 : _fifo.front() & 0xFF;
+  }
+  if (reg == FIFO_DATA_OUT_H) {
+    if (_fifo.empty()) {
+      return 0;
+    }
+    uint8_t high = _fifo.front() >> 8;
+    _fifo.pop_front();
+    _fifoPattern = (_fifoPattern + 1) % FifoSetWords;
+    _fifoOverrun = false;
+    return high;
+  }
+  if (reg >= TIMESTAMP0_REG && reg <= TIMESTAMP2_REG) {
+    return timestamp(Clock::Now()) >> (8 * (reg - TIMESTAMP0_REG));
+  }
+
+  uint8_t value = _regs[reg];
+
+  // data-ready flags clear once the high byte of the last axis has been read
+  switch (reg) {
+    case OUTZ_H_XL:
+      _regs[STATUS_REG] &= ~XLDA;
+      break;
+    case OUTZ_H_G:
+      _regs[STATUS_REG] &= ~GDA;
+      refreshPin();
+      break;
+    case OUT_TEMP_H:
+      _regs[STATUS_REG] &= ~TDA;
+      break;
+  }
+  return value;
+}
+
+void SimLSM6DS33::WriteRegister(uint8_t reg, uint8_t value) {
+  if (reg == WHO_AM_I || reg == STATUS_REG || (reg >= OUT_TEMP_L && reg <= OUTZ_H_XL)) {
+    return;  // read-only
+  }
+  if (reg == CTRL3_C && (value & 0x01)) {
+    reset();
+    return;
+  }
+  if (reg == TIMESTAMP2_REG) {
+    if (value == TIMESTAMP_RESET) {
+      _timerStart = Clock::Now();
+    }
+    return;
+  }
+  if (reg >= FIFO_STATUS1 && reg < TIMESTAMP2_REG) {
+    return;  // read-only
+  }
+  if (reg == FIFO_CTRL5 || reg == CTRL2_G) {
+    _fifoFrom = Clock::Now();
+  }
+  if (reg == FIFO_CTRL5 && (value & 0x07) == 0) {
+    // bypass mode empties the FIFO
+    _fifo.clear();
+    _fifoPattern = 0;
+    _fifoOverrun = false;
+  }
+  _regs[reg] = value;
+  refreshPin();
+}
+
+uint8_t SimLSM6DS33::NextRegister(uint8_t reg) {
+  if (!(_regs[CTRL3_C] & 0x04)) {
+    return reg;
+  }
+  // burst reads of the FIFO output roll over, so any number of words can be read in one
+  return reg == FIFO_DATA_OUT_H ? FIFO_DATA_OUT_L : reg + 1;
+}
+
+}  // namespace host
@@ -0,0 +1,145 @@
+/*!
+ * @file SimLSM6DS33.h
+ * @author Sebastian S.
+ * @brief Simulated LSM6DS33 IMU for the host build.
+ */
+
+#ifndef HOST_SIM_LSM6DS33_H_
+#define HOST_SIM_LSM6DS33_H_
+
+#include <deque>
+
+#include "RegisterDevice.h"
+
+namespace host {
+
+/*!
+ * @class SimLSM6DS33
+ * @brief Register-level model of the LSM6DS33: output data rates, full-scale ranges, data-ready flags,
+ *        register auto-increment, the timestamp counter and the FIFO.
+ *
+ * New samples are produced on the configured output data rate grid of the virtual clock from a settable
+ * true acceleration, angular rate and temperature plus Gaussian noise.
+ *
+ * The FIFO is modeled for the one configuration the firmware uses: gyroscope, accelerometer and timestamp data
+ * sets undecimated, stored on every gyroscope sample in FIFO or continuous mode. Continuous mode overwrites the
+ * oldest whole data set when full.
+ *
+ * INT1 can be wired to a pin, which follows the gyroscope data-ready flag while INT1_CTRL routes it there, latched
+ * until the sample is read. Samples are produced on the clock's time while it is wired, so the pin rises on time.
+ */
+class SimLSM6DS33 : public RegisterDevice, public ClockListener {
+ public:
+  SimLSM6DS33();
+  ~SimLSM6DS33();
+
+  /*!
+   * @brief Sets the true specific force seen by the accelerometer
+   * @param x,y,z Acceleration in m/s^2
+   */
+  void SetAcceleration(float x, float y, float z) { _acc[0] = x; _acc[1] = y; _acc[2] = z; }
+
+  /*!
+   * @brief Sets the true angular rate seen by the gyroscope, including any bias
+   * @param x,y,z Angular rate in rad/s
+   */
+  void SetAngularRate(float x, float y, float z) { _gyro[0] = x; _gyro[1] = y; _gyro[2] = z; }
+
+  /*!
+   * @brief Sets the die temperature
+   * @param celsius Temperature in degrees Celsius
+   */
+  void SetTemperature(float celsius) { _temp = celsius; }
+
+  /*!
+   * @brief Sets the per-axis noise standard deviations
+   * @param acc Accelerometer noise in m/s^2
+   * @param gyro Gyroscope noise in rad/s
+   */
+  void SetNoise(float acc, float gyro) { _accNoise = acc; _gyroNoise = gyro; }
+
+  /*!
+   * @return Number of accelerometer samples produced so far
+   */
+  uint32_t AccelSamples() const { return _accCount; }
+
+  /*!
+   * @return Number of gyroscope samples produced so far
+   */
+  uint32_t GyroSamples() const { return _gyroCount; }
+
+  /*!
+   * @return Number of 16-bit words waiting in the FIFO
+   */
+  size_t FifoWords() const { return _fifo.size(); }
+
+  /*!
+   * @var size_t FifoCapacity
+   * Size of the FIFO in 16-bit words
+   */
+  static constexpr size_t FifoCapacity = 4096;
+
+  /*!
+   * @var size_t FifoSetWords
+   * Words stored in the FIFO per sample: gyroscope x, y, z, accelerometer x, y, z, then timestamp and step count
+   */
+  static constexpr size_t FifoSetWords = 9;
+
+  /*!
+   * @brief Wires INT1 to the given pin
+   * @param pin Pin to drive with SetPin, NoPin to leave INT1 unconnected
+   */
+  void SetDataReadyPin(uint8_t pin);
+
+  /*!
+   * @brief Produces any samples that are due at the current virtual time
+   */
+  void Update();
+
+  uint64_t NextEvent() override;
+  void OnEvent() override;
+
+  static constexpr uint8_t Address = 0x6A;
+ protected:
+  void BeginRead(uint8_t reg) override;
+  uint8_t ReadRegister(uint8_t reg) override;
+  void WriteRegister(uint8_t reg, uint8_t value) override;
+  uint8_t NextRegister(uint8_t reg) override;
+
+  /*!
+   * @brief Called for every new accelerometer/gyroscope sample pair, after output registers are updated
+   */
+  virtual void OnSample() { }
+
+  float _acc[3];
+  float _gyro[3];
+  float _temp;
+  float _accNoise;
+  float _gyroNoise;
+  SimNoise _noise;
+
+  uint64_t _accIndex;     // index of the last produced accelerometer sample on its ODR grid
+  uint64_t _gyroIndex;    // index of the last produced gyroscope sample on its ODR grid
+  uint32_t _accCount;
+  uint32_t _gyroCount;
+
+  std::deque<uint16_t> _fifo;   // words waiting to be read, oldest first
+  uint8_t _fifoPattern;         // position within its data set of the word at the front of the FIFO
+  bool _fifoOverrun;            // true if data was overwritten since the FIFO was last read
+  uint64_t _timerStart;         // virtual time the timestamp counter was last reset
+  uint64_t _fifoFrom;           // virtual time the FIFO or gyroscope data rate was last configured
+  uint8_t _drdyPin;             // pin INT1 is wired to, NoPin if none
+
+  void reset();
+  uint32_t timestamp(uint64_t when);  // timestamp counter at the given virtual time
+  void pushFifo(uint64_t when);
+  uint8_t fifoStatus(uint8_t reg);
+  void refreshPin();      // drives INT1 to match the gyroscope data-ready flag, if routed there
+  float accelLsb();       // m/s^2 per count at the current range
+  float gyroLsb();        // rad/s per count at the current range
+  static uint32_t odrMilliHz(uint8_t odrBits);
+};
+
+}  // namespace host
+
+#endif
@@ -0,0 +1,54 @@
+/*!
+ * @file SimOneU.cpp
+ * @author Sebastian S.
+ * @brief Implementation of SimOneU.h
+ */
+
+#include "SimOneU.h"
+
+namespace host {
+
+SimOneU::SimOneU() : _receivingAddr(true) {
+  _regs[0x00] = Address;  // WhoAmI
+  _regs[0x01] = 0x07;     // all sensors healthy
+  SetSensorData(Magnetometer, 0.0, 1.0, 2.0);
+  SetSensorData(Accelerometer, 3.0, 4.0, 5.0);
+  SetSensorData(Gyroscope, 6.0, 7.0, 8.0);
+}
+
+void SimOneU::Receive(const uint8_t *buf, size_t len) {
+  if (len == 0) {
+    return;
+  }
+
+  size_t i = 0;
+  if (_receivingAddr) {
+    _ptr = buf[i++];
+    _receivingAddr = false;
+    if (i == len) {
+      return;
+    }
+  }
+
+  for (; i < len; i++) {
+    if (_ptr < 0x80) {
+      // the data registers are the interface's to write
+      WriteRegister(_ptr, buf[i]);
+    }
+    _ptr = NextRegister(_ptr);
+  }
+  _receivingAddr = true;
+}
+
+void SimOneU::BeginRequest() {
+  RegisterDevice::BeginRequest();
+  _receivingAddr = true;
+}
+
+void SimOneU::SetSensorData(Sensor sensor, float x, float y, float z) {
+  uint8_t addr = 0x80 + 12 * sensor;
+  float values[3] = { x, y, z };
+  memcpy(&_regs[addr], values, sizeof(values));
+}
+
+}  // namespace host
@@ -0,0 +1,55 @@
+/*!
+ * @file SimOneU.h
+ * @author Sebastian S.
+ * @brief Simulated 1U test system implementing the Blueboy interface register map.
+ */
+
+#ifndef HOST_SIM_ONEU_H_
+#define HOST_SIM_ONEU_H_
+
+#include "RegisterDevice.h"
+
+namespace host {
+
+/*!
+ * @class SimOneU
+ * @brief Model of the MSP430 BlueboyInterface slave.
+ *
+ * Follows the interface's addressing rules: a transaction that starts while an address is expected sets
+ * the register pointer, data after it in that transaction or the next write one is stored from that pointer,
+ * and reads return data
+ * from the pointer onwards. The data registers, 0x80 up, take no writes from the master, and SetSensorData
+ * changes them between transactions, as the interface's banked commits appear to a reader.
+ */
+class SimOneU : public RegisterDevice {
+ public:
+  /*!
+   * @enum Sensor
+   * Sensor indices used by the interface
+   */
+  enum Sensor : uint8_t {
+    Magnetometer = 0,
+    Accelerometer = 1,
+    Gyroscope = 2
+  };
+
+  SimOneU();
+
+  void Receive(const uint8_t *buf, size_t len) override;
+  void BeginRequest() override;
+
+  /*!
+   * @brief Stores a raw data vector in the register bank
+   * @param sensor Sensor to update
+   * @param x,y,z Values to store as floats
+   */
+  void SetSensorData(Sensor sensor, float x, float y, float z);
+
+  static constexpr uint8_t Address = 0x3A;
+ private:
+  bool _receivingAddr;    // whether the next write transaction carries an address
+};
+
+}  // namespace host
+
+#endif
@@ -52,7 +52,8 @@ struct Quaternion {
  * @struct AttitudeData
  * @brief A representation of a single attitude data packet.
  *
- * Interpretable either as three vectors of raw data, orientation in euler angles, or orientation as a quaternion.
+ * Interpretable either as three vectors of raw data, orientation in euler angles, orientation as a quaternion,
+ * or raw data in the sensors' native counts.
  */
 struct AttitudeData {
   union {
@@ -66,9 +67,138 @@ struct AttitudeData {
       struct Vector euler;              // radians
       struct Quaternion quaternion;     // ???
     } orientation;
+
+    struct {
+      int16_t magnetic[3];              // native sensor counts, x, y, z
+      int16_t acceleration[3];
+      int16_t gyro[3];
+    } counts;
   };
 };
 
+/*
+ * Telemetry payloads, laid out exactly as they are sent so each can be added to a packet in one copy
+ */
+
+/*!
+ * @struct RawAttitudePayload
+ * @brief Raw attitude telemetry data: magnetometer, accelerometer, then gyroscope x, y, z.
+ */
+struct RawAttitudePayload {
+  float magnetic[3];        // uT
+  float acceleration[3];    // m/s^2
+  float gyro[3];            // rad/s
+};
+
+/*!
+ * @struct EulerAttitudePayload
+ * @brief Euler attitude telemetry data, in the order pitch, roll, yaw.
+ */
+struct EulerAttitudePayload {
+  float pitch;              // radians
+  float roll;               // radians
+  float heading;            // radians
+};
+
+/*!
+ * @struct CountsScalePayload
+ * @brief Converts a device's count attitude data to SI units: value = counts * scale - offset, then corrected as
+ *        the CountsCorrectionPayload sent with it says.
+ *
+ * Sent when count logging begins, since it only changes with sensor ranges and calibration, and again as the
+ * gyroscope's temperature moves its offsets.
+ */
+struct CountsScalePayload {
+  float magneticScale;          // uT per count
+  float accelerationScale;      // m/s^2 per count
+  float gyroScale;              // rad/s per count
+  float magneticOffset[3];      // uT
+  float accelerationOffset[3];  // m/s^2
+  float gyroOffset[3];          // rad/s
+};
+
+/*!
+ * @struct CountsCorrectionPayload
+ * @brief The rest of a device's calibration, applied to its count attitude data once CountsScalePayload's scale and
+ *        offset have been: the magnetic field is multiplied by the soft-iron matrix, and each axis of acceleration
+ *        by its gain.
+ *
+ * Sent straight after the CountsScalePayload, too large to share its packet.
+ */
+struct CountsCorrectionPayload {
+  float magneticCorrection[3][3];   // rows x, y, z of the magnetometer's soft-iron correction
+  float accelerationGain[3];        // accelerometer correction per axis, the inverse of its scale
+};
+
+/*!
+ * @struct StatusPayload
+ * @brief Loop health, sent every STATUS_PERIOD. Figures "over the period" cover the time since the last one.
+ */
+struct StatusPayload {
+  uint16_t loopsPerSecond;    // loop() iterations per second over the period
+  uint32_t worstLoop;         // us taken by the longest loop() over the period
+  uint32_t readTime;          // us spent reading sensors over I2C over the period; background reads count from being
+                              // queued until they land, bus time included
+  uint16_t txBacklog;         // most bytes of an attitude packet left waiting on the link over the period
+  uint8_t sampleQueue;        // most attitude samples waiting to be packed over the period
+  uint16_t missedSamples;     // attitude samples both devices have missed since they began logging
+  uint32_t droppedBytes;      // command link bytes that ended up in no packet since startup
+  uint16_t syncLosses;        // command frames abandoned after their sync pattern since startup
+  uint16_t oversizeLengths;   // command frames abandoned for a length too long since startup
+  uint16_t freeRam;           // bytes free between the heap and the stack when sent
+  uint16_t stackHeadroom;     // bytes between the heap and the deepest the stack has reached since startup
+  uint32_t fusionCycles;      // CPU cycles an update of Blueboy's attitude filter took on average over the period,
+                              // 0 if it didn't run
+} __attribute__((packed));
+
+/*!
+ * @struct LogRatePayload
+ * @brief The rate a device's attitude logging was granted out of the link's bandwidth.
+ *
+ * Sent when a device begins logging, and again for any other device whose rate that changes.
+ */
+struct LogRatePayload {
+  uint8_t device;             // Device
+  uint8_t mode;               // AttitudeMode
+  uint8_t batchDepth;         // samples per packet
+  uint8_t logging;            // 0 if the link had no room, and logging was refused or stopped
+  uint32_t requestedPeriod;   // us between samples as commanded, 0 for every loop
+  uint32_t period;            // us between samples as granted, no shorter than requested unless rounded to an
+                              // IMU output data rate
+  uint16_t bytesPerSecond;    // link bandwidth the device's attitude packets take at that period
+  uint8_t acquisition;        // Acquisition the samples are taken by
+} __attribute__((packed));
+
+/*!
+ * @struct CalibrationProgressPayload
+ * @brief How far a calibration of one of Blueboy's own sensors has got, sent every
+ *        BlueboyTelemetry::ProgressPeriod while it runs.
+ *
+ * Spread says how well the offsets are known, in the sensor's own terms: the gyroscope bias's standard error in
+ * rad/s, the magnetometer fit's residual as a fraction of the field, or the accelerometer fit's residual in
+ * m/s^2. The offsets are only what the samples so far give, none of it stored until calibration ends.
+ */
+struct CalibrationProgressPayload {
+  uint8_t sensor;             // sensors_type_t being calibrated
+  uint8_t positions;          // accelerometer positions held long enough, bit 0 x up to bit 5 z down; gyroscope
+                              // temperature slots swept, bit 0 the coolest; 0 otherwise
+  uint16_t samples;           // samples taken so far
+  float offsets[3];           // offsets the samples give so far, x, y, z in the sensor's units; 0 until known
+  float spread;               // how well the offsets are known, as above; negative until known
+} __attribute__((packed));
+
+/*!
+ * @struct AttitudeBatchHeader
+ * @brief Leads the data of a batched attitude packet, followed by count samples in the packet's mode.
+ *
+ * Samples follow the first at the logging period the device was commanded with; a batch is cut short rather than
+ * span a missed sample.
+ */
+struct AttitudeBatchHeader {
+  uint8_t count;            // samples in the packet
+  uint32_t timestamp;       // us since startup when the first sample was taken, wrapping about every 71.6 minutes
+} __attribute__((packed));
+
 /*! 
  * @enum Device
  * Device id
@@ -97,6 +227,34 @@ enum class Device {
  */
 constexpr uint32_t SYNC_PATTERN = 0xDEADBEEF;
 
+/*!
+ * @var unsigned long LINK_BAUD
+ * Baud rate of the bluetooth link. At 8N1 each byte takes 10 bits, so it carries LINK_BAUD / 10 bytes per second.
+ */
+constexpr unsigned long LINK_BAUD = 57600;
+
+/*!
+ * @var unsigned long STATUS_PERIOD
+ * Time in microseconds between status packets
+ */
+constexpr unsigned long STATUS_PERIOD = 1000000;
+
+/*
+ * Pins
+ */
+
+/*!
+ * @var uint8_t IMU_DRDY_PIN
+ * Port D pin wired to the LSM6DS33's INT1, raised when a new gyroscope sample is ready
+ */
+constexpr uint8_t IMU_DRDY_PIN = 6;
+
+/*!
+ * @var uint8_t MAG_DRDY_PIN
+ * Port D pin wired to the LIS2MDL's INT/DRDY, raised when a new sample is ready
+ */
+constexpr uint8_t MAG_DRDY_PIN = 7;
+
 /*! 
  * @enum CommandID
  * IDs of commands that can be recognized.
@@ -104,6 +262,7 @@ constexpr uint32_t SYNC_PATTERN = 0xDEADBEEF;
 enum class CommandID {
   Reset =             0x00,
   Echo =              0x01,
+  LinkStats =         0x02,
   
   BeginOwnAttitude =  0x10,
   EndOwnAttitude =    0x11,
@@ -128,31 +287,67 @@ enum class CommandID {
   Invalid = 0xFF,
 };
 
+/*!
+ * @var uint8_t ATTITUDE_BATCH_BIT
+ * Set in an attitude telemetry ID when the packet carries a batch of samples rather than a single one.
+ */
+constexpr uint8_t ATTITUDE_BATCH_BIT = 0x08;
+
 /*! 
  * @enum TelemetryID
- * IDs of telemetry packets to use.
+ * IDs of telemetry packets to use. Attitude IDs are the device in the high 4 bits, the mode in the low,
+ * with ATTITUDE_BATCH_BIT set for batched packets. A device's counts scale and correction descriptors are 0x07 and
+ * 0x06 in the low bits; only Blueboy itself sends counts.
  */
 enum class TelemetryID {
   Status =                  0x00,
   Message =                 0x01,
+  LinkStats =               0x02,
+  LogRate =                 0x03,
+  CalibrationProgress =     0x04,
 
   OwnAttitudeRaw =          0x10,
   OwnAttitudeEuler =        0x11,
   OwnAttitudeQuaternion =   0x12,
+  OwnAttitudeCounts =       0x13,
+  OwnCountsCorrection =     0x16,
+  OwnCountsScale =          0x17,
+
+  OwnAttitudeRawBatch =         0x18,
+  OwnAttitudeEulerBatch =       0x19,
+  OwnAttitudeQuaternionBatch =  0x1A,
+  OwnAttitudeCountsBatch =      0x1B,
 
-  TestAttitudeRaw =         0x10,
-  TestAttitudeEuler =       0x11,
-  TestAttitudeQuaternion =  0x12,
+  TestAttitudeRaw =         0x20,
+  TestAttitudeEuler =       0x21,
+  TestAttitudeQuaternion =  0x22,
+
+  TestAttitudeRawBatch =        0x28,
+  TestAttitudeEulerBatch =      0x29,
+  TestAttitudeQuaternionBatch = 0x2A,
 };
 
 /*! 
  * @enum AttitudeMode
- * Mode to send attitude data in over bluetooth.
+ * Mode to send attitude data in over bluetooth. Counts sends raw data as the sensors' native int16 counts,
+ * scaled on the ground by the device's CountsScalePayload.
  */
 enum class AttitudeMode {
   Raw =         0x00,
   Euler =       0x01,
-  Quaternion =  0x02
+  Quaternion =  0x02,
+  Counts =      0x03
+};
+
+/*!
+ * @enum Acquisition
+ * How a device's samples are taken. The FIFO and data-ready interrupts are Blueboy's IMU only, in raw or counts
+ * mode, and sample at the IMU output data rate nearest the logging period.
+ */
+enum class Acquisition : uint8_t {
+  Deadline =    0x00,   // read whenever the logging period elapses
+  Fifo =        0x01,   // sampled into the IMU's FIFO and drained in bursts, timestamped by the IMU
+  DataReady =   0x02    // read as each sample is flagged on the sensors' data-ready pins, timestamped by the edge
 };
 
 #endif
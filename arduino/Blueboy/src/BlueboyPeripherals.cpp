@@ -5,6 +5,18 @@
  */
 
 #include "BlueboyPeripherals.h"
+#include "util/Log.h"
+
+/*!
+ * @brief Spreads the test system's raw data out into attitude data
+ * @param raw Data as the 1U's registers pack it, without our padding
+ * @param data Attitude data to fill
+ */
+static void spreadRaw(const struct RawAttitudePayload& raw, struct AttitudeData *data) {
+  memcpy(&data->raw.magnetic.x, raw.magnetic, sizeof(raw.magnetic));
+  memcpy(&data->raw.acceleration.x, raw.acceleration, sizeof(raw.acceleration));
+  memcpy(&data->raw.gyro.x, raw.gyro, sizeof(raw.gyro));
+}
 
 bool BlueboyPeripherals::Initialize() {
   if (_initialized) {
@@ -14,17 +26,17 @@ bool BlueboyPeripherals::Initialize() {
   CalibrationStorage::Initialize();
   
   if (!lis2mdl.Initialize()) {
-    Serial.println(F("Failed to find LIS2MDL"));
+    LOG_ERROR(F("Failed to find LIS2MDL"));
     return false;
   }
   
   if (!lsm6ds33.Initialize()) {
-    Serial.println(F("Failed to find LSM6DS33"));
+    LOG_ERROR(F("Failed to find LSM6DS33"));
     return false;
   }
 
   if (!oneU.Initialize()) {
-    Serial.println(F("Failed to find test system"));
+    LOG_ERROR(F("Failed to find test system"));
     return false;
   }
 
@@ -33,76 +45,337 @@ bool BlueboyPeripherals::Initialize() {
 }
 
 bool BlueboyPeripherals::ReadRaw(Device dev, struct AttitudeData *data) {
+  unsigned long start = micros();
+  bool read;
   switch (dev) {
     case Device::Own:
-      return ReadOwnRaw(data);
+      read = ReadOwnRaw(data);
+      break;
     case Device::Test:
-      return ReadTestRaw(data);
+      read = ReadTestRaw(data);
+      break;
     default:
-      return false;
+      read = false;
+      break;
   }
+  _readTime += micros() - start;
+  return read;
 }
 
 bool BlueboyPeripherals::ReadOwnRaw(struct AttitudeData *data) {
-  sensors_event_t event;
-  
-  // Adafruit's unified sensor vector has to be converted to our vectors
-  if (!lis2mdl.GetEvent(&event)) {
+  // our vectors start with x, y, z, so the drivers write straight into them
+  return lis2mdl.GetMagnetic(&data->raw.magnetic.x) &&
+         lsm6ds33.GetMotion(&data->raw.gyro.x, &data->raw.acceleration.x);
+}
+
+bool BlueboyPeripherals::ReadTestRaw(struct AttitudeData *data) {
+  // the 1U's registers pack the vectors without our padding, so they're read whole then spread out
+  struct RawAttitudePayload raw;
+  if (!oneU.GetRawSnapshot(&raw)) {
     return false;
   }
-  data->raw.magnetic = *(struct Vector *)&event.magnetic;
-  
-  if (!lsm6ds33.GetEventRaw(&event, SENSOR_TYPE_ACCELEROMETER)) {
+  spreadRaw(raw, data);
+  return true;
+}
+
+bool BlueboyPeripherals::FinishTestRead(struct AttitudeData *data) {
+  struct RawAttitudePayload raw;
+  if (!oneU.FinishSnapshot(&raw)) {
     return false;
   }
-  data->raw.acceleration = *(struct Vector *)&event.acceleration;
-  
-  if (!lsm6ds33.GetEvent(&event, SENSOR_TYPE_GYROSCOPE)) {
+  unsigned long start = micros();
+  spreadRaw(raw, data);
+  _readTime += oneU.SnapshotTime() + micros() - start;
+  return true;
+}
+
+bool BlueboyPeripherals::ReadCounts(Device dev, struct AttitudeData *data) {
+  if (dev != Device::Own) {
+    return false;  // the test system only reports floats
+  }
+  unsigned long start = micros();
+  bool read = ReadOwnCounts(data);
+  _readTime += micros() - start;
+  return read;
+}
+
+bool BlueboyPeripherals::ReadOwnCounts(struct AttitudeData *data) {
+  return lis2mdl.GetCountsRaw(data->counts.magnetic) &&
+         lsm6ds33.GetMotionCounts(data->counts.gyro, data->counts.acceleration);
+}
+
+bool BlueboyPeripherals::BeginOwnRead() {
+  if (_ownRead == OwnRead::Busy) {
     return false;
   }
-  data->raw.gyro = *(struct Vector *)&event.gyro;
-  
+
+  _ownRead = OwnRead::Busy;
+  _ownReadStart = micros();
+  CalibratedLIS2MDL::PrepareCountsRead(&_magneticTransfer, _ownCounts);
+  CalibratedLSM6DS33::PrepareMotionRead(&_motionTransfer, _ownCounts + 3, OnOwnRead, this);
+  I2CEngine::Submit(&_magneticTransfer);
+  I2CEngine::Submit(&_motionTransfer);
   return true;
 }
 
-bool BlueboyPeripherals::ReadTestRaw(struct AttitudeData *data) {  
-  sensors_event_t event;
-  
-  // Adafruit's unified sensor vector has to be converted to our vectors
-  if (!oneU.GetEventRaw(&event, SENSOR_TYPE_MAGNETIC_FIELD)) {
+void BlueboyPeripherals::OnOwnRead(struct I2CTransfer *transfer) {
+  // the magnetometer's transfer was queued first, so it has finished as well; the read's time runs from its
+  // submission to here, the bus time the synchronous reads count, plus up to a loop's wait for I2CEngine::Tick
+  BlueboyPeripherals *peripherals = (BlueboyPeripherals *) transfer->context;
+  peripherals->_readTime += micros() - peripherals->_ownReadStart;
+  peripherals->_ownRead = OwnRead::Landed;
+}
+
+bool BlueboyPeripherals::FinishOwnRead(AttitudeMode mode, struct AttitudeData *data) {
+  _ownRead = OwnRead::Idle;
+  if (_magneticTransfer.status != I2CStatus::Done || _motionTransfer.status != I2CStatus::Done) {
     return false;
   }
-  data->raw.magnetic = *(struct Vector *)&event.magnetic;
-  
-  if (!oneU.GetEventRaw(&event, SENSOR_TYPE_ACCELEROMETER)) {
+
+  unsigned long start = micros();
+  const int16_t *gyro = _ownCounts + 3;
+  const int16_t *acceleration = _ownCounts + 6;
+  if (mode == AttitudeMode::Counts) {
+    CalibratedLIS2MDL::AlignCounts(_ownCounts, data->counts.magnetic);
+    memcpy(data->counts.gyro, gyro, sizeof(data->counts.gyro));
+    memcpy(data->counts.acceleration, acceleration, sizeof(data->counts.acceleration));
+  } else {
+    int16_t magnetic[3];
+    CalibratedLIS2MDL::AlignCounts(_ownCounts, magnetic);
+    lis2mdl.ToMagnetic(magnetic, &data->raw.magnetic.x);
+    lsm6ds33.ToMotion(gyro, acceleration, &data->raw.gyro.x, &data->raw.acceleration.x);
+  }
+  _readTime += micros() - start;
+
+  if (mode == AttitudeMode::Euler || mode == AttitudeMode::Quaternion) {
+    Fuse(*data);
+    ReadOwnOrientation(mode, data);
+  }
+  return true;
+}
+
+void BlueboyPeripherals::Fuse(const struct AttitudeData& raw) {
+  unsigned long start = micros();
+  unsigned long gap = _ownReadStart - _fusedAt;
+  float dt = gap * 1e-6f;
+  if (!_filter.Started() || gap > MaxFusionGap) {
+    // nothing to integrate from; this read only sets roll, pitch and heading going
+    _filter.Reset();
+    dt = 0;
+  }
+  _fusedAt = _ownReadStart;
+
+  _filter.Update(&raw.raw.gyro.x, &raw.raw.acceleration.x, &raw.raw.magnetic.x, dt);
+  _fusionTime += micros() - start;
+  _fusions++;
+}
+
+bool BlueboyPeripherals::GetCountsScale(Device dev, struct CountsScalePayload *scale) {
+  if (dev != Device::Own) {
     return false;
   }
-  data->raw.acceleration = *(struct Vector *)&event.acceleration;
-  
-  if (!oneU.GetEventRaw(&event, SENSOR_TYPE_GYROSCOPE)) {
+
+  scale->magneticScale = lis2mdl.CountsScale();
+  scale->accelerationScale = lsm6ds33.CountsScale(SENSOR_TYPE_ACCELEROMETER);
+  scale->gyroScale = lsm6ds33.CountsScale(SENSOR_TYPE_GYROSCOPE);
+
+  // the offsets of the compensation ReadOwnRaw applies; GetCountsCorrection describes the rest
+  struct AxisOffsets off;
+  lis2mdl.GetCalibration(&off);
+  memcpy(scale->magneticOffset, &off, sizeof(scale->magneticOffset));
+  lsm6ds33.GetCalibration(&off, SENSOR_TYPE_ACCELEROMETER);
+  memcpy(scale->accelerationOffset, &off, sizeof(scale->accelerationOffset));
+  lsm6ds33.GetCalibration(&off, SENSOR_TYPE_GYROSCOPE);
+  memcpy(scale->gyroOffset, &off, sizeof(scale->gyroOffset));
+  return true;
+}
+
+bool BlueboyPeripherals::GetCountsCorrection(Device dev, struct CountsCorrectionPayload *correction) {
+  if (dev != Device::Own) {
     return false;
   }
-  data->raw.gyro = *(struct Vector *)&event.gyro;
-  
+
+  struct AxisCorrection magnetic;
+  lis2mdl.GetCorrection(&magnetic);
+  memcpy(correction->magneticCorrection, magnetic.m, sizeof(correction->magneticCorrection));
+  lsm6ds33.GetAccelGain(correction->accelerationGain);
+  return true;
+}
+
+bool BlueboyPeripherals::GetCalibrationProgress(sensors_type_t type, struct CalibrationProgressPayload *progress) {
+  struct AxisOffsets off = { 0, 0, 0 };
+  float spread = -1;   // filled here, not in the packed payload, which may leave it unaligned
+  progress->sensor = type;
+  progress->positions = 0;
+  switch (type) {
+    case SENSOR_TYPE_GYROSCOPE:
+      if (lsm6ds33.Calibrating() != type) {
+        return false;
+      }
+      progress->samples = lsm6ds33.BiasSamples();
+      progress->positions = lsm6ds33.SweptSlots();
+      if (progress->samples >= BiasEstimator::WarmUp) {
+        lsm6ds33.GetBias(&off);
+        spread = lsm6ds33.BiasError();
+      }
+      break;
+    case SENSOR_TYPE_ACCELEROMETER:
+      if (lsm6ds33.Calibrating() != type) {
+        return false;
+      }
+      progress->samples = lsm6ds33.AccelSamples();
+      progress->positions = lsm6ds33.AccelPositions();
+      lsm6ds33.FitAccel(&off, &spread);   // leaves both as they were until every position is held
+      break;
+    case SENSOR_TYPE_MAGNETIC_FIELD:
+      if (!lis2mdl.Calibrating()) {
+        return false;
+      }
+      progress->samples = lis2mdl.CalibrationSamples();
+      lis2mdl.Fit(&off, &spread);         // leaves both as they were until the samples fit
+      break;
+    default:
+      return false;
+  }
+  memcpy(progress->offsets, &off, sizeof(progress->offsets));
+  progress->spread = spread;
   return true;
 }
 
-bool BlueboyPeripherals::ReadOrientation(Device dev, struct AttitudeData *data) {
+bool BlueboyPeripherals::ReadOrientation(Device dev, AttitudeMode mode, struct AttitudeData *data) {
+  unsigned long start = micros();
+  bool read = false;
   switch (dev) {
     case Device::Own:
-      return ReadOwnOrientation(data);
+      read = ReadOwnOrientation(mode, data);
+      break;
     case Device::Test:
-      return ReadTestOrientation(data);
+      read = ReadTestOrientation(mode, data);
+      break;
   }
-  return false;
+  _readTime += micros() - start;
+  return read;
+}
+
+uint16_t BlueboyPeripherals::OwnFifoSamples(bool *overrun) {
+  unsigned long start = micros();
+  uint16_t samples = lsm6ds33.FifoSamples(overrun);
+  _readTime += micros() - start;
+  return samples;
 }
 
-//! @todo finish this
-bool BlueboyPeripherals::ReadOwnOrientation(struct AttitudeData *data) {
-  return false;
+bool BlueboyPeripherals::ReadOwnMagnetic(AttitudeMode mode, struct AttitudeData *data) {
+  unsigned long start = micros();
+  bool read;
+  if (mode == AttitudeMode::Counts) {
+    read = lis2mdl.GetCountsRaw(data->counts.magnetic);
+  } else {
+    read = lis2mdl.GetMagnetic(&data->raw.magnetic.x);
+  }
+  _readTime += micros() - start;
+  return read;
 }
 
-//! @todo finish this
-bool BlueboyPeripherals::ReadTestOrientation(struct AttitudeData *data) {
-  return false;
+bool BlueboyPeripherals::ReadOwnFifo(AttitudeMode mode, struct AttitudeData *data, unsigned long *timestamp) {
+  struct FifoSample sample;
+  unsigned long start = micros();
+  bool read = lsm6ds33.ReadFifo(&sample);
+  _readTime += micros() - start;
+  if (!read) {
+    return false;
+  }
+  *timestamp = sample.timestamp;
+
+  if (mode == AttitudeMode::Counts) {
+    memcpy(data->counts.acceleration, sample.acceleration, sizeof(data->counts.acceleration));
+    memcpy(data->counts.gyro, sample.gyro, sizeof(data->counts.gyro));
+    return true;
+  }
+
+  // the same compensation ReadOwnRaw applies
+  lsm6ds33.ToMotion(sample.gyro, sample.acceleration, &data->raw.gyro.x, &data->raw.acceleration.x);
+  return true;
+}
+
+bool BlueboyPeripherals::BeginOwnDataReady(unsigned long period) {
+  // whatever both sensors hold is read here, lowering their pins so the next samples raise them on time; the
+  // IMU's is from before the rate change and dropped
+  int16_t gyro[3], acceleration[3];
+  if (!lsm6ds33.BeginDataReady(period) || !lis2mdl.EnableDataReady(true) || !lis2mdl.GetCountsRaw(_magnetic) ||
+      !lsm6ds33.GetMotionCounts(gyro, acceleration)) {
+    EndOwnDataReady();
+    return false;
+  }
+  _magneticUnread = false;
+  DataReady::Attach(DataReadySource::Imu, IMU_DRDY_PIN);
+  DataReady::Attach(DataReadySource::Magnetometer, MAG_DRDY_PIN);
+  return true;
+}
+
+void BlueboyPeripherals::EndOwnDataReady() {
+  DataReady::Detach(DataReadySource::Imu);
+  DataReady::Detach(DataReadySource::Magnetometer);
+  lsm6ds33.EndDataReady();
+  lis2mdl.EnableDataReady(false);
+}
+
+bool BlueboyPeripherals::ReadOwnDataReady(AttitudeMode mode, struct AttitudeData *data) {
+  // the IMU first, before its next sample can overwrite the one flagged
+  unsigned long start = micros();
+  bool read;
+  if (mode == AttitudeMode::Counts) {
+    read = lsm6ds33.GetMotionCounts(data->counts.gyro, data->counts.acceleration);
+  } else {
+    read = lsm6ds33.GetMotion(&data->raw.gyro.x, &data->raw.acceleration.x);
+  }
+
+  unsigned long magneticTime;
+  if (DataReady::Take(DataReadySource::Magnetometer, &magneticTime) || _magneticUnread) {
+    // a failed read leaves the pin high, so no edge will come for the next sample; retry it with the next IMU
+    // sample instead, keeping the previous one meanwhile
+    _magneticUnread = !lis2mdl.GetCountsRaw(_magnetic);
+  }
+  if (mode == AttitudeMode::Counts) {
+    memcpy(data->counts.magnetic, _magnetic, sizeof(data->counts.magnetic));
+  } else {
+    lis2mdl.ToMagnetic(_magnetic, &data->raw.magnetic.x);
+  }
+  _readTime += micros() - start;
+  return read;
+}
+
+unsigned long BlueboyPeripherals::TakeReadTime() {
+  unsigned long time = _readTime;
+  _readTime = 0;
+  return time;
+}
+
+uint32_t BlueboyPeripherals::TakeFusionCycles() {
+  uint32_t cycles = 0;
+  if (_fusions > 0) {
+    cycles = _fusionTime * (F_CPU / 1000000UL) / _fusions;
+  }
+  _fusionTime = 0;
+  _fusions = 0;
+  return cycles;
+}
+
+bool BlueboyPeripherals::ReadOwnOrientation(AttitudeMode mode, struct AttitudeData *data) {
+  if (!_filter.Settled()) {
+    return false;
+  }
+
+  if (mode == AttitudeMode::Euler) {
+    _filter.GetEuler(&data->orientation.euler);
+  } else {
+    _filter.GetQuaternion(&data->orientation.quaternion);
+  }
+  return true;
+}
+
+bool BlueboyPeripherals::ReadTestOrientation(AttitudeMode mode, struct AttitudeData *data) {
+  if (mode == AttitudeMode::Euler) {
+    return oneU.GetOrientationEulers(&data->orientation.euler);
+  }
+  return oneU.GetOrientationQuaternion(&data->orientation.quaternion);
 }
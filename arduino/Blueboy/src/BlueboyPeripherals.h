@@ -6,14 +6,15 @@
 
 #ifndef BLUEBOY_PERIPHERALS_H_
 #define BLUEBOY_PERIPHERALS_H_
-#include <Wire.h>
 
 #include <Adafruit_Sensor.h>
-#include <Adafruit_LIS2MDL.h>
 #include "Blueboy.h"
+#include "sensor/I2CEngine.h"
 #include "sensor/OneUDriver.h"
 #include "sensor/CalibratedLSM6DS33.h"
 #include "sensor/CalibratedLIS2MDL.h"
+#include "sensor/DataReady.h"
+#include "sensor/MadgwickFilter.h"
 
 /*!
  * @class BlueboyPeripherals
@@ -21,12 +22,21 @@
  */
 class BlueboyPeripherals {
  public:
+  /*!
+   * @var unsigned long MaxFusionGap
+   * Longest time in microseconds between reads fused into the attitude filter before its orientation is taken
+   * as stale, and the filter started again from the next
+   */
+  static constexpr unsigned long MaxFusionGap = 100000;
+
   /*!
    * @brief BlueboyPeripherals constructor
    */
   BlueboyPeripherals() : lsm6ds33(CalibratedLSM6DS33()),
                                           lis2mdl(CalibratedLIS2MDL()),
-                                          oneU() , _initialized(false) { }
+                                          oneU() , _initialized(false), _readTime(0),
+                                          _magneticUnread(false), _ownRead(OwnRead::Idle), _ownReadStart(0),
+                                          _fusedAt(0), _fusionTime(0), _fusions(0) { }
   
   /*!
    * @brief Initializes sensors and the mounted test system.
@@ -52,29 +62,201 @@ class BlueboyPeripherals {
    */
   bool ReadTestRaw(struct AttitudeData *data);
 
+  /*!
+   * @brief Reads raw data in native sensor counts from the given device.
+   * @param dev Device to read counts from
+   * @param data Pointer to an AttitudeData struct to be filled with counts
+   * @return False if the device has no count output or a sensor failed to read
+   */
+  bool ReadCounts(Device dev, struct AttitudeData *data);
+
+  /*!
+   * @brief Reads raw data in native sensor counts from Blueboy sensors, skipping conversion to floats.
+   * @param data Pointer to an AttitudeData struct to be filled with counts
+   */
+  bool ReadOwnCounts(struct AttitudeData *data);
+
+  /*!
+   * @brief Starts reading Blueboy's sensors on the I2CEngine in the background, to be taken by FinishOwnRead
+   * @return False if the last read is still on the bus
+   *
+   * The magnetometer and IMU reads are queued together and move back to back under the TWI interrupt, so the
+   * loop carries on with commands and telemetry meanwhile. A landed read not yet taken is dropped.
+   */
+  bool BeginOwnRead();
+
+  /*!
+   * @return True if the read begun by BeginOwnRead is off the bus, whether or not it succeeded, and waits for
+   *         FinishOwnRead; landed reads are noticed in I2CEngine::Tick
+   */
+  bool OwnReadLanded() { return _ownRead == OwnRead::Landed; }
+
+  /*!
+   * @brief Takes the read begun by BeginOwnRead into the data of the given mode
+   * @param mode AttitudeMode::Raw or AttitudeMode::Counts, or an orientation mode to fuse the read into the
+   *             attitude filter
+   * @param data Attitude data to fill, as ReadOwnRaw, ReadOwnCounts or ReadOwnOrientation would
+   * @return True if both sensors were read
+   * @pre OwnReadLanded()
+   *
+   * Fused reads are timed from when each began, so the filter integrates the real time between them however the
+   * loop schedules them.
+   */
+  bool FinishOwnRead(AttitudeMode mode, struct AttitudeData *data);
+
+  /*!
+   * @brief Starts reading the test system's raw data on the I2CEngine in the background, to be taken by
+   *        FinishTestRead
+   * @return False if the last read is still on the bus
+   */
+  bool BeginTestRead() { return oneU.BeginSnapshot(); }
+
+  /*!
+   * @return True if the read begun by BeginTestRead is off the bus, whether or not it succeeded, and waits for
+   *         FinishTestRead
+   */
+  bool TestReadLanded() { return oneU.SnapshotLanded(); }
+
+  /*!
+   * @brief Takes the read begun by BeginTestRead
+   * @param data Attitude data to fill, as ReadTestRaw would
+   * @return True if the test system returned a reading
+   * @pre TestReadLanded()
+   */
+  bool FinishTestRead(struct AttitudeData *data);
+
+  /*!
+   * @brief Describes how to convert the given device's counts to the units of its raw data.
+   * @param dev Device to describe
+   * @param scale Pointer to a CountsScalePayload to be filled with the current scales and calibration offsets
+   * @return False if the device has no count output
+   */
+  bool GetCountsScale(Device dev, struct CountsScalePayload *scale);
+
+  /*!
+   * @brief Describes how to correct the given device's counts once scaled and offset, as its raw data is.
+   * @param dev Device to describe
+   * @param correction Pointer to a CountsCorrectionPayload to be filled with the current soft-iron correction and
+   *                   accelerometer gains
+   * @return False if the device has no count output
+   */
+  bool GetCountsCorrection(Device dev, struct CountsCorrectionPayload *correction);
+
+  /*!
+   * @brief Describes how far calibration of one of Blueboy's own sensors has got
+   * @param type Sensor to describe: SENSOR_TYPE_ACCELEROMETER, SENSOR_TYPE_MAGNETIC_FIELD or SENSOR_TYPE_GYROSCOPE
+   * @param progress Pointer to a CalibrationProgressPayload to be filled
+   * @return False if the sensor isn't calibrating
+   *
+   * The magnetometer's offsets come from fitting its samples so far, which takes tens of milliseconds.
+   */
+  bool GetCalibrationProgress(sensors_type_t type, struct CalibrationProgressPayload *progress);
+
   /*!
    * @brief Reads orientation data from the given device.
    * @param dev Device to read orientation data from
+   * @param mode AttitudeMode::Euler or AttitudeMode::Quaternion
    * @param data Pointer to an AttitudeData struct to be filled with data
    */
-  bool ReadOrientation(Device dev, struct AttitudeData *data);
+  bool ReadOrientation(Device dev, AttitudeMode mode, struct AttitudeData *data);
   
   /*!
-   * @brief Reads orientation data from Blueboy.
+   * @brief Reads orientation data from Blueboy's attitude filter, without touching the bus.
+   * @param mode AttitudeMode::Euler or AttitudeMode::Quaternion
    * @param data Pointer to an AttitudeData struct to be filled with data
+   * @return False until the filter has settled, MadgwickFilter::StartUpdates reads after starting or a gap
    */
-  bool ReadOwnOrientation(struct AttitudeData *data);
+  bool ReadOwnOrientation(AttitudeMode mode, struct AttitudeData *data);
   
   /*!
    * @brief Reads orientation data from the mounted test system.
+   * @param mode AttitudeMode::Euler or AttitudeMode::Quaternion
    * @param data Pointer to an AttitudeData struct to be filled with data
    */
-  bool ReadTestOrientation(struct AttitudeData *data);
+  bool ReadTestOrientation(AttitudeMode mode, struct AttitudeData *data);
   
+  /*!
+   * @brief Starts Blueboy's IMU sampling into its FIFO
+   * @param period Time in microseconds between samples, one CalibratedLSM6DS33::DataRatePeriodAtMost or
+   *        DataRatePeriodAtLeast returned
+   * @return True if the IMU was configured
+   */
+  bool BeginOwnFifo(unsigned long period) { return lsm6ds33.BeginFifo(period); }
+
+  /*!
+   * @brief Stops Blueboy's IMU sampling into its FIFO
+   */
+  void EndOwnFifo() { lsm6ds33.EndFifo(); }
+
+  /*!
+   * @param overrun Set true if the FIFO lost samples since last checked
+   * @return The number of samples waiting in Blueboy's IMU FIFO
+   */
+  uint16_t OwnFifoSamples(bool *overrun);
+
+  /*!
+   * @brief Reads Blueboy's magnetometer into the raw or counts data of the given mode, to go with FIFO samples
+   * @param mode AttitudeMode::Raw or AttitudeMode::Counts
+   * @param data Attitude data whose magnetic field to fill
+   * @return True if the magnetometer was read
+   */
+  bool ReadOwnMagnetic(AttitudeMode mode, struct AttitudeData *data);
+
+  /*!
+   * @brief Reads the oldest sample in Blueboy's IMU FIFO into the raw or counts data of the given mode
+   * @param mode AttitudeMode::Raw or AttitudeMode::Counts
+   * @param data Attitude data whose acceleration and angular rate to fill, compensated as ReadOwnRaw does in
+   *             raw mode; the magnetic field is left as it was
+   * @param timestamp Set to micros() when the sample was taken
+   * @return True if a sample was read
+   */
+  bool ReadOwnFifo(AttitudeMode mode, struct AttitudeData *data, unsigned long *timestamp);
+
+  /*!
+   * @brief Starts Blueboy's sensors flagging each new sample on their data-ready pins, IMU_DRDY_PIN and
+   *        MAG_DRDY_PIN, and watching those for edges
+   * @param period Time in microseconds between IMU samples, one CalibratedLSM6DS33::DataRatePeriodAtMost or
+   *        DataRatePeriodAtLeast returned
+   * @return True if both sensors were configured
+   */
+  bool BeginOwnDataReady(unsigned long period);
+
+  /*!
+   * @brief Stops Blueboy's sensors flagging samples on their data-ready pins
+   */
+  void EndOwnDataReady();
+
+  /*!
+   * @brief Takes the IMU's latest data-ready edge, if one arrived since the last
+   * @param timestamp Set to micros() when the edge arrived
+   * @return True if the IMU has a sample waiting, which ReadOwnDataReady must read to re-arm its pin
+   */
+  bool OwnDataReady(unsigned long *timestamp) { return DataReady::Take(DataReadySource::Imu, timestamp); }
+
+  /*!
+   * @brief Reads the IMU's latest sample into the raw or counts data of the given mode, with the magnetometer's
+   *        latest sample, read first if its data-ready pin flagged a new one
+   * @param mode AttitudeMode::Raw or AttitudeMode::Counts
+   * @param data Attitude data to fill, compensated as ReadOwnRaw does in raw mode
+   * @return True if the IMU was read
+   */
+  bool ReadOwnDataReady(AttitudeMode mode, struct AttitudeData *data);
+
   /*!
    * @return True if any onboard sensors are currently calibrating.
    */
   bool Calibrating() { return lsm6ds33.Calibrating() || lis2mdl.Calibrating(); }
+
+  /*!
+   * @return Time in microseconds spent in ReadRaw, ReadCounts and ReadOrientation since the last call, and by
+   *         background reads from being started until they land, and in taking them
+   */
+  unsigned long TakeReadTime();
+
+  /*!
+   * @return CPU cycles an update of the attitude filter took on average since the last call, 0 if none ran
+   */
+  uint32_t TakeFusionCycles();
   
   /*!
    * @var CalibratedLSM6DS33 Internal calibrated LSM6DS33 driver
@@ -91,7 +273,35 @@ class BlueboyPeripherals {
    */
   OneUDriver oneU;
  private:
+  /*!
+   * @enum OwnRead
+   * Progress of the background read begun by BeginOwnRead
+   */
+  enum class OwnRead : uint8_t {
+    Idle,       // none begun, or taken
+    Busy,       // on the bus
+    Landed      // off the bus, not yet taken
+  };
+
+  // marks the background read landed; the callback of its last transfer
+  static void OnOwnRead(struct I2CTransfer *transfer);
+
   bool _initialized;
+  unsigned long _readTime;  // us spent reading since the last TakeReadTime
+  int16_t _magnetic[3];     // magnetometer's latest counts in GetCountsRaw's axes, while flagging data-ready
+  bool _magneticUnread;     // true if the magnetometer flagged a sample that failed to read
+  volatile OwnRead _ownRead;
+  struct I2CTransfer _magneticTransfer;   // background read of the magnetometer
+  struct I2CTransfer _motionTransfer;     // background read of the IMU, queued after the magnetometer's
+  int16_t _ownCounts[9];    // background read's counts: magnetometer in its own axes, gyroscope, accelerometer
+  unsigned long _ownReadStart;  // micros() the background read began
+  MadgwickFilter _filter;
+  unsigned long _fusedAt;   // micros() the last read fused into the filter began
+  unsigned long _fusionTime;    // us spent updating the filter since the last TakeFusionCycles
+  uint16_t _fusions;        // updates of the filter since the last TakeFusionCycles
+
+  // updates the attitude filter with the read begun at _ownReadStart, in raw data
+  void Fuse(const struct AttitudeData& raw);
 };
 
 #endif
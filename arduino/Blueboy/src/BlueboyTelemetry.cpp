@@ -4,19 +4,44 @@
  * @brief Implementation of BlueboyTelemetry.h
  */
 
+#include <stddef.h>
+#include <limits.h>
+
 #include "BlueboyTelemetry.h"
+#include "Messages.h"
+#include "sensor/TemperatureBias.h"
+#include "util/Log.h"
+#include "util/Memory.h"
 
 BlueboyTelemetry::BlueboyTelemetry(AltSoftSerial& serial,
                                    BlueboyPeripherals& peripherals,
                                    uint32_t sync): _serial(serial),
+                                                   _peripherals(peripherals),
                                                    _sender(PacketSender(_sendbuf, sync)),
-                                                   _peripherals(peripherals) {
+                                                   _batchSender(PacketSender(_batchbuf, sync, BatchBufferSize)),
+                                                   _txNext(NULL),
+                                                   _txLeft(0),
+                                                   _txHighWater(0),
+                                                   _queueHighWater(0),
+                                                   _landingTimestamps{0, 0},
+                                                   _nextFusion(0),
+                                                   _nextProgress(0),
+                                                   _countsSlot(0) {
   // Initialize settings to defaults
   for (int i = 0; i < 2; i++) {
-    _settings[i].sendDelay = DEFAULT_LOG_DELAY;
-    _settings[i].lastSent = 0;
+    _settings[i].requestedPeriod = DEFAULT_LOG_PERIOD;
+    _settings[i].period = DEFAULT_LOG_PERIOD;
+    _settings[i].nextSample = 0;
     _settings[i].logging = false;
+    _settings[i].acquisition = Acquisition::Deadline;
+    _settings[i].gap = false;
+    _settings[i].missed = 0;
     _settings[i].mode = DEFAULT_ATTITUDE_MODE;
+    _settings[i].batchDepth = 1;
+    _settings[i].depth = 1;
+    _settings[i].batched = 0;
+    _settings[i].packetDepth = 1;
+    _settings[i].packetMode = DEFAULT_ATTITUDE_MODE;
   }
 }
 
@@ -26,18 +51,186 @@ bool BlueboyTelemetry::InitializePeripherals() {
 
 void BlueboyTelemetry::SetLogPeriod(Device dev, unsigned long period) {
   int index = (int) dev - 1;
-  _settings[index].sendDelay = period;
+  _settings[index].requestedPeriod = period;
+}
+
+unsigned long BlueboyTelemetry::LogPeriod(Device dev) {
+  int index = (int) dev - 1;
+  return _settings[index].period;
 }
 
-void BlueboyTelemetry::BeginLogging(Device dev, AttitudeMode mode) {
+bool BlueboyTelemetry::BeginLogging(Device dev, AttitudeMode mode, uint8_t batchDepth, Acquisition acquisition) {
   int index = (int) dev - 1;
+  if (PayloadSize(mode) == 0 || (mode == AttitudeMode::Counts && !SendCountsScale(dev))) {
+    return false;
+  }
+
+  EndAcquisition(index);  // restarted below at the new rate, if still wanted
+  if (dev != Device::Own || (mode != AttitudeMode::Raw && mode != AttitudeMode::Counts)) {
+    acquisition = Acquisition::Deadline;
+  }
+  _settings[index].acquisition = acquisition;
+
+  // samples still queued from before go out as they were taken; the first new one starts a new packet
   _settings[index].logging = true;
   _settings[index].mode = mode;
+  _settings[index].batchDepth = constrain(batchDepth, 1, MaxBatchDepth(mode));
+  _settings[index].nextSample = micros();
+  _settings[index].gap = true;
+  _settings[index].missed = 0;
+  if (dev == Device::Own) {
+    _nextFusion = micros();
+  }
+  if (!Budget(index)) {
+    _settings[index].acquisition = Acquisition::Deadline;
+    return false;
+  }
+
+  bool begun = true;
+  if (_settings[index].acquisition == Acquisition::Fifo) {
+    begun = _peripherals.BeginOwnFifo(_settings[index].period);
+  } else if (_settings[index].acquisition == Acquisition::DataReady) {
+    begun = _peripherals.BeginOwnDataReady(_settings[index].period);
+    _settings[index].nextSample = micros() + _settings[index].period * DataReadyTimeoutPeriods;
+  }
+  if (!begun) {
+    // carry on reading on deadlines at the same period
+    _settings[index].acquisition = Acquisition::Deadline;
+    _settings[index].nextSample = micros();
+    SendLogRate(index);
+  }
+  return true;
 }
 
 void BlueboyTelemetry::EndLogging(Device dev) {
   int index = (int) dev - 1;
-  _settings[index].logging = false;
+  _settings[index].logging = false;  // the partial batch goes out once the samples queued before it have
+  EndAcquisition(index);
+  Budget(-1);
+}
+
+void BlueboyTelemetry::EndAcquisition(int index) {
+  if (_settings[index].acquisition == Acquisition::Fifo) {
+    _peripherals.EndOwnFifo();
+  } else if (_settings[index].acquisition == Acquisition::DataReady) {
+    _peripherals.EndOwnDataReady();
+  }
+  _settings[index].acquisition = Acquisition::Deadline;
+}
+
+uint16_t BlueboyTelemetry::MissedSamples(Device dev) {
+  int index = (int) dev - 1;
+  return _settings[index].missed;
+}
+
+uint8_t BlueboyTelemetry::MaxBatchDepth(AttitudeMode mode) {
+  if (PayloadSize(mode) == 0) {
+    return 0;
+  }
+  return (BatchBufferSize - PacketSender::HeaderSize - sizeof(AttitudeBatchHeader)) / PayloadSize(mode);
+}
+
+uint16_t BlueboyTelemetry::BytesPerSecond(AttitudeMode mode, uint8_t batchDepth, unsigned long period) {
+  if (period == 0) {
+    return UINT16_MAX;  // as fast as the loop goes, which is faster than the link
+  }
+  unsigned long perSecond = (PacketSize(mode, batchDepth) * 1000000UL + period * batchDepth - 1) /
+                            (period * batchDepth);
+  return min(perSecond, (unsigned long) UINT16_MAX);
+}
+
+uint8_t BlueboyTelemetry::PacketSize(AttitudeMode mode, uint8_t batchDepth) {
+  if (batchDepth > 1) {
+    return PacketSender::HeaderSize + sizeof(AttitudeBatchHeader) + batchDepth * PayloadSize(mode);
+  }
+  return PacketSender::HeaderSize + PayloadSize(mode) + sizeof(uint32_t);   // trailed by its timestamp
+}
+
+bool BlueboyTelemetry::Budget(int begun) {
+  uint16_t left = AttitudeBudget;
+  bool fits = true;
+
+  // in priority order, so Blueboy's own logging is decimated last
+  for (int i = 0; i < 2; i++) {
+    struct TelemetrySettings& settings = _settings[i];
+    if (!settings.logging) {
+      continue;
+    }
+
+    // one packet is built at a time, so a batch would be cut short by every sample of the other device
+    uint8_t depth = _settings[1 - i].logging ? 1 : settings.batchDepth;
+
+    // the shortest period whose packets fit in what's left, rounded up so they never take more
+    unsigned long samples = (unsigned long) left * depth;
+    unsigned long shortest = left > 0 ? (PacketSize(settings.mode, depth) * 1000000UL + samples - 1) /
+                                        samples : ULONG_MAX;
+    unsigned long period = max(settings.requestedPeriod, shortest);
+    if (settings.acquisition != Acquisition::Deadline) {
+      // the IMU only samples at its output data rates: the nearest at least as fast, or the next slower if that
+      // doesn't fit
+      unsigned long odrPeriod = CalibratedLSM6DS33::DataRatePeriodAtMost(period);
+      if (odrPeriod == 0 || BytesPerSecond(settings.mode, depth, odrPeriod) > left) {
+        odrPeriod = CalibratedLSM6DS33::DataRatePeriodAtLeast(period);
+      }
+      if (odrPeriod > 0) {
+        period = odrPeriod;
+      } else {
+        settings.acquisition = Acquisition::Deadline;   // read on deadlines instead
+      }
+    }
+    bool changed = period != settings.period || depth != settings.depth;
+
+    if (period > settings.requestedPeriod && period > MaxDecimatedPeriod) {
+      // decimated this far the data wouldn't be worth having
+      LOG_WARN(F("No link room for device "), i + 1);
+      settings.logging = false;
+      settings.period = period;
+      fits = fits && i != begun;
+      SendLogRate(i);
+      continue;
+    }
+
+    settings.period = period;
+    settings.depth = depth;
+    left -= BytesPerSecond(settings.mode, depth, period);
+    if (changed || i == begun) {
+      SendLogRate(i);
+    }
+  }
+  return fits;
+}
+
+void BlueboyTelemetry::SendLogRate(int index) {
+  const struct TelemetrySettings& settings = _settings[index];
+  struct LogRatePayload rate;
+  rate.device = index + 1;
+  rate.mode = (uint8_t) settings.mode;
+  rate.batchDepth = settings.depth;
+  rate.logging = settings.logging;
+  rate.requestedPeriod = settings.requestedPeriod;
+  rate.period = settings.period;
+  rate.bytesPerSecond = settings.logging ? BytesPerSecond(settings.mode, settings.depth, settings.period) : 0;
+  rate.acquisition = (uint8_t) settings.acquisition;
+
+  CompleteTransmission();
+  _sender.Begin((uint8_t) TelemetryID::LogRate);
+  _sender.Add(rate);
+  _sender.Send(_serial);
+}
+
+uint8_t BlueboyTelemetry::PayloadSize(AttitudeMode mode) {
+  switch (mode) {
+    case AttitudeMode::Euler:
+      return sizeof(EulerAttitudePayload);
+    case AttitudeMode::Quaternion:
+      return sizeof(Quaternion);
+    case AttitudeMode::Raw:
+      return sizeof(RawAttitudePayload);
+    case AttitudeMode::Counts:
+      return sizeof(AttitudeData::counts);
+    default:
+      return 0;
+  }
 }
 
 bool BlueboyTelemetry::Logging(Device dev) {
@@ -45,78 +238,482 @@ bool BlueboyTelemetry::Logging(Device dev) {
   return _settings[index].logging;
 }
 
-static char msgbuf[64];  // buffer to copy flash messages into
 void BlueboyTelemetry::SendMessage(const __FlashStringHelper *str) {
-  strcpy_P(msgbuf, (const char *)str);
-  SendMessage(msgbuf);
+  LOG_INFO(str);
+  CompleteTransmission();
+  _sender.Begin((uint8_t) TelemetryID::Message);
+  _sender.AddStr(str);
+  _sender.Send(_serial);
 }
 
 void BlueboyTelemetry::SendMessage(const char *str) {
-  Serial.println(str);
+  LOG_INFO(str);
+  CompleteTransmission();
   _sender.Begin((uint8_t) TelemetryID::Message);
   _sender.AddStr(str);
   _sender.Send(_serial);
 }
 
-void BlueboyTelemetry::SendAttitude(Device dev, AttitudeMode mode, const struct AttitudeData& data) {
+void BlueboyTelemetry::SendAttitude(Device dev, AttitudeMode mode, const struct AttitudeData& data,
+                                    unsigned long timestamp) {
+  uint8_t payload[sizeof(RawAttitudePayload)];
+  ToPayload(mode, data, payload);
+
+  CompleteTransmission();
   _sender.Begin(((uint8_t) dev << 4) | (uint8_t) mode);   // dev as high 4 bits, mode as low
+  _sender.AddBuf((const char *) payload, PayloadSize(mode));
+  _sender.Add((uint32_t) timestamp);
+  _sender.Send(_serial);
+}
+
+bool BlueboyTelemetry::SendCountsScale(Device dev) {
+  struct CountsScalePayload scale;
+  struct CountsCorrectionPayload correction;
+  if (!_peripherals.GetCountsScale(dev, &scale) || !_peripherals.GetCountsCorrection(dev, &correction)) {
+    return false;
+  }
+
+  // only Blueboy's own sensors have counts
+  _countsSlot = TemperatureBias::Slot(_peripherals.lsm6ds33.Temperature());
+  CompleteTransmission();
+  _sender.Begin((uint8_t) TelemetryID::OwnCountsScale);
+  _sender.Add(scale);
+  _sender.Send(_serial);
+  CompleteTransmission();
+  _sender.Begin((uint8_t) TelemetryID::OwnCountsCorrection);
+  _sender.Add(correction);
+  _sender.Send(_serial);
+  return true;
+}
+
+bool BlueboyTelemetry::SendStatus(LoopMonitor& monitor, const struct ReceiverStats& link) {
+  struct StatusPayload status;
+  if (_txLeft > 0 || _serial.availableForWrite() < (int) (PacketSender::HeaderSize + sizeof(status))) {
+    return false;
+  }
+
+  status.loopsPerSecond = monitor.LoopsPerSecond();
+  status.worstLoop = monitor.WorstLoop();
+  status.readTime = _peripherals.TakeReadTime();
+  status.txBacklog = _txHighWater;
+  status.sampleQueue = _queueHighWater;
+  status.missedSamples = _settings[0].missed + _settings[1].missed;
+  status.droppedBytes = link.droppedBytes;
+  status.syncLosses = link.syncLosses;
+  status.oversizeLengths = link.oversizeLengths;
+  status.freeRam = FreeRam();
+  status.stackHeadroom = StackHeadroom();
+  status.fusionCycles = _peripherals.TakeFusionCycles();
 
+  _sender.Begin((uint8_t) TelemetryID::Status);
+  _sender.Add(status);
+  _sender.Send(_serial);
+
+  monitor.Reset();
+  _txHighWater = 0;
+  _queueHighWater = 0;
+  return true;
+}
+
+bool BlueboyTelemetry::SendCalibrationProgress() {
+  // the IMU calibrates one of its sensors at a time, so at most two packets, checked for room together so
+  // neither is sent twice
+  const sensors_type_t types[] = { _peripherals.lsm6ds33.Calibrating(), _peripherals.lis2mdl.Calibrating() };
+  int size = 0;
+  for (sensors_type_t type : types) {
+    if (type) {
+      size += PacketSender::HeaderSize + sizeof(struct CalibrationProgressPayload);
+    }
+  }
+  if (size == 0) {
+    return true;
+  }
+  if (_txLeft > 0 || _serial.availableForWrite() < size) {
+    return false;
+  }
+
+  for (sensors_type_t type : types) {
+    struct CalibrationProgressPayload progress;
+    if (type && _peripherals.GetCalibrationProgress(type, &progress)) {
+      _sender.Begin((uint8_t) TelemetryID::CalibrationProgress);
+      _sender.Add(progress);
+      _sender.Send(_serial);
+    }
+  }
+  return true;
+}
+
+void BlueboyTelemetry::SendLinkStats(const struct ReceiverStats& stats) {
+  CompleteTransmission();
+  _sender.Begin((uint8_t) TelemetryID::LinkStats);
+  _sender.Add(stats);
+  _sender.Send(_serial);
+}
+
+void BlueboyTelemetry::ToPayload(AttitudeMode mode, const struct AttitudeData& data, uint8_t *payload) {
   switch (mode) {
-    case AttitudeMode::Raw:
-      _sender.AddFloat(data.raw.magnetic.x);
-      _sender.AddFloat(data.raw.magnetic.y);
-      _sender.AddFloat(data.raw.magnetic.z);
-    
-      _sender.AddFloat(data.raw.acceleration.x);
-      _sender.AddFloat(data.raw.acceleration.y);
-      _sender.AddFloat(data.raw.acceleration.z);
-      
-      _sender.AddFloat(data.raw.gyro.x);
-      _sender.AddFloat(data.raw.gyro.y);
-      _sender.AddFloat(data.raw.gyro.z);
+    case AttitudeMode::Raw: {
+      // the first three floats of each Vector are x, y, z
+      struct RawAttitudePayload raw;
+      memcpy(raw.magnetic, &data.raw.magnetic, sizeof(raw.magnetic));
+      memcpy(raw.acceleration, &data.raw.acceleration, sizeof(raw.acceleration));
+      memcpy(raw.gyro, &data.raw.gyro, sizeof(raw.gyro));
+      memcpy(payload, &raw, sizeof(raw));
       break;
-    case AttitudeMode::Euler:
-      _sender.AddFloat(data.orientation.euler.pitch);
-      _sender.AddFloat(data.orientation.euler.roll);
-      _sender.AddFloat(data.orientation.euler.heading);
+    }
+    case AttitudeMode::Euler: {
+      struct EulerAttitudePayload euler;
+      euler.pitch = data.orientation.euler.pitch;
+      euler.roll = data.orientation.euler.roll;
+      euler.heading = data.orientation.euler.heading;
+      memcpy(payload, &euler, sizeof(euler));
       break;
+    }
     case AttitudeMode::Quaternion:
-      _sender.AddFloat(data.orientation.quaternion.x);
-      _sender.AddFloat(data.orientation.quaternion.y);
-      _sender.AddFloat(data.orientation.quaternion.z);
-      _sender.AddFloat(data.orientation.quaternion.w);
+      memcpy(payload, &data.orientation.quaternion, sizeof(data.orientation.quaternion));
+      break;
+    case AttitudeMode::Counts:
+      memcpy(payload, &data.counts, sizeof(data.counts));
       break;
   }
-  
-  _sender.Send(_serial);
+}
+
+void BlueboyTelemetry::Sample(int index) {
+  struct TelemetrySettings& settings = _settings[index];
+  struct AttitudeSample *sample = _samples.Claim();
+  bool own = index == (int) Device::Own - 1;
+  bool background = settings.mode == AttitudeMode::Raw || (own && settings.mode == AttitudeMode::Counts);
+
+  if (sample == NULL) {
+    // the link has fallen behind; drop this sample rather than wait on it
+    settings.missed++;
+    settings.gap = true;
+  } else if (background) {
+    // read on the bus while the loop carries on, queued by Land; the slot is claimed again then
+    unsigned long now = micros();
+    if (own ? _peripherals.BeginOwnRead() : _peripherals.BeginTestRead()) {
+      _landingTimestamps[index] = now;
+    } else if (settings.period != 0) {
+      // the last read is still on the bus; sampling every tick just waits for it
+      settings.missed++;
+      settings.gap = true;
+    }
+  } else {
+    struct AttitudeData data;
+    Device dev = (Device) (index + 1);
+    sample->timestamp = micros();
+    bool read = true;
+    if (settings.mode == AttitudeMode::Raw) {
+      _peripherals.ReadRaw(dev, &data);
+    } else if (settings.mode == AttitudeMode::Counts) {
+      _peripherals.ReadCounts(dev, &data);
+    } else {
+      read = _peripherals.ReadOrientation(dev, settings.mode, &data);
+    }
+
+    if (!read) {
+      // no orientation to send, Blueboy's attitude filter hasn't settled or the test system didn't answer
+      settings.missed++;
+      settings.gap = true;
+    } else {
+      sample->index = index;
+      sample->mode = settings.mode;
+      sample->gap = settings.gap;
+      ToPayload(settings.mode, data, sample->payload);
+      _samples.Commit();
+      settings.gap = false;
+    }
+  }
+
+  if (settings.period == 0) {
+    settings.nextSample = micros();
+    return;
+  }
+
+  // the next deadline is a period after this one, not after now, so the time spent here doesn't accumulate
+  settings.nextSample += settings.period;
+  unsigned long behind = micros() - settings.nextSample;
+  if ((long) behind >= (long) settings.period) {
+    // a whole period or more late, skip the deadlines already missed rather than sampling in a burst
+    unsigned long skipped = behind / settings.period;
+    settings.nextSample += skipped * settings.period;
+    settings.missed += skipped;
+    settings.gap = true;
+  }
+}
+
+void BlueboyTelemetry::Land(int index) {
+  struct TelemetrySettings& settings = _settings[index];
+  struct AttitudeData data;
+  bool own = index == (int) Device::Own - 1;
+  bool read = own ? _peripherals.FinishOwnRead(settings.mode, &data) : _peripherals.FinishTestRead(&data);
+  if (!settings.logging || settings.acquisition != Acquisition::Deadline || (own && Fusing()) ||
+      (!own && settings.mode != AttitudeMode::Raw)) {
+    return;  // logging ended or changed while it was on the bus, or the read only fed the attitude filter
+  }
+
+  struct AttitudeSample *sample = _samples.Claim();
+  if (!read || sample == NULL) {
+    // failed, or the other device's samples filled the queue meanwhile
+    settings.missed++;
+    settings.gap = true;
+    return;
+  }
+  sample->timestamp = _landingTimestamps[index];
+  sample->index = index;
+  sample->mode = settings.mode;
+  sample->gap = settings.gap;
+  ToPayload(settings.mode, data, sample->payload);
+  _samples.Commit();
+  settings.gap = false;
+}
+
+bool BlueboyTelemetry::Fusing() {
+  struct TelemetrySettings& settings = _settings[(int) Device::Own - 1];
+  return settings.logging && (settings.mode == AttitudeMode::Euler || settings.mode == AttitudeMode::Quaternion);
+}
+
+void BlueboyTelemetry::DrainFifo(int index) {
+  struct TelemetrySettings& settings = _settings[index];
+  settings.nextSample = micros() + settings.period * FifoDrainPeriods;
+
+  bool overrun = false;
+  uint8_t room = SampleQueueDepth - _samples.Count();
+  uint16_t waiting = _peripherals.OwnFifoSamples(&overrun);
+  if (overrun) {
+    // the FIFO held samples longer than its 8 KB lasts, so some were overwritten; how many isn't known
+    settings.missed++;
+    settings.gap = true;
+  }
+  uint8_t count = min(waiting, (uint16_t) room);
+  if (count == 0) {
+    return;
+  }
+
+  struct AttitudeData data;
+  if (!_peripherals.ReadOwnMagnetic(settings.mode, &data)) {
+    return;
+  }
+  for (uint8_t i = 0; i < count; i++) {
+    struct AttitudeSample *sample = _samples.Claim();
+    if (!_peripherals.ReadOwnFifo(settings.mode, &data, &sample->timestamp)) {
+      return;
+    }
+    sample->index = index;
+    sample->mode = settings.mode;
+    sample->gap = settings.gap;
+    ToPayload(settings.mode, data, sample->payload);
+    _samples.Commit();
+    settings.gap = false;
+  }
+}
+
+void BlueboyTelemetry::Acquire(int index) {
+  struct TelemetrySettings& settings = _settings[index];
+  unsigned long timestamp;
+  if (!_peripherals.OwnDataReady(&timestamp)) {
+    if ((long) (micros() - settings.nextSample) < 0) {
+      return;
+    }
+    // no edge for several periods: one was lost, or a failed read left the pin high; reading re-arms it
+    timestamp = micros();
+    settings.missed++;
+    settings.gap = true;
+  }
+  settings.nextSample = timestamp + settings.period * DataReadyTimeoutPeriods;
+
+  // the pin rises only once until the sample is read, so if this is a period or more late, newer samples have
+  // overwritten the one flagged without raising edges of their own; the one read is the latest of them
+  unsigned long late = micros() - timestamp;
+  if (late >= settings.period) {
+    unsigned long skipped = late / settings.period;
+    timestamp += skipped * settings.period;
+    settings.missed += skipped;
+    settings.gap = true;
+  }
+
+  // read even with no room to queue it, so the pin falls and rises again for the next sample
+  struct AttitudeData data;
+  bool read = _peripherals.ReadOwnDataReady(settings.mode, &data);
+  struct AttitudeSample *sample = _samples.Claim();
+  if (!read || sample == NULL) {
+    settings.missed++;
+    settings.gap = true;
+    return;
+  }
+  sample->timestamp = timestamp;
+  sample->index = index;
+  sample->mode = settings.mode;
+  sample->gap = settings.gap;
+  ToPayload(settings.mode, data, sample->payload);
+  _samples.Commit();
+  settings.gap = false;
+}
+
+void BlueboyTelemetry::Transmit() {
+  while (true) {
+    if (_txLeft > 0) {
+      int room = _serial.availableForWrite();
+      uint16_t count = room > 0 ? min((uint16_t) room, _txLeft) : 0;
+      _serial.write((const uint8_t *) _txNext, count);
+      _txNext += count;
+      _txLeft -= count;
+      if (_txLeft > 0) {
+        return;
+      }
+    }
+    if (!NextPacket()) {
+      return;
+    }
+  }
+}
+
+void BlueboyTelemetry::CompleteTransmission() {
+  if (_txLeft > 0) {
+    _serial.write((const uint8_t *) _txNext, _txLeft);
+    _txLeft = 0;
+  }
+}
+
+bool BlueboyTelemetry::NextPacket() {
+  while (!_samples.Empty()) {
+    struct AttitudeSample& sample = _samples.Front();
+    struct TelemetrySettings& settings = _settings[sample.index];
+
+    if (settings.batched > 0 && (sample.gap || sample.mode != settings.packetMode)) {
+      // samples in a batch are a period apart in one mode, so this one has to start the next packet
+      StartPacket(sample.index);
+      return true;
+    }
+
+    if (settings.batched == 0 && _settings[1 - sample.index].batched > 0) {
+      // packets are built one at a time, so the other device's batch goes out as far as it got
+      StartPacket(1 - sample.index);
+      return true;
+    }
+
+    AddSample(sample);
+    _samples.Pop();
+    if (settings.batched >= settings.packetDepth) {
+      StartPacket(sample.index);
+      return true;
+    }
+  }
+
+  // a device that stopped logging sends what it has batched once nothing it sampled is left queued
+  for (int i = 0; i < 2; i++) {
+    if (!_settings[i].logging && _settings[i].batched > 0) {
+      StartPacket(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+void BlueboyTelemetry::AddSample(const struct AttitudeSample& sample) {
+  struct TelemetrySettings& settings = _settings[sample.index];
+  PacketSender& sender = _batchSender;
+  uint8_t id = ((uint8_t) (sample.index + 1) << 4) | (uint8_t) sample.mode;   // dev as high 4 bits, mode as low
+
+  if (settings.batched == 0) {
+    settings.packetDepth = settings.depth;
+    settings.packetMode = sample.mode;
+    if (settings.packetDepth > 1) {
+      // first sample of a new batch, the count is filled in when the batch is sent
+      sender.Begin(id | ATTITUDE_BATCH_BIT);
+
+      struct AttitudeBatchHeader header;
+      header.count = 0;
+      header.timestamp = sample.timestamp;
+      sender.Add(header);
+    } else {
+      sender.Begin(id);
+    }
+  }
+
+  sender.AddBuf((const char *) sample.payload, PayloadSize(sample.mode));
+  if (settings.packetDepth == 1) {
+    sender.Add((uint32_t) sample.timestamp);
+  }
+  settings.batched++;
+}
+
+void BlueboyTelemetry::StartPacket(int index) {
+  if (_settings[index].packetDepth > 1) {
+    _batchSender.Set(offsetof(AttitudeBatchHeader, count), _settings[index].batched);
+  }
+  _txNext = _batchbuf;
+  _txLeft = _batchSender.Finish();
+  _settings[index].batched = 0;
+}
+
+void BlueboyTelemetry::FlushSamples() {
+  CompleteTransmission();
+  while (NextPacket()) {
+    CompleteTransmission();
+  }
+  for (int i = 0; i < 2; i++) {
+    if (_settings[i].batched > 0) {
+      StartPacket(i);
+      CompleteTransmission();
+    }
+  }
 }
 
 void BlueboyTelemetry::Tick() {
+  // each reads only once its output data rate has a new sample, so between samples these return at once
   if (_peripherals.lsm6ds33.Calibrating()) {
     _peripherals.lsm6ds33.AddCalibrationSample();
-    delay(1);
+    if (!_peripherals.lsm6ds33.Calibrating()) {
+      SendMessage(SETTLED_CALIB_MSG);   // ended itself; the test system's calibration is left to the command
+    }
   }
-  
   if (_peripherals.lis2mdl.Calibrating()) {
     _peripherals.lis2mdl.AddCalibrationSample();
-    delay(1);
+  }
+  if ((long) (micros() - _nextProgress) >= 0 && SendCalibrationProgress()) {
+    _nextProgress = micros() + ProgressPeriod;
   }
   
-  for (int i = 0; i < 2; i++) {
-    if (_settings[i].logging && (millis() - _settings[i].lastSent >= _settings[i].sendDelay)) {
-      // we are currently logging on this device, and it has been at least as long as the collection period
-      struct AttitudeData data;
+  // ahead of any sample due now, which was taken later
+  if (_peripherals.OwnReadLanded()) {
+    Land((int) Device::Own - 1);
+  }
+  if (_peripherals.TestReadLanded()) {
+    Land((int) Device::Test - 1);
+  }
 
-      Device dev = (Device) (i + 1);
-  
-      // send attitude
-      if (_settings[i].mode == AttitudeMode::Raw) {
-        _peripherals.ReadRaw(dev, &data);
+  if (Fusing() && (long) (micros() - _nextFusion) >= 0 && _peripherals.BeginOwnRead()) {
+    // the filter integrates the time between reads as it was, so a late one needn't be caught up on
+    _nextFusion = micros() + FusionPeriod;
+  }
+
+  // the ground converts counts with the descriptors last sent, so those sampled at the old temperature go first
+  const struct TelemetrySettings& own = _settings[(int) Device::Own - 1];
+  if (own.logging && own.mode == AttitudeMode::Counts &&
+      TemperatureBias::Slot(_peripherals.lsm6ds33.Temperature()) != _countsSlot) {
+    FlushSamples();
+    SendCountsScale(Device::Own);
+  }
+
+  for (int i = 0; i < 2; i++) {
+    if (!_settings[i].logging) {
+      continue;
+    }
+    if (_settings[i].acquisition == Acquisition::DataReady) {
+      // checked every tick, the sensor keeps the time
+      Acquire(i);
+    } else if ((long) (micros() - _settings[i].nextSample) >= 0) {
+      // its next sample or drain is due
+      if (_settings[i].acquisition == Acquisition::Fifo) {
+        DrainFifo(i);
+      } else {
+        Sample(i);
       }
-  
-      SendAttitude(dev, _settings[i].mode, data);
-      
-      _settings[i].lastSent = millis();
     }
   }
+  _queueHighWater = max(_queueHighWater, _samples.Count());
+
+  Transmit();
+  _txHighWater = max(_txHighWater, _txLeft);
 }
@@ -9,6 +9,9 @@
 #include <Arduino.h>
 #include <AltSoftSerial.h>
 #include "util/PacketSender.h"
+#include "util/PacketReceiver.h"
+#include "util/RingBuffer.h"
+#include "util/LoopMonitor.h"
 
 #include "Blueboy.h"
 #include "BlueboyPeripherals.h"
@@ -19,15 +22,38 @@
  */
 struct TelemetrySettings {
   AttitudeMode mode;          //!< attitude logging mode
-  unsigned long sendDelay;    //!< time in milliseconds between sending data log packets
-  unsigned long lastSent;     //!< time that the last data log packet was sent
+  unsigned long requestedPeriod;  //!< time in microseconds between attitude samples as commanded
+  unsigned long period;       //!< time in microseconds between attitude samples as the link budget allows
+  unsigned long nextSample;   //!< micros() deadline of the next attitude sample
   bool logging;               //!< true if currently logging data
+  Acquisition acquisition;    //!< how samples are taken: read on deadlines, drained from the IMU's FIFO, or read on
+                              //!< the sensors' data-ready edges
+  bool gap;                   //!< true if a sample was missed since the last one queued
+  uint16_t missed;            //!< samples missed since logging began, to a late loop or a full sample queue
+  uint8_t batchDepth;         //!< number of samples commanded to pack into each attitude packet
+  uint8_t depth;              //!< number of samples packed into each attitude packet: batchDepth, or 1 while the
+                              //!< other device logs too
+  uint8_t batched;            //!< number of samples in the attitude packet currently being built
+  uint8_t packetDepth;        //!< batch depth the attitude packet being built was begun with
+  AttitudeMode packetMode;    //!< attitude mode of the packet being built
 };
 
 /*!
- * @var long Default time in milliseconds between data packets being sent
+ * @struct AttitudeSample
+ * @brief An attitude sample waiting to be packed into telemetry, already laid out as it is sent.
  */
-constexpr unsigned long DEFAULT_LOG_DELAY = 200;
+struct AttitudeSample {
+  unsigned long timestamp;    //!< micros() when the sample was read
+  uint8_t index;              //!< index of the device sampled
+  AttitudeMode mode;          //!< attitude mode of the payload
+  bool gap;                   //!< true if samples were missed just before this one
+  uint8_t payload[sizeof(RawAttitudePayload)];  //!< the largest payload, only PayloadSize(mode) bytes are used
+};
+
+/*!
+ * @var long Default time in microseconds between attitude samples
+ */
+constexpr unsigned long DEFAULT_LOG_PERIOD = 200000;
 
 /*!
  * @var AttitudeMode Default attitude mode for data to be sent in
@@ -40,6 +66,64 @@ constexpr AttitudeMode DEFAULT_ATTITUDE_MODE = AttitudeMode::Raw;
  */
 class BlueboyTelemetry {
  public:
+  /*!
+   * @var int BatchBufferSize
+   * Size in bytes of the buffer attitude packets are built in, one device's at a time
+   */
+  static constexpr int BatchBufferSize = 128;
+
+  /*!
+   * @var uint8_t SampleQueueDepth
+   * Number of samples that can wait for the attitude packet going out to finish, at least the FifoDrainPeriods
+   * samples a drain of the IMU's FIFO takes
+   */
+  static constexpr uint8_t SampleQueueDepth = 2;
+
+  /*!
+   * @var uint16_t LinkBytesPerSecond
+   * Bytes per second the link carries
+   */
+  static constexpr uint16_t LinkBytesPerSecond = LINK_BAUD / 10;
+
+  /*!
+   * @var uint16_t AttitudeBudget
+   * Bytes per second attitude logging may take between all devices. The rest is left for messages and replies to
+   * commands, which go out ahead of any queued attitude data and so mustn't find the link already saturated.
+   */
+  static constexpr uint16_t AttitudeBudget = LinkBytesPerSecond * 85UL / 100;
+
+  /*!
+   * @var unsigned long MaxDecimatedPeriod
+   * Longest period in microseconds a device's logging is stretched to in order to fit the budget; a device that
+   * would need longer is refused instead, unless it was commanded longer in the first place.
+   */
+  static constexpr unsigned long MaxDecimatedPeriod = 1000000;
+
+  /*!
+   * @var uint8_t FifoDrainPeriods
+   * Sample periods between drains of the IMU's FIFO when logging from it, so each drain reads several samples
+   */
+  static constexpr uint8_t FifoDrainPeriods = 2;
+
+  /*!
+   * @var uint8_t DataReadyTimeoutPeriods
+   * Sample periods without a data-ready edge after which the IMU is read anyway, re-arming a pin left high
+   */
+  static constexpr uint8_t DataReadyTimeoutPeriods = 4;
+
+  /*!
+   * @var unsigned long FusionPeriod
+   * Time in microseconds between reads of Blueboy's sensors into its attitude filter while it logs orientation:
+   * the magnetometer's 100 Hz, so each read has a new sample of both sensors
+   */
+  static constexpr unsigned long FusionPeriod = 10000;
+
+  /*!
+   * @var unsigned long ProgressPeriod
+   * Time in microseconds between calibration progress packets for each of Blueboy's own sensors calibrating
+   */
+  static constexpr unsigned long ProgressPeriod = 1000000;
+
   /*!
    * @brief Initialize telemetry to use the given serial stream and sync pattern
    * @param serial Reference to the AltSoftSerial stream to write bytes to
@@ -55,29 +139,82 @@ class BlueboyTelemetry {
 
   /*!
    * @brief Updates the telemetry handler
+   *
+   * Takes the attitude samples that are due, then writes queued telemetry out as far as the link's transmit
+   * buffer has room, so neither waits on the other.
+   *
+   * Calibrating sensors take a sample whenever their output data rate has a new one, and report their progress
+   * every ProgressPeriod.
    */
   void Tick();
 
   /*!
    * @brief Sets the log period of the given device
    * @param dev Device to change the log period of
-   * @param period logging period in milliseconds
+   * @param period logging period in microseconds, 0 to sample on every tick
+   *
+   * Samples are due at fixed intervals from when logging began, so the time taken reading and sending doesn't
+   * drift the period. A deadline missed by a whole period is skipped rather than sampled late.
+   *
+   * Raw samples, and Blueboy's counts samples, are read in the background, stamped when the read starts and
+   * queued on the tick after it lands; a deadline that comes round with the last read still on the bus is missed.
+   *
+   * Takes effect when logging begins, and may be lengthened then to fit the link budget.
    */
   void SetLogPeriod(Device dev, unsigned long period);
 
+  /*!
+   * @param dev Device to check
+   * @return Time in microseconds between the device's attitude samples, as the link budget allows
+   */
+  unsigned long LogPeriod(Device dev);
+
   /*!
    * @brief Enables attitude logging on the given device with the given mode
    * @param dev Device to begin logging from
    * @param mode Attitude mode data should be sent in
+   * @param batchDepth Number of samples to pack into each packet, clamped to MaxBatchDepth(mode)
+   * @param acquisition How to take samples; only Blueboy's raw or counts data can be taken other than on deadlines
+   * @return False if the device can't send data in the given mode, leaving logging unchanged, or if the link has
+   *         no room for it, ending any logging it was doing
+   *
+   * Counts mode first sends the device's counts descriptors. Samples are only batched while one device logs,
+   * as the devices share a buffer to build packets in. A log rate packet is sent for every device whose period or
+   * batch depth changed.
    */
-  void BeginLogging(Device dev, AttitudeMode mode);
+  bool BeginLogging(Device dev, AttitudeMode mode, uint8_t batchDepth = 1,
+                    Acquisition acquisition = Acquisition::Deadline);
 
   /*!
-   * @brief Disables attitude logging on the given device
+   * @param mode Attitude mode of the samples
+   * @return The largest number of samples in the given mode that fit in one batched attitude packet, 0 for an
+   *         unknown mode
+   */
+  static uint8_t MaxBatchDepth(AttitudeMode mode);
+
+  /*!
+   * @param mode Attitude mode of the samples
+   * @param batchDepth Number of samples in each packet
+   * @param period Time in microseconds between samples
+   * @return Link bandwidth in bytes per second the samples take, framing included, rounded up
+   */
+  static uint16_t BytesPerSecond(AttitudeMode mode, uint8_t batchDepth, unsigned long period);
+
+  /*!
+   * @brief Disables attitude logging on the given device, sending any partially filled batch
    * @param dev Device to end logging from
+   *
+   * Other devices decimated or kept from batching to make room for this one get their rates and batch depths back,
+   * and log rate packets saying so.
    */
   void EndLogging(Device dev);
 
+  /*!
+   * @param dev Device to check
+   * @return Samples the device has missed since logging began, to a late loop or a full sample queue
+   */
+  uint16_t MissedSamples(Device dev);
+
   /*!
    * @brief Sends a message packet with the given message
    * @param str Null-terminated string to send
@@ -86,7 +223,7 @@ class BlueboyTelemetry {
   
   /*!
    * @brief Sends a message packet with the given message
-   * @param str Null-terminated string in flash memory to send
+   * @param str Null-terminated string in flash memory to send, copied straight into the packet
    */
   void SendMessage(const __FlashStringHelper *str);
 
@@ -95,8 +232,37 @@ class BlueboyTelemetry {
    * @param dev Device to send attitude data from
    * @param mode Mode to send attitude data in
    * @param data Attitude data to send
+   * @param timestamp micros() when the data was read
+   */
+  void SendAttitude(Device dev, AttitudeMode mode, const struct AttitudeData& data, unsigned long timestamp);
+  
+  /*!
+   * @brief Sends the descriptor packets converting the given device's count attitude data to SI units, its scale
+   *        and offsets then its correction
+   * @param dev Device to describe
+   * @return False if the device has no count output
+   *
+   * The gyroscope's offsets follow its temperature, so while Blueboy logs counts they are sent again each time the
+   * temperature moves into another slot of its bias model.
    */
-  void SendAttitude(Device dev, AttitudeMode mode, const struct AttitudeData& data);
+  bool SendCountsScale(Device dev);
+
+  /*!
+   * @brief Sends a status packet, unless the link is busy
+   * @param monitor Timing of the loop over the status period, reset if the packet is sent
+   * @param link The command link's error counters
+   * @return False if the packet wasn't sent because the link was still busy with another, so it can be tried
+   *         again on the next loop instead of waiting
+   *
+   * Resets the other figures covering the status period as well: sensor read time and backlog high-water marks.
+   */
+  bool SendStatus(LoopMonitor& monitor, const struct ReceiverStats& link);
+
+  /*!
+   * @brief Sends a packet with the command link's error counters
+   * @param stats Counters to send
+   */
+  void SendLinkStats(const struct ReceiverStats& stats);
   
   /*!
    * @param dev The device to check for logging status
@@ -104,13 +270,80 @@ class BlueboyTelemetry {
    */
   bool Logging(Device dev);
  private:
+  static uint8_t PayloadSize(AttitudeMode mode);
+  static void ToPayload(AttitudeMode mode, const struct AttitudeData& data, uint8_t *payload);
+
+  // bytes one attitude packet of the given mode and batch depth takes on the link
+  static uint8_t PacketSize(AttitudeMode mode, uint8_t batchDepth);
+
+  // shares the attitude budget out between logging devices in priority order, decimating or stopping those that
+  // don't fit, and reports the rate of the device at the given index and of any other whose rate changed
+  bool Budget(int begun);
+
+  // sends the rate the device at the given index is logging at
+  void SendLogRate(int index);
+
+  // reads an attitude sample from the device at the given index into the sample queue, and schedules the next
+  void Sample(int index);
+
+  // queues the sample the background read of the device at the given index landed, begun by Sample, or for
+  // Blueboy fuses it into the attitude filter
+  void Land(int index);
+
+  // true if Blueboy is logging its orientation, so its sensors are read into the attitude filter
+  bool Fusing();
+
+  // moves samples from the IMU's FIFO into the sample queue as far as it has room, and schedules the next drain
+  void DrainFifo(int index);
+
+  // reads the IMU's sample into the sample queue if its data-ready pin flagged one, or it has been silent too long
+  void Acquire(int index);
+
+  // stops the FIFO or data-ready flagging the device at the given index was taking samples with
+  void EndAcquisition(int index);
+
+  // sends a calibration progress packet for each of Blueboy's own sensors calibrating, returning false if the link
+  // had no room for one so the rest can be tried again on the next tick
+  bool SendCalibrationProgress();
+
+  // writes the packet going out, and queues the next, as far as the link has room
+  void Transmit();
+
+  // writes out the rest of the packet going out, waiting on the link, so another can be sent whole
+  void CompleteTransmission();
+
+  // packs queued samples into attitude packets until one is ready to go out, returning false if none is
+  bool NextPacket();
+
+  // adds a sample to the attitude packet its device is building, beginning one if needed
+  void AddSample(const struct AttitudeSample& sample);
+
+  // starts the attitude packet the device at the given index was building going out
+  void StartPacket(int index);
+
+  // packs and writes out every sample queued, waiting on the link, so a packet sent next follows them
+  void FlushSamples();
+
   AltSoftSerial& _serial;
 
   BlueboyPeripherals& _peripherals;
   
-  char _sendbuf[64];            // send packet buffer, used to build a packet
+  char _sendbuf[PacketSender::BufferSize];  // send packet buffer, used to build a packet
   PacketSender _sender;         // internal packet sender
 
+  char _batchbuf[BatchBufferSize];      // buffer attitude packets are built in
+  PacketSender _batchSender;            // attitude packet sender, single or batched
+
+  RingBuffer<struct AttitudeSample, SampleQueueDepth> _samples;  // samples taken but not yet packed
+  const char *_txNext;                  // next byte of the attitude packet going out
+  uint16_t _txLeft;                     // bytes of the attitude packet going out still to write
+  uint16_t _txHighWater;                // most bytes left waiting on the link since the last status packet
+  uint8_t _queueHighWater;              // most samples queued since the last status packet
+  unsigned long _landingTimestamps[2];  // micros() when each device's background read began
+  unsigned long _nextFusion;            // micros() deadline of the next read into the attitude filter
+  unsigned long _nextProgress;          // micros() deadline of the next calibration progress packets
+  uint8_t _countsSlot;                  // temperature slot of the counts descriptors last sent
+
   struct TelemetrySettings _settings[2];
 };
 
@@ -5,6 +5,7 @@
  */
 
 #include "CommandProcessor.h"
+#include "util/Log.h"
 
 /*!
  * @fn NOOPCMD
@@ -12,7 +13,22 @@
  */
 constexpr bool NOOPCMD (CommandID cmd, const char *data, uint16_t len) { return false; }
 
-CommandProcessor::CommandProcessor(AltSoftSerial& serial, uint32_t sync) : _serial(serial), _receiver(PacketReceiver(_rcvbuf, sync)) {
+/*!
+ * @var size_t RX_CHUNK_SIZE
+ * Number of received bytes to pass to the packet receiver at once
+ */
+constexpr size_t RX_CHUNK_SIZE = 16;
+
+/*!
+ * @var unsigned long RX_TIMEOUT
+ * Milliseconds without a byte after which a partly received packet is abandoned. Commands arrive as whole
+ * packets far apart, so a stall mid-packet means its length was corrupt and it is waiting on bytes that belong
+ * to later packets, or on none at all
+ */
+constexpr unsigned long RX_TIMEOUT = 100;
+
+CommandProcessor::CommandProcessor(AltSoftSerial& serial, uint32_t sync) : _serial(serial),
+    _receiver(PacketReceiver(_rcvbuf, sync, sizeof(_rcvbuf))), _lastReceived(0) {
   _reset =               &NOOPCMD;
   _echo =                &NOOPCMD;
   _beginOwnAttitude =    &NOOPCMD;
@@ -23,6 +39,7 @@ CommandProcessor::CommandProcessor(AltSoftSerial& serial, uint32_t sync) : _seri
   _beginCalibrate =      &NOOPCMD;
   _endCalibrate =        &NOOPCMD;
   _clearCalibrate =      &NOOPCMD;
+  _linkStats =           &NOOPCMD;
   _receiver.Begin();
 }
 
@@ -36,6 +53,10 @@ void CommandProcessor::Bind(CommandID cmd, CommandCallback cmdCallback) {
       _echo = cmdCallback;
       break;
 
+    case CommandID::LinkStats:
+      _linkStats = cmdCallback;
+      break;
+
     case CommandID::BeginOwnAttitude:
       _beginOwnAttitude = cmdCallback;
       break;
@@ -86,6 +107,10 @@ bool CommandProcessor::Dispatch(CommandID cmd, const char *data, uint16_t dataLe
       return _echo(cmd, data, dataLen);
       break;
 
+    case CommandID::LinkStats:
+      return _linkStats(cmd, data, dataLen);
+      break;
+
     case CommandID::BeginOwnAttitude:
       return _beginOwnAttitude(cmd, data, dataLen);
       break;
@@ -127,19 +152,45 @@ bool CommandProcessor::Dispatch(CommandID cmd, const char *data, uint16_t dataLe
 }
 
 void CommandProcessor::Tick() {
-  while (_serial.available()) {
-    // read a single byte at a time, add it to a packet being built
-    char readbyte = _serial.read();
-    if (_receiver.AddByte(readbyte)) {
+  uint8_t chunk[RX_CHUNK_SIZE];
+  size_t len = 0;
+  const uint8_t *next = chunk;
+
+  if (_receiver.InProgress() && !_serial.available() && millis() - _lastReceived > RX_TIMEOUT) {
+    _receiver.Abort();  // any packet it turns out to hold is dispatched below
+  }
+
+  while (true) {
+    if (_receiver.Completed()) {
       // a full packet was just received
-      _receiver.PrintPacketInfo();
-      
       CommandID cmd = (CommandID) _receiver.GetPacketID();
       const char *data = _receiver.GetPacketData();
       uint16_t datalen = _receiver.GetPacketDataLength();
+      LOG_DEBUG(F("Received command "), LogHex((uint8_t) cmd), F(" with "), datalen, F(" data bytes"));
       Dispatch(cmd, data, datalen);
       
-      _receiver.Begin();  // restart packet receiver
+      _receiver.Begin();  // restart packet receiver, which may complete a packet found in an abandoned one
+      continue;
     }
+
+    if (len == 0) {
+      // drain what has arrived into a chunk, then hand it to the packet receiver in bulk
+      while (len < sizeof(chunk) && _serial.available()) {
+        chunk[len++] = _serial.read();
+      }
+      if (len == 0) {
+        break;
+      }
+      next = chunk;
+      _lastReceived = millis();
+    }
+
+    size_t consumed = _receiver.AddBytes(next, len);
+    next += consumed;
+    len -= consumed;
   }
 }
+
+const struct ReceiverStats& CommandProcessor::LinkStats() {
+  return _receiver.Stats();
+}
@@ -51,14 +51,21 @@ class CommandProcessor {
    * @return True iff the command callback successfully executed.
    */
   bool Dispatch(CommandID cmd, const char *data, uint16_t dataLen);
+
+  /*!
+   * @return Error counters of the command link since startup
+   */
+  const struct ReceiverStats& LinkStats();
  private:
   AltSoftSerial& _serial;       // serial stream to read command bytes from
   
   char _rcvbuf[64];             // buffer containing data received from packets (without sync, length, id, etc.)
   PacketReceiver _receiver;     // internal packet receiver
+  unsigned long _lastReceived;  // time in ms the latest bytes were received
   
   CommandCallback _reset;              // reset command callback
   CommandCallback _echo;               // message command callback
+  CommandCallback _linkStats;          // link statistics command callback
   CommandCallback _beginOwnAttitude;   // begin logging own attitude command callback
   CommandCallback _endOwnAttitude;     // end logging own attitude command callback
   CommandCallback _beginTestAttitude;  // begin logging test attitude command callback
@@ -13,14 +13,21 @@
 #define DEFAULT_MSG         F("see how the brain plays around")
 #define SETUP_MSG           F("Initialized system")
 #define CANT_LOG_MSG        F("Can't log, stop calibrating first")
+#define CANT_LOG_MODE_MSG   F("Can't log, mode unsupported or link full")
 #define BEGIN_LOG_MSG       F("Began logging")
 #define END_LOG_MSG         F("Ended logging")
 #define RESET_MSG           F("Resetting system...")
 #define UNRECOGNIZED_MSG    F("Unrecognized command")
 
 #define CANT_CALIB_MSG      F("Can't calibrate, stop logging first")
+#define BUSY_CALIB_MSG      F("Can't calibrate, a sensor is already calibrating")
 #define BEGIN_CALIB_MSG     F("Began calibration")
+#define NOT_CALIB_MSG       F("Wasn't calibrating that sensor")
 #define END_CALIB_MSG       F("Ended calibration")
 #define CLEAR_CALIB_MSG     F("Cleared calibration")
+#define FIT_CALIB_MSG       PSTR("Ended calibration, fit residual %u.%02u%% of field")
+#define SETTLED_CALIB_MSG   F("Gyroscope bias settled, ended calibration")
+#define NO_FIT_CALIB_MSG    F("Calibration failed, samples fit no ellipsoid")
+#define NO_POS_CALIB_MSG    F("Calibration failed, hold each axis up and down")
 
 #endif
\ No newline at end of file
@@ -0,0 +1,69 @@
+/*!
+ * @file BiasEstimator.cpp
+ * @author Sebastian S.
+ * @brief Implementation of BiasEstimator.h
+ */
+
+#include <math.h>
+#include "BiasEstimator.h"
+
+void BiasEstimator::Reset(float resolution) {
+  _resolution = resolution;
+  _rejected = 0;
+  restart();
+}
+
+void BiasEstimator::restart() {
+  for (uint8_t i = 0; i < 3; i++) {
+    _mean[i] = 0;
+    _squares[i] = 0;
+  }
+  _samples = 0;
+  _run = 0;
+}
+
+bool BiasEstimator::Add(const float sample[3]) {
+  if (_samples == 0xFFFF) {
+    return true;    // the mean is as settled as it will get
+  }
+
+  if (_samples >= WarmUp) {
+    for (uint8_t i = 0; i < 3; i++) {
+      float deviation = max(sqrtf(_squares[i] / (_samples - 1)), _resolution);
+      float off = sample[i] - _mean[i];
+      if (off * off > RejectSigma * RejectSigma * deviation * deviation) {
+        _rejected++;
+        if (++_run >= RestartRun) {
+          restart();
+        }
+        return false;
+      }
+    }
+  }
+  _run = 0;
+
+  // Welford's update: the deviation from the old mean times that from the new adds the sample's share of the
+  // squares without the cancellation of summing squares and subtracting the squared sum
+  _samples++;
+  for (uint8_t i = 0; i < 3; i++) {
+    float before = sample[i] - _mean[i];
+    _mean[i] += before / _samples;
+    _squares[i] += before * (sample[i] - _mean[i]);
+  }
+  return true;
+}
+
+void BiasEstimator::GetMean(struct AxisOffsets *mean) {
+  mean->xOff = _mean[0];
+  mean->yOff = _mean[1];
+  mean->zOff = _mean[2];
+}
+
+float BiasEstimator::StandardError() {
+  if (_samples < WarmUp) {
+    return INFINITY;
+  }
+
+  float squares = max(max(_squares[0], _squares[1]), _squares[2]);
+  return sqrtf(squares / (_samples - 1) / _samples);
+}
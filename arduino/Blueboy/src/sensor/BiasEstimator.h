@@ -0,0 +1,93 @@
+/*!
+ * @file BiasEstimator.h
+ * @author Sebastian S.
+ * @brief Declaration for BiasEstimator
+ */
+
+#ifndef BIAS_ESTIMATOR_H_
+#define BIAS_ESTIMATOR_H_
+
+#include <Arduino.h>
+#include "CalibrationStorage.h"
+
+/*!
+ * @class BiasEstimator
+ * @brief Streaming mean and variance of a still three-axis sensor, for its bias.
+ *
+ * Keeps Welford's running mean and sum of squared deviations per axis, so the mean is of every sample, not of
+ * the noise's two extremes, and the variance says how well the mean is known: its standard error is the
+ * standard deviation over the square root of the samples. A sample further than RejectSigma deviations from
+ * the mean on any axis, a knock or a glitch, is left out; RestartRun of them in a row means the sensor is really
+ * moving, and the statistics start again.
+ */
+class BiasEstimator {
+ public:
+  /*!
+   * @var uint8_t WarmUp
+   * Samples taken before any is rejected, so the first deviation is worth testing against
+   */
+  static constexpr uint8_t WarmUp = 16;
+
+  /*!
+   * @var float RejectSigma
+   * Deviations from the mean past which a sample is rejected; Gaussian noise goes that far once in 16000
+   */
+  static constexpr float RejectSigma = 4.0f;
+
+  /*!
+   * @var uint8_t RestartRun
+   * Rejected samples in a row after which the statistics start again
+   */
+  static constexpr uint8_t RestartRun = 16;
+
+  /*!
+   * @param resolution As for Reset
+   */
+  BiasEstimator(float resolution = 0) { Reset(resolution); }
+
+  /*!
+   * @brief Discards every sample taken
+   * @param resolution Smallest step the sensor reads, the least deviation a sample is tested against, so a
+   *        sensor quiet enough to read the same count every time doesn't reject its first change
+   */
+  void Reset(float resolution);
+
+  /*!
+   * @param sample Reading to take, x, y, z
+   * @return False if it was rejected
+   */
+  bool Add(const float sample[3]);
+
+  /*!
+   * @return Samples taken into the statistics since they last started
+   */
+  uint16_t Samples() { return _samples; }
+
+  /*!
+   * @return Samples rejected since the last Reset
+   */
+  uint16_t Rejected() { return _rejected; }
+
+  /*!
+   * @param mean Filled with the mean of the samples taken
+   */
+  void GetMean(struct AxisOffsets *mean);
+
+  /*!
+   * @return Standard error of the mean on its least certain axis, in the samples' units; a large value until
+   *         WarmUp samples are in
+   */
+  float StandardError();
+ private:
+  float _mean[3];         // running mean per axis
+  float _squares[3];      // running sum of squared deviations from the mean per axis
+  float _resolution;      // least deviation a sample is tested against
+  uint16_t _samples;      // samples taken since the statistics last started
+  uint16_t _rejected;     // samples rejected since the last Reset
+  uint8_t _run;           // samples rejected in a row
+
+  // the statistics start again, keeping the resolution and the count of rejections
+  void restart();
+};
+
+#endif
@@ -5,100 +5,156 @@
  */
 
 #include "CalibratedLIS2MDL.h"
+#include "../util/Log.h"
 
-CalibratedLIS2MDL::CalibratedLIS2MDL(): _lis2mdl(Adafruit_LIS2MDL()) {
+/*!
+ * @brief Negates a count, saturating the one value whose negation doesn't fit
+ */
+static int16_t negateCount(int16_t count) {
+  return count == -32768 ? 32767 : -count;
+}
+
+/*!
+ * @brief Applies a soft-iron correction to a field its offsets have been taken from
+ * @param correction Correction to apply
+ * @param magnetic Field to correct, x, y, z
+ */
+static void correct(const struct AxisCorrection& correction, float magnetic[3]) {
+  float x = magnetic[0], y = magnetic[1], z = magnetic[2];
+  for (uint8_t i = 0; i < 3; i++) {
+    magnetic[i] = correction.m[i][0] * x + correction.m[i][1] * y + correction.m[i][2] * z;
+  }
+}
+
+CalibratedLIS2MDL::CalibratedLIS2MDL(): _lis2mdl(LIS2MDL()), _fitResidual(-1) {
   _handle = CalibrationStorage::Register();
   FetchCalibration();
 }
 
 bool CalibratedLIS2MDL::Initialize() {
-  bool began = _lis2mdl.begin();
+  bool began = _lis2mdl.Begin();
   if (began) {
-    Serial.println(F("Stored magnetometer calibration offsets: "));
-    Serial.print(F("  x: ")); Serial.println(_magOffsets.xOff);
-    Serial.print(F("  y: ")); Serial.println(_magOffsets.yOff);
-    Serial.print(F("  z: ")); Serial.println(_magOffsets.zOff);
+    LOG_INFO(F("Stored magnetometer calibration offsets: "), _magOffsets.xOff, F(", "), _magOffsets.yOff, F(", "),
+             _magOffsets.zOff);
   }
   return began;
 }
 
 bool CalibratedLIS2MDL::GetEventRaw(sensors_event_t *event, sensors_type_t type) {
-  bool success = _lis2mdl.getEvent(event);
-  
+  int16_t counts[3];
+  memset(event, 0, sizeof(sensors_event_t));
+  if (!_lis2mdl.ReadMagnetic(counts)) {
+    return false;
+  }
+  event->version = sizeof(sensors_event_t);
+  event->type = SENSOR_TYPE_MAGNETIC_FIELD;
+  event->timestamp = millis();
+
   // swap x and y axes and invert them to match axes on the LSM6DS33
-  float tmp = event->magnetic.x;
-  event->magnetic.x = -event->magnetic.y;
-  event->magnetic.y = -tmp;
+  float scale = LIS2MDL::Scale();
+  event->magnetic.x = -counts[1] * scale;
+  event->magnetic.y = -counts[0] * scale;
+  event->magnetic.z = counts[2] * scale;
   
-  /*
-  Serial.print("Raw: (");
-  Serial.print(event->magnetic.x, 4); Serial.print(", ");
-  Serial.print(event->magnetic.y, 4); Serial.print(", ");
-  Serial.print(event->magnetic.z, 4); Serial.println(")");
-  //*/
+  LOG_TRACE(F("Raw: ("), LogFloat(event->magnetic.x, 4), F(", "),
+            LogFloat(event->magnetic.y, 4), F(", "), LogFloat(event->magnetic.z, 4), F(")"));
   
-  return success;
+  return true;
+}
+
+bool CalibratedLIS2MDL::GetCountsRaw(int16_t counts[3], sensors_type_t type) {
+  int16_t raw[3];
+  if (!_lis2mdl.ReadMagnetic(raw)) {
+    return false;
+  }
+
+  AlignCounts(raw, counts);
+  return true;
+}
+
+void CalibratedLIS2MDL::AlignCounts(const int16_t raw[3], int16_t counts[3]) {
+  // same swap and inversion as GetEventRaw
+  counts[0] = negateCount(raw[1]);
+  counts[1] = negateCount(raw[0]);
+  counts[2] = raw[2];
+}
+
+bool CalibratedLIS2MDL::GetMagnetic(float magnetic[3]) {
+  int16_t counts[3];
+  if (!GetCountsRaw(counts)) {
+    return false;
+  }
+  ToMagnetic(counts, magnetic);
+  return true;
+}
+
+void CalibratedLIS2MDL::ToMagnetic(const int16_t counts[3], float magnetic[3]) {
+  // counts are already in GetEventRaw's axes; compensated as GetEvent would
+  float scale = LIS2MDL::Scale();
+  magnetic[0] = counts[0] * scale - _magOffsets.xOff;
+  magnetic[1] = counts[1] * scale - _magOffsets.yOff;
+  magnetic[2] = counts[2] * scale - _magOffsets.zOff;
+  correct(_magCorrection, magnetic);
 }
 
 void CalibratedLIS2MDL::BeginCalibration(sensors_type_t type) {
   if (type == SENSOR_TYPE_MAGNETIC_FIELD) {
     _currCalibration = type;
-    
-    // just initialize to BIG values, assuming we read at least one sample and this doesn't become real data
-    // if we ever read larger than 1000 or smaller than -1000 something went REALLY wrong
-    _magLimits.xMin = _magLimits.yMin = _magLimits.zMin = 1000;
-    _magLimits.xMax = _magLimits.yMax = _magLimits.zMax = -1000;
+    Scratch().magFit = EllipsoidFit();
     _magToDiscard = 10;
+    _lastCalibrationSample = micros() - LIS2MDL::Period;
   }
 }
 
 void CalibratedLIS2MDL::EndCalibration() {
   if (_currCalibration) {  // type is not 0, so we were calibrating
-    // Set offsets to be the midpoints of axis limits
-    _magOffsets.xOff = (_magLimits.xMin + _magLimits.xMax) / 2.0;
-    _magOffsets.yOff = (_magLimits.yMin + _magLimits.yMax) / 2.0;
-    _magOffsets.zOff = (_magLimits.zMin + _magLimits.zMax) / 2.0;
-    _currCalibration = 0;
-    
+    _currCalibration = (sensors_type_t) 0;
+
+    struct AxisOffsets offsets;
+    struct AxisCorrection correction;
+    if (!Scratch().magFit.Solve(&offsets, &correction, &_fitResidual)) {
+      LOG_ERROR(F("Magnetometer calibration failed: "), Scratch().magFit.Samples(),
+                F(" samples don't pin down an ellipsoid; turn it through more orientations"));
+      _fitResidual = -1;
+      return;
+    }
+
+    _magOffsets = offsets;
+    _magCorrection = correction;
     UpdateCalibration();
+    LOG_INFO(F("Magnetometer ellipsoid fit to "), Scratch().magFit.Samples(), F(" samples, residual "),
+             LogFloat(_fitResidual * 100, 2), F("%"));
   }
 }
 
 void CalibratedLIS2MDL::AddCalibrationSample() {
   if (_currCalibration) {
+    // one sample per output period: a sample read twice would weigh twice in the fit
+    unsigned long now = micros();
+    if (now - _lastCalibrationSample < LIS2MDL::Period) {
+      return;
+    }
+
     sensors_event_t event;
     if (GetEventRaw(&event, _currCalibration)) {
+      _lastCalibrationSample = now;
       if (_magToDiscard > 0) {
         _magToDiscard--;  // Discard the first few samples
       } else {
-        _magLimits.xMin = min(_magLimits.xMin, event.magnetic.x);
-        _magLimits.yMin = min(_magLimits.yMin, event.magnetic.y);
-        _magLimits.zMin = min(_magLimits.zMin, event.magnetic.z);
-        
-        /*
-        Serial.print("min: (");
-        Serial.print(_magLimits.xMin, 4); Serial.print(", ");
-        Serial.print(_magLimits.yMin, 4); Serial.print(", ");
-        Serial.print(_magLimits.zMin, 4); Serial.print(")\t");
-        //*/
-        
-        _magLimits.xMax = max(_magLimits.xMax, event.magnetic.x);
-        _magLimits.yMax = max(_magLimits.yMax, event.magnetic.y);
-        _magLimits.zMax = max(_magLimits.zMax, event.magnetic.z);
-        
-        /*
-        Serial.print("max: (");
-        Serial.print(_magLimits.xMax, 4); Serial.print(", ");
-        Serial.print(_magLimits.yMax, 4); Serial.print(", ");
-        Serial.print(_magLimits.zMax, 4); Serial.println(")");
-        //*/
+        Scratch().magFit.Add(&event.magnetic.x);
       }
     }
   }
 }
 
+bool CalibratedLIS2MDL::Fit(struct AxisOffsets *offsets, float *residual) {
+  struct AxisCorrection correction;
+  return Scratch().magFit.Solve(offsets, &correction, residual);
+}
+
 void CalibratedLIS2MDL::Compensate(sensors_event_t *reading, sensors_type_t type) {
   reading->magnetic.x -= _magOffsets.xOff;
   reading->magnetic.y -= _magOffsets.yOff;
   reading->magnetic.z -= _magOffsets.zOff;
+  correct(_magCorrection, &reading->magnetic.x);
 }
@@ -9,13 +9,18 @@
 
 #include <Arduino.h>
 #include <Adafruit_Sensor.h>
-#include <Adafruit_LIS2MDL.h>
 
+#include "CalibrationScratch.h"
+#include "LIS2MDL.h"
 #include "SimpleCalibratedSensor.h"
 
 /*!
  * @class CalibratedLIS2MDL
  * @brief Calibrated sensor driver for the LIS2MDL magnetometer
+ *
+ * Calibration fits an ellipsoid to the field as the sensor is turned through every orientation: its centre is
+ * the hard-iron offset, and the matrix taking it back to a sphere corrects soft iron. Both are stored, and
+ * applied as correction * (field - offsets).
  */
 class CalibratedLIS2MDL : public SimpleCalibratedSensor {
  public:  
@@ -25,40 +30,125 @@ class CalibratedLIS2MDL : public SimpleCalibratedSensor {
   
   // Outputs a sensor event of the given event (ignored if this sensor only outputs one type)
   // Returns true iff the sensor was successfully read
-  bool GetEventRaw(sensors_event_t *event, sensors_type_t type = 0) override;
+  bool GetEventRaw(sensors_event_t *event, sensors_type_t type = (sensors_type_t) 0) override;
+
+  // Reads magnetometer counts directly from the output registers, in the same axes as GetEventRaw
+  bool GetCountsRaw(int16_t counts[3], sensors_type_t type = (sensors_type_t) 0) override;
+
+  // Returns microtesla per count
+  float CountsScale(sensors_type_t type = (sensors_type_t) 0) override { return LIS2MDL::Scale(); }
+
+  /*!
+   * @brief Fills in a transfer reading the magnetometer's counts in its own axes, to be submitted to the
+   *        I2CEngine and passed through AlignCounts once finished
+   * @param transfer Transfer to fill
+   * @param raw Counts to fill, x, y, z in the sensor's own axes
+   * @param callback Function to call once finished, NULL for none
+   * @param context Left in the transfer for the callback
+   */
+  static void PrepareCountsRead(struct I2CTransfer *transfer, int16_t raw[3], I2CCallback callback = NULL,
+                                void *context = NULL) {
+    LIS2MDL::PrepareMagneticRead(transfer, raw, callback, context);
+  }
+
+  /*!
+   * @brief Turns counts in the sensor's own axes into GetCountsRaw's
+   * @param raw Counts as the sensor reports them, x, y, z
+   * @param counts Counts to fill, x, y, z in the same axes as GetEventRaw
+   */
+  static void AlignCounts(const int16_t raw[3], int16_t counts[3]);
+
+  /*!
+   * @brief Reads the magnetic field compensated as GetEvent would, without filling a sensors_event_t
+   * @param magnetic Field to fill in uT, x, y, z in the same axes as GetEventRaw
+   * @return True if the sensor was read
+   */
+  bool GetMagnetic(float magnetic[3]);
+
+  /*!
+   * @brief Converts counts read by GetCountsRaw to the field GetMagnetic would have read
+   * @param counts Counts, x, y, z
+   * @param magnetic Field to fill in uT, x, y, z
+   */
+  void ToMagnetic(const int16_t counts[3], float magnetic[3]);
+
+  /*!
+   * @brief Drives the INT/DRDY pin high while a sample is waiting to be read
+   * @param enable True to drive it, false to leave it low
+   * @return True if the sensor acknowledged
+   */
+  bool EnableDataReady(bool enable) { return _lis2mdl.EnableDataReady(enable); }
   
   // Begins calibrating the sensor of the given type
   void BeginCalibration(sensors_type_t type) override;
   
-  // Ends the current calibration
+  // Ends the current calibration, storing the fit if the samples made one and keeping the calibration before
+  // it if not
   void EndCalibration() override;
+
+  /*!
+   * @return RMS distance of the last calibration's samples from the ellipsoid fitted to them, as a fraction of
+   *         the field's strength; negative if they didn't fit one, leaving the calibration as it was
+   */
+  float FitResidual() { return _fitResidual; }
   
-  // Adds a calibration sample for the given sensor type (ignored if this sensor only outputs one type)
+  // Adds a calibration sample for the given sensor type (ignored if this sensor only outputs one type), one per
+  // output period
   void AddCalibrationSample() override;
+
+  /*!
+   * @return Samples calibration has taken into the fit so far, or took last
+   */
+  uint16_t CalibrationSamples() { return Scratch().magFit.Samples(); }
+
+  /*!
+   * @brief Fits an ellipsoid to calibration's samples so far, without storing or applying the fit
+   * @param offsets Filled with its centre, the hard-iron offset
+   * @param residual Filled with the samples' RMS distance from it, as a fraction of the field's strength
+   * @return False, filling nothing, if the samples don't pin down an ellipsoid yet
+   *
+   * The whole of EndCalibration's fit, so tens of milliseconds on the ATmega; not one for every loop.
+   */
+  bool Fit(struct AxisOffsets *offsets, float *residual);
   
   // Returns the currently stored offsets of the given reading type
-  void GetCalibration(struct AxisOffsets *offsets, sensors_type_t type = 0) override { *offsets = _magOffsets; }
+  void GetCalibration(struct AxisOffsets *offsets, sensors_type_t type = (sensors_type_t) 0) override {
+    *offsets = _magOffsets;
+  }
+
+  // Returns the currently stored soft-iron correction
+  void GetCorrection(struct AxisCorrection *correction) { *correction = _magCorrection; }
   
-  // Clears the currently stored calibration offsets
-  virtual void ClearCalibration(sensors_type_t type = 0) override {    
+  // Clears the currently stored calibration offsets and correction
+  virtual void ClearCalibration(sensors_type_t type = (sensors_type_t) 0) override {    
     CalibrationStorage::Clear(_handle);
+    CalibrationStorage::ClearCorrection(_handle);
     _magOffsets.xOff = _magOffsets.yOff = _magOffsets.zOff = 0.0;
+    CalibrationStorage::Identity(&_magCorrection);
   }
  private:
-  Adafruit_LIS2MDL   _lis2mdl;        // internal LIS2MDL driver
-  struct AxisLimits   _magLimits;     // magnetometer limits
-  struct AxisOffsets  _magOffsets;    // magnetometer offsets
+  LIS2MDL            _lis2mdl;        // internal LIS2MDL driver
+  struct AxisOffsets  _magOffsets;    // magnetometer offsets, hard iron
+  struct AxisCorrection _magCorrection;   // magnetometer correction, soft iron
+  float _fitResidual;                 // residual of the last calibration's fit, negative if it failed
   int _magToDiscard;                  // number of samples to discard
+  unsigned long _lastCalibrationSample;   // micros() the last calibration sample was read
   StorageHandle _handle;              // EEPROM handle
   
   // Compensates the sensor value of the given type pointed to by reading
   void Compensate(sensors_event_t *reading, sensors_type_t) override;
   
-  // Fetches the calibration offset data stored in the EEPROM
-  void FetchCalibration() override { CalibrationStorage::Fetch(_handle, &_magOffsets); }
+  // Fetches the calibration offsets and correction stored in the EEPROM
+  void FetchCalibration() override {
+    CalibrationStorage::Fetch(_handle, &_magOffsets);
+    CalibrationStorage::Fetch(_handle, &_magCorrection);
+  }
   
-  // Updates the calibration offset data stored in the EEPROM with the current offsets
-  void UpdateCalibration() override { CalibrationStorage::Update(_handle, &_magOffsets); }
+  // Updates the calibration offsets and correction stored in the EEPROM with the current ones
+  void UpdateCalibration() override {
+    CalibrationStorage::Update(_handle, &_magOffsets);
+    CalibrationStorage::Update(_handle, &_magCorrection);
+  }
 };
 
 #endif
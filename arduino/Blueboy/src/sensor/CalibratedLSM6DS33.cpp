@@ -4,118 +4,567 @@
  * @brief Implementation of CalibratedLSM6DS33.h
  */
 
+#include <math.h>
 #include "CalibratedLSM6DS33.h"
+#include "RegisterIO.h"
+#include "../util/Log.h"
 
-CalibratedLSM6DS33::CalibratedLSM6DS33(): _lsm6ds33(Adafruit_LSM6DS33()) {
-  CalibrationStorage::Register();  // dummmy, save a space for accelerometer
+/*
+ * FIFO and timestamp registers and bits
+ */
+constexpr uint8_t LSM6DS33_FIFO_CTRL2 = 0x07;
+constexpr uint8_t LSM6DS33_FIFO_CTRL3 = 0x08;
+constexpr uint8_t LSM6DS33_FIFO_CTRL4 = 0x09;
+constexpr uint8_t LSM6DS33_FIFO_CTRL5 = 0x0A;
+constexpr uint8_t LSM6DS33_FIFO_STATUS1 = 0x3A;
+constexpr uint8_t LSM6DS33_FIFO_DATA_OUT_L = 0x3E;
+constexpr uint8_t LSM6DS33_TIMESTAMP2_REG = 0x42;
+constexpr uint8_t LSM6DS33_TAP_CFG = 0x58;
+constexpr uint8_t LSM6DS33_WAKE_UP_DUR = 0x5C;
+
+constexpr uint8_t TIMER_PEDO_FIFO_EN = 1 << 7;  // FIFO_CTRL2: timestamp and step count as the 4th data set
+constexpr uint8_t FIFO_DEC_NONE = 0x01;         // FIFO_CTRL3/4: data set stored undecimated
+constexpr uint8_t FIFO_MODE_BYPASS = 0x00;      // FIFO_CTRL5
+constexpr uint8_t FIFO_MODE_CONTINUOUS = 0x06;  // FIFO_CTRL5: overwrites the oldest data when full
+constexpr uint8_t FIFO_OVER_RUN = 1 << 6;       // FIFO_STATUS2
+constexpr uint8_t TIMER_EN = 1 << 7;            // TAP_CFG
+constexpr uint8_t TIMER_HR = 1 << 4;            // WAKE_UP_DUR: 25 us timestamp resolution rather than 6.4 ms
+constexpr uint8_t TIMESTAMP_RESET = 0xAA;       // written to TIMESTAMP2_REG
+
+/*!
+ * @var uint8_t FIFO_SET_WORDS
+ * 16-bit words the FIFO stores per sample: gyroscope x, y, z, accelerometer x, y, z, then timestamp and step count
+ */
+constexpr uint8_t FIFO_SET_WORDS = 9;
+
+/*!
+ * @var unsigned long FIFO_TIMESTAMP_TICK
+ * Microseconds per timestamp counter tick with TIMER_HR set
+ */
+constexpr unsigned long FIFO_TIMESTAMP_TICK = 25;
+
+// period in us of the given output data rate setting, LSM6DS33_RATE_12_5_HZ to LSM6DS33_RATE_1_66K_HZ
+static unsigned long OdrPeriod(uint8_t odr) {
+  switch (odr) {
+    case LSM6DS33_RATE_12_5_HZ:   return 80000;
+    case LSM6DS33_RATE_26_HZ:     return 38462;
+    case LSM6DS33_RATE_52_HZ:     return 19231;
+    case LSM6DS33_RATE_104_HZ:    return 9615;
+    case LSM6DS33_RATE_208_HZ:    return 4808;
+    case LSM6DS33_RATE_416_HZ:    return 2404;
+    case LSM6DS33_RATE_833_HZ:    return 1200;
+    case LSM6DS33_RATE_1_66K_HZ:  return 602;
+    default:                    return 0;
+  }
+}
+
+// the fastest output data rate setting no faster than the given period, 0 if there is none
+static uint8_t FifoOdr(unsigned long period) {
+  uint8_t odr = LSM6DS33_RATE_1_66K_HZ;
+  while (odr > LSM6DS33_RATE_SHUTDOWN && OdrPeriod(odr) < period) {
+    odr--;
+  }
+  return odr;
+}
+
+// the slowest output data rate setting at least as fast as the given period, 0 if there is none
+static uint8_t FifoOdrAtMost(unsigned long period) {
+  uint8_t odr = LSM6DS33_RATE_12_5_HZ;
+  while (odr <= LSM6DS33_RATE_1_66K_HZ && OdrPeriod(odr) > period) {
+    odr++;
+  }
+  return odr <= LSM6DS33_RATE_1_66K_HZ ? odr : LSM6DS33_RATE_SHUTDOWN;
+}
+
+// the given gyroscope offsets in counts times 2^TemperatureBias::FractionBits, held to what an int16_t takes
+static void ToFixed(const struct AxisOffsets& offsets, int16_t bias[3]) {
+  const float *off = &offsets.xOff;
+  for (uint8_t i = 0; i < 3; i++) {
+    long fixed = lroundf(off[i] / LSM6DS33::GyroScale() * (1 << TemperatureBias::FractionBits));
+    bias[i] = constrain(fixed, -32767L, 32767L);
+  }
+}
+
+// the given gyroscope bias in counts times 2^TemperatureBias::FractionBits as offsets in rad/s
+static void FromFixed(const int16_t bias[3], struct AxisOffsets *offsets) {
+  float scale = LSM6DS33::GyroScale() / (1 << TemperatureBias::FractionBits);
+  offsets->xOff = bias[0] * scale;
+  offsets->yOff = bias[1] * scale;
+  offsets->zOff = bias[2] * scale;
+}
+
+CalibratedLSM6DS33::CalibratedLSM6DS33(): _lsm6ds33(LSM6DS33()), _temperature(0), _temperatureReading(0),
+                                       _temperatureRead(0), _sweeping(false), _sweepSlot(0), _swept(0),
+                                       _accelFitted(true), _fifoRunning(false), _rateOverridden(false) {
+  LSM6DS33::PrepareTemperatureRead(&_temperatureTransfer, &_temperatureReading);
+  _accelHandle = CalibrationStorage::Register();
   _handle = CalibrationStorage::Register();
   FetchCalibration();
 }
 
 bool CalibratedLSM6DS33::Initialize() {
-  bool began = _lsm6ds33.begin_I2C();
+  bool began = _lsm6ds33.Begin();
   if (began) {
-    Serial.println(F("Stored gyroscope calibration offsets: "));
-    Serial.print(F("  x: ")); Serial.println(_gyroOffsets.xOff);
-    Serial.print(F("  y: ")); Serial.println(_gyroOffsets.yOff);
-    Serial.print(F("  z: ")); Serial.println(_gyroOffsets.zOff);
+    // read once now, so the first readings are compensated for the temperature before Tick reads it
+    _temperatureRead = millis();
+    LSM6DS33::PrepareTemperatureRead(&_temperatureTransfer, &_temperatureReading);
+    if (I2CEngine::Run(&_temperatureTransfer)) {
+      _temperature = _temperatureReading;
+    }
+
+    struct AxisOffsets off;
+    GetCalibration(&off);
+    LOG_INFO(F("Stored gyroscope calibration offsets: "), off.xOff, F(", "), off.yOff, F(", "), off.zOff,
+             F(" at "), LogFloat(_temperature / 16.0 + 25, 1), F(" C"));
+    LOG_INFO(F("Stored accelerometer calibration offsets: "), _accelOffsets.xOff, F(", "), _accelOffsets.yOff,
+             F(", "), _accelOffsets.zOff, F(", scale: "), LogFloat(1 / _accelGain[0], 4), F(", "),
+             LogFloat(1 / _accelGain[1], 4), F(", "), LogFloat(1 / _accelGain[2], 4));
   }
   return began;
 }
 
+void CalibratedLSM6DS33::Tick() {
+  if (_temperatureTransfer.status == I2CStatus::Queued || millis() - _temperatureRead < TemperaturePeriod) {
+    return;
+  }
+
+  _temperatureRead = millis();
+  LSM6DS33::PrepareTemperatureRead(&_temperatureTransfer, &_temperatureReading, OnTemperature, this);
+  I2CEngine::Submit(&_temperatureTransfer);
+}
+
+void CalibratedLSM6DS33::OnTemperature(struct I2CTransfer *transfer) {
+  CalibratedLSM6DS33 *driver = (CalibratedLSM6DS33 *) transfer->context;
+  if (transfer->status == I2CStatus::Done) {
+    driver->_temperature = driver->_temperatureReading;
+  }
+}
+
+unsigned long CalibratedLSM6DS33::DataRatePeriodAtMost(unsigned long period) {
+  return OdrPeriod(FifoOdrAtMost(period));
+}
+
+unsigned long CalibratedLSM6DS33::DataRatePeriodAtLeast(unsigned long period) {
+  return OdrPeriod(FifoOdr(period));
+}
+
+bool CalibratedLSM6DS33::BeginFifo(unsigned long period) {
+  uint8_t odr = FifoOdr(period);
+  if (odr == LSM6DS33_RATE_SHUTDOWN) {
+    return false;
+  }
+
+  // bypass first to empty the FIFO, so the first word read is the first of a sample
+  bool configured = OverrideRate(odr) &&
+                    WriteRegister(LSM6DS33::Address, LSM6DS33_FIFO_CTRL5, FIFO_MODE_BYPASS) &&
+                    WriteRegister(LSM6DS33::Address, LSM6DS33_TAP_CFG, TIMER_EN) &&
+                    WriteRegister(LSM6DS33::Address, LSM6DS33_WAKE_UP_DUR, TIMER_HR) &&
+                    WriteRegister(LSM6DS33::Address, LSM6DS33_FIFO_CTRL2, TIMER_PEDO_FIFO_EN) &&
+                    WriteRegister(LSM6DS33::Address, LSM6DS33_FIFO_CTRL3, (FIFO_DEC_NONE << 3) | FIFO_DEC_NONE) &&
+                    WriteRegister(LSM6DS33::Address, LSM6DS33_FIFO_CTRL4, FIFO_DEC_NONE << 3) &&
+                    WriteRegister(LSM6DS33::Address, LSM6DS33_TIMESTAMP2_REG, TIMESTAMP_RESET);
+  _fifoStart = micros();
+  _timestampHigh = 0;
+  _lastTimestamp = 0;
+  configured = configured &&
+               WriteRegister(LSM6DS33::Address, LSM6DS33_FIFO_CTRL5, (odr << 3) | FIFO_MODE_CONTINUOUS);
+
+  if (!configured) {
+    LOG_ERROR(F("LSM6DS33 FIFO configuration failed"));
+    EndFifo();
+    return false;
+  }
+  _fifoRunning = true;
+  return true;
+}
+
+void CalibratedLSM6DS33::EndFifo() {
+  WriteRegister(LSM6DS33::Address, LSM6DS33_FIFO_CTRL5, FIFO_MODE_BYPASS);
+  RestoreRate();
+  _fifoRunning = false;
+}
+
+bool CalibratedLSM6DS33::BeginDataReady(unsigned long period) {
+  uint8_t odr = FifoOdr(period);
+  if (odr == LSM6DS33_RATE_SHUTDOWN || !OverrideRate(odr) || !_lsm6ds33.EnableDataReady(true)) {
+    LOG_ERROR(F("LSM6DS33 data-ready configuration failed"));
+    EndDataReady();
+    return false;
+  }
+  return true;
+}
+
+void CalibratedLSM6DS33::EndDataReady() {
+  _lsm6ds33.EnableDataReady(false);
+  RestoreRate();
+}
+
+bool CalibratedLSM6DS33::OverrideRate(uint8_t odr) {
+  if (!_rateOverridden) {
+    _accelRate = _lsm6ds33.AccelRate();
+    _gyroRate = _lsm6ds33.GyroRate();
+    _rateOverridden = true;
+  }
+  return _lsm6ds33.SetRates((LSM6DS33Rate) odr, (LSM6DS33Rate) odr);
+}
+
+void CalibratedLSM6DS33::RestoreRate() {
+  if (_rateOverridden) {
+    _lsm6ds33.SetRates(_accelRate, _gyroRate);
+    _rateOverridden = false;
+  }
+}
+
+uint16_t CalibratedLSM6DS33::FifoSamples(bool *overrun) {
+  uint8_t status[4];  // FIFO_STATUS1 to 4: unread words, flags, then the position within a sample of the next
+  if (!ReadRegisters(LSM6DS33::Address, LSM6DS33_FIFO_STATUS1, status, sizeof(status))) {
+    return 0;
+  }
+  uint16_t words = status[0] | ((status[1] & 0x0F) << 8);
+  uint16_t pattern = status[2] | ((status[3] & 0x03) << 8);
+  *overrun = status[1] & FIFO_OVER_RUN;
+
+  if (pattern != 0 && words >= FIFO_SET_WORDS - pattern) {
+    // an overrun overwrote part of the oldest sample, skip the rest of it
+    uint8_t skip[2 * FIFO_SET_WORDS];
+    ReadRegisters(LSM6DS33::Address, LSM6DS33_FIFO_DATA_OUT_L, skip, 2 * (FIFO_SET_WORDS - pattern));
+    words -= FIFO_SET_WORDS - pattern;
+    *overrun = true;
+  } else if (pattern != 0) {
+    return 0;
+  }
+  return words / FIFO_SET_WORDS;
+}
+
+bool CalibratedLSM6DS33::ReadFifo(struct FifoSample *sample) {
+  // FIFO_DATA_OUT rolls over from its high byte to its low one, so a whole sample is one burst
+  uint8_t words[2 * FIFO_SET_WORDS];
+  if (!ReadRegisters(LSM6DS33::Address, LSM6DS33_FIFO_DATA_OUT_L, words, sizeof(words))) {
+    return false;
+  }
+  memcpy(sample->gyro, words, sizeof(sample->gyro));
+  memcpy(sample->acceleration, words + 6, sizeof(sample->acceleration));
+
+  // the 4th data set is TIMESTAMP[15:8], TIMESTAMP[23:16], unused, TIMESTAMP[7:0], then the step count
+  uint32_t timestamp = ((uint32_t) words[13] << 16) | ((uint32_t) words[12] << 8) | words[15];
+  if (timestamp < _lastTimestamp) {
+    _timestampHigh += 1UL << 24;
+  }
+  _lastTimestamp = timestamp;
+  sample->timestamp = _fifoStart + (_timestampHigh + timestamp) * FIFO_TIMESTAMP_TICK;
+  return true;
+}
+
 bool CalibratedLSM6DS33::GetEventRaw(sensors_event_t *event, sensors_type_t type) {
-  bool success;
-  float tmp;
+  int16_t counts[3];
+  float scale;
+  memset(event, 0, sizeof(sensors_event_t));
+  event->version = sizeof(sensors_event_t);
+  event->type = type;
+  event->timestamp = millis();
   switch (type) {
     case SENSOR_TYPE_GYROSCOPE:
-      success = _lsm6ds33.getGyroSensor()->getEvent(event);
-      
-      /*
-      Serial.print("Raw: (");
-      Serial.print(event->gyro.x, 4); Serial.print(", ");
-      Serial.print(event->gyro.y, 4); Serial.print(", ");
-      Serial.print(event->gyro.z, 4); Serial.println(")");
-      //*/
-      
-      return success;
+      if (!_lsm6ds33.ReadGyro(counts)) {
+        return false;
+      }
+      scale = LSM6DS33::GyroScale();
+      event->gyro.x = counts[0] * scale;
+      event->gyro.y = counts[1] * scale;
+      event->gyro.z = counts[2] * scale;
+
+      LOG_TRACE(F("Raw: ("), LogFloat(event->gyro.x, 4), F(", "),
+                LogFloat(event->gyro.y, 4), F(", "), LogFloat(event->gyro.z, 4), F(")"));
+
+      return true;
     case SENSOR_TYPE_ACCELEROMETER:
-      success = _lsm6ds33.getAccelerometerSensor()->getEvent(event);
-      
-      /*
-      Serial.print("Raw: (");
-      Serial.print(event->acceleration.x, 4); Serial.print(", ");
-      Serial.print(event->acceleration.y, 4); Serial.print(", ");
-      Serial.print(event->acceleration.z, 4); Serial.println(")");
-      //*/
-      
-      return success;
+      if (!_lsm6ds33.ReadAcceleration(counts)) {
+        return false;
+      }
+      scale = LSM6DS33::AccelScale();
+      event->acceleration.x = counts[0] * scale;
+      event->acceleration.y = counts[1] * scale;
+      event->acceleration.z = counts[2] * scale;
+
+      LOG_TRACE(F("Raw: ("), LogFloat(event->acceleration.x, 4), F(", "),
+                LogFloat(event->acceleration.y, 4), F(", "), LogFloat(event->acceleration.z, 4), F(")"));
+
+      return true;
     case SENSOR_TYPE_AMBIENT_TEMPERATURE:
-      return _lsm6ds33.getTemperatureSensor()->getEvent(event);
+      return _lsm6ds33.ReadTemperature(&event->temperature);
+    default:
+      return false;
+  }
+}
+
+bool CalibratedLSM6DS33::GetCountsRaw(int16_t counts[3], sensors_type_t type) {
+  switch (type) {
+    case SENSOR_TYPE_GYROSCOPE:
+      return _lsm6ds33.ReadGyro(counts);
+    case SENSOR_TYPE_ACCELEROMETER:
+      return _lsm6ds33.ReadAcceleration(counts);
     default:
       return false;
   }
 }
 
+float CalibratedLSM6DS33::CountsScale(sensors_type_t type) {
+  switch (type) {
+    case SENSOR_TYPE_GYROSCOPE:
+      return LSM6DS33::GyroScale();
+    case SENSOR_TYPE_ACCELEROMETER:
+      return LSM6DS33::AccelScale();
+    default:
+      return 0;
+  }
+}
+
+bool CalibratedLSM6DS33::GetMotion(float gyro[3], float acceleration[3]) {
+  int16_t gyroCounts[3];
+  int16_t accelerationCounts[3];
+  if (!_lsm6ds33.ReadMotion(gyroCounts, accelerationCounts)) {
+    return false;
+  }
+  ToMotion(gyroCounts, accelerationCounts, gyro, acceleration);
+  return true;
+}
+
+void CalibratedLSM6DS33::ToMotion(const int16_t gyroCounts[3], const int16_t accelerationCounts[3], float gyro[3],
+                                  float acceleration[3]) {
+  // the same compensation GetEvent applies: offset gyroscope, offset and scaled accelerometer; the gyroscope's
+  // offset is taken off in fixed point, leaving one multiply per axis
+  int16_t bias[3];
+  _gyroModel.At(_temperature, bias);
+  float scale = LSM6DS33::GyroScale() / (1 << TemperatureBias::FractionBits);
+  for (uint8_t i = 0; i < 3; i++) {
+    gyro[i] = ((int32_t) gyroCounts[i] * (1L << TemperatureBias::FractionBits) - bias[i]) * scale;
+  }
+  scale = LSM6DS33::AccelScale();
+  acceleration[0] = (accelerationCounts[0] * scale - _accelOffsets.xOff) * _accelGain[0];
+  acceleration[1] = (accelerationCounts[1] * scale - _accelOffsets.yOff) * _accelGain[1];
+  acceleration[2] = (accelerationCounts[2] * scale - _accelOffsets.zOff) * _accelGain[2];
+}
+
 void CalibratedLSM6DS33::BeginCalibration(sensors_type_t type) {
   if (type == SENSOR_TYPE_GYROSCOPE) {
     _currCalibration = type;
-    
-    // just initialize to BIG values, assuming we read at least one sample and this doesn't become real data
-    // if we ever read larger than 1000 or smaller than -1000 something went REALLY wrong
-    _gyroLimits.xMin = _gyroLimits.yMin = _gyroLimits.zMin = 1000;
-    _gyroLimits.xMax = _gyroLimits.yMax = _gyroLimits.zMax = -1000;
+    Scratch().gyroBias = BiasEstimator(LSM6DS33::GyroScale());
     _gyroToDiscard = 10;
+    _lastCalibrationSample = micros() - OdrPeriod(_lsm6ds33.GyroRate());
+    _sweeping = false;
+    _sweepSlot = TemperatureBias::Slot(_temperature);
+    _swept = 0;
+  } else if (type == SENSOR_TYPE_ACCELEROMETER) {
+    _currCalibration = type;
+    Scratch().accelFit = SixPositionFit();
+    _lastCalibrationSample = micros() - OdrPeriod(_lsm6ds33.AccelRate());
   }
 }
 
 void CalibratedLSM6DS33::EndCalibration() {
-  if (_currCalibration) {  // type is not 0, so we were calibrating
-    _gyroOffsets.xOff = (_gyroLimits.xMin + _gyroLimits.xMax) / 2.0;
-    _gyroOffsets.yOff = (_gyroLimits.yMin + _gyroLimits.yMax) / 2.0;
-    _gyroOffsets.zOff = (_gyroLimits.zMin + _gyroLimits.zMax) / 2.0;
-    _currCalibration = 0;
-    
+  if (_currCalibration == SENSOR_TYPE_ACCELEROMETER) {
+    _currCalibration = (sensors_type_t) 0;
+
+    struct AxisOffsets offsets;
+    struct AxisCorrection correction;
+    float residual;
+    _accelFitted = Scratch().accelFit.Solve(&offsets, &correction, &residual);
+    if (!_accelFitted) {
+      LOG_ERROR(F("Accelerometer calibration failed: a position wasn't held still long enough, or the fit was "),
+                F("implausible; kept the last"));
+      return;
+    }
+
+    _accelOffsets = offsets;
+    for (uint8_t i = 0; i < 3; i++) {
+      _accelGain[i] = correction.m[i][i];
+    }
     UpdateCalibration();
+    LOG_INFO(F("Accelerometer bias: "), LogFloat(offsets.xOff, 4), F(", "), LogFloat(offsets.yOff, 4), F(", "),
+             LogFloat(offsets.zOff, 4), F(", scale: "), LogFloat(1 / _accelGain[0], 4), F(", "),
+             LogFloat(1 / _accelGain[1], 4), F(", "), LogFloat(1 / _accelGain[2], 4), F(", residual: "),
+             LogFloat(residual, 4));
+  } else if (_currCalibration) {  // type is not 0, so we were calibrating
+    _currCalibration = (sensors_type_t) 0;
+    if (_sweeping) {
+      // the slot the sweep ended in is kept if it had enough samples, however unsettled
+      _sweeping = false;
+      if (!(_swept & (1 << _sweepSlot)) && Scratch().gyroBias.Samples() >= BiasEstimator::WarmUp) {
+        KeepBias();
+        _swept |= 1 << _sweepSlot;
+      }
+      uint8_t slots = 0;
+      for (uint8_t s = 0; s < TEMPERATURE_POINTS; s++) {
+        slots += (_swept >> s) & 1;
+      }
+      LOG_INFO(F("Gyroscope temperature sweep found the bias in "), slots, F(" slots"));
+      return;
+    }
+    if (Scratch().gyroBias.Samples() < BiasEstimator::WarmUp) {
+      LOG_ERROR(F("Gyroscope calibration ended before it had "), (uint8_t) BiasEstimator::WarmUp,
+                F(" still samples; kept the last"));
+      return;
+    }
+
+    KeepBias();
+  }
+}
+
+void CalibratedLSM6DS33::BeginSweep() {
+  BeginCalibration(SENSOR_TYPE_GYROSCOPE);
+  _sweeping = true;
+}
+
+void CalibratedLSM6DS33::KeepBias() {
+  BiasEstimator& estimator = Scratch().gyroBias;
+  estimator.GetMean(&_gyroOffsets);
+  int16_t bias[3];
+  ToFixed(_gyroOffsets, bias);
+
+  struct TemperatureTable table;
+  CalibrationStorage::Fetch(_handle, &table);
+  TemperatureBias::Record(&table, _temperature, bias);
+  CalibrationStorage::Update(_handle, &table);
+  BuildModel(table);
+  UpdateCalibration();
+  LOG_INFO(F("Gyroscope bias at "), LogFloat(_temperature / 16.0 + 25, 1), F(" C from "), estimator.Samples(),
+           F(" samples to "), LogFloat(estimator.StandardError(), 6), F(" rad/s, "), estimator.Rejected(),
+           F(" rejected"));
+}
+
+void CalibratedLSM6DS33::BuildModel(const struct TemperatureTable& table) {
+  if (!_gyroModel.Build(table)) {
+    int16_t bias[3];
+    ToFixed(_gyroOffsets, bias);
+    _gyroModel.Constant(bias);
   }
 }
 
 void CalibratedLSM6DS33::AddCalibrationSample() {
   if (_currCalibration == SENSOR_TYPE_GYROSCOPE) {
+    // one sample per output period: reading one twice would count its noise twice, overstating how settled the
+    // bias is
+    unsigned long now = micros();
+    if (now - _lastCalibrationSample < OdrPeriod(_lsm6ds33.GyroRate())) {
+      return;
+    }
+
     sensors_event_t event;
     if (GetEventRaw(&event, _currCalibration)) {
+      _lastCalibrationSample = now;
+      if (_sweeping) {
+        // a bias per slot: samples from the slot before would drag this one's towards it
+        uint8_t slot = TemperatureBias::Slot(_temperature);
+        if (slot != _sweepSlot) {
+          _sweepSlot = slot;
+          Scratch().gyroBias.Reset(LSM6DS33::GyroScale());
+        }
+        if (_swept & (1 << slot)) {
+          return;
+        }
+      }
+
       if (_gyroToDiscard > 0) {
         _gyroToDiscard--;
-      } else {
-        _gyroLimits.xMin = min(_gyroLimits.xMin, event.gyro.x);
-        _gyroLimits.yMin = min(_gyroLimits.yMin, event.gyro.y);
-        _gyroLimits.zMin = min(_gyroLimits.zMin, event.gyro.z);
-        
-        /*
-        Serial.print("min: (");
-        Serial.print(_gyroLimits.xMin, 4); Serial.print(", ");
-        Serial.print(_gyroLimits.yMin, 4); Serial.print(", ");
-        Serial.print(_gyroLimits.zMin, 4); Serial.print(")\t");
-        //*/
-        
-        _gyroLimits.xMax = max(_gyroLimits.xMax, event.gyro.x);
-        _gyroLimits.yMax = max(_gyroLimits.yMax, event.gyro.y);
-        _gyroLimits.zMax = max(_gyroLimits.zMax, event.gyro.z);
-        
-        /*
-        Serial.print("max: (");
-        Serial.print(_gyroLimits.xMax, 4); Serial.print(", ");
-        Serial.print(_gyroLimits.yMax, 4); Serial.print(", ");
-        Serial.print(_gyroLimits.zMax, 4); Serial.println(")");
-        //*/
+      } else if (Scratch().gyroBias.Add(&event.gyro.x) && Scratch().gyroBias.Samples() >= MinBiasSamples &&
+                 Scratch().gyroBias.StandardError() <= BiasSettled) {
+        if (_sweeping) {
+          KeepBias();
+          _swept |= 1 << _sweepSlot;
+        } else {
+          EndCalibration();
+        }
       }
     }
+  } else if (_currCalibration == SENSOR_TYPE_ACCELEROMETER) {
+    // one sample per output period, so a position's count says how long it was held
+    unsigned long now = micros();
+    if (now - _lastCalibrationSample < OdrPeriod(_lsm6ds33.AccelRate())) {
+      return;
+    }
+
+    sensors_event_t event;
+    if (GetEventRaw(&event, _currCalibration)) {
+      _lastCalibrationSample = now;
+      Scratch().accelFit.Add(&event.acceleration.x);
+    }
+  }
+}
+
+bool CalibratedLSM6DS33::FitAccel(struct AxisOffsets *offsets, float *residual) {
+  struct AxisCorrection correction;
+  return Scratch().accelFit.Solve(offsets, &correction, residual);
+}
+
+void CalibratedLSM6DS33::GetAccelScale(float scale[3]) {
+  for (uint8_t i = 0; i < 3; i++) {
+    scale[i] = 1 / _accelGain[i];
+  }
+}
+
+void CalibratedLSM6DS33::ClearCalibration(sensors_type_t type) {
+  if (type == SENSOR_TYPE_ACCELEROMETER) {
+    CalibrationStorage::Clear(_accelHandle);
+    CalibrationStorage::ClearCorrection(_accelHandle);
+    _accelOffsets.xOff = _accelOffsets.yOff = _accelOffsets.zOff = 0.0;
+    _accelGain[0] = _accelGain[1] = _accelGain[2] = 1.0;
+  } else {
+    CalibrationStorage::Clear(_handle);
+    CalibrationStorage::ClearTable(_handle);
+    _gyroOffsets.xOff = _gyroOffsets.yOff = _gyroOffsets.zOff = 0.0;
+    const int16_t none[3] = { 0, 0, 0 };
+    _gyroModel.Constant(none);
+  }
+}
+
+void CalibratedLSM6DS33::GetCalibration(struct AxisOffsets *offsets, sensors_type_t type) {
+  if (type == SENSOR_TYPE_ACCELEROMETER) {
+    *offsets = _accelOffsets;
+    return;
+  }
+
+  int16_t bias[3];
+  _gyroModel.At(_temperature, bias);
+  FromFixed(bias, offsets);
+}
+
+void CalibratedLSM6DS33::FetchCalibration() {
+  CalibrationStorage::Fetch(_handle, &_gyroOffsets);
+  CalibrationStorage::Fetch(_accelHandle, &_accelOffsets);
+
+  struct TemperatureTable table;
+  CalibrationStorage::Fetch(_handle, &table);
+  BuildModel(table);
+
+  // only the diagonal is ever stored off the identity
+  struct AxisCorrection correction;
+  CalibrationStorage::Fetch(_accelHandle, &correction);
+  for (uint8_t i = 0; i < 3; i++) {
+    _accelGain[i] = correction.m[i][i];
+  }
+}
+
+void CalibratedLSM6DS33::UpdateCalibration() {
+  CalibrationStorage::Update(_handle, &_gyroOffsets);
+  CalibrationStorage::Update(_accelHandle, &_accelOffsets);
+
+  struct AxisCorrection correction;
+  CalibrationStorage::Identity(&correction);
+  for (uint8_t i = 0; i < 3; i++) {
+    correction.m[i][i] = _accelGain[i];
   }
+  CalibrationStorage::Update(_accelHandle, &correction);
 }
 
 void CalibratedLSM6DS33::Compensate(sensors_event_t *reading, sensors_type_t type) {
   if (type == SENSOR_TYPE_GYROSCOPE) {
-    reading->gyro.x -= _gyroOffsets.xOff;
-    reading->gyro.y -= _gyroOffsets.yOff;
-    reading->gyro.z -= _gyroOffsets.zOff;
+    struct AxisOffsets off;
+    GetCalibration(&off);
+    reading->gyro.x -= off.xOff;
+    reading->gyro.y -= off.yOff;
+    reading->gyro.z -= off.zOff;
+  } else if (type == SENSOR_TYPE_ACCELEROMETER) {
+    reading->acceleration.x = (reading->acceleration.x - _accelOffsets.xOff) * _accelGain[0];
+    reading->acceleration.y = (reading->acceleration.y - _accelOffsets.yOff) * _accelGain[1];
+    reading->acceleration.z = (reading->acceleration.z - _accelOffsets.zOff) * _accelGain[2];
   }
 }
\ No newline at end of file
@@ -0,0 +1,13 @@
+/*!
+ * @file CalibrationScratch.cpp
+ * @author Sebastian S.
+ * @brief Implementation of CalibrationScratch.h
+ */
+
+#include "CalibrationScratch.h"
+
+static CalibrationScratch scratch;  // shared by every sensor's calibration
+
+CalibrationScratch& Scratch() {
+  return scratch;
+}
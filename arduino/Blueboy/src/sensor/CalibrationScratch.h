@@ -0,0 +1,36 @@
+/*!
+ * @file CalibrationScratch.h
+ * @author Sebastian S.
+ * @brief Declaration for CalibrationScratch
+ */
+
+#ifndef CALIBRATION_SCRATCH_H_
+#define CALIBRATION_SCRATCH_H_
+
+#include <Arduino.h>
+#include "BiasEstimator.h"
+#include "EllipsoidFit.h"
+#include "SixPositionFit.h"
+
+/*!
+ * @union CalibrationScratch
+ * @brief What Blueboy's sensors gather while calibrating, one sensor at a time.
+ *
+ * The sums behind each calibration are only needed until it ends, and Blueboy calibrates one sensor at a time,
+ * so they share their RAM. A sensor beginning calibration assigns a fresh fit to its member, which makes that
+ * member the one in use; the others hold nothing meaningful until assigned again.
+ */
+union CalibrationScratch {
+  CalibrationScratch() : magFit() { }
+
+  EllipsoidFit magFit;        //!< the magnetometer's ellipsoid fit
+  SixPositionFit accelFit;    //!< the accelerometer's per-position means
+  BiasEstimator gyroBias;     //!< the gyroscope's bias statistics
+};
+
+/*!
+ * @return The scratch the sensor calibrating gathers its samples in
+ */
+CalibrationScratch& Scratch();
+
+#endif
@@ -49,4 +49,71 @@ void CalibrationStorage::Clear(StorageHandle handle) {
   cleared.offsets.xOff = cleared.offsets.yOff = cleared.offsets.zOff = 0.0;
   
   EEPROM.put(address, cleared);
-}
\ No newline at end of file
+}
+
+void CalibrationStorage::Fetch(StorageHandle handle, struct AxisCorrection *correction) {
+  struct StoredCorrection stored;
+  EEPROM.get(_correctionAddress(handle), stored);
+
+  // as with offsets, no canary means nothing has been stored here, so nothing is corrected
+  if (stored.canary == STORAGE_CANARY) {
+    *correction = stored.correction;
+  } else {
+    Identity(correction);
+  }
+}
+
+void CalibrationStorage::Update(StorageHandle handle, struct AxisCorrection *correction) {
+  struct StoredCorrection stored;
+  stored.canary = STORAGE_CANARY;
+  stored.correction = *correction;
+  EEPROM.put(_correctionAddress(handle), stored);
+}
+
+void CalibrationStorage::ClearCorrection(StorageHandle handle) {
+  struct StoredCorrection cleared;
+  cleared.canary = 0x0000;
+  Identity(&cleared.correction);
+  EEPROM.put(_correctionAddress(handle), cleared);
+}
+
+void CalibrationStorage::Identity(struct AxisCorrection *correction) {
+  for (uint8_t i = 0; i < 3; i++) {
+    for (uint8_t j = 0; j < 3; j++) {
+      correction->m[i][j] = i == j ? 1.0 : 0.0;
+    }
+  }
+}
+
+void CalibrationStorage::Fetch(StorageHandle handle, struct TemperatureTable *table) {
+  struct StoredTemperatureTable stored;
+  EEPROM.get(_tableAddress(handle), stored);
+
+  // as with offsets, no canary means nothing has been stored here, so nothing was measured
+  if (stored.canary == STORAGE_CANARY) {
+    *table = stored.table;
+  } else {
+    Unset(table);
+  }
+}
+
+void CalibrationStorage::Update(StorageHandle handle, struct TemperatureTable *table) {
+  struct StoredTemperatureTable stored;
+  stored.canary = STORAGE_CANARY;
+  stored.table = *table;
+  EEPROM.put(_tableAddress(handle), stored);
+}
+
+void CalibrationStorage::ClearTable(StorageHandle handle) {
+  struct StoredTemperatureTable cleared;
+  cleared.canary = 0x0000;
+  Unset(&cleared.table);
+  EEPROM.put(_tableAddress(handle), cleared);
+}
+
+void CalibrationStorage::Unset(struct TemperatureTable *table) {
+  for (uint8_t p = 0; p < TEMPERATURE_POINTS; p++) {
+    table->points[p].temperature = TEMPERATURE_UNSET;
+    table->points[p].offsets[0] = table->points[p].offsets[1] = table->points[p].offsets[2] = 0;
+  }
+}
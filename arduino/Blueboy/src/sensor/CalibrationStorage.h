@@ -41,9 +41,70 @@ struct StoredCalibration {
   struct AxisOffsets offsets;   // calibration offsets
 };
 
+/*!
+ * @struct AxisCorrection
+ * Representation of a matrix applied to a three-axis sensor's readings once its offsets are removed,
+ * correcting scale and cross-axis coupling.
+ */
+struct AxisCorrection {
+  float m[3][3];                // rows x, y, z of the correction
+};
+
+/*!
+ * @struct StoredCorrection
+ * Representation of an AxisCorrection preceded by space for STORAGE_CANARY.
+ */
+struct StoredCorrection {
+  uint16_t canary;                    // equal to STORAGE_CANARY if a valid value has been written in this space
+  struct AxisCorrection correction;   // calibration correction
+};
+
+/*!
+ * @var uint8_t TEMPERATURE_POINTS
+ * Measurements a TemperatureTable holds
+ */
+constexpr uint8_t TEMPERATURE_POINTS = 8;
+
+/*!
+ * @var int16_t TEMPERATURE_UNSET
+ * Temperature of a TemperaturePoint nothing has been measured at
+ */
+constexpr int16_t TEMPERATURE_UNSET = -32767 - 1;
+
+/*!
+ * @struct TemperaturePoint
+ * Representation of a three-axis sensor's offsets measured at one temperature, in fixed point of the sensor's
+ * choosing.
+ */
+struct TemperaturePoint {
+  int16_t temperature;          // temperature measured at, TEMPERATURE_UNSET if none
+  int16_t offsets[3];           // offsets measured, x, y, z
+};
+
+/*!
+ * @struct TemperatureTable
+ * Representation of a three-axis sensor's offsets measured across a range of temperatures.
+ */
+struct TemperatureTable {
+  struct TemperaturePoint points[TEMPERATURE_POINTS];   // measurements, in a slot per temperature band
+};
+
+/*!
+ * @struct StoredTemperatureTable
+ * Representation of a TemperatureTable preceded by space for STORAGE_CANARY.
+ */
+struct StoredTemperatureTable {
+  uint16_t canary;                // equal to STORAGE_CANARY if a valid value has been written in this space
+  struct TemperatureTable table;  // offsets by temperature
+};
+
 /*!
  * @class CalibrationStorage
- * @brief Stores AxisOffsets of calibrated sensors in the EEPROM.
+ * @brief Stores AxisOffsets, and AxisCorrections and TemperatureTables where a sensor has them, of calibrated
+ *        sensors in the EEPROM.
+ *
+ * Each handle has space for all three, corrections in a region of their own after the offsets and tables in one
+ * after the corrections.
  */
 class CalibrationStorage {
  public: 
@@ -77,6 +138,56 @@ class CalibrationStorage {
    * @param handle StorageHandle of the space that should be cleared
    */
   static void Clear(StorageHandle handle);
+
+  /*!
+   * @brief Fetches the AxisCorrection stored at the space allocated by the given storage handle
+   * @param handle StorageHandle to access the AxisCorrection of
+   * @param correction Pointer to an AxisCorrection to fill with data, the identity if none is stored
+   */
+  static void Fetch(StorageHandle handle, struct AxisCorrection *correction);
+
+  /*!
+   * @brief Stores the given AxisCorrection at the space allocated by the given storage handle
+   * @param handle StorageHandle of the space the new AxisCorrection should be placed at
+   * @param correction Pointer to the AxisCorrection to store in the EEPROM
+   */
+  static void Update(StorageHandle handle, struct AxisCorrection *correction);
+
+  /*!
+   * @brief Clears the stored AxisCorrection at the space allocated by the given storage handle
+   * @param handle StorageHandle of the space that should be cleared
+   */
+  static void ClearCorrection(StorageHandle handle);
+
+  /*!
+   * @param correction Pointer to an AxisCorrection to set to the identity, correcting nothing
+   */
+  static void Identity(struct AxisCorrection *correction);
+
+  /*!
+   * @brief Fetches the TemperatureTable stored at the space allocated by the given storage handle
+   * @param handle StorageHandle to access the TemperatureTable of
+   * @param table Pointer to a TemperatureTable to fill with data, every point unset if none is stored
+   */
+  static void Fetch(StorageHandle handle, struct TemperatureTable *table);
+
+  /*!
+   * @brief Stores the given TemperatureTable at the space allocated by the given storage handle
+   * @param handle StorageHandle of the space the new TemperatureTable should be placed at
+   * @param table Pointer to the TemperatureTable to store in the EEPROM
+   */
+  static void Update(StorageHandle handle, struct TemperatureTable *table);
+
+  /*!
+   * @brief Clears the stored TemperatureTable at the space allocated by the given storage handle
+   * @param handle StorageHandle of the space that should be cleared
+   */
+  static void ClearTable(StorageHandle handle);
+
+  /*!
+   * @param table Pointer to a TemperatureTable to set every point of unset
+   */
+  static void Unset(struct TemperatureTable *table);
  
   CalibrationStorage() = delete;
   CalibrationStorage(const CalibrationStorage &) = delete;
@@ -89,6 +200,20 @@ class CalibrationStorage {
    * The location in the EEPROM to start storing calibration offsets.
    */
   static constexpr uint16_t AddressOffset = 0x100;
+
+  /*!
+   * @var uint16_t CorrectionOffset
+   * The location in the EEPROM to start storing calibration corrections, leaving room for eight handles'
+   * offsets before it.
+   */
+  static constexpr uint16_t CorrectionOffset = AddressOffset + 8 * sizeof(struct StoredCalibration);
+
+  /*!
+   * @var uint16_t TableOffset
+   * The location in the EEPROM to start storing temperature tables, after eight handles' corrections; the 1 KB
+   * EEPROM has room for five handles' tables.
+   */
+  static constexpr uint16_t TableOffset = CorrectionOffset + 8 * sizeof(struct StoredCorrection);
   
   /*!
    * @brief Translates a StorageHandle to its corresponding EEPROM address
@@ -97,6 +222,22 @@ class CalibrationStorage {
   static uint16_t _eepromAddress(StorageHandle handle) {
     return AddressOffset + handle * sizeof(struct StoredCalibration);
   }
+
+  /*!
+   * @brief Translates a StorageHandle to the EEPROM address of its correction
+   * @return The address in the EEPROM corresponding with the handle's correction
+   */
+  static uint16_t _correctionAddress(StorageHandle handle) {
+    return CorrectionOffset + handle * sizeof(struct StoredCorrection);
+  }
+
+  /*!
+   * @brief Translates a StorageHandle to the EEPROM address of its temperature table
+   * @return The address in the EEPROM corresponding with the handle's temperature table
+   */
+  static uint16_t _tableAddress(StorageHandle handle) {
+    return TableOffset + handle * sizeof(struct StoredTemperatureTable);
+  }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,78 @@
+/*!
+ * @file DataReady.cpp
+ * @author Sebastian S.
+ * @brief Implementation of DataReady.h
+ */
+
+#include "DataReady.h"
+
+uint8_t DataReady::_masks[2] = { 0, 0 };
+volatile uint8_t DataReady::_levels = 0;
+volatile uint8_t DataReady::_pending = 0;
+volatile unsigned long DataReady::_times[2] = { 0, 0 };
+
+ISR(PCINT2_vect) {
+  DataReady::OnPinChange(PIND);
+}
+
+void DataReady::Attach(DataReadySource source, uint8_t pin) {
+  uint8_t index = (uint8_t) source;
+  uint8_t mask = 1 << pin;
+  pinMode(pin, INPUT);
+
+  noInterrupts();
+  _masks[index] = mask;
+  uint8_t levels = PIND;
+  _levels = (_levels & ~mask) | (levels & mask);
+  if (levels & mask) {
+    _times[index] = micros();
+    _pending |= 1 << index;
+  } else {
+    _pending &= ~(1 << index);
+  }
+  PCMSK2 |= mask;
+  PCICR |= 1 << PCIE2;
+  interrupts();
+}
+
+void DataReady::Detach(DataReadySource source) {
+  uint8_t index = (uint8_t) source;
+
+  noInterrupts();
+  PCMSK2 &= ~_masks[index];
+  if (PCMSK2 == 0) {
+    PCICR &= ~(1 << PCIE2);
+  }
+  _masks[index] = 0;
+  _pending &= ~(1 << index);
+  interrupts();
+}
+
+bool DataReady::Take(DataReadySource source, unsigned long *time) {
+  uint8_t bit = 1 << (uint8_t) source;
+  if (!(_pending & bit)) {
+    return false;
+  }
+
+  noInterrupts();
+  *time = _times[(uint8_t) source];
+  _pending &= ~bit;
+  interrupts();
+  return true;
+}
+
+void DataReady::OnPinChange(uint8_t levels) {
+  uint8_t rising = levels & ~_levels;
+  _levels = levels;
+  if (!(rising & (_masks[0] | _masks[1]))) {
+    return;
+  }
+
+  unsigned long now = micros();
+  for (uint8_t i = 0; i < 2; i++) {
+    if (rising & _masks[i]) {
+      _times[i] = now;
+      _pending |= 1 << i;
+    }
+  }
+}
@@ -0,0 +1,65 @@
+/*!
+ * @file DataReady.h
+ * @author Sebastian S.
+ * @brief Declaration for DataReady
+ */
+
+#ifndef DATA_READY_H_
+#define DATA_READY_H_
+
+#include <Arduino.h>
+
+/*!
+ * @enum DataReadySource
+ * Sensors whose data-ready outputs can be watched
+ */
+enum class DataReadySource : uint8_t {
+  Imu =           0,
+  Magnetometer =  1
+};
+
+/*!
+ * @class DataReady
+ * @brief Latches rising edges of sensors' data-ready outputs, and the micros() they arrived at, from the port D
+ *        pin-change interrupt.
+ *
+ * The sensors hold their data-ready outputs high until their samples are read, so one edge arrives per sample as
+ * long as each is read before the next. Taking an edge and reading the sample should follow each other promptly.
+ */
+class DataReady {
+ public:
+  /*!
+   * @brief Starts watching a source's data-ready output
+   * @param source Sensor to watch
+   * @param pin Port D pin it is wired to, 2 to 7
+   *
+   * An output already high counts as an edge now, since it won't rise again until its sample is read.
+   */
+  static void Attach(DataReadySource source, uint8_t pin);
+
+  /*!
+   * @brief Stops watching a source's data-ready output, forgetting any edge not taken
+   */
+  static void Detach(DataReadySource source);
+
+  /*!
+   * @brief Takes the latest edge from a source, if one arrived since last taken
+   * @param source Sensor to check
+   * @param time Set to micros() when the edge arrived
+   * @return True if there was an edge, meaning the source has a sample not yet read
+   */
+  static bool Take(DataReadySource source, unsigned long *time);
+
+  /*!
+   * @brief Latches rising edges on watched pins; for the pin-change interrupt only
+   * @param levels Levels of port D pins, as read from PIND
+   */
+  static void OnPinChange(uint8_t levels);
+ private:
+  static uint8_t _masks[2];                 // port D bit watched for each source, 0 if detached
+  static volatile uint8_t _levels;          // levels at the last pin change
+  static volatile uint8_t _pending;         // bit per source with an edge not yet taken
+  static volatile unsigned long _times[2];  // micros() of each source's latest edge
+};
+
+#endif
@@ -0,0 +1,311 @@
+/*!
+ * @file EllipsoidFit.cpp
+ * @author Sebastian S.
+ * @brief Implementation of EllipsoidFit.h
+ */
+
+#include <math.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+#include "EllipsoidFit.h"
+
+/*!
+ * @var uint8_t TERMS
+ * Unknowns of the fit, a to i
+ */
+constexpr uint8_t TERMS = 9;
+
+/*!
+ * @brief Packs powers of x, y and z, each up to 4, into a byte
+ */
+constexpr uint8_t power(uint8_t x, uint8_t y, uint8_t z) {
+  return x * 25 + y * 5 + z;
+}
+
+// powers of x, y and z in each of the fit's terms: x^2, y^2, z^2, xy, xz, yz, x, y, z
+static const uint8_t TERM_POWERS[TERMS] PROGMEM = {
+  power(2, 0, 0), power(0, 2, 0), power(0, 0, 2), power(1, 1, 0), power(1, 0, 1), power(0, 1, 1),
+  power(1, 0, 0), power(0, 1, 0), power(0, 0, 1)
+};
+
+// powers of x, y and z in each of the sums kept, in the order Add accumulates them
+static const uint8_t MOMENTS[EllipsoidFit::Moments] PROGMEM = {
+  power(1, 0, 0), power(0, 1, 0), power(0, 0, 1),
+  power(2, 0, 0), power(0, 2, 0), power(0, 0, 2), power(1, 1, 0), power(1, 0, 1), power(0, 1, 1),
+  power(3, 0, 0), power(0, 3, 0), power(0, 0, 3), power(2, 1, 0), power(2, 0, 1), power(1, 2, 0),
+  power(0, 2, 1), power(1, 0, 2), power(0, 1, 2), power(1, 1, 1),
+  power(4, 0, 0), power(0, 4, 0), power(0, 0, 4), power(3, 1, 0), power(3, 0, 1), power(1, 3, 0),
+  power(0, 3, 1), power(1, 0, 3), power(0, 1, 3), power(2, 2, 0), power(2, 0, 2), power(0, 2, 2),
+  power(2, 1, 1), power(1, 2, 1), power(1, 1, 2)
+};
+
+/*!
+ * @brief Finds the sum of a product
+ * @param sums Sums in MOMENTS' order
+ * @param powers Powers of x, y and z in the product, packed by power()
+ * @return The sum of that product
+ */
+static float moment(const float *sums, uint8_t powers) {
+  uint8_t i = 0;
+  while (pgm_read_byte(&MOMENTS[i]) != powers) {
+    i++;
+  }
+  return sums[i];
+}
+
+/*!
+ * @brief Finds the sum of a product of the samples less a point, from the sums of products of the samples
+ * @param sums Sums in MOMENTS' order
+ * @param samples Samples summed
+ * @param powers Powers of x, y and z in the product, packed by power()
+ * @param point Point to take from the samples
+ * @return Sum over the samples of (x - point x)^i (y - point y)^j (z - point z)^k
+ */
+static float centredMoment(const float *sums, uint16_t samples, uint8_t powers, const float point[3]) {
+  static const uint8_t BINOMIAL[5][5] PROGMEM = { { 1 }, { 1, 1 }, { 1, 2, 1 }, { 1, 3, 3, 1 }, { 1, 4, 6, 4, 1 } };
+  uint8_t px = powers / 25, py = powers / 5 % 5, pz = powers % 5;
+
+  // each power of a difference expanded binomially, the sums of lower products weighted by the point's powers
+  float total = 0;
+  float fx = 1;
+  for (uint8_t i = px + 1; i-- > 0; fx *= -point[0]) {
+    float fy = 1;
+    for (uint8_t j = py + 1; j-- > 0; fy *= -point[1]) {
+      float fz = 1;
+      for (uint8_t k = pz + 1; k-- > 0; fz *= -point[2]) {
+        uint8_t lower = power(i, j, k);
+        float sum = lower ? moment(sums, lower) : samples;
+        uint8_t weight = pgm_read_byte(&BINOMIAL[px][i]) * pgm_read_byte(&BINOMIAL[py][j])
+                         * pgm_read_byte(&BINOMIAL[pz][k]);
+        total += weight * fx * fy * fz * sum;
+      }
+    }
+  }
+  return total;
+}
+
+/*!
+ * @param i Row
+ * @param j Column, at most i
+ * @return Index of element (i, j) of a symmetric matrix packed by rows of its lower triangle
+ */
+static uint8_t packed(uint8_t i, uint8_t j) {
+  return i * (i + 1) / 2 + j;
+}
+
+/*!
+ * @brief Solves a symmetric positive definite system in place by Cholesky decomposition
+ * @param a Matrix, packed by packed(); left holding its factor
+ * @param b Right-hand side; left holding the solution
+ * @param n Unknowns
+ * @return False if the matrix is too near singular to solve
+ */
+static bool cholesky(float *a, float *b, uint8_t n) {
+  for (uint8_t i = 0; i < n; i++) {
+    for (uint8_t j = 0; j <= i; j++) {
+      float sum = a[packed(i, j)];
+      for (uint8_t k = 0; k < j; k++) {
+        sum -= a[packed(i, k)] * a[packed(j, k)];
+      }
+
+      if (i == j) {
+        // a pivot that has lost nearly all of the diagonal it began as means the samples leave a term undecided
+        if (sum <= a[packed(i, i)] * 1e-6f) {
+          return false;
+        }
+        a[packed(i, i)] = sqrtf(sum);
+      } else {
+        a[packed(i, j)] = sum / a[packed(j, j)];
+      }
+    }
+  }
+
+  for (uint8_t i = 0; i < n; i++) {
+    for (uint8_t k = 0; k < i; k++) {
+      b[i] -= a[packed(i, k)] * b[k];
+    }
+    b[i] /= a[packed(i, i)];
+  }
+  for (uint8_t i = n; i-- > 0;) {
+    for (uint8_t k = i + 1; k < n; k++) {
+      b[i] -= a[packed(k, i)] * b[k];
+    }
+    b[i] /= a[packed(i, i)];
+  }
+  return true;
+}
+
+/*!
+ * @brief Diagonalises a symmetric 3x3 matrix by Jacobi rotations
+ * @param a Matrix; left holding its eigenvalues on the diagonal
+ * @param v Filled with the eigenvectors, one per column
+ */
+static void eigen(float a[3][3], float v[3][3]) {
+  for (uint8_t i = 0; i < 3; i++) {
+    for (uint8_t j = 0; j < 3; j++) {
+      v[i][j] = i == j ? 1 : 0;
+    }
+  }
+
+  for (uint8_t sweep = 0; sweep < 8; sweep++) {
+    float diagonal = a[0][0] * a[0][0] + a[1][1] * a[1][1] + a[2][2] * a[2][2];
+    float off = a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2];
+    if (off <= diagonal * 1e-14f) {
+      return;
+    }
+
+    for (uint8_t p = 0; p < 2; p++) {
+      for (uint8_t q = p + 1; q < 3; q++) {
+        if (a[p][q] == 0) {
+          continue;
+        }
+
+        // the rotation in the p-q plane that zeroes a[p][q]
+        float theta = (a[q][q] - a[p][p]) / (2 * a[p][q]);
+        float t = 1 / (fabsf(theta) + sqrtf(theta * theta + 1));
+        if (theta < 0) {
+          t = -t;
+        }
+        float c = 1 / sqrtf(t * t + 1), s = t * c;
+
+        for (uint8_t k = 0; k < 3; k++) {
+          float kp = a[k][p], kq = a[k][q];
+          a[k][p] = c * kp - s * kq;
+          a[k][q] = s * kp + c * kq;
+        }
+        for (uint8_t k = 0; k < 3; k++) {
+          float pk = a[p][k], qk = a[q][k];
+          a[p][k] = c * pk - s * qk;
+          a[q][k] = s * pk + c * qk;
+        }
+        for (uint8_t k = 0; k < 3; k++) {
+          float kp = v[k][p], kq = v[k][q];
+          v[k][p] = c * kp - s * kq;
+          v[k][q] = s * kp + c * kq;
+        }
+      }
+    }
+  }
+}
+
+void EllipsoidFit::Reset() {
+  memset(_sums, 0, sizeof(_sums));
+  _samples = 0;
+  _spikes = 0;
+}
+
+void EllipsoidFit::Add(const float sample[3]) {
+  if (_samples == 0xFFFF) {
+    return;
+  }
+  if (_samples > 0) {
+    float dx = sample[0] - _last[0], dy = sample[1] - _last[1], dz = sample[2] - _last[2];
+    if (dx * dx + dy * dy + dz * dz > SpikeLimit * SpikeLimit && ++_spikes < SpikeRun) {
+      return;
+    }
+  }
+  _spikes = 0;
+  memcpy(_last, sample, sizeof(_last));
+  _samples++;
+
+  float x = sample[0] / Scale, y = sample[1] / Scale, z = sample[2] / Scale;
+  float xx = x * x, yy = y * y, zz = z * z, xy = x * y, xz = x * z, yz = y * z;
+
+  // in MOMENTS' order
+  float *sum = _sums;
+  *sum++ += x;       *sum++ += y;       *sum++ += z;
+  *sum++ += xx;      *sum++ += yy;      *sum++ += zz;      *sum++ += xy;      *sum++ += xz;      *sum++ += yz;
+  *sum++ += xx * x;  *sum++ += yy * y;  *sum++ += zz * z;  *sum++ += xx * y;  *sum++ += xx * z;  *sum++ += xy * y;
+  *sum++ += yy * z;  *sum++ += xz * z;  *sum++ += yz * z;  *sum++ += xy * z;
+  *sum++ += xx * xx; *sum++ += yy * yy; *sum++ += zz * zz; *sum++ += xx * xy; *sum++ += xx * xz; *sum++ += xy * yy;
+  *sum++ += yy * yz; *sum++ += xz * zz; *sum++ += yz * zz; *sum++ += xx * yy; *sum++ += xx * zz; *sum++ += yy * zz;
+  *sum++ += xx * yz; *sum++ += xy * yz; *sum++ += xz * yz;
+}
+
+bool EllipsoidFit::Solve(struct AxisOffsets *offsets, struct AxisCorrection *correction, float *residual) {
+  if (_samples < MinSamples) {
+    return false;
+  }
+
+  // fitted about the samples' mean rather than the origin: the constant the fit is normalised to makes it
+  // unstable when the origin sits near the ellipsoid's surface, as it does when hard iron moves it by about the
+  // field's strength
+  float mean[3] = { _sums[0] / _samples, _sums[1] / _samples, _sums[2] / _samples };
+
+  // the normal equations, each term times each other summed over the samples, and each term's own sum; in a
+  // block of their own so the stack they take is free again for the rest
+  float p[TERMS];
+  float squares = _samples;
+  {
+    float a[TERMS * (TERMS + 1) / 2];
+    for (uint8_t i = 0; i < TERMS; i++) {
+      uint8_t powers = pgm_read_byte(&TERM_POWERS[i]);
+      for (uint8_t j = 0; j <= i; j++) {
+        a[packed(i, j)] = centredMoment(_sums, _samples, powers + pgm_read_byte(&TERM_POWERS[j]), mean);
+      }
+      p[i] = centredMoment(_sums, _samples, powers, mean);
+    }
+    if (!cholesky(a, p, TERMS)) {
+      return false;
+    }
+  }
+
+  // least squares leaves the squared residual at samples less the solution dotted with the right-hand side
+  for (uint8_t i = 0; i < TERMS; i++) {
+    squares -= p[i] * centredMoment(_sums, _samples, pgm_read_byte(&TERM_POWERS[i]), mean);
+  }
+
+  // as x'Mx + 2v'x = 1; the ellipsoid has to curve the same way on every axis, or it isn't one
+  float values[3][3] = {
+    { p[0], p[3] / 2, p[4] / 2 },
+    { p[3] / 2, p[1], p[5] / 2 },
+    { p[4] / 2, p[5] / 2, p[2] }
+  };
+  float v[3] = { p[6] / 2, p[7] / 2, p[8] / 2 };
+  float vectors[3][3];
+  eigen(values, vectors);
+  float lambda[3] = { values[0][0], values[1][1], values[2][2] };
+  if (lambda[0] <= 0 || lambda[1] <= 0 || lambda[2] <= 0) {
+    return false;
+  }
+
+  // centre c = -M^-1 v, through the eigenvectors, leaving (x - c)'M(x - c) = k with k = 1 - c'v
+  float centre[3];
+  for (uint8_t i = 0; i < 3; i++) {
+    float sum = 0;
+    for (uint8_t e = 0; e < 3; e++) {
+      float along = vectors[0][e] * v[0] + vectors[1][e] * v[1] + vectors[2][e] * v[2];
+      sum += vectors[i][e] * along / lambda[e];
+    }
+    centre[i] = -sum;
+  }
+  float k = 1 - (centre[0] * v[0] + centre[1] * v[1] + centre[2] * v[2]);
+  if (k <= 0) {
+    return false;
+  }
+
+  // M's square root, scaled to keep the volume, takes the ellipsoid onto a sphere of its mean radius without
+  // turning it; k scales M's eigenvalues and their geometric mean alike, so drops out
+  float geometric = powf(lambda[0] * lambda[1] * lambda[2], 1.0f / 3);
+  float stretch[3];
+  for (uint8_t e = 0; e < 3; e++) {
+    stretch[e] = sqrtf(lambda[e] / geometric);
+  }
+  for (uint8_t i = 0; i < 3; i++) {
+    for (uint8_t j = 0; j < 3; j++) {
+      float sum = 0;
+      for (uint8_t e = 0; e < 3; e++) {
+        sum += vectors[i][e] * stretch[e] * vectors[j][e];
+      }
+      correction->m[i][j] = sum;
+    }
+  }
+
+  offsets->xOff = (mean[0] + centre[0]) * Scale;
+  offsets->yOff = (mean[1] + centre[1]) * Scale;
+  offsets->zOff = (mean[2] + centre[2]) * Scale;
+
+  // a sample a fraction r off the ellipsoid misses the fit's 1 by about 2kr
+  *residual = sqrtf(max(squares, 0.0f) / _samples) / (2 * k);
+  return true;
+}
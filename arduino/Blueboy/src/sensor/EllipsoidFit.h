@@ -0,0 +1,94 @@
+/*!
+ * @file EllipsoidFit.h
+ * @author Sebastian S.
+ * @brief Declaration for EllipsoidFit
+ */
+
+#ifndef ELLIPSOID_FIT_H_
+#define ELLIPSOID_FIT_H_
+
+#include <Arduino.h>
+#include "CalibrationStorage.h"
+
+/*!
+ * @class EllipsoidFit
+ * @brief Streaming least-squares fit of an ellipsoid to three-axis readings, for hard- and soft-iron
+ *        magnetometer calibration.
+ *
+ * Fits ax^2 + by^2 + cz^2 + dxy + exz + fyz + gx + hy + iz = 1 to every sample added. The normal equations of
+ * that fit are sums of products of the sample's components, up to the fourth power; only the 34 distinct sums
+ * are kept, so memory is constant however long calibration runs, and a sample costs a few dozen multiplies.
+ * Solve turns them into the ellipsoid's centre, the hard-iron offset, and the symmetric matrix that maps the
+ * ellipsoid back onto a sphere of the same volume, the soft-iron correction.
+ *
+ * The fit is only as good as the orientations it is shown: the samples must reach well round the sphere on
+ * every axis, not only turn about one.
+ */
+class EllipsoidFit {
+ public:
+  /*!
+   * @var float Scale
+   * Units of a sample per unit of the fit, bringing a field in uT near 1 so the fourth powers keep their
+   * precision in a float
+   */
+  static constexpr float Scale = 64.0f;
+
+  /*!
+   * @var uint16_t MinSamples
+   * Fewest samples Solve will fit
+   */
+  static constexpr uint16_t MinSamples = 100;
+
+  /*!
+   * @var float SpikeLimit
+   * Furthest in uT a sample may be from the last one taken; a least-squares fit weighs a glitch by its distance
+   * to the fourth power, so one far-off reading would ruin it, while turning the sensor moves the field a few
+   * uT between readings
+   */
+  static constexpr float SpikeLimit = 20.0f;
+
+  /*!
+   * @var uint8_t SpikeRun
+   * Samples past SpikeLimit in a row after which the field is taken to have really moved, and followed
+   */
+  static constexpr uint8_t SpikeRun = 32;
+
+  /*!
+   * @var uint8_t Moments
+   * Distinct sums the normal equations are built from
+   */
+  static constexpr uint8_t Moments = 34;
+
+  EllipsoidFit() { Reset(); }
+
+  /*!
+   * @brief Discards every sample added
+   */
+  void Reset();
+
+  /*!
+   * @param sample Reading to add, x, y, z; ignored if it looks like a glitch, past SpikeLimit
+   */
+  void Add(const float sample[3]);
+
+  /*!
+   * @return Samples added since the last Reset
+   */
+  uint16_t Samples() { return _samples; }
+
+  /*!
+   * @brief Fits the ellipsoid to the samples added
+   * @param offsets Filled with the ellipsoid's centre, in the samples' units
+   * @param correction Filled with the matrix that maps a sample, less offsets, onto a sphere
+   * @param residual Filled with the fit's RMS distance from the ellipsoid, as a fraction of its mean radius
+   * @return False, filling nothing, if there were too few samples or they don't pin down an ellipsoid
+   */
+  bool Solve(struct AxisOffsets *offsets, struct AxisCorrection *correction, float *residual);
+ private:
+  float _sums[Moments];   // sums over the samples of each product in MOMENTS' order, in units of the fit
+  uint16_t _samples;      // samples added; Add ignores any past the most a uint16_t counts
+  float _last[3];         // last sample added, to check the next against SpikeLimit
+  uint8_t _spikes;        // samples in a row ignored past SpikeLimit
+};
+
+#endif
@@ -0,0 +1,226 @@
+/*!
+ * @file I2CEngine.cpp
+ * @author Sebastian S.
+ * @brief Implementation of I2CEngine.h
+ */
+
+#include <util/twi.h>
+#include "I2CEngine.h"
+
+/*!
+ * @var uint8_t CONTINUE
+ * TWCR value that clears the interrupt flag to carry out the next step, keeping the TWI and its interrupt enabled
+ */
+constexpr uint8_t CONTINUE = _BV(TWINT) | _BV(TWEN) | _BV(TWIE);
+
+struct I2CTransfer *volatile I2CEngine::_head = NULL;
+struct I2CTransfer *I2CEngine::_tail = NULL;
+struct I2CTransfer *volatile I2CEngine::_finished = NULL;
+struct I2CTransfer *I2CEngine::_finishedTail = NULL;
+uint8_t I2CEngine::_index = 0;
+bool I2CEngine::_reading = false;
+bool I2CEngine::_held = false;
+
+ISR(TWI_vect) {
+  I2CEngine::OnInterrupt();
+}
+
+void I2CEngine::Begin() {
+  digitalWrite(SDA, HIGH);
+  digitalWrite(SCL, HIGH);
+
+  TWSR = 0;
+  TWBR = ((F_CPU / BusClock) - 16) / 2;
+  TWCR = _BV(TWEN) | _BV(TWIE);
+}
+
+void I2CEngine::Prepare(struct I2CTransfer *transfer, uint8_t address, uint8_t reg, uint8_t *data, uint8_t length,
+                        uint8_t flags, I2CCallback callback, void *context) {
+  transfer->address = address;
+  transfer->reg = reg;
+  transfer->data = data;
+  transfer->length = length;
+  transfer->flags = flags;
+  transfer->callback = callback;
+  transfer->context = context;
+  transfer->status = I2CStatus::Idle;
+  transfer->next = NULL;
+}
+
+bool I2CEngine::Submit(struct I2CTransfer *transfer) {
+  if (transfer->status == I2CStatus::Queued) {
+    return false;
+  }
+
+  noInterrupts();
+  for (struct I2CTransfer *finished = _finished; finished != NULL; finished = finished->next) {
+    if (finished == transfer) {
+      // linking it into the queue would cut the callbacks after it off the finished list
+      interrupts();
+      return false;
+    }
+  }
+  transfer->status = I2CStatus::Queued;
+  transfer->next = NULL;
+  if (_head == NULL) {
+    _head = transfer;
+    _tail = transfer;
+    start();
+  } else {
+    _tail->next = transfer;
+    _tail = transfer;
+  }
+  interrupts();
+  return true;
+}
+
+bool I2CEngine::Run(struct I2CTransfer *transfer) {
+  if (!Submit(transfer)) {
+    return false;
+  }
+
+  unsigned long began = micros();
+  while (transfer->status == I2CStatus::Queued) {
+    if (micros() - began >= Timeout) {
+      Reset();
+      break;
+    }
+    yield();
+  }
+  return transfer->status == I2CStatus::Done;
+}
+
+void I2CEngine::Tick() {
+  while (_finished != NULL) {
+    noInterrupts();
+    struct I2CTransfer *transfer = _finished;
+    _finished = transfer->next;
+    interrupts();
+
+    transfer->callback(transfer);
+  }
+}
+
+void I2CEngine::Reset() {
+  noInterrupts();
+  // disabling the TWI drops whatever it was doing and lets go of both lines
+  TWCR = 0;
+  while (_head != NULL) {
+    struct I2CTransfer *transfer = _head;
+    _head = transfer->next;
+    retire(transfer, I2CStatus::Failed);
+  }
+  _held = false;
+  TWCR = _BV(TWEN) | _BV(TWIE);
+  interrupts();
+}
+
+void I2CEngine::OnInterrupt() {
+  struct I2CTransfer *transfer = _head;
+  if (transfer == NULL) {
+    TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWSTO);
+    return;
+  }
+
+  switch (TW_STATUS) {
+    case TW_START:
+    case TW_REP_START:
+      TWDR = (transfer->address << 1) | (_reading ? TW_READ : TW_WRITE);
+      TWCR = CONTINUE;
+      break;
+
+    case TW_MT_SLA_ACK:
+      if (!(transfer->flags & NoRegister)) {
+        TWDR = transfer->reg;
+        TWCR = CONTINUE;
+        break;
+      }
+      // with no register address, straight on to the data
+      // fall through
+    case TW_MT_DATA_ACK:
+      if (transfer->flags & Read) {
+        // the register address is out, turn the bus round to read from it
+        _reading = true;
+        TWCR = CONTINUE | _BV(TWSTA);
+      } else if (_index < transfer->length) {
+        TWDR = transfer->data[_index++];
+        TWCR = CONTINUE;
+      } else {
+        finish(I2CStatus::Done);
+      }
+      break;
+
+    case TW_MR_SLA_ACK:
+      // acknowledge every byte but the last, which tells the device to stop sending
+      TWCR = CONTINUE | (transfer->length > 1 ? _BV(TWEA) : 0);
+      break;
+
+    case TW_MR_DATA_ACK:
+      transfer->data[_index++] = TWDR;
+      TWCR = CONTINUE | (_index + 1 < transfer->length ? _BV(TWEA) : 0);
+      break;
+
+    case TW_MR_DATA_NACK:
+      transfer->data[_index++] = TWDR;
+      finish(I2CStatus::Done);
+      break;
+
+    default:
+      // a NACK, or lost arbitration with no other master on the bus
+      finish(I2CStatus::Failed);
+      break;
+  }
+}
+
+void I2CEngine::prepareHead() {
+  _index = 0;
+  _reading = (_head->flags & Read) && (_head->flags & NoRegister);
+}
+
+void I2CEngine::start() {
+  prepareHead();
+  if (_held) {
+    // the bus was kept for this transfer, so this is a repeated start
+    _held = false;
+  } else {
+    // a stop from the last transfer may still be going out, and a start written meanwhile would be lost
+    while (TWCR & _BV(TWSTO)) {
+      yield();
+    }
+  }
+  TWCR = CONTINUE | _BV(TWSTA);
+}
+
+void I2CEngine::finish(I2CStatus status) {
+  struct I2CTransfer *transfer = _head;
+  bool hold = status == I2CStatus::Done && (transfer->flags & Hold);
+  _head = transfer->next;
+  retire(transfer, status);
+
+  if (_head != NULL) {
+    // straight into the next transfer, through a stop unless this one keeps the bus for it
+    prepareHead();
+    TWCR = CONTINUE | _BV(TWSTA) | (hold ? 0 : _BV(TWSTO));
+  } else if (hold) {
+    // leaving the interrupt flag set stretches the clock until the next transfer is submitted
+    _held = true;
+    TWCR = _BV(TWEN);
+  } else {
+    TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWSTO);
+  }
+}
+
+void I2CEngine::retire(struct I2CTransfer *transfer, I2CStatus status) {
+  transfer->status = status;
+  if (transfer->callback == NULL) {
+    return;
+  }
+
+  transfer->next = NULL;
+  if (_finished == NULL) {
+    _finished = transfer;
+  } else {
+    _finishedTail->next = transfer;
+  }
+  _finishedTail = transfer;
+}
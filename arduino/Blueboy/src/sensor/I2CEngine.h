@@ -0,0 +1,172 @@
+/*!
+ * @file I2CEngine.h
+ * @author Sebastian S.
+ * @brief Declaration for I2CEngine
+ */
+
+#ifndef I2C_ENGINE_H_
+#define I2C_ENGINE_H_
+
+#include <Arduino.h>
+
+/*!
+ * @enum I2CStatus
+ * Progress of an I2C transfer
+ */
+enum class I2CStatus : uint8_t {
+  Idle =    0,    // never submitted
+  Queued =  1,    // waiting for the bus, or on it
+  Done =    2,    // every byte moved
+  Failed =  3     // the device didn't acknowledge, or the bus was reset
+};
+
+struct I2CTransfer;
+
+/*!
+ * @brief Called from I2CEngine::Tick once a transfer has finished, successfully or not
+ * @param transfer The transfer, whose status tells which
+ */
+typedef void (*I2CCallback)(struct I2CTransfer *transfer);
+
+/*!
+ * @struct I2CTransfer
+ * @brief One register access on the I2C bus: the register address, then data written after it, or read back
+ *        after a repeated start.
+ *
+ * Owned by the caller, which keeps it and its data in place until it has finished.
+ */
+struct I2CTransfer {
+  uint8_t address;            //!< 7-bit address of the device
+  uint8_t reg;                //!< register address written first, unless flagged I2CEngine::NoRegister
+  uint8_t *data;              //!< bytes to write after the register, or buffer to read into
+  uint8_t length;             //!< bytes in data; at least one when reading
+  uint8_t flags;              //!< I2CEngine::Read, NoRegister and Hold
+  I2CCallback callback;       //!< called once finished, NULL for none
+  void *context;              //!< left for the callback
+  volatile I2CStatus status;  //!< progress, kept by the engine
+  struct I2CTransfer *next;   //!< the engine's queue link
+};
+
+/*!
+ * @class I2CEngine
+ * @brief Interrupt-driven I2C master at 400 kHz, moving a queue of transfers over the AVR's TWI without the CPU
+ *        waiting on the bus.
+ *
+ * Each byte is moved by the TWI interrupt, which starts the next queued transfer as soon as one finishes, so a
+ * read submitted before parsing commands or writing telemetry has landed by the next loop. Callbacks run from
+ * Tick, in the loop rather than the interrupt, so they can take their time.
+ *
+ * Replaces Wire, whose TWI interrupt it would otherwise clash with; Run gives the blocking access Wire did.
+ */
+class I2CEngine {
+ public:
+  /*!
+   * @var uint32_t BusClock
+   * SCL frequency in Hz, I2C fast mode, which all of the bus's devices support
+   */
+  static constexpr uint32_t BusClock = 400000;
+
+  /*!
+   * @var unsigned long Timeout
+   * Microseconds Run waits on a transfer before giving the bus up as stuck and resetting it
+   */
+  static constexpr unsigned long Timeout = 10000;
+
+  /*!
+   * @var uint8_t Read
+   * Transfer flag: read the data after a repeated start, rather than writing it
+   */
+  static constexpr uint8_t Read = 1 << 0;
+
+  /*!
+   * @var uint8_t NoRegister
+   * Transfer flag: skip the register address, moving only the data
+   */
+  static constexpr uint8_t NoRegister = 1 << 1;
+
+  /*!
+   * @var uint8_t Hold
+   * Transfer flag: end with a repeated start into the next transfer rather than a stop, keeping the bus
+   */
+  static constexpr uint8_t Hold = 1 << 2;
+
+  /*!
+   * @brief Enables the TWI, with the internal pull-ups on SDA and SCL as Wire enabled them
+   */
+  static void Begin();
+
+  /*!
+   * @brief Fills in a transfer
+   * @param transfer Transfer to fill
+   * @param address 7-bit address of the device
+   * @param reg Register address written first
+   * @param data Bytes to write, or buffer to read into
+   * @param length Bytes in data
+   * @param flags Read, NoRegister and Hold, 0 to write data to reg
+   * @param callback Function to call once finished, NULL for none
+   * @param context Left in the transfer for the callback
+   */
+  static void Prepare(struct I2CTransfer *transfer, uint8_t address, uint8_t reg, uint8_t *data, uint8_t length,
+                      uint8_t flags = 0, I2CCallback callback = NULL, void *context = NULL);
+
+  /*!
+   * @brief Queues a transfer, starting it if the bus is free
+   * @param transfer Transfer to queue, which mustn't be changed until it has finished
+   * @return False if the transfer is already queued, or finished with its callback still to run
+   *
+   * A transfer with a callback may be submitted again from the callback, but not before it has run: its status
+   * reads finished from the moment it leaves the bus, while it still waits on Tick.
+   */
+  static bool Submit(struct I2CTransfer *transfer);
+
+  /*!
+   * @brief Queues a transfer and waits for it to finish, after any queued before it
+   * @param transfer Transfer to move
+   * @return True if it moved every byte; false if it failed, or took so long the bus was reset
+   */
+  static bool Run(struct I2CTransfer *transfer);
+
+  /*!
+   * @brief Runs the callbacks of transfers finished since last called
+   *
+   * Call once per loop.
+   */
+  static void Tick();
+
+  /*!
+   * @return True if no transfer is queued
+   */
+  static bool Idle() { return _head == NULL; }
+
+  /*!
+   * @brief Abandons the transfer on the bus and those queued after it, failing them, and releases the bus
+   */
+  static void Reset();
+
+  /*!
+   * @brief Moves the transfer on the bus on by one step; for the TWI interrupt only
+   */
+  static void OnInterrupt();
+ private:
+  static struct I2CTransfer *volatile _head;      // transfer on the bus, followed by the rest of the queue
+  static struct I2CTransfer *_tail;               // last queued transfer
+  static struct I2CTransfer *volatile _finished;  // finished transfers with callbacks still to run
+  static struct I2CTransfer *_finishedTail;
+  static uint8_t _index;                          // data byte of the transfer on the bus moved next
+  static bool _reading;                           // true once the transfer on the bus is reading
+  static bool _held;                              // true if a transfer ended holding the bus for the next
+
+  // readies the engine for the transfer at the head of the queue, before its start goes out
+  static void prepareHead();
+
+  // starts the transfer at the head of the queue on an idle bus, or one held for it
+  static void start();
+
+  // takes the transfer on the bus off the queue with the given status, and starts the next
+  static void finish(I2CStatus status);
+
+  // sets a transfer's final status, and queues its callback
+  static void retire(struct I2CTransfer *transfer, I2CStatus status);
+};
+
+#endif
@@ -0,0 +1,59 @@
+/*!
+ * @file LIS2MDL.cpp
+ * @author Sebastian S.
+ * @brief Implementation of LIS2MDL.h
+ */
+
+#include "LIS2MDL.h"
+#include "RegisterIO.h"
+
+/*
+ * Registers and bits
+ */
+constexpr uint8_t LIS2MDL_WHO_AM_I = 0x4F;
+constexpr uint8_t LIS2MDL_CFG_REG_A = 0x60;
+constexpr uint8_t LIS2MDL_CFG_REG_C = 0x62;
+constexpr uint8_t LIS2MDL_OUTX_L = 0x68;
+
+constexpr uint8_t LIS2MDL_CHIP_ID = 0x40;
+constexpr uint8_t REBOOT = 1 << 6;            // CFG_REG_A
+constexpr uint8_t SOFT_RST = 1 << 5;          // CFG_REG_A
+constexpr uint8_t ODR_100_HZ = 0x03 << 2;     // CFG_REG_A, in continuous mode
+constexpr uint8_t BDU = 1 << 4;               // CFG_REG_C: block data update
+constexpr uint8_t DRDY_ON_PIN = 1 << 0;       // CFG_REG_C
+
+/*!
+ * @var unsigned long BOOT_TIME
+ * Milliseconds to wait after a reboot before the sensor takes writes again
+ */
+constexpr unsigned long BOOT_TIME = 100;
+
+bool LIS2MDL::Begin() {
+  uint8_t id;
+  if (!ReadRegisters(Address, LIS2MDL_WHO_AM_I, &id, 1) || id != LIS2MDL_CHIP_ID) {
+    return false;
+  }
+
+  if (!WriteRegister(Address, LIS2MDL_CFG_REG_A, REBOOT | SOFT_RST)) {
+    return false;
+  }
+  delay(BOOT_TIME);
+
+  return WriteRegister(Address, LIS2MDL_CFG_REG_A, ODR_100_HZ) &&
+         WriteRegister(Address, LIS2MDL_CFG_REG_C, BDU);
+}
+
+bool LIS2MDL::EnableDataReady(bool enable) {
+  return WriteRegister(Address, LIS2MDL_CFG_REG_C, enable ? BDU | DRDY_ON_PIN : BDU);
+}
+
+bool LIS2MDL::ReadMagnetic(int16_t counts[3]) {
+  // outputs are little-endian x, y, z, the same layout as counts
+  return ReadRegisters(Address, LIS2MDL_OUTX_L, (uint8_t *) counts, 3 * sizeof(int16_t));
+}
+
+void LIS2MDL::PrepareMagneticRead(struct I2CTransfer *transfer, int16_t counts[3], I2CCallback callback,
+                                  void *context) {
+  I2CEngine::Prepare(transfer, Address, LIS2MDL_OUTX_L, (uint8_t *) counts, 3 * sizeof(int16_t), I2CEngine::Read,
+                     callback, context);
+}
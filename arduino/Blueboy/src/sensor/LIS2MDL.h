@@ -0,0 +1,69 @@
+/*!
+ * @file LIS2MDL.h
+ * @author Sebastian S.
+ * @brief Declaration for LIS2MDL
+ */
+
+#ifndef LIS2MDL_H_
+#define LIS2MDL_H_
+
+#include <Arduino.h>
+#include "I2CEngine.h"
+
+/*!
+ * @class LIS2MDL
+ * @brief Register-level driver for the LIS2MDL magnetometer, reading in native counts.
+ *
+ * Runs continuously at 100 Hz with block data update, as the Adafruit driver configured it.
+ */
+class LIS2MDL {
+ public:
+  /*!
+   * @var uint8_t LIS2MDL::Address
+   * I2C address, fixed by the part
+   */
+  static constexpr uint8_t Address = 0x1E;
+
+  /*!
+   * @var unsigned long LIS2MDL::Period
+   * Microseconds between samples at its 100 Hz
+   */
+  static constexpr unsigned long Period = 10000;
+
+  /*!
+   * @brief Checks the sensor's identity, reboots it and starts continuous conversion
+   * @return True if the sensor answered and was configured
+   */
+  bool Begin();
+
+  /*!
+   * @brief Drives the INT/DRDY pin with the data-ready signal, which then stays high until the sample is read
+   * @param enable True to drive it, false to leave it low
+   * @return True if the sensor acknowledged
+   */
+  bool EnableDataReady(bool enable);
+
+  /*!
+   * @brief Reads the latest sample in the sensor's own axes
+   * @param counts Counts to fill, x, y, z
+   * @return True if the sensor was read
+   */
+  bool ReadMagnetic(int16_t counts[3]);
+
+  /*!
+   * @brief Fills in a transfer reading the same burst as ReadMagnetic, to be submitted to the I2CEngine
+   * @param transfer Transfer to fill
+   * @param counts Counts to fill once it has finished, x, y, z
+   * @param callback Function to call once finished, NULL for none
+   * @param context Left in the transfer for the callback
+   */
+  static void PrepareMagneticRead(struct I2CTransfer *transfer, int16_t counts[3], I2CCallback callback = NULL,
+                                  void *context = NULL);
+
+  /*!
+   * @return Microtesla per count
+   */
+  static float Scale() { return 0.15; }
+};
+
+#endif
@@ -0,0 +1,111 @@
+/*!
+ * @file LSM6DS33.cpp
+ * @author Sebastian S.
+ * @brief Implementation of LSM6DS33.h
+ */
+
+#include "LSM6DS33.h"
+#include "RegisterIO.h"
+
+/*
+ * Registers and bits
+ */
+constexpr uint8_t LSM6DS33_INT1_CTRL = 0x0D;
+constexpr uint8_t LSM6DS33_WHO_AM_I = 0x0F;
+constexpr uint8_t LSM6DS33_CTRL1_XL = 0x10;
+constexpr uint8_t LSM6DS33_CTRL2_G = 0x11;
+constexpr uint8_t LSM6DS33_CTRL3_C = 0x12;
+constexpr uint8_t LSM6DS33_OUT_TEMP_L = 0x20;
+constexpr uint8_t LSM6DS33_OUTX_L_G = 0x22;   // followed by the rest of the gyroscope, then the accelerometer
+constexpr uint8_t LSM6DS33_OUTX_L_XL = 0x28;
+
+constexpr uint8_t LSM6DS33_CHIP_ID = 0x69;
+constexpr uint8_t INT1_DRDY_G = 1 << 1;       // INT1_CTRL
+constexpr uint8_t SW_RESET = 1 << 0;          // CTRL3_C, clears itself once the reset is done
+constexpr uint8_t IF_INC = 1 << 2;            // CTRL3_C: auto-increment over burst reads
+constexpr uint8_t BDU = 1 << 6;               // CTRL3_C: block data update
+constexpr uint8_t FS_XL_4_G = 0x02 << 2;      // CTRL1_XL
+constexpr uint8_t FS_G_2000_DPS = 0x03 << 2;  // CTRL2_G
+
+/*!
+ * @var uint8_t RESET_POLLS
+ * Times to check a software reset has finished before giving up, each a register read of about 100 us
+ */
+constexpr uint8_t RESET_POLLS = 10;
+
+bool LSM6DS33::Begin() {
+  uint8_t id;
+  if (!ReadRegisters(Address, LSM6DS33_WHO_AM_I, &id, 1) || id != LSM6DS33_CHIP_ID) {
+    return false;
+  }
+
+  if (!WriteRegister(Address, LSM6DS33_CTRL3_C, SW_RESET)) {
+    return false;
+  }
+  uint8_t ctrl = SW_RESET;
+  for (uint8_t i = 0; i < RESET_POLLS && (ctrl & SW_RESET); i++) {
+    if (!ReadRegisters(Address, LSM6DS33_CTRL3_C, &ctrl, 1)) {
+      return false;
+    }
+  }
+  if (ctrl & SW_RESET) {
+    return false;
+  }
+
+  return WriteRegister(Address, LSM6DS33_CTRL3_C, BDU | IF_INC) &&
+         SetRates(LSM6DS33_RATE_104_HZ, LSM6DS33_RATE_104_HZ);
+}
+
+bool LSM6DS33::SetRates(LSM6DS33Rate accel, LSM6DS33Rate gyro) {
+  if (!WriteRegister(Address, LSM6DS33_CTRL1_XL, (accel << 4) | FS_XL_4_G) ||
+      !WriteRegister(Address, LSM6DS33_CTRL2_G, (gyro << 4) | FS_G_2000_DPS)) {
+    return false;
+  }
+  _accelRate = accel;
+  _gyroRate = gyro;
+  return true;
+}
+
+bool LSM6DS33::EnableDataReady(bool enable) {
+  return WriteRegister(Address, LSM6DS33_INT1_CTRL, enable ? INT1_DRDY_G : 0);
+}
+
+bool LSM6DS33::ReadMotion(int16_t gyro[3], int16_t acceleration[3]) {
+  // outputs are little-endian x, y, z, the same layout as the counts
+  int16_t counts[6];
+  if (!ReadRegisters(Address, LSM6DS33_OUTX_L_G, (uint8_t *) counts, sizeof(counts))) {
+    return false;
+  }
+  memcpy(gyro, counts, 3 * sizeof(int16_t));
+  memcpy(acceleration, counts + 3, 3 * sizeof(int16_t));
+  return true;
+}
+
+void LSM6DS33::PrepareMotionRead(struct I2CTransfer *transfer, int16_t counts[6], I2CCallback callback,
+                                 void *context) {
+  I2CEngine::Prepare(transfer, Address, LSM6DS33_OUTX_L_G, (uint8_t *) counts, 6 * sizeof(int16_t),
+                     I2CEngine::Read, callback, context);
+}
+
+bool LSM6DS33::ReadGyro(int16_t gyro[3]) {
+  return ReadRegisters(Address, LSM6DS33_OUTX_L_G, (uint8_t *) gyro, 3 * sizeof(int16_t));
+}
+
+bool LSM6DS33::ReadAcceleration(int16_t acceleration[3]) {
+  return ReadRegisters(Address, LSM6DS33_OUTX_L_XL, (uint8_t *) acceleration, 3 * sizeof(int16_t));
+}
+
+void LSM6DS33::PrepareTemperatureRead(struct I2CTransfer *transfer, int16_t *counts, I2CCallback callback,
+                                      void *context) {
+  I2CEngine::Prepare(transfer, Address, LSM6DS33_OUT_TEMP_L, (uint8_t *) counts, sizeof(int16_t), I2CEngine::Read,
+                     callback, context);
+}
+
+bool LSM6DS33::ReadTemperature(float *celsius) {
+  int16_t counts;
+  if (!ReadRegisters(Address, LSM6DS33_OUT_TEMP_L, (uint8_t *) &counts, sizeof(counts))) {
+    return false;
+  }
+  *celsius = counts / 16.0 + 25.0;
+  return true;
+}
@@ -0,0 +1,142 @@
+/*!
+ * @file LSM6DS33.h
+ * @author Sebastian S.
+ * @brief Declaration for LSM6DS33
+ */
+
+#ifndef LSM6DS33_H_
+#define LSM6DS33_H_
+
+#include <Arduino.h>
+#include <Adafruit_Sensor.h>   // for unit conversions
+#include "I2CEngine.h"
+
+/*!
+ * @enum LSM6DS33Rate
+ * Output data rate settings, the ODR field of CTRL1_XL and CTRL2_G
+ */
+enum LSM6DS33Rate : uint8_t {
+  LSM6DS33_RATE_SHUTDOWN,
+  LSM6DS33_RATE_12_5_HZ,
+  LSM6DS33_RATE_26_HZ,
+  LSM6DS33_RATE_52_HZ,
+  LSM6DS33_RATE_104_HZ,
+  LSM6DS33_RATE_208_HZ,
+  LSM6DS33_RATE_416_HZ,
+  LSM6DS33_RATE_833_HZ,
+  LSM6DS33_RATE_1_66K_HZ
+};
+
+/*!
+ * @class LSM6DS33
+ * @brief Register-level driver for the LSM6DS33 6-dof IMU, reading in native counts.
+ *
+ * Runs the accelerometer at +/-4 g and the gyroscope at +/-2000 dps, the ranges the Adafruit driver chose, with
+ * block data update so an axis's two bytes always come from the same sample. The gyroscope and accelerometer
+ * outputs are adjacent, so both are read in one 12-byte burst.
+ */
+class LSM6DS33 {
+ public:
+  /*!
+   * @var uint8_t LSM6DS33::Address
+   * I2C address, with SA0 pulled high as on the Adafruit breakout
+   */
+  static constexpr uint8_t Address = 0x6A;
+
+  LSM6DS33() : _accelRate(LSM6DS33_RATE_SHUTDOWN), _gyroRate(LSM6DS33_RATE_SHUTDOWN) { }
+
+  /*!
+   * @brief Checks the sensor's identity, resets it and starts both sensors at 104 Hz
+   * @return True if the sensor answered and was configured
+   */
+  bool Begin();
+
+  /*!
+   * @brief Sets the output data rates, keeping the ranges
+   * @param accel Accelerometer rate
+   * @param gyro Gyroscope rate
+   * @return True if the sensor acknowledged both
+   */
+  bool SetRates(LSM6DS33Rate accel, LSM6DS33Rate gyro);
+
+  /*!
+   * @return The accelerometer's output data rate as last set
+   */
+  LSM6DS33Rate AccelRate() const { return _accelRate; }
+
+  /*!
+   * @return The gyroscope's output data rate as last set
+   */
+  LSM6DS33Rate GyroRate() const { return _gyroRate; }
+
+  /*!
+   * @brief Routes the gyroscope's data-ready signal to INT1, which then stays high until the sample is read
+   * @param enable True to route it, false to leave INT1 low
+   * @return True if the sensor acknowledged
+   */
+  bool EnableDataReady(bool enable);
+
+  /*!
+   * @brief Reads the latest gyroscope and accelerometer samples in one burst
+   * @param gyro Gyroscope counts to fill, x, y, z
+   * @param acceleration Accelerometer counts to fill, x, y, z
+   * @return True if the sensor was read
+   */
+  bool ReadMotion(int16_t gyro[3], int16_t acceleration[3]);
+
+  /*!
+   * @brief Fills in a transfer reading the same burst as ReadMotion, to be submitted to the I2CEngine
+   * @param transfer Transfer to fill
+   * @param counts Counts to fill once it has finished, gyroscope x, y, z then accelerometer x, y, z
+   * @param callback Function to call once finished, NULL for none
+   * @param context Left in the transfer for the callback
+   */
+  static void PrepareMotionRead(struct I2CTransfer *transfer, int16_t counts[6], I2CCallback callback = NULL,
+                                void *context = NULL);
+
+  /*!
+   * @brief Reads the latest gyroscope sample
+   * @param gyro Counts to fill, x, y, z
+   * @return True if the sensor was read
+   */
+  bool ReadGyro(int16_t gyro[3]);
+
+  /*!
+   * @brief Reads the latest accelerometer sample
+   * @param acceleration Counts to fill, x, y, z
+   * @return True if the sensor was read
+   */
+  bool ReadAcceleration(int16_t acceleration[3]);
+
+  /*!
+   * @brief Reads the die temperature
+   * @param celsius Set to the temperature in degrees Celsius
+   * @return True if the sensor was read
+   */
+  bool ReadTemperature(float *celsius);
+
+  /*!
+   * @brief Fills in a transfer reading the die temperature, to be submitted to the I2CEngine
+   * @param transfer Transfer to fill
+   * @param counts Temperature to fill once it has finished, 1/16 degree from 25 C
+   * @param callback Function to call once finished, NULL for none
+   * @param context Left in the transfer for the callback
+   */
+  static void PrepareTemperatureRead(struct I2CTransfer *transfer, int16_t *counts, I2CCallback callback = NULL,
+                                     void *context = NULL);
+
+  /*!
+   * @return Meters per second squared per accelerometer count
+   */
+  static float AccelScale() { return 0.122 * SENSORS_GRAVITY_STANDARD / 1000; }
+
+  /*!
+   * @return Radians per second per gyroscope count
+   */
+  static float GyroScale() { return 70.0 * SENSORS_DPS_TO_RADS / 1000; }
+ private:
+  LSM6DS33Rate _accelRate;
+  LSM6DS33Rate _gyroRate;
+};
+
+#endif
@@ -0,0 +1,129 @@
+/*!
+ * @file MadgwickFilter.cpp
+ * @author Sebastian S.
+ * @brief Implementation of MadgwickFilter.h
+ */
+
+#include <math.h>
+#include "MadgwickFilter.h"
+#include "../util/FastTrig.h"
+
+/*!
+ * @brief Scales a vector to unit length
+ * @param v Vector to scale
+ * @param n Number of elements
+ * @return False if the vector is zero, and left as it was
+ */
+static bool normalise(float *v, uint8_t n) {
+  float squares = 0;
+  for (uint8_t i = 0; i < n; i++) {
+    squares += v[i] * v[i];
+  }
+  if (squares == 0) {
+    return false;
+  }
+
+  float scale = 1.0f / sqrtf(squares);
+  for (uint8_t i = 0; i < n; i++) {
+    v[i] *= scale;
+  }
+  return true;
+}
+
+MadgwickFilter::MadgwickFilter() {
+  Reset();
+}
+
+void MadgwickFilter::Reset() {
+  _q[0] = 1;
+  _q[1] = 0;
+  _q[2] = 0;
+  _q[3] = 0;
+  _updates = 0;
+}
+
+void MadgwickFilter::Update(const float gyro[3], const float acceleration[3], const float magnetic[3],
+                            float dt) {
+  float q0 = _q[0], q1 = _q[1], q2 = _q[2], q3 = _q[3];
+
+  // rate of change of the orientation the gyroscope alone gives
+  float qDot[4] = {
+    0.5f * (-q1 * gyro[0] - q2 * gyro[1] - q3 * gyro[2]),
+    0.5f * (q0 * gyro[0] + q2 * gyro[2] - q3 * gyro[1]),
+    0.5f * (q0 * gyro[1] - q1 * gyro[2] + q3 * gyro[0]),
+    0.5f * (q0 * gyro[2] + q1 * gyro[1] - q2 * gyro[0])
+  };
+
+  float a[3] = { acceleration[0], acceleration[1], acceleration[2] };
+  if (normalise(a, 3)) {
+    float q0q0 = q0 * q0, q0q1 = q0 * q1, q0q2 = q0 * q2, q0q3 = q0 * q3;
+    float q1q1 = q1 * q1, q1q2 = q1 * q2, q1q3 = q1 * q3;
+    float q2q2 = q2 * q2, q2q3 = q2 * q3, q3q3 = q3 * q3;
+
+    // gravity as the orientation predicts it, less as measured
+    float f1 = 2 * (q1q3 - q0q2) - a[0];
+    float f2 = 2 * (q0q1 + q2q3) - a[1];
+    float f3 = 1 - 2 * (q1q1 + q2q2) - a[2];
+
+    // the gradient of its square, the Jacobian's transpose times it
+    float s[4] = {
+      2 * (-q2 * f1 + q1 * f2),
+      2 * (q3 * f1 + q0 * f2) - 4 * q1 * f3,
+      2 * (-q0 * f1 + q3 * f2) - 4 * q2 * f3,
+      2 * (q1 * f1 + q2 * f2)
+    };
+
+    float m[3] = { magnetic[0], magnetic[1], magnetic[2] };
+    if (normalise(m, 3)) {
+      // the field turned into the Earth's frame, then flattened onto north and down, so the magnetometer
+      // corrects heading without pulling on roll and pitch
+      float hx = m[0] * (q0q0 + q1q1 - q2q2 - q3q3) + 2 * m[1] * (q1q2 - q0q3) + 2 * m[2] * (q0q2 + q1q3);
+      float hy = 2 * m[0] * (q0q3 + q1q2) + m[1] * (q0q0 - q1q1 + q2q2 - q3q3) + 2 * m[2] * (q2q3 - q0q1);
+      float bx = sqrtf(hx * hx + hy * hy);
+      float bz = 2 * m[0] * (q1q3 - q0q2) + 2 * m[1] * (q0q1 + q2q3) + m[2] * (q0q0 - q1q1 - q2q2 + q3q3);
+
+      // that field as the orientation predicts it, less as measured
+      float f4 = bx * (1 - 2 * (q2q2 + q3q3)) + 2 * bz * (q1q3 - q0q2) - m[0];
+      float f5 = 2 * bx * (q1q2 - q0q3) + 2 * bz * (q0q1 + q2q3) - m[1];
+      float f6 = 2 * bx * (q0q2 + q1q3) + bz * (1 - 2 * (q1q1 + q2q2)) - m[2];
+
+      s[0] += 2 * (-bz * q2 * f4 + (bz * q1 - bx * q3) * f5 + bx * q2 * f6);
+      s[1] += 2 * (bz * q3 * f4 + (bx * q2 + bz * q0) * f5 + (bx * q3 - 2 * bz * q1) * f6);
+      s[2] += 2 * ((-2 * bx * q2 - bz * q0) * f4 + (bx * q1 + bz * q3) * f5 + (bx * q0 - 2 * bz * q2) * f6);
+      s[3] += 2 * ((bz * q1 - 2 * bx * q3) * f4 + (bz * q2 - bx * q0) * f5 + bx * q1 * f6);
+    }
+
+    // one step down the gradient, as far as beta says the gyroscope can be wrong
+    if (normalise(s, 4)) {
+      float beta = _updates < StartUpdates ? StartBeta : DefaultBeta;
+      for (uint8_t i = 0; i < 4; i++) {
+        qDot[i] -= beta * s[i];
+      }
+    }
+  }
+
+  for (uint8_t i = 0; i < 4; i++) {
+    _q[i] += qDot[i] * dt;
+  }
+  normalise(_q, 4);
+
+  if (_updates < StartUpdates) {
+    _updates++;
+  }
+}
+
+void MadgwickFilter::GetQuaternion(struct Quaternion *quaternion) {
+  quaternion->w = _q[0];
+  quaternion->x = _q[1];
+  quaternion->y = _q[2];
+  quaternion->z = _q[3];
+}
+
+void MadgwickFilter::GetEuler(struct Vector *euler) {
+  float q0 = _q[0], q1 = _q[1], q2 = _q[2], q3 = _q[3];
+  float sinPitch = 2 * (q0 * q2 - q1 * q3);
+
+  euler->roll = FastAtan2(q0 * q1 + q2 * q3, 0.5f - q1 * q1 - q2 * q2);
+  euler->pitch = FastAsin(sinPitch);    // clamps it, as rounding can take it just past 1 at +-90 degrees
+  euler->heading = FastAtan2(q1 * q2 + q0 * q3, 0.5f - q2 * q2 - q3 * q3);
+}
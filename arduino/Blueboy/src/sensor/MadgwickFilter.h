@@ -0,0 +1,86 @@
+/*!
+ * @file MadgwickFilter.h
+ * @author Sebastian S.
+ * @brief Declaration for MadgwickFilter
+ */
+
+#ifndef MADGWICK_FILTER_H_
+#define MADGWICK_FILTER_H_
+
+#include <Arduino.h>
+#include "../Blueboy.h"
+
+/*!
+ * @class MadgwickFilter
+ * @brief Madgwick's gradient descent attitude filter, fusing angular rate, acceleration and magnetic field into
+ *        an orientation quaternion.
+ *
+ * Integrates the gyroscope, then corrects its drift with one gradient descent step towards the orientation
+ * that best matches gravity and the Earth's field as the accelerometer and magnetometer see them. Both are
+ * normalised first, so any units do; the gyroscope is in rad/s. The three sensors are taken to share axes.
+ */
+class MadgwickFilter {
+ public:
+  /*!
+   * @var float DefaultBeta
+   * Gain of the correction, the gyroscope error in rad/s it removes: about sqrt(3/4) times the gyroscope's
+   * noise, as Madgwick suggests, with margin for an uncalibrated bias
+   */
+  static constexpr float DefaultBeta = 0.1f;
+
+  /*!
+   * @var float StartBeta
+   * Gain used for the first StartUpdates updates, so the orientation settles from wherever it began in well
+   * under a second rather than the many DefaultBeta would take
+   */
+  static constexpr float StartBeta = 2.5f;
+
+  /*!
+   * @var uint16_t StartUpdates
+   * Updates run at StartBeta after a reset
+   */
+  static constexpr uint16_t StartUpdates = 100;
+
+  MadgwickFilter();
+
+  /*!
+   * @brief Forgets the orientation, starting again from the identity at StartBeta
+   */
+  void Reset();
+
+  /*!
+   * @brief Moves the orientation on by one sample of each sensor
+   * @param gyro Angular rate, x, y, z, rad/s
+   * @param acceleration Acceleration, x, y, z; the gyroscope alone is integrated if zero
+   * @param magnetic Magnetic field, x, y, z; left out, correcting only roll and pitch, if zero
+   * @param dt Seconds since the last update
+   */
+  void Update(const float gyro[3], const float acceleration[3], const float magnetic[3], float dt);
+
+  /*!
+   * @return True once an update has run since the last reset
+   */
+  bool Started() { return _updates > 0; }
+
+  /*!
+   * @return True once the StartUpdates since the last reset have run, and the orientation has settled
+   */
+  bool Settled() { return _updates >= StartUpdates; }
+
+  /*!
+   * @param quaternion Quaternion to fill with the orientation
+   */
+  void GetQuaternion(struct Quaternion *quaternion);
+
+  /*!
+   * @param euler Vector to fill with the orientation as roll, pitch and heading in radians
+   *
+   * Goes through FastTrig's tables, good to 3e-5 rad.
+   */
+  void GetEuler(struct Vector *euler);
+ private:
+  float _q[4];          // orientation, w, x, y, z, rotating the sensor frame to the Earth's
+  uint16_t _updates;    // updates since the last reset, stopping at StartUpdates
+};
+
+#endif
@@ -5,8 +5,9 @@
  */
 
 #include <Arduino.h>
-#include <Wire.h>
 #include "OneUDriver.h"
+#include "I2CEngine.h"
+#include "../util/Log.h"
 
 /*!
  * @var uint8_t ONEU_ADDR
@@ -14,7 +15,20 @@
  */
 constexpr uint8_t ONEU_ADDR = 0x3A;
 
-OneUDriver::OneUDriver() { }
+/*
+ * Control and status registers
+ */
+constexpr uint8_t ONEU_SENSOR_HEALTH = 0x01;
+constexpr uint8_t ONEU_OPERATION = 0x10;
+constexpr uint8_t ONEU_CALIBRATION = 0x11;
+
+constexpr uint8_t RESET = 1 << 0;   // OPERATION
+
+OneUDriver::OneUDriver() : _control{0, 0}, _controlKnown(false), _health(0), _healthReading(0), _healthKnown(false),
+                           _healthPending(false), _healthPeriod(DefaultHealthPeriod), _healthRead(0),
+                           _snapshotPending(false), _snapshotLanded(false), _snapshotTime(0) {
+  I2CEngine::Prepare(&_healthTransfer, ONEU_ADDR, ONEU_SENSOR_HEALTH, &_healthReading, 1, I2CEngine::Read);
+}
 
 /*!
  * @brief Translates a reading type into its corresponding data register address
@@ -54,82 +68,35 @@ static int bitFromType(sensors_type_t type) {
   }
 }
 
-/*!
- * @brief Starts a transaction with the 1U over I2C, sending the register address with repeated start
- * @param addr Address of the register to access
- * @return True if the transaction was successfully carried out
- */
-static bool requestAddress(uint8_t addr) {
-  Wire.beginTransmission(ONEU_ADDR);
-  Wire.write(addr);
-  uint8_t status = Wire.endTransmission(false);
-  if (status) {
-    // not a success
-    Serial.print(F("  OneUDriver failed to access address "));
-    Serial.print(addr, HEX);
-    Serial.print(F(": "));
-    Serial.println(status);
-    return false;
-  }
-  return true;
-}
-
 /*!
  * @brief Reads bytes from the 1U starting at the given register address
  * @param addr Address of the first register to access
  * @param len Number of bytes to read
  * @param buf Buffer to write read data into
- * @param stop True if a stop should be sent following this transaction, false for a repeated start
  * @return True if the transaction was successfully carried out
  */
-static bool readAddress(uint8_t addr, uint8_t len, char *buf, bool stop = true) {
-  if (!requestAddress(addr)) {
-    return false;
-  }
-  
-  uint8_t received = Wire.requestFrom(ONEU_ADDR, len, (uint8_t) stop);
-  if (received != len) {
-    Serial.print(F("  OneUDriver failed to request "));
-    Serial.print(len);
-    Serial.print(F(" bytes from address "));
-    Serial.print(addr, HEX);
-    Serial.print(F(": "));
-    Serial.println(received);
+static bool readAddress(uint8_t addr, uint8_t len, char *buf) {
+  struct I2CTransfer transfer;
+  I2CEngine::Prepare(&transfer, ONEU_ADDR, addr, (uint8_t *) buf, len, I2CEngine::Read);
+  if (!I2CEngine::Run(&transfer)) {
+    LOG_ERROR(F("OneUDriver failed to read "), len, F(" bytes from address "), LogHex(addr));
     return false;
   }
-  
-  for (int i = 0; i < len; i++) {
-    // there should be len bytes in the Wire buffer
-    if (Wire.available()) {
-      buf[i] = Wire.read();
-    }
-  }
-  
   return true;
 }
 
 /*!
- * @brief Transmits bytes to the 1U starting at the given register address
+ * @brief Transmits bytes to the 1U starting at the given register address, in one transaction
  * @param addr Address of the first register to write to
  * @param len Number of bytes to write
  * @param buf Buffer containing data to write
- * @param stop True if a stop should be sent following this transaction, false for a repeated start
  * @return True if the transaction was successfully carried out
  */
-static bool writeAddress(uint8_t addr, uint8_t len, const char *buf, bool stop = true) {
-  if (!requestAddress(addr)) {
-    return false;
-  }
-  
-  Wire.beginTransmission(ONEU_ADDR);
-  Wire.write(buf, len);
-  uint8_t status = Wire.endTransmission(stop);
-  if (status) {
-    // not a success
-    Serial.print(F("  OneUDriver failed to transmit "));
-    Serial.print(len);
-    Serial.print(F(" bytes from address "));
-    Serial.print(addr, HEX);
+static bool writeAddress(uint8_t addr, uint8_t len, const char *buf) {
+  struct I2CTransfer transfer;
+  I2CEngine::Prepare(&transfer, ONEU_ADDR, addr, (uint8_t *) buf, len);
+  if (!I2CEngine::Run(&transfer)) {
+    LOG_ERROR(F("OneUDriver failed to transmit "), len, F(" bytes to address "), LogHex(addr));
     return false;
   }
   return true;
@@ -139,32 +106,64 @@ bool OneUDriver::Initialize() {
   return true;
 }
 
+bool OneUDriver::updateControl(uint8_t addr, uint8_t set, uint8_t clear) {
+  if (!_controlKnown) {
+    // only the master writes the control registers, so once read the shadows stay true until the 1U resets
+    if (!readAddress(ONEU_OPERATION, sizeof(_control), (char *) _control)) {
+      return false;
+    }
+    _controlKnown = true;
+  }
+
+  uint8_t *shadow = &_control[addr - ONEU_OPERATION];
+  uint8_t value = (*shadow | set) & ~clear;
+  if (!writeAddress(addr, 1, (const char *) &value)) {
+    return false;
+  }
+  *shadow = value;
+  return true;
+}
+
 void OneUDriver::Reset() {
-  uint8_t byte;
-  
-  if (!readAddress(0x10, 1, &byte, false)) {
+  if (!updateControl(ONEU_OPERATION, RESET, 0)) {
     return;
   }
-  
-  byte |= (1 << 0);
-  
-  if (!writeAddress(0x10, 1, &byte, true)) {
+  // it comes back with its registers cleared, so the shadows are read again rather than assumed
+  _controlKnown = false;
+  _healthKnown = false;
+}
+
+void OneUDriver::SetHealthPeriod(unsigned long period) {
+  _healthPeriod = period;
+}
+
+void OneUDriver::Tick() {
+  // pending rather than the transfer's status, which reads finished before the callback is done with it
+  if (_healthPeriod == 0 || _healthPending || millis() - _healthRead < _healthPeriod) {
     return;
   }
+
+  _healthRead = millis();
+  I2CEngine::Prepare(&_healthTransfer, ONEU_ADDR, ONEU_SENSOR_HEALTH, &_healthReading, 1, I2CEngine::Read,
+                     OnHealth, this);
+  _healthPending = I2CEngine::Submit(&_healthTransfer);
+}
+
+void OneUDriver::OnHealth(struct I2CTransfer *transfer) {
+  OneUDriver *driver = (OneUDriver *) transfer->context;
+  driver->_healthPending = false;
+  if (transfer->status == I2CStatus::Done) {
+    driver->_health = driver->_healthReading;
+    driver->_healthKnown = true;
+  }
 }
 
 bool OneUDriver::SensorHealthy(sensors_type_t type) {
-  uint8_t byte;
   int bit = bitFromType(type);
-  if (bit == -1) {
-    return false;
-  }
-  
-  if (!readAddress(0x01, 1, &byte, true)) {
+  if (bit == -1 || !_healthKnown) {
     return false;
   }
-  
-  return (byte & (1 << bit)) != 0;
+  return (_health & (1 << bit)) != 0;
 }
 
 bool OneUDriver::GetEventRaw(sensors_event_t *event, sensors_type_t type) {
@@ -172,77 +171,81 @@ bool OneUDriver::GetEventRaw(sensors_event_t *event, sensors_type_t type) {
   if (addr) {
     char *raw = (char *) event->data;
     
-    bool result = readAddress(addr, 12, raw);
-    
-    delay(1);  // next read returns garbage data unless a miniscule delay exists, TODO figure out why instead of using this hack
-    
-    return result;
+    return readAddress(addr, 12, raw);
   }
   return false;
 }
 
+bool OneUDriver::GetRawSnapshot(struct RawAttitudePayload *raw) {
+  // the three vectors are adjacent, magnetometer first, so one burst takes them all from the same update
+  return readAddress(addrFromType(SENSOR_TYPE_MAGNETIC_FIELD), sizeof(struct RawAttitudePayload), (char *) raw);
+}
+
+bool OneUDriver::BeginSnapshot() {
+  if (_snapshotPending) {
+    return false;
+  }
+
+  _snapshotLanded = false;
+  _snapshotTime = micros();
+  I2CEngine::Prepare(&_snapshotTransfer, ONEU_ADDR, addrFromType(SENSOR_TYPE_MAGNETIC_FIELD), (uint8_t *) &_snapshot,
+                     sizeof(_snapshot), I2CEngine::Read, OnSnapshot, this);
+  _snapshotPending = I2CEngine::Submit(&_snapshotTransfer);
+  return _snapshotPending;
+}
+
+void OneUDriver::OnSnapshot(struct I2CTransfer *transfer) {
+  OneUDriver *driver = (OneUDriver *) transfer->context;
+  driver->_snapshotTime = micros() - driver->_snapshotTime;
+  driver->_snapshotPending = false;
+  driver->_snapshotLanded = true;
+}
+
+bool OneUDriver::FinishSnapshot(struct RawAttitudePayload *raw) {
+  _snapshotLanded = false;
+  if (_snapshotTransfer.status != I2CStatus::Done) {
+    LOG_ERROR(F("OneUDriver failed to read "), sizeof(_snapshot), F(" bytes from address "),
+              LogHex(addrFromType(SENSOR_TYPE_MAGNETIC_FIELD)));
+    return false;
+  }
+  *raw = _snapshot;
+  return true;
+}
+
 bool OneUDriver::GetOrientationEulers(struct Vector *eulers) {
   uint8_t addr = 0xA4;  //! @todo Make this a constant
   char *raw = (char *) eulers;
   
-  bool result = readAddress(addr, 12, raw);
-  
-  delay(1);
-  
-  return result;
+  return readAddress(addr, 12, raw);
 }
 
 bool OneUDriver::GetOrientationQuaternion(struct Quaternion *quaternion) {
   uint8_t addr = 0xB0;  //! @todo Make this a constant
   char *raw = (char *) quaternion;
   
-  bool result = readAddress(addr, 16, raw);
-  
-  delay(1);
-  
-  return result;
+  return readAddress(addr, 16, raw);
 }
 
 // tell the 1U to start calibrating a sensor
 void OneUDriver::BeginCalibration(sensors_type_t type) {    
-  uint8_t byte;  
   int bit = bitFromType(type);
   if (bit == -1) {
     return;
   }
   
-  if (!_currCalibration) {
-    
-    if (!readAddress(0x11, 1, &byte, false)) {
-      return;
-    }
-    
-    byte |= (1 << bit);
-    
-    if (!writeAddress(0x11, 1, &byte, true)) {
-      return;
-    }
+  if (!_currCalibration && updateControl(ONEU_CALIBRATION, 1 << bit, 0)) {
     _currCalibration = type;
   }
 }
 
 // tell the 1U to stop calibrating a sensor
 void OneUDriver::EndCalibration() {
-  uint8_t byte;
   int bit = bitFromType(_currCalibration);
   if (bit == -1) {
     return;
   }
   
-  if (!readAddress(0x11, 1, &byte, false)) {
-    return;
+  if (updateControl(ONEU_CALIBRATION, 0, 1 << bit)) {
+    _currCalibration = (sensors_type_t) 0;
   }
-
-  byte &= ~(1 << bit);
-
-  if (!writeAddress(0x11, 1, &byte, true)) {
-    return;
-  }
-  
-  _currCalibration = 0;
-}
\ No newline at end of file
+}
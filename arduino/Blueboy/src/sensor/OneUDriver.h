@@ -10,22 +10,69 @@
 #include <Arduino.h>
 #include <Adafruit_Sensor.h>
 
+#include "I2CEngine.h"
 #include "SimpleCalibratedSensor.h"
 #include "../Blueboy.h"
 
 /*!
  * @class OneUDriver
  * @brief Driver for the mounted 1U test system
+ *
+ * Keeps shadows of the 1U's control registers, so changing one bit is a single write rather than a read, a
+ * write and the wait between, and keeps its sensor health from a read made in the background every so often.
+ * Its raw data can be read in the background too, so the loop carries on while the burst is on the bus.
  */
 class OneUDriver : public SimpleCalibratedSensor {
  public:
+  /*!
+   * @var unsigned long DefaultHealthPeriod
+   * Milliseconds between reads of the 1U's sensor health, until set otherwise
+   */
+  static constexpr unsigned long DefaultHealthPeriod = 1000;
+
   OneUDriver();
   
   bool Initialize() override;
   
   // Outputs a sensor event of the given event (ignored if this sensor only outputs one type)
   // Returns true iff the sensor was successfully read
-  bool GetEventRaw(sensors_event_t *event, sensors_type_t type = 0) override;
+  bool GetEventRaw(sensors_event_t *event, sensors_type_t type = (sensors_type_t) 0) override;
+  
+  /*!
+   * @brief Reads the 1U test system's magnetometer, accelerometer and gyroscope data in one burst
+   * @param raw Payload to fill, laid out as the 1U's data registers 0x80 to 0xA3 are
+   * @return True if the system successfully returned a reading
+   *
+   * One transaction instead of a GetEventRaw per sensor, so the vectors can't straddle one of the 1U's updates.
+   */
+  bool GetRawSnapshot(struct RawAttitudePayload *raw);
+
+  /*!
+   * @brief Starts reading a GetRawSnapshot burst on the I2CEngine in the background, to be taken by FinishSnapshot
+   * @return False if the last snapshot is still on the bus
+   *
+   * A landed snapshot not yet taken is dropped.
+   */
+  bool BeginSnapshot();
+
+  /*!
+   * @return True if the snapshot begun by BeginSnapshot is off the bus, whether or not it succeeded, and waits for
+   *         FinishSnapshot; landed snapshots are noticed in I2CEngine::Tick
+   */
+  bool SnapshotLanded() { return _snapshotLanded; }
+
+  /*!
+   * @brief Takes the snapshot begun by BeginSnapshot
+   * @param raw Payload to fill, as GetRawSnapshot would
+   * @return True if the system successfully returned a reading
+   * @pre SnapshotLanded()
+   */
+  bool FinishSnapshot(struct RawAttitudePayload *raw);
+
+  /*!
+   * @return Time in microseconds the last landed snapshot took from being started to landing
+   */
+  unsigned long SnapshotTime() { return _snapshotTime; }
   
   /*!
    * @brief Requests a reset of the 1U test system
@@ -33,11 +80,25 @@ class OneUDriver : public SimpleCalibratedSensor {
   void Reset();
   
   /*!
-   * @brief Checks the health of a sensor aboard the test system
+   * @brief Sets how often the sensor health is read
+   * @param period Milliseconds between reads, 0 to stop reading it
+   */
+  void SetHealthPeriod(unsigned long period);
+  
+  /*!
+   * @brief Reads the sensor health in the background once it's due
+   *
+   * Call once per loop, after I2CEngine::Tick. Reads are a health period apart whether or not the last one
+   * succeeded, so an absent 1U costs one NACK a period.
+   */
+  void Tick();
+  
+  /*!
+   * @brief Checks the health of a sensor aboard the test system, as of the last read, without touching the bus
    * @param type The type of sensor to check the health of
-   * @return True if the given sensor is healthy
+   * @return True if the given sensor is healthy; false if not, or no read of the health has landed yet
    */
-  bool OneUDriver::SensorHealthy(sensors_type_t type);
+  bool SensorHealthy(sensors_type_t type);
   
   /*!
    * @brief Takes a reading of the 1U test system's orientation in euler angles
@@ -58,6 +119,30 @@ class OneUDriver : public SimpleCalibratedSensor {
   
   // Ends the current calibration
   void EndCalibration() override;
+ private:
+  uint8_t _control[2];                  // shadows of the operation and calibration registers
+  bool _controlKnown;                   // false until the shadows are read, and again after a reset
+  uint8_t _health;                      // sensor health, a bit per sensor
+  uint8_t _healthReading;               // read into by _healthTransfer
+  bool _healthKnown;                    // false until a read of the health lands, and again after a reset
+  bool _healthPending;                  // true from submitting _healthTransfer until its callback has run
+  unsigned long _healthPeriod;
+  unsigned long _healthRead;            // millis() the last read of the health was submitted
+  struct I2CTransfer _healthTransfer;
+  struct RawAttitudePayload _snapshot;  // read into by _snapshotTransfer
+  bool _snapshotPending;                // true from submitting _snapshotTransfer until its callback has run
+  bool _snapshotLanded;                 // true from the snapshot landing until it's taken
+  unsigned long _snapshotTime;          // micros() the snapshot was started, then how long it took once landed
+  struct I2CTransfer _snapshotTransfer;
+
+  // sets then clears bits of a control register in one write, reading the shadows first if they aren't known
+  bool updateControl(uint8_t addr, uint8_t set, uint8_t clear);
+
+  // keeps the health a transfer read, if it succeeded
+  static void OnHealth(struct I2CTransfer *transfer);
+
+  // marks the snapshot landed
+  static void OnSnapshot(struct I2CTransfer *transfer);
 };
 
 #endif
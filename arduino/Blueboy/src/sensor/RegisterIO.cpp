@@ -0,0 +1,20 @@
+/*!
+ * @file RegisterIO.cpp
+ * @author Sebastian S.
+ * @brief Implementation of RegisterIO.h
+ */
+
+#include "I2CEngine.h"
+#include "RegisterIO.h"
+
+bool ReadRegisters(uint8_t addr, uint8_t reg, uint8_t *buf, uint8_t len) {
+  struct I2CTransfer transfer;
+  I2CEngine::Prepare(&transfer, addr, reg, buf, len, I2CEngine::Read);
+  return I2CEngine::Run(&transfer);
+}
+
+bool WriteRegister(uint8_t addr, uint8_t reg, uint8_t value) {
+  struct I2CTransfer transfer;
+  I2CEngine::Prepare(&transfer, addr, reg, &value, 1);
+  return I2CEngine::Run(&transfer);
+}
@@ -0,0 +1,35 @@
+/*!
+ * @file RegisterIO.h
+ * @author Sebastian S.
+ * @brief Direct register access to I2C sensors, for data the Adafruit drivers would convert to floats and for
+ *        features they don't cover.
+ */
+
+#ifndef REGISTER_IO_H_
+#define REGISTER_IO_H_
+
+#include <Arduino.h>
+
+/*!
+ * @brief Reads consecutive registers from an I2C device in one burst, using a repeated start, waiting on the
+ *        I2CEngine
+ * @param addr I2C address of the device
+ * @param reg Address of the first register to read
+ * @param buf Buffer to fill with the register contents
+ * @param len Number of registers to read, at least one
+ * @return True if every requested byte was read
+ *
+ * The device must auto-increment its register address over a burst read.
+ */
+bool ReadRegisters(uint8_t addr, uint8_t reg, uint8_t *buf, uint8_t len);
+
+/*!
+ * @brief Writes one register of an I2C device, waiting on the I2CEngine
+ * @param addr I2C address of the device
+ * @param reg Address of the register to write
+ * @param value Value to write
+ * @return True if the device acknowledged the write
+ */
+bool WriteRegister(uint8_t addr, uint8_t reg, uint8_t value);
+
+#endif
@@ -28,9 +28,9 @@ struct AxisLimits {
 class SimpleCalibratedSensor {
  public:
   /*!
-   * @brief Default constructor
+   * @brief Default constructor, starting with no calibration in progress
    */
-  SimpleCalibratedSensor() = default;
+  SimpleCalibratedSensor() : _currCalibration((sensors_type_t) 0) { }
   
   /*!
    * @brief Initializes the sensor
@@ -46,7 +46,7 @@ class SimpleCalibratedSensor {
    * @param type The type of data to read from this sensor, can be ignored by sensors with one type of reading
    * @return True if the sensor successfully returned a reading
    */
-  bool GetEvent(sensors_event_t *event, sensors_type_t type = 0);
+  bool GetEvent(sensors_event_t *event, sensors_type_t type = (sensors_type_t) 0);
   
   /*!
    * @brief Takes a raw reading from the sensor
@@ -56,7 +56,21 @@ class SimpleCalibratedSensor {
    *
    * Must be implemented by subclasses
    */
-  virtual bool GetEventRaw(sensors_event_t *event, sensors_type_t type = 0) = 0;
+  virtual bool GetEventRaw(sensors_event_t *event, sensors_type_t type = (sensors_type_t) 0) = 0;
+
+  /*!
+   * @brief Takes a raw reading from the sensor in its native counts, without conversion to SI units
+   * @param counts Array of three counts to fill in, x, y, z in the same axes as GetEventRaw
+   * @param type The type of data to read from this sensor, can be ignored by sensors with one type of reading
+   * @return True if the sensor successfully returned a reading, false if it has no count output
+   */
+  virtual bool GetCountsRaw(int16_t counts[3], sensors_type_t type = (sensors_type_t) 0) { return false; }
+
+  /*!
+   * @param type The type of reading to get the scale of, can be ignored by sensors with one type of reading
+   * @return SI units per count of the given reading type as configured, 0 if the sensor has no count output
+   */
+  virtual float CountsScale(sensors_type_t type = (sensors_type_t) 0) { return 0; }
   
   /*!
    * @brief Begins calibrating the sensor for the given type of reading
@@ -88,13 +102,13 @@ class SimpleCalibratedSensor {
    * @param offsets Pointer to an AxisOffsets to be filled in
    * @param type The type of reading to receive offsets from
    */
-  virtual void GetCalibration(struct AxisOffsets *offsets, sensors_type_t type = 0) { }
+  virtual void GetCalibration(struct AxisOffsets *offsets, sensors_type_t type = (sensors_type_t) 0) { }
   
   /*!
    * @brief Clears the currently stored offsets of the given reading type.
    * @param type The type of reading to receive offsets from
    */
-  virtual void ClearCalibration(sensors_type_t type = 0) { }
+  virtual void ClearCalibration(sensors_type_t type = (sensors_type_t) 0) { }
  protected:
   sensors_type_t _currCalibration;
   
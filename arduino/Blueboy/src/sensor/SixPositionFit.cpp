@@ -0,0 +1,139 @@
+/*!
+ * @file SixPositionFit.cpp
+ * @author Sebastian S.
+ * @brief Implementation of SixPositionFit.h
+ */
+
+#include <math.h>
+#include <Adafruit_Sensor.h>
+#include "SixPositionFit.h"
+
+/*!
+ * @var uint8_t TILT_PASSES
+ * Times the fit is refined by the tilt the last pass's bias and scale put on each position
+ */
+constexpr uint8_t TILT_PASSES = 4;
+
+void SixPositionFit::Reset() {
+  for (uint8_t p = 0; p < Positions; p++) {
+    for (uint8_t i = 0; i < 3; i++) {
+      _means[p][i] = 0;
+    }
+    _counts[p] = 0;
+  }
+  for (uint8_t i = 0; i < 3; i++) {
+    _last[i] = 0;
+  }
+  _still = 0;
+}
+
+void SixPositionFit::Add(const float sample[3]) {
+  float moved = 0, squares = 0;
+  uint8_t vertical = 0;
+  for (uint8_t i = 0; i < 3; i++) {
+    float step = sample[i] - _last[i];
+    moved += step * step;
+    squares += sample[i] * sample[i];
+    if (fabsf(sample[i]) > fabsf(sample[vertical])) {
+      vertical = i;
+    }
+    _last[i] = sample[i];
+  }
+
+  if (moved > StillLimit * StillLimit) {
+    _still = 0;
+    return;
+  }
+  if (_still < SettleRun) {
+    _still++;
+    return;
+  }
+  if (sample[vertical] * sample[vertical] < TiltLimit * TiltLimit * squares) {
+    return;
+  }
+
+  uint8_t p = 2 * vertical + (sample[vertical] < 0);
+  if (_counts[p] == 0xFFFF) {
+    return;   // the mean is as settled as it will get
+  }
+  _counts[p]++;
+  for (uint8_t i = 0; i < 3; i++) {
+    _means[p][i] += (sample[i] - _means[p][i]) / _counts[p];
+  }
+}
+
+uint8_t SixPositionFit::Captured() {
+  uint8_t captured = 0;
+  for (uint8_t p = 0; p < Positions; p++) {
+    if (_counts[p] >= MinPositionSamples) {
+      captured |= 1 << p;
+    }
+  }
+  return captured;
+}
+
+uint16_t SixPositionFit::Samples() {
+  uint32_t samples = 0;
+  for (uint8_t p = 0; p < Positions; p++) {
+    samples += _counts[p];
+  }
+  return min(samples, (uint32_t) 0xFFFF);
+}
+
+bool SixPositionFit::Solve(struct AxisOffsets *offsets, struct AxisCorrection *correction, float *residual) {
+  if (Captured() != (1 << Positions) - 1) {
+    return false;
+  }
+
+  // the vertical axis saw what the others leave of g: all of it while the sensor is taken to be square, then
+  // each pass corrects the others' means by the last pass's bias and scale to find their tilt
+  float bias[3] = { 0, 0, 0 }, scale[3] = { 1, 1, 1 };
+  for (uint8_t pass = 0; pass < TILT_PASSES; pass++) {
+    float seen[Positions];
+    for (uint8_t p = 0; p < Positions; p++) {
+      float gravity = SENSORS_GRAVITY_STANDARD * SENSORS_GRAVITY_STANDARD;
+      for (uint8_t i = 0; i < 3; i++) {
+        if (i != p / 2) {
+          float tilt = (_means[p][i] - bias[i]) / scale[i];
+          gravity -= tilt * tilt;
+        }
+      }
+      seen[p] = sqrtf(max(gravity, 0.0f));
+    }
+
+    // up reads scale * seen + bias, down -scale * seen + bias
+    for (uint8_t i = 0; i < 3; i++) {
+      float up = _means[2 * i][i], down = _means[2 * i + 1][i];
+      scale[i] = (up - down) / (seen[2 * i] + seen[2 * i + 1]);
+      bias[i] = up - scale[i] * seen[2 * i];
+    }
+  }
+
+  for (uint8_t i = 0; i < 3; i++) {
+    if (!(fabsf(scale[i] - 1) <= ScaleLimit)) {
+      return false;
+    }
+  }
+
+  // the fit leaves each position's own axis reading g; what's left shows in the magnitude
+  float squares = 0;
+  for (uint8_t p = 0; p < Positions; p++) {
+    float magnitude = 0;
+    for (uint8_t i = 0; i < 3; i++) {
+      float corrected = (_means[p][i] - bias[i]) / scale[i];
+      magnitude += corrected * corrected;
+    }
+    float off = sqrtf(magnitude) - SENSORS_GRAVITY_STANDARD;
+    squares += off * off;
+  }
+  *residual = sqrtf(squares / Positions);
+
+  offsets->xOff = bias[0];
+  offsets->yOff = bias[1];
+  offsets->zOff = bias[2];
+  CalibrationStorage::Identity(correction);
+  for (uint8_t i = 0; i < 3; i++) {
+    correction->m[i][i] = 1 / scale[i];
+  }
+  return true;
+}
@@ -0,0 +1,99 @@
+/*!
+ * @file SixPositionFit.h
+ * @author Sebastian S.
+ * @brief Declaration for SixPositionFit
+ */
+
+#ifndef SIX_POSITION_FIT_H_
+#define SIX_POSITION_FIT_H_
+
+#include <Arduino.h>
+#include "CalibrationStorage.h"
+
+/*!
+ * @class SixPositionFit
+ * @brief Accelerometer bias and scale from the still sensor's readings with each axis in turn pointing up and
+ *        down.
+ *
+ * Each still sample is sorted into one of six positions by the axis nearest vertical and which way it points, and
+ * folded into that position's running mean, so memory is constant however long each position is held. With an
+ * axis up it reads scale * g + bias, and down -scale * g + bias; the two means give both. The sensor needn't be
+ * set square: the other axes' means say how far it is tilted, and so how much of g the vertical axis really saw.
+ */
+class SixPositionFit {
+ public:
+  /*!
+   * @var uint8_t Positions
+   * Orientations sampled: x up, x down, y up, y down, z up, z down
+   */
+  static constexpr uint8_t Positions = 6;
+
+  /*!
+   * @var uint16_t MinPositionSamples
+   * Fewest samples in every position Solve will fit, half a second at the default output data rate
+   */
+  static constexpr uint16_t MinPositionSamples = 50;
+
+  /*!
+   * @var float StillLimit
+   * Furthest in m/s^2 a sample may be from the last for the sensor to count as still, about 0.05 g
+   */
+  static constexpr float StillLimit = 0.5f;
+
+  /*!
+   * @var uint8_t SettleRun
+   * Still samples in a row before any is taken, so one isn't taken while the sensor is set down
+   */
+  static constexpr uint8_t SettleRun = 16;
+
+  /*!
+   * @var float TiltLimit
+   * Least fraction of the reading on the axis nearest vertical for a sample to be taken, about 25 degrees off it
+   */
+  static constexpr float TiltLimit = 0.9f;
+
+  /*!
+   * @var float ScaleLimit
+   * Furthest a fitted scale may be from 1; the LSM6DS33 is within a few percent, so further means a bad fit
+   */
+  static constexpr float ScaleLimit = 0.1f;
+
+  SixPositionFit() { Reset(); }
+
+  /*!
+   * @brief Discards every sample taken
+   */
+  void Reset();
+
+  /*!
+   * @param sample Reading to take in m/s^2, x, y, z; ignored unless the sensor is still and near a position
+   */
+  void Add(const float sample[3]);
+
+  /*!
+   * @return Positions with MinPositionSamples taken, a bit each from bit 0, x up, to bit 5, z down
+   */
+  uint8_t Captured();
+
+  /*!
+   * @return Samples taken into every position's mean since the last Reset, at most the most a uint16_t counts
+   */
+  uint16_t Samples();
+
+  /*!
+   * @brief Fits bias and scale to the positions' means
+   * @param offsets Filled with the bias, in m/s^2
+   * @param correction Filled with the matrix that maps a sample, less offsets, onto the acceleration, the inverse
+   *        scale on its diagonal
+   * @param residual Filled with the RMS difference in m/s^2 between g and the positions' corrected means
+   * @return False, filling nothing, if a position has too few samples or the fit is implausible
+   */
+  bool Solve(struct AxisOffsets *offsets, struct AxisCorrection *correction, float *residual);
+ private:
+  float _means[Positions][3];     // running mean of each position's samples, x, y, z
+  uint16_t _counts[Positions];    // samples taken into each position's mean
+  float _last[3];                 // last sample offered, to tell if the sensor is still
+  uint8_t _still;                 // samples in a row within StillLimit of the last
+};
+
+#endif
@@ -0,0 +1,108 @@
+/*!
+ * @file TemperatureBias.cpp
+ * @author Sebastian S.
+ * @brief Implementation of TemperatureBias.h
+ */
+
+#include "TemperatureBias.h"
+
+/*!
+ * @brief Reads one axis of the line through two measurements at a temperature
+ * @param a Measurement the line starts from
+ * @param b Measurement the line goes to, at a higher temperature than a unless the same one
+ * @param temperature Temperature to read at, between them or beyond either
+ * @param axis Axis to read
+ * @return The bias on the line, held to what an int16_t takes
+ */
+static int16_t interpolate(const struct TemperaturePoint& a, const struct TemperaturePoint& b, int16_t temperature,
+                           uint8_t axis) {
+  if (&a == &b) {
+    return a.offsets[axis];
+  }
+  int32_t bias = a.offsets[axis] + ((int32_t) b.offsets[axis] - a.offsets[axis]) * (temperature - a.temperature) /
+                                   (b.temperature - a.temperature);
+  return constrain(bias, -32767L, 32767L);
+}
+
+uint8_t TemperatureBias::Slot(int16_t temperature) {
+  int32_t along = (int32_t) temperature - First + (1 << (StepShift - 1));   // rounded to the nearest grid point
+  if (along < 0) {
+    return 0;
+  }
+  return min(along >> StepShift, (int32_t) TEMPERATURE_POINTS - 1);
+}
+
+void TemperatureBias::Record(struct TemperatureTable *table, int16_t temperature, const int16_t bias[3]) {
+  struct TemperaturePoint *point = &table->points[Slot(temperature)];
+  point->temperature = temperature;
+  for (uint8_t i = 0; i < 3; i++) {
+    point->offsets[i] = bias[i];
+  }
+}
+
+bool TemperatureBias::Build(const struct TemperatureTable& table) {
+  // a slot's measurements are all nearer its grid point than the next slot's, so the slots are in order of
+  // temperature
+  uint8_t first = TEMPERATURE_POINTS, last = 0;
+  for (uint8_t p = 0; p < TEMPERATURE_POINTS; p++) {
+    if (table.points[p].temperature != TEMPERATURE_UNSET) {
+      first = min(first, p);
+      last = p;
+    }
+  }
+  if (first == TEMPERATURE_POINTS) {
+    return false;
+  }
+
+  const struct TemperaturePoint& low = table.points[first];
+  const struct TemperaturePoint& high = table.points[last];
+  bool trend = high.temperature - low.temperature >= (1 << StepShift);
+
+  for (uint8_t g = 0; g < TEMPERATURE_POINTS; g++) {
+    int16_t temperature = First + (g << StepShift);
+    const struct TemperaturePoint *a = &low;
+    const struct TemperaturePoint *b = trend ? &high : &low;
+    if (temperature >= high.temperature) {
+      a = trend ? &low : &high;
+      b = &high;
+    } else if (temperature > low.temperature) {
+      // between two measurements, the line through them
+      for (uint8_t p = first + 1; p <= last; p++) {
+        if (table.points[p].temperature == TEMPERATURE_UNSET) {
+          continue;
+        }
+        b = &table.points[p];
+        if (b->temperature >= temperature) {
+          break;
+        }
+        a = b;
+      }
+    }
+    for (uint8_t i = 0; i < 3; i++) {
+      _grid[g][i] = interpolate(*a, *b, temperature, i);
+    }
+  }
+  return true;
+}
+
+void TemperatureBias::Constant(const int16_t bias[3]) {
+  for (uint8_t g = 0; g < TEMPERATURE_POINTS; g++) {
+    for (uint8_t i = 0; i < 3; i++) {
+      _grid[g][i] = bias[i];
+    }
+  }
+}
+
+void TemperatureBias::At(int16_t temperature, int16_t bias[3]) const {
+  int16_t along = constrain(temperature - First, 0, (TEMPERATURE_POINTS - 1) << StepShift);
+  uint8_t g = along >> StepShift;
+  uint8_t fraction = along & ((1 << StepShift) - 1);
+  if (g == TEMPERATURE_POINTS - 1) {
+    // the last grid point itself, as the end of the segment before it
+    g--;
+    fraction = 1 << StepShift;
+  }
+  for (uint8_t i = 0; i < 3; i++) {
+    bias[i] = _grid[g][i] + (int16_t) ((((int32_t) _grid[g + 1][i] - _grid[g][i]) * fraction) >> StepShift);
+  }
+}
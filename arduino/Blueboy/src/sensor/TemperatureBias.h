@@ -0,0 +1,88 @@
+/*!
+ * @file TemperatureBias.h
+ * @author Sebastian S.
+ * @brief Declaration for TemperatureBias
+ */
+
+#ifndef TEMPERATURE_BIAS_H_
+#define TEMPERATURE_BIAS_H_
+
+#include <Arduino.h>
+#include "CalibrationStorage.h"
+
+/*!
+ * @class TemperatureBias
+ * @brief A three-axis sensor's bias as a function of its temperature, in fixed point, from the biases measured
+ *        across a TemperatureTable.
+ *
+ * Temperatures are in the LSM6DS33's own counts, 1/16 degree from 25 C, and biases in the sensor's counts times
+ * 2^FractionBits. The measurements are interpolated, and extrapolated along the trend across them all, onto a
+ * grid every 2^StepShift counts from First, one grid point per table slot; a measurement is kept in the slot of
+ * the grid point nearest it. Reading the bias at a temperature is then a shift, a mask and a multiply per axis,
+ * cheap enough for every sample.
+ */
+class TemperatureBias {
+ public:
+  /*!
+   * @var int16_t First
+   * Temperature of the first grid point, 12 C
+   */
+  static constexpr int16_t First = (12 - 25) * 16;
+
+  /*!
+   * @var uint8_t StepShift
+   * Grid spacing as a power of two, 64 counts or 4 C, so the grid spans 12 C to 40 C
+   */
+  static constexpr uint8_t StepShift = 6;
+
+  /*!
+   * @var uint8_t FractionBits
+   * Fractional bits of a bias in sensor counts; a bias of 511 counts still fits an int16_t
+   */
+  static constexpr uint8_t FractionBits = 6;
+
+  TemperatureBias() {
+    const int16_t none[3] = { 0, 0, 0 };
+    Constant(none);
+  }
+
+  /*!
+   * @param temperature Temperature to find the slot of
+   * @return Slot of the grid point nearest the temperature, the first or last beyond the grid
+   */
+  static uint8_t Slot(int16_t temperature);
+
+  /*!
+   * @brief Keeps a measurement in its slot of a table, replacing any measured there before
+   * @param table Table to record into
+   * @param temperature Temperature measured at
+   * @param bias Bias measured, x, y, z
+   */
+  static void Record(struct TemperatureTable *table, int16_t temperature, const int16_t bias[3]);
+
+  /*!
+   * @brief Fits the grid to a table's measurements
+   * @param table Measurements to fit
+   * @return False, leaving the grid as it was, if nothing was measured
+   *
+   * A single measurement is taken to hold at every temperature. Beyond the measurements the bias follows the
+   * trend from the first to the last, unless they are less than a grid step apart to show one, when it stays at
+   * the nearest.
+   */
+  bool Build(const struct TemperatureTable& table);
+
+  /*!
+   * @param bias Bias to take at every temperature, x, y, z
+   */
+  void Constant(const int16_t bias[3]);
+
+  /*!
+   * @param temperature Temperature to read the bias at, held to the grid's ends beyond them
+   * @param bias Filled with the bias, x, y, z
+   */
+  void At(int16_t temperature, int16_t bias[3]) const;
+ private:
+  int16_t _grid[TEMPERATURE_POINTS][3];   // bias at each grid point, x, y, z
+};
+
+#endif
@@ -0,0 +1,103 @@
+/*!
+ * @file FastTrig.cpp
+ * @author Sebastian S.
+ * @brief Implementation of FastTrig.h
+ */
+
+#include <Arduino.h>
+#include <math.h>
+#include <avr/pgmspace.h>
+#include "FastTrig.h"
+
+/*!
+ * @var uint8_t TABLE_STEPS
+ * Intervals each table divides its range into
+ */
+constexpr uint8_t TABLE_STEPS = 64;
+
+// round(atan(i / 64.0) * 65536): atan over 0 to 1, in 1/65536 radians
+static const uint16_t ATAN_TABLE[TABLE_STEPS + 1] PROGMEM = {
+      0,  1024,  2047,  3070,  4091,  5110,  6126,  7140,  8150,  9156,
+  10158, 11155, 12147, 13133, 14114, 15088, 16055, 17015, 17968, 18913,
+  19850, 20779, 21699, 22610, 23512, 24406, 25289, 26163, 27028, 27882,
+  28727, 29561, 30386, 31200, 32003, 32797, 33580, 34353, 35115, 35867,
+  36608, 37340, 38060, 38771, 39472, 40162, 40842, 41512, 42172, 42823,
+  43464, 44095, 44716, 45328, 45931, 46525, 47109, 47685, 48251, 48809,
+  49359, 49899, 50432, 50956, 51472
+};
+
+// round(sin(i / 64.0 * pi / 2) * 65535): a quarter wave of sine, full scale 65535
+static const uint16_t SIN_TABLE[TABLE_STEPS + 1] PROGMEM = {
+      0,  1608,  3216,  4821,  6424,  8022,  9616, 11204, 12785, 14359,
+  15924, 17479, 19024, 20557, 22078, 23586, 25079, 26557, 28020, 29465,
+  30893, 32302, 33692, 35061, 36409, 37736, 39039, 40319, 41575, 42806,
+  44011, 45189, 46340, 47464, 48558, 49624, 50659, 51664, 52638, 53580,
+  54490, 55367, 56211, 57021, 57797, 58537, 59243, 59913, 60546, 61144,
+  61704, 62227, 62713, 63161, 63571, 63943, 64276, 64570, 64826, 65042,
+  65219, 65357, 65456, 65515, 65535
+};
+
+/*!
+ * @brief Interpolates linearly between a table's points
+ * @param table Table in flash, TABLE_STEPS + 1 points, increasing
+ * @param t Where to read it, 0 to 1 across the table
+ * @return Value at t, in the table's units
+ */
+static float lookup(const uint16_t *table, float t) {
+  float position = t * TABLE_STEPS;
+  uint8_t i = (uint8_t)position;
+  if (i >= TABLE_STEPS) {
+    return pgm_read_word(&table[TABLE_STEPS]);
+  }
+
+  uint16_t below = pgm_read_word(&table[i]);
+  uint16_t above = pgm_read_word(&table[i + 1]);
+  return below + (above - below) * (position - i);
+}
+
+/*!
+ * @param quarters Angle in quarter turns
+ * @return Sine of the angle
+ */
+static float quarterWave(float quarters) {
+  long whole = (long)quarters;
+  if (quarters < whole) {
+    whole--;    // truncation rounds negative angles up; the table wants the quarter below
+  }
+  float part = quarters - whole;
+
+  // the table covers the first quarter; the second reads it backwards, the last two are the first two negated
+  float sine = lookup(SIN_TABLE, (whole & 1) ? 1 - part : part) * (1.0f / 65535);
+  return (whole & 2) ? -sine : sine;
+}
+
+float FastAtan2(float y, float x) {
+  float ax = fabsf(x), ay = fabsf(y);
+  if (ax == 0 && ay == 0) {
+    return 0;
+  }
+
+  // fold into the first octant, where the table is, then unfold
+  bool steep = ay > ax;
+  float angle = lookup(ATAN_TABLE, steep ? ax / ay : ay / ax) * (1.0f / 65536);
+  if (steep) {
+    angle = (float)HALF_PI - angle;
+  }
+  if (x < 0) {
+    angle = (float)PI - angle;
+  }
+  return y < 0 ? -angle : angle;
+}
+
+float FastAsin(float x) {
+  x = constrain(x, -1.0f, 1.0f);
+  return FastAtan2(x, sqrtf(1 - x * x));
+}
+
+float FastSin(float angle) {
+  return quarterWave(angle * (float)(2 / PI));
+}
+
+float FastCos(float angle) {
+  return quarterWave(angle * (float)(2 / PI) + 1);
+}
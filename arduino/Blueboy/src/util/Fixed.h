@@ -0,0 +1,381 @@
+/*!
+ * @file Fixed.h
+ * @author Sebastian S.
+ * @brief Declaration and implementation of the Fixed, FixedVector and FixedQuaternion templates
+ *
+ * Q-format fixed-point arithmetic for the ATmega, which has no FPU: every float operation is a library call of
+ * a few hundred cycles, where these are a handful of integer multiplies. Q15 holds values in [-1, 1), for unit
+ * vectors and quaternions; Q16_16 holds [-32768, 32768) to 1/65536, for sensor data in SI units.
+ *
+ * Results outside a format's range saturate rather than wrap. Products are rounded to nearest. Q15 vectors and
+ * quaternions are taken to be no longer than 1, which keeps every intermediate within 32 bits.
+ */
+
+#ifndef FIXED_H_
+#define FIXED_H_
+
+#include <stdint.h>
+#include "../Blueboy.h"
+
+/*!
+ * @struct FixedTraits
+ * @brief The types a Fixed of the given raw type computes in: Wide holds a product of two raw values, UWide a
+ *        sum of squares of three
+ */
+template <class Raw>
+struct FixedTraits;
+
+template <>
+struct FixedTraits<int16_t> {
+  typedef int32_t Wide;
+  typedef uint32_t UWide;
+  static constexpr int16_t Min = -32767 - 1;
+  static constexpr int16_t Max = 32767;
+};
+
+template <>
+struct FixedTraits<int32_t> {
+  typedef int64_t Wide;
+  typedef uint64_t UWide;
+  static constexpr int32_t Min = -2147483647L - 1;
+  static constexpr int32_t Max = 2147483647L;
+};
+
+/*!
+ * @return Zero bits above the highest set bit of v, which mustn't be 0
+ */
+inline uint8_t FixedLeadingZeros(uint32_t v) {
+  return __builtin_clzl((unsigned long) v) - (sizeof(unsigned long) - sizeof(uint32_t)) * 8;
+}
+
+inline uint8_t FixedLeadingZeros(uint64_t v) {
+  return __builtin_clzll((unsigned long long) v) - (sizeof(unsigned long long) - sizeof(uint64_t)) * 8;
+}
+
+/*!
+ * @brief Fast inverse square root, 1/sqrt(v / 2^frac) as (m / 2^15) / 2^(shift - 15)
+ * @param v Value to take the inverse square root of, greater than 0
+ * @param frac Fractional bits of v
+ * @param shift Set to the right shift that, applied to x * m, gives x / sqrt(v / 2^frac) in x's format
+ * @return The mantissa m, in (2^15, 2^16)
+ *
+ * v is scaled by a power of four into [1/4, 1), a chord of 1/sqrt over each half of that range guesses its
+ * inverse square root to within 5%, and three Newton steps take that to the 16-bit mantissa's resolution, in
+ * 16 by 16 bit multiplies the AVR does in hardware.
+ */
+template <class U>
+uint16_t FixedInvSqrt(U v, uint8_t frac, int8_t *shift) {
+  // a = m / 2^30 in [1/4, 1), with v / 2^frac = a * 2^e for an even e
+  int8_t k = 30 - (int8_t) (sizeof(U) * 8 - FixedLeadingZeros(v));
+  if ((k + frac) & 1) {
+    k--;
+  }
+  uint32_t m = k >= 0 ? (uint32_t) (v << k) : (uint32_t) (v >> -k);
+  int8_t e = 30 - k - frac;
+
+  // Q2.30 guess, on the chord through (1/4, 2) and (1/2, sqrt 2), or through (1/2, sqrt 2) and (1, 1)
+  uint16_t a = m >> 14;   // Q0.16
+  uint32_t y;
+  if (a < 0x8000) {
+    y = 0x7FFFFFFFUL - (uint32_t) 38390 * (a - 0x4000);             // 2 - 2.34315 (a - 1/4)
+  } else {
+    y = 1518500250UL - (uint32_t) 13573 * (a - 0x8000);             // sqrt 2 - 0.82843 (a - 1/2)
+  }
+
+  for (uint8_t i = 0; i < 3; i++) {
+    // y += y (1 - a y^2) / 2
+    uint16_t y15 = y >= 0x7FFF8000UL ? 0xFFFF : (uint16_t) (y >> 15);
+    uint32_t ay2 = (uint32_t) a * (((uint32_t) y15 * y15) >> 16);   // Q0.16 by Q4.14
+    int32_t error = (int32_t) ((1UL << 30) - ay2);
+    y += ((int32_t) y15 * (error >> 15)) >> 1;
+  }
+
+  *shift = 15 + e / 2;
+  return y >= 0x7FFF8000UL ? 0xFFFF : (uint16_t) (y >> 15);
+}
+
+/*!
+ * @class Fixed
+ * @brief A signed fixed-point number of raw type R with F fractional bits.
+ */
+template <uint8_t F, class R>
+class Fixed {
+ public:
+  typedef R Raw;
+  typedef typename FixedTraits<R>::Wide Wide;
+  typedef typename FixedTraits<R>::UWide UWide;
+
+  /*!
+   * @var uint8_t FracBits
+   * Bits of the raw value below the binary point
+   */
+  static constexpr uint8_t FracBits = F;
+
+  Raw raw;  //!< the value times 2^F
+
+  /*!
+   * @return The Fixed with the given raw value
+   */
+  static Fixed FromRaw(Raw raw) {
+    Fixed value;
+    value.raw = raw;
+    return value;
+  }
+
+  /*!
+   * @return The Fixed nearest a wide raw value, saturated to the format's range
+   */
+  static Fixed FromWide(Wide wide) {
+    if (wide > FixedTraits<R>::Max) {
+      wide = FixedTraits<R>::Max;
+    } else if (wide < FixedTraits<R>::Min) {
+      wide = FixedTraits<R>::Min;
+    }
+    return FromRaw((Raw) wide);
+  }
+
+  /*!
+   * @return The Fixed nearest a float, saturated to the format's range
+   */
+  static Fixed FromFloat(float value) {
+    float scaled = value * (float) ((Wide) 1 << F);
+    if (scaled >= (float) FixedTraits<R>::Max) {
+      return FromRaw(FixedTraits<R>::Max);
+    } else if (scaled <= (float) FixedTraits<R>::Min) {
+      return FromRaw(FixedTraits<R>::Min);
+    }
+    return FromRaw((Raw) (scaled + (scaled >= 0 ? 0.5f : -0.5f)));
+  }
+
+  /*!
+   * @return The value as a float
+   */
+  float ToFloat() const { return raw * (1.0f / (float) ((Wide) 1 << F)); }
+
+  /*!
+   * @return A wide raw value shifted right, rounded to nearest
+   */
+  static Wide RoundShift(Wide wide, uint8_t shift) {
+    return (wide + ((Wide) 1 << (shift - 1))) >> shift;
+  }
+
+  Fixed operator+(Fixed other) const { return FromWide((Wide) raw + other.raw); }
+  Fixed operator-(Fixed other) const { return FromWide((Wide) raw - other.raw); }
+  Fixed operator-() const { return FromWide(-(Wide) raw); }
+  Fixed operator*(Fixed other) const { return FromWide(RoundShift((Wide) raw * other.raw, F)); }
+
+  bool operator==(Fixed other) const { return raw == other.raw; }
+  bool operator!=(Fixed other) const { return raw != other.raw; }
+  bool operator<(Fixed other) const { return raw < other.raw; }
+  bool operator>(Fixed other) const { return raw > other.raw; }
+};
+
+/*!
+ * @var Q15
+ * Fixed-point in [-1, 1) to 1/32768, in 16 bits
+ */
+typedef Fixed<15, int16_t> Q15;
+
+/*!
+ * @var Q16_16
+ * Fixed-point in [-32768, 32768) to 1/65536, in 32 bits
+ */
+typedef Fixed<16, int32_t> Q16_16;
+
+/*!
+ * @struct FixedVector
+ * @brief A 3D vector of Fixed T, interpretable as x, y, z.
+ */
+template <class T>
+struct FixedVector {
+  typedef typename T::Wide Wide;
+
+  T x;
+  T y;
+  T z;
+
+  /*!
+   * @return The vector nearest a float Vector's x, y, z
+   */
+  static FixedVector FromVector(const struct Vector& v) {
+    FixedVector fixed = { T::FromFloat(v.x), T::FromFloat(v.y), T::FromFloat(v.z) };
+    return fixed;
+  }
+
+  /*!
+   * @param v Vector whose x, y, z to set to this one
+   */
+  void ToVector(struct Vector *v) const {
+    v->x = x.ToFloat();
+    v->y = y.ToFloat();
+    v->z = z.ToFloat();
+  }
+
+  FixedVector operator+(const FixedVector& o) const {
+    FixedVector sum = { x + o.x, y + o.y, z + o.z };
+    return sum;
+  }
+
+  FixedVector operator-(const FixedVector& o) const {
+    FixedVector difference = { x - o.x, y - o.y, z - o.z };
+    return difference;
+  }
+
+  FixedVector operator*(T scale) const {
+    FixedVector scaled = { x * scale, y * scale, z * scale };
+    return scaled;
+  }
+
+  /*!
+   * @return The dot product with another vector, summed at full precision and rounded once
+   */
+  T Dot(const FixedVector& o) const {
+    Wide sum = (Wide) x.raw * o.x.raw + (Wide) y.raw * o.y.raw + (Wide) z.raw * o.z.raw;
+    return T::FromWide(T::RoundShift(sum, T::FracBits));
+  }
+
+  /*!
+   * @return The cross product with another vector, this one first
+   */
+  FixedVector Cross(const FixedVector& o) const {
+    FixedVector cross = {
+      T::FromWide(T::RoundShift((Wide) y.raw * o.z.raw - (Wide) z.raw * o.y.raw, T::FracBits)),
+      T::FromWide(T::RoundShift((Wide) z.raw * o.x.raw - (Wide) x.raw * o.z.raw, T::FracBits)),
+      T::FromWide(T::RoundShift((Wide) x.raw * o.y.raw - (Wide) y.raw * o.x.raw, T::FracBits))
+    };
+    return cross;
+  }
+
+  /*!
+   * @brief Scales the vector to unit length
+   * @return False if it's zero, and left as it was
+   */
+  bool Normalize() {
+    typedef typename T::UWide UWide;
+    UWide squares = (UWide) ((Wide) x.raw * x.raw) + (UWide) ((Wide) y.raw * y.raw) +
+                    (UWide) ((Wide) z.raw * z.raw);
+    if (squares == 0) {
+      return false;
+    }
+
+    int8_t shift;
+    uint16_t scale = FixedInvSqrt(squares, 2 * T::FracBits, &shift);
+    x = scaleRaw(x, scale, shift);
+    y = scaleRaw(y, scale, shift);
+    z = scaleRaw(z, scale, shift);
+    return true;
+  }
+
+  // multiplies a component by an inverse square root from FixedInvSqrt
+  static T scaleRaw(T value, uint16_t scale, int8_t shift) {
+    Wide product = (Wide) value.raw * scale;
+    if (shift <= 0) {
+      return T::FromWide(product << -shift);
+    }
+    return T::FromWide(T::RoundShift(product, shift));
+  }
+};
+
+/*!
+ * @struct FixedQuaternion
+ * @brief A quaternion of Fixed T, interpretable as w, x, y, z.
+ */
+template <class T>
+struct FixedQuaternion {
+  typedef typename T::Wide Wide;
+
+  T w;
+  T x;
+  T y;
+  T z;
+
+  /*!
+   * @return The quaternion nearest a float Quaternion
+   */
+  static FixedQuaternion FromQuaternion(const struct Quaternion& q) {
+    FixedQuaternion fixed = { T::FromFloat(q.w), T::FromFloat(q.x), T::FromFloat(q.y), T::FromFloat(q.z) };
+    return fixed;
+  }
+
+  /*!
+   * @param q Quaternion to set to this one
+   */
+  void ToQuaternion(struct Quaternion *q) const {
+    q->w = w.ToFloat();
+    q->x = x.ToFloat();
+    q->y = y.ToFloat();
+    q->z = z.ToFloat();
+  }
+
+  /*!
+   * @return The conjugate, the inverse of a unit quaternion
+   */
+  FixedQuaternion Conjugate() const {
+    FixedQuaternion conjugate = { w, -x, -y, -z };
+    return conjugate;
+  }
+
+  /*!
+   * @return The Hamilton product, this quaternion's rotation following the other's
+   */
+  FixedQuaternion operator*(const FixedQuaternion& o) const {
+    FixedQuaternion product = {
+      narrow((Wide) w.raw * o.w.raw - (Wide) x.raw * o.x.raw - (Wide) y.raw * o.y.raw - (Wide) z.raw * o.z.raw),
+      narrow((Wide) w.raw * o.x.raw + (Wide) x.raw * o.w.raw + (Wide) y.raw * o.z.raw - (Wide) z.raw * o.y.raw),
+      narrow((Wide) w.raw * o.y.raw - (Wide) x.raw * o.z.raw + (Wide) y.raw * o.w.raw + (Wide) z.raw * o.x.raw),
+      narrow((Wide) w.raw * o.z.raw + (Wide) x.raw * o.y.raw - (Wide) y.raw * o.x.raw + (Wide) z.raw * o.w.raw)
+    };
+    return product;
+  }
+
+  /*!
+   * @brief Scales the quaternion to unit length
+   * @return False if it's zero, and left as it was
+   */
+  bool Normalize() {
+    typedef typename T::UWide UWide;
+    UWide squares = (UWide) ((Wide) w.raw * w.raw) + (UWide) ((Wide) x.raw * x.raw) +
+                    (UWide) ((Wide) y.raw * y.raw) + (UWide) ((Wide) z.raw * z.raw);
+    if (squares == 0) {
+      return false;
+    }
+
+    int8_t shift;
+    uint16_t scale = FixedInvSqrt(squares, 2 * T::FracBits, &shift);
+    w = FixedVector<T>::scaleRaw(w, scale, shift);
+    x = FixedVector<T>::scaleRaw(x, scale, shift);
+    y = FixedVector<T>::scaleRaw(y, scale, shift);
+    z = FixedVector<T>::scaleRaw(z, scale, shift);
+    return true;
+  }
+
+  /*!
+   * @brief Rotates a vector by this unit quaternion, q v q*
+   * @param v Vector to rotate
+   * @return The rotated vector
+   *
+   * Goes through the rotation matrix, whose entries are no larger than 1, rather than two Hamilton products,
+   * whose intermediates can reach twice the vector's length.
+   */
+  FixedVector<T> Rotate(const FixedVector<T>& v) const {
+    const uint8_t f = T::FracBits;
+    Wide one = (Wide) 1 << f;
+    Wide xx = T::RoundShift((Wide) x.raw * x.raw, f), yy = T::RoundShift((Wide) y.raw * y.raw, f);
+    Wide zz = T::RoundShift((Wide) z.raw * z.raw, f), xy = T::RoundShift((Wide) x.raw * y.raw, f);
+    Wide xz = T::RoundShift((Wide) x.raw * z.raw, f), yz = T::RoundShift((Wide) y.raw * z.raw, f);
+    Wide wx = T::RoundShift((Wide) w.raw * x.raw, f), wy = T::RoundShift((Wide) w.raw * y.raw, f);
+    Wide wz = T::RoundShift((Wide) w.raw * z.raw, f);
+
+    FixedVector<T> rotated = {
+      narrow((one - 2 * (yy + zz)) * v.x.raw + 2 * (xy - wz) * v.y.raw + 2 * (xz + wy) * v.z.raw),
+      narrow(2 * (xy + wz) * v.x.raw + (one - 2 * (xx + zz)) * v.y.raw + 2 * (yz - wx) * v.z.raw),
+      narrow(2 * (xz - wy) * v.x.raw + 2 * (yz + wx) * v.y.raw + (one - 2 * (xx + yy)) * v.z.raw)
+    };
+    return rotated;
+  }
+
+  // a sum of products of raw values, back to T
+  static T narrow(Wide sum) { return T::FromWide(T::RoundShift(sum, T::FracBits)); }
+};
+
+#endif
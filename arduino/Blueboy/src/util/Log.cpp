@@ -0,0 +1,55 @@
+/*!
+ * @file Log.cpp
+ * @author Sebastian S.
+ * @brief Implementation of Log.h
+ */
+
+#include "Log.h"
+
+LogBuffer& Log() {
+  static LogBuffer log;
+  return log;
+}
+
+size_t LogBuffer::write(uint8_t byte) {
+  uint16_t next = (_head + 1) & Mask;
+  if (next == _tail) {
+    // full, and the console can only catch up once the loop drains it
+    _overflowed = true;
+    return 0;
+  }
+  _buf[_head] = byte;
+  _head = next;
+  return 1;
+}
+
+void LogBuffer::Begin(unsigned long baud) {
+  // double speed, as the core does, for a divisor nearer the rate
+  UCSR0A = _BV(U2X0);
+  UBRR0 = (F_CPU / 4 / baud - 1) / 2;
+  UCSR0C = _BV(UCSZ01) | _BV(UCSZ00);
+  UCSR0B = _BV(TXEN0);
+}
+
+void LogBuffer::Drain() {
+  while (_tail != _head && (UCSR0A & _BV(UDRE0))) {
+    UDR0 = _buf[_tail];
+    _tail = (_tail + 1) & Mask;
+  }
+
+  if (_droppedLines > 0 && _tail == _head) {
+    uint16_t dropped = _droppedLines;
+    _droppedLines = 0;
+    Line('W', F("Log dropped "), dropped, F(" lines"));
+  }
+}
+
+void LogBuffer::Flush() {
+  while (_tail != _head) {
+    while (!(UCSR0A & _BV(UDRE0))) {
+      yield();
+    }
+    UDR0 = _buf[_tail];
+    _tail = (_tail + 1) & Mask;
+  }
+}
@@ -0,0 +1,171 @@
+/*!
+ * @file Log.h
+ * @author Sebastian S.
+ * @brief Declaration for LogBuffer and the leveled logging macros.
+ *
+ * Log lines are formatted into a RAM ring buffer and drained to the console only as fast as its USART takes them,
+ * so logging never blocks the loop. A line that doesn't fit is dropped whole and counted. The log drives USART0
+ * itself rather than through the core's Serial, whose buffers would take another 128 bytes of RAM.
+ *
+ * LOG_LEVEL selects which macros compile to anything; the rest expand to nothing, arguments included. It
+ * defaults to LOG_LEVEL_INFO; release builds should define it as LOG_LEVEL_NONE (e.g. arduino-cli
+ * --build-property "build.extra_flags=-DLOG_LEVEL=0"), which also shrinks the buffer away.
+ */
+
+#ifndef LOG_H_
+#define LOG_H_
+
+#include <Arduino.h>
+
+#define LOG_LEVEL_NONE    0
+#define LOG_LEVEL_ERROR   1   // a peripheral or the link failed
+#define LOG_LEVEL_WARN    2   // something unexpected that was recovered from
+#define LOG_LEVEL_INFO    3   // state changes and messages sent over telemetry
+#define LOG_LEVEL_DEBUG   4   // every command received
+#define LOG_LEVEL_TRACE   5   // every byte and sample, far more than the console can carry
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) Log().Line('E', __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void) 0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(...) Log().Line('W', __VA_ARGS__)
+#else
+#define LOG_WARN(...) ((void) 0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) Log().Line('I', __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void) 0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) Log().Line('D', __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void) 0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_TRACE
+#define LOG_TRACE(...) Log().Line('T', __VA_ARGS__)
+#else
+#define LOG_TRACE(...) ((void) 0)
+#endif
+
+/*!
+ * @struct LogHex
+ * @brief Logs a number in hexadecimal.
+ */
+struct LogHex {
+  unsigned long value;
+  LogHex(unsigned long value) : value(value) { }
+};
+
+/*!
+ * @struct LogFloat
+ * @brief Logs a number with the given digits after the decimal point, rather than the default 2.
+ */
+struct LogFloat {
+  double value;
+  int digits;
+  LogFloat(double value, int digits) : value(value), digits(digits) { }
+};
+
+/*!
+ * @class LogBuffer
+ * @brief Ring buffer of formatted log lines, drained to a serial port without blocking.
+ *
+ * Not safe to log to from interrupts.
+ */
+class LogBuffer : public Print {
+ public:
+  /*!
+   * @var uint16_t LogBuffer::Size
+   * Bytes of buffered log text, a power of two. The console's 9600 baud drains it in about 130 ms.
+   */
+  static constexpr uint16_t Size = LOG_LEVEL > LOG_LEVEL_NONE ? 128 : 1;
+
+  LogBuffer() : _head(0), _tail(0), _lineStart(0), _overflowed(false), _droppedLines(0) { }
+
+  /*!
+   * @brief Buffers one log line made up of the given values, each printed as by Print::print
+   * @param level Letter leading the line to tell its level
+   * @param args Values to print, in order; wrap in LogHex or LogFloat to change their formatting
+   *
+   * Use the LOG_ macros rather than calling this directly, so lines above LOG_LEVEL compile out.
+   */
+  template <class... Args>
+  void Line(char level, const Args&... args) {
+    _lineStart = _head;
+    _overflowed = false;
+    write(level);
+    write(' ');
+    Put(args...);
+    write('\n');
+    if (_overflowed) {
+      _head = _lineStart;  // a line cut short is more confusing than a missing one
+      _droppedLines++;
+    }
+  }
+
+  /*!
+   * @brief Sets up USART0, the console's port, to transmit 8N1 at the given rate, in place of Serial.begin
+   * @param baud Bits per second
+   */
+  void Begin(unsigned long baud);
+
+  /*!
+   * @brief Moves as much buffered text to the console as its USART can take without waiting
+   *
+   * That's at most two bytes a call, so the console keeps up as long as the loop runs at least once a byte time,
+   * about 1 ms at 9600 baud.
+   */
+  void Drain();
+
+  /*!
+   * @brief Writes all buffered text to the console, waiting on it as needed
+   *
+   * Only for setup, whose burst of lines would otherwise outrun the buffer before the loop starts draining it.
+   */
+  void Flush();
+
+  size_t write(uint8_t byte) override;
+  using Print::write;
+ private:
+  static constexpr uint16_t Mask = Size - 1;
+
+  uint8_t _buf[Size];
+  uint16_t _head;           // where the next byte is written
+  uint16_t _tail;           // where the next byte is drained from
+  uint16_t _lineStart;      // where the line being written began
+  bool _overflowed;         // true if the line being written ran out of room
+  uint16_t _droppedLines;   // lines dropped since the last report of them
+
+  void Put() { }
+
+  template <class T, class... Rest>
+  void Put(const T& first, const Rest&... rest) {
+    Emit(first);
+    Put(rest...);
+  }
+
+  template <class T>
+  void Emit(const T& value) { print(value); }
+  void Emit(const LogHex& hex) { print(hex.value, HEX); }
+  void Emit(const LogFloat& number) { print(number.value, number.digits); }
+};
+
+/*!
+ * @return The log every LOG_ macro writes to, drained once per loop
+ *
+ * Constructed on first use, so global constructors can log too.
+ */
+LogBuffer& Log();
+
+#endif
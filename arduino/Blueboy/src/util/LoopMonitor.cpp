@@ -0,0 +1,41 @@
+/*!
+ * @file LoopMonitor.cpp
+ * @author Sebastian S.
+ * @brief Implementation of LoopMonitor.h
+ */
+
+#include "LoopMonitor.h"
+
+void LoopMonitor::Tick() {
+  unsigned long now = micros();
+  if (!_started) {
+    _started = true;
+    _periodStart = now;
+  } else {
+    unsigned long took = now - _loopStart;
+    if (took > _worst) {
+      _worst = took;
+    }
+    _loops++;
+  }
+  _loopStart = now;
+}
+
+bool LoopMonitor::Elapsed(unsigned long period) {
+  return _started && micros() - _periodStart >= period;
+}
+
+uint16_t LoopMonitor::LoopsPerSecond() {
+  // in ms, so the loop count can reach millions before the multiplication overflows
+  unsigned long elapsed = (micros() - _periodStart) / 1000;
+  if (elapsed == 0) {
+    return 0;
+  }
+  return min(_loops * 1000UL / elapsed, (unsigned long) UINT16_MAX);
+}
+
+void LoopMonitor::Reset() {
+  _periodStart = micros();
+  _loops = 0;
+  _worst = 0;
+}
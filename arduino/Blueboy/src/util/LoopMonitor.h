@@ -0,0 +1,55 @@
+/*!
+ * @file LoopMonitor.h
+ * @author Sebastian S.
+ * @brief Declaration for LoopMonitor
+ */
+
+#ifndef LOOP_MONITOR_H_
+#define LOOP_MONITOR_H_
+
+#include <Arduino.h>
+
+/*!
+ * @class LoopMonitor
+ * @brief Counts and times loop() iterations over a report period.
+ */
+class LoopMonitor {
+ public:
+  LoopMonitor() : _started(false), _loopStart(0), _periodStart(0), _loops(0), _worst(0) { }
+
+  /*!
+   * @brief Marks the start of a loop() iteration, timing the one before it
+   *
+   * Call first thing in loop().
+   */
+  void Tick();
+
+  /*!
+   * @param period Report period in microseconds
+   * @return True once the report period has passed since the last Reset
+   */
+  bool Elapsed(unsigned long period);
+
+  /*!
+   * @return Iterations per second since the last Reset
+   */
+  uint16_t LoopsPerSecond();
+
+  /*!
+   * @return Time in microseconds taken by the longest iteration since the last Reset
+   */
+  unsigned long WorstLoop() { return _worst; }
+
+  /*!
+   * @brief Begins a new report period
+   */
+  void Reset();
+ private:
+  bool _started;                // true once an iteration has begun
+  unsigned long _loopStart;     // micros() the current iteration began
+  unsigned long _periodStart;   // micros() the report period began
+  uint32_t _loops;              // iterations completed in the report period
+  unsigned long _worst;         // longest iteration in the report period
+};
+
+#endif
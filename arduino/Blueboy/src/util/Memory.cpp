@@ -0,0 +1,62 @@
+/*!
+ * @file Memory.cpp
+ * @author Sebastian S.
+ * @brief Implementation of Memory.h
+ */
+
+#include "Memory.h"
+
+#ifdef __AVR__
+
+extern uint8_t _end;          // end of static data, where the heap begins
+extern uint8_t __stack;       // top of RAM, where the stack begins
+extern char *__brkval;        // top of the heap, or 0 if nothing has been allocated
+
+/*!
+ * @var uint8_t STACK_PAINT
+ * Byte free RAM is painted with at startup
+ */
+constexpr uint8_t STACK_PAINT = 0xC5;
+
+// runs in .init1, before the zero register or the stack are set up, so it has to be assembly; fills _end up to
+// and including __stack with STACK_PAINT
+void PaintStack() __attribute__((naked, used, section(".init1")));
+void PaintStack() {
+  __asm volatile ("    ldi r30, lo8(_end)\n"
+                  "    ldi r31, hi8(_end)\n"
+                  "    ldi r24, %0\n"
+                  "    ldi r25, hi8(__stack)\n"
+                  "    rjmp 2f\n"
+                  "1:  st Z+, r24\n"
+                  "2:  cpi r30, lo8(__stack)\n"
+                  "    cpc r31, r25\n"
+                  "    brlo 1b\n"
+                  "    breq 1b\n" :: "M" (STACK_PAINT));
+}
+
+uint16_t FreeRam() {
+  uint8_t top;  // the most recent thing on the stack
+  return &top - (__brkval ? (uint8_t *) __brkval : &_end);
+}
+
+uint16_t StackHeadroom() {
+  const uint8_t *p = __brkval ? (const uint8_t *) __brkval : &_end;
+  uint16_t count = 0;
+  while (p <= &__stack && *p == STACK_PAINT) {
+    p++;
+    count++;
+  }
+  return count;
+}
+
+#else
+
+uint16_t FreeRam() {
+  return 0;
+}
+
+uint16_t StackHeadroom() {
+  return 0;
+}
+
+#endif
@@ -0,0 +1,29 @@
+/*!
+ * @file Memory.h
+ * @author Sebastian S.
+ * @brief Declarations for RAM usage probes.
+ *
+ * On the AVR, RAM between the end of static data and the top of the stack is painted with a known byte before
+ * any constructor runs. The stack's deepest reach since then is where the paint ends. Off the AVR both probes
+ * return 0.
+ */
+
+#ifndef MEMORY_H_
+#define MEMORY_H_
+
+#include <stdint.h>
+
+/*!
+ * @return Bytes free between the heap and the stack right now
+ */
+uint16_t FreeRam();
+
+/*!
+ * @return Bytes between the heap and the deepest the stack has reached since startup
+ *
+ * Scans up from the heap through untouched paint, so costs a few cycles per free byte; call it once per report,
+ * not every loop.
+ */
+uint16_t StackHeadroom();
+
+#endif
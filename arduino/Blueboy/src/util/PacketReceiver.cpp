@@ -5,62 +5,63 @@
  */
 
 #include "PacketReceiver.h"
-#include "hardwareSerial.h"
-
-/*!
- * @var bool DEBUG
- * If true, debug information should be printed over Serial during operation
- */
-constexpr bool DEBUG = false;
+#include "Log.h"
 
 void PacketReceiver::Begin() {
   _offset = 0;
   _plen = 0;
   _id = 0;
+  _matched = 0;
   _mode = Syncing;
 
-  if (DEBUG) Serial.println(F("Beginning packet receive"));
+  LOG_TRACE(F("Beginning packet receive"));
+
+  Replay();  // pick up scanning an abandoned frame where a packet found in it left off
+}
+
+void PacketReceiver::Abort() {
+  if (InProgress()) {
+    LOG_WARN(F("Packet stalled, rescanning"));
+    Rescan();
+  }
 }
 
-// adds the given byte to the buffer, returning true if adding the byte
-// completed the packet and false otherwise
 bool PacketReceiver::AddByte(uint8_t readbyte) {
-  if (_toRead == 0 && _mode != Syncing) {
+  _stats.bytes++;
+  if (_mode == Syncing && _matched == 0 && readbyte != _sync[0]) {
+    // line noise between packets can't start a sync pattern, so skip the state machine
+    _stats.droppedBytes++;
     return false;
   }
+  return Receive(readbyte);
+}
+
+size_t PacketReceiver::AddBytes(const uint8_t *bytes, size_t len) {
+  size_t consumed = Consume(bytes, len);
+  _stats.bytes += consumed;
+  return consumed;
+}
+
+// adds the given byte to the buffer, returning true if adding the byte
+// completed the packet and false otherwise
+bool PacketReceiver::Receive(uint8_t readbyte) {
   switch (_mode) {
     case Syncing:
-      _pattern = ((uint32_t) readbyte << 24) | (_pattern >> 8);
-
-      if (DEBUG) Serial.print(F("Syncing: "));
-      if (DEBUG) Serial.println(_pattern, HEX);
+      LOG_TRACE(F("Syncing: "), LogHex(readbyte));
       
-      if (_pattern == _sync) {
-        _mode = Length;
-        _toRead = sizeof(_plen);
-        if (DEBUG) Serial.println(F("Sync found, moving to Length"));
+      _stats.droppedBytes++;  // until it turns out to finish a sync pattern
+      if (MatchSync(readbyte)) {
+        Synced();
       }
       break;
     case Length:
       _plen = ((uint16_t) readbyte << 8) | (_plen >> 8);
       _toRead--;
 
-      if (DEBUG) Serial.print(F("Length: "));
-      if (DEBUG) Serial.println(_plen, HEX);
+      LOG_TRACE(F("Length: "), LogHex(_plen));
       
       if (_toRead == 0) {
-        if (_plen == 0) {
-          // invalid packet length, go back go back
-          _mode = Syncing;
-          
-          if (DEBUG) Serial.println(F("Received a packet length of 0, bad packet"));
-        } else {
-          // we just added the last length field byte, move to data on next cycle
-          _toRead = _plen;
-          _mode = ID;
-  
-          if (DEBUG) Serial.println(F("Length complete, moving to ID"));
-        }
+        LengthReceived();
       }
       break;
     case ID:
@@ -68,10 +69,12 @@ bool PacketReceiver::AddByte(uint8_t readbyte) {
       _toRead--;
       if (_toRead == 0) {
         // we received a packet with just an ID and no data, we're done
-        if (DEBUG) Serial.println(F("Packet with no data detected, complete"));
+        LOG_TRACE(F("Packet with no data detected, complete"));
+        _mode = Complete;
+        _stats.packets++;
         return true;
       } else {
-        if (DEBUG) Serial.println(F("ID complete, moving to Data"));
+        LOG_TRACE(F("ID complete, moving to Data"));
         _mode = Data;
       }
       break;
@@ -79,24 +82,173 @@ bool PacketReceiver::AddByte(uint8_t readbyte) {
       _dataBuf[_offset++] = readbyte;
       _toRead--;
 
-      if (DEBUG) Serial.print(F("Data: "));
-      if (DEBUG) Serial.println(readbyte, HEX);
+      LOG_TRACE(F("Data: "), LogHex(readbyte));
       
       if (_toRead == 0) {
         // just added last data byte, we're done
-        if (DEBUG) Serial.println(F("Data complete, packet complete"));
+        LOG_TRACE(F("Data complete, packet complete"));
+        _mode = Complete;
+        _stats.packets++;
         return true;
       }
       break;
     default:
-      // this shouldn't happen
+      // a completed packet is waiting on Begin, ignore anything more
+      _stats.droppedBytes++;
       break;
   }
   return false;
 }
 
+size_t PacketReceiver::Consume(const uint8_t *bytes, size_t len) {
+  size_t i = 0;
+  while (i < len) {
+    if (_mode == Syncing) {
+      size_t start = i;
+      if (_matched == 0) {
+        // nothing matched so far, only an occurrence of the first sync byte can start a pattern
+        const uint8_t *found = (const uint8_t *) memchr(bytes + i, _sync[0], len - i);
+        if (found == NULL) {
+          _stats.droppedBytes += len - i;
+          return len;
+        }
+        i = found - bytes + 1;
+        _matched = 1;
+      }
+
+      // compare the rest of the pattern directly, falling back to a byte at a time on a mismatch
+      while (i < len && _matched < sizeof(_sync) && bytes[i] == _sync[_matched]) {
+        _matched++;
+        i++;
+      }
+      bool synced = _matched == sizeof(_sync) || (i < len && MatchSync(bytes[i++]));
+      _stats.droppedBytes += i - start;  // until it turns out to finish a sync pattern
+      if (synced) {
+        Synced();
+      }
+    } else if (_mode == Length && _toRead == sizeof(_plen) && len - i >= sizeof(_plen)) {
+      // whole little-endian length field at once
+      memcpy(&_plen, bytes + i, sizeof(_plen));
+      i += sizeof(_plen);
+      _toRead = 0;
+      LengthReceived();
+    } else if (_mode == Data) {
+      // copy as much of the remaining data as we have in one go
+      // (rescanning an abandoned frame copies from further along the data buf itself, hence memmove)
+      size_t count = min((size_t) _toRead, len - i);
+      memmove(_dataBuf + _offset, bytes + i, count);
+      _offset += count;
+      _toRead -= count;
+      i += count;
+
+      if (_toRead == 0) {
+        _mode = Complete;
+        _stats.packets++;
+        break;
+      }
+    } else if (_mode == Complete) {
+      break;
+    } else if (Receive(bytes[i++])) {
+      break;
+    }
+  }
+  return i;
+}
+
+uint8_t PacketReceiver::Resync(uint8_t byte) {
+  // the bytes just received are the matched prefix followed by this one; find the longest sync prefix
+  // they end with, which is the matched prefix shifted along by one or more bytes, or nothing
+  uint8_t k = _matched;
+  while (k > 0) {
+    bool prefix = _sync[k - 1] == byte;
+    for (uint8_t j = 0; prefix && j + 1 < k; j++) {
+      prefix = _sync[j] == _sync[_matched - k + 1 + j];
+    }
+    if (prefix) {
+      break;
+    }
+    k--;
+  }
+  return k;
+}
+
+void PacketReceiver::LengthReceived() {
+  if (_plen == 0 || _plen - sizeof(_id) > _size) {
+    // invalid packet length, go back go back
+    LOG_WARN(F("Bad packet length "), _plen, F(", rescanning"));
+
+    if (_plen != 0) {
+      _stats.oversizeLengths++;
+    }
+    Rescan();
+  } else {
+    // we just added the last length field byte, move to data on next cycle
+    _toRead = _plen;
+    _mode = ID;
+
+    LOG_TRACE(F("Length complete, moving to ID"));
+  }
+}
+
+void PacketReceiver::Synced() {
+  _matched = 0;
+  _mode = Length;
+  _toRead = sizeof(_plen);
+  _stats.droppedBytes -= sizeof(_sync);  // counted as dropped while syncing
+  LOG_TRACE(F("Sync found, moving to Length"));
+}
+
+void PacketReceiver::Rescan() {
+  // rebuild the frame's header as it was received: the sync pattern, as much of the little-endian length
+  // as arrived (the latest byte is shifted in at the top), then the ID once data has begun
+  uint8_t header[sizeof(_sync) + sizeof(_plen) + sizeof(_id)];
+  uint8_t headerLen = sizeof(_sync);
+  memcpy(header, _sync, sizeof(_sync));
+  if (_mode == Length && _toRead > 0) {
+    header[headerLen++] = _plen >> 8;
+  } else {
+    memcpy(header + headerLen, &_plen, sizeof(_plen));
+    headerLen += sizeof(_plen);
+    if (_mode == Data) {
+      header[headerLen++] = _id;
+    }
+  }
+  uint16_t data = _mode == Data ? _offset : 0;
+
+  _stats.syncLosses++;
+  _stats.droppedBytes++;  // the first sync byte, all the others get another chance
+  _mode = Syncing;
+  _matched = 0;
+  _offset = 0;
+
+  // too short to hold a sync pattern and a whole length, so this can't fail another frame
+  Consume(header + 1, headerLen - 1);
+
+  // a frame that failed on its length has no data; otherwise, the data buf is scanned again in place.
+  // A new frame found there is at least a header behind, so its data never overtakes the bytes still to scan
+  if (data > 0) {
+    _replayed = 0;
+    _replayEnd = data;
+    Replay();
+  }
+}
+
+void PacketReceiver::Replay() {
+  while (_replayed < _replayEnd && _mode != Complete) {
+    _replayed += Consume((const uint8_t *) _dataBuf + _replayed, _replayEnd - _replayed);
+  }
+}
+
 bool PacketReceiver::Completed() {
-  return _toRead == 0;
+  return _mode == Complete;
+}
+
+bool PacketReceiver::InProgress() {
+  return _mode == Length || _mode == ID || _mode == Data;
+}
+
+const struct ReceiverStats& PacketReceiver::Stats() {
+  return _stats;
 }
 
 const char *PacketReceiver::GetPacketData() {
@@ -110,26 +262,3 @@ uint16_t PacketReceiver::GetPacketDataLength() {
 uint8_t PacketReceiver::GetPacketID() {
   return _id;
 }
-
-void PacketReceiver::PrintPacketInfo() {
-  int datalen = GetPacketDataLength();
-  
-  Serial.println(F("Packet received"));
-  
-  Serial.print(F("  ID: "));
-  Serial.println(_id);
-  
-  Serial.print(F("  Data length: "));
-  Serial.println(datalen);
-  
-  Serial.print(F("  Received data: "));
-  if (datalen == 0) {
-    Serial.println(F("None"));
-  } else {
-    for (int i = 0; i < _plen - sizeof(_id); i++) {
-      Serial.print(_dataBuf[i], HEX);
-      Serial.print(F(" "));
-    }
-    Serial.println();
-  }
-}
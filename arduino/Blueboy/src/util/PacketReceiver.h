@@ -9,6 +9,18 @@
 
 #include <Arduino.h>
 
+/*!
+ * @struct ReceiverStats
+ * @brief Link error counters kept by a PacketReceiver since it was constructed.
+ */
+struct ReceiverStats {
+  uint32_t packets;          // packets completed
+  uint32_t bytes;            // bytes received
+  uint32_t droppedBytes;     // bytes that ended up in no packet: line noise and the remains of abandoned frames
+  uint16_t syncLosses;       // frames abandoned after their sync pattern, for a bad length or by Abort
+  uint16_t oversizeLengths;  // frames abandoned for a length too long for the data buffer
+};
+
 /*!
  * @class PacketReceiver
  * @brief Receives bytes and recognizes packets.
@@ -16,6 +28,10 @@
  * Recognizes packets that start with a sync pattern in the form
  * [Length: 2 bytes] | [ID: 1 byte] | [Data: Length - 1]
  * Where Length is the byte size of the entire packet, excluding itself and the sync pattern.
+ *
+ * A length of zero or one whose data would overflow the buffer is a framing failure, as is a frame abandoned
+ * through Abort. The bytes of a failed frame after its first are scanned again for a sync pattern, so a packet
+ * that a corrupt header swallowed is still recognized.
  */
 class PacketReceiver {
  public:
@@ -23,15 +39,28 @@ class PacketReceiver {
    * @brief Initializes a PacketReceiver
    * @param buf An external buffer to use in building the packet
    * @param sync 32-bit sync pattern in little-endian to recognize before each packet
+   * @param size Size of buf, the longest packet data accepted
    */
-  PacketReceiver(char *buf, uint32_t sync): _dataBuf(buf), _sync(sync),
-                                            _pattern(0), _plen(0), _id(0),
-                                            _toRead(0), _offset(0), _mode(Length) { }
+  PacketReceiver(char *buf, uint32_t sync, uint16_t size): _mode(Complete), _matched(0), _dataBuf(buf),
+                                                           _size(size), _plen(0), _id(0), _toRead(0), _offset(0),
+                                                           _replayed(0), _replayEnd(0), _stats() {
+    memcpy(_sync, &sync, sizeof(_sync));  // little-endian, so memory order is the order bytes are received
+  }
   
   /*!
    * @brief Prepares the PacketReceiver to receive a new packet
+   *
+   * If an abandoned frame still holds bytes to scan, scanning resumes and may complete another packet at once.
    */
   void Begin();
+
+  /*!
+   * @brief Abandons the frame in progress as a framing failure, scanning its bytes again for a sync pattern
+   *
+   * For a frame that stalled part way, typically one whose corrupt length is waiting on bytes that will never come.
+   * Does nothing unless a frame is in progress.
+   */
+  void Abort();
   
   /*!
    * @brief Receive a single byte.
@@ -39,12 +68,34 @@ class PacketReceiver {
    * @return True if receiving this byte completed a packet
    */
   bool AddByte(uint8_t byte);
+
+  /*!
+   * @brief Receive a chunk of bytes, stopping early if they complete a packet.
+   * @param bytes Bytes to receive
+   * @param len Number of bytes to receive
+   * @return The number of bytes consumed; fewer than len only if a packet was completed
+   *
+   * Equivalent to calling AddByte on each byte until one returns true, but skips through bytes
+   * that can't start a sync pattern with memchr and copies packet data in blocks. Bytes left over
+   * after a completed packet should be passed in again after handling the packet and calling Begin.
+   */
+  size_t AddBytes(const uint8_t *bytes, size_t len);
   
   /*!
    * @return True if the current packet is completed
    */
   bool Completed();
 
+  /*!
+   * @return True if a sync pattern has been received and its packet isn't complete yet
+   */
+  bool InProgress();
+
+  /*!
+   * @return Link error counters since construction
+   */
+  const struct ReceiverStats& Stats();
+
   /*!
    * @return A pointer to a buffer containing a completed packet's data
    * @pre PacketReceiver::Completed()
@@ -63,23 +114,53 @@ class PacketReceiver {
    */
   uint8_t GetPacketID();
 
-  /*!
-   * @brief Prints information about the current packet.
-   * Information printed includes whether one is currently completed, and if so the id, length and data.
-   */
-  void PrintPacketInfo();
  private:
-  enum ReadMode { Syncing, Length, ID, Data};
+  enum ReadMode { Syncing, Length, ID, Data, Complete };
   ReadMode  _mode;
 
-  uint32_t  _sync;        // sync pattern
-  uint32_t  _pattern;     // last four bytes received
+  uint8_t   _sync[4];     // sync pattern, in the order it is received
+  uint8_t   _matched;     // number of sync pattern bytes matched by the latest bytes received
   
   char *    _dataBuf;     // data buf
+  uint16_t  _size;        // size of the data buf
   uint16_t  _plen;        // packet length
   uint8_t   _id;
   uint16_t  _toRead;
   uint16_t  _offset;
+
+  uint16_t  _replayed;    // data buf bytes of an abandoned frame scanned again so far
+  uint16_t  _replayEnd;   // data buf bytes of an abandoned frame to scan again
+
+  struct ReceiverStats _stats;
+
+  // receive bytes without counting them as received, for scanning an abandoned frame again
+  bool Receive(uint8_t byte);
+  size_t Consume(const uint8_t *bytes, size_t len);
+
+  // advances the sync match by one received byte, returning true once the full pattern has been matched
+  bool MatchSync(uint8_t byte) {
+    if (byte == _sync[_matched]) {
+      _matched++;
+    } else if (_matched > 0) {
+      _matched = Resync(byte);
+    }
+    return _matched == sizeof(_sync);
+  }
+
+  // length of the longest sync prefix ending in the given byte that failed to extend the current match
+  uint8_t Resync(uint8_t byte);
+
+  // moves on to the length field once a sync pattern has been matched
+  void Synced();
+
+  // moves on to the ID once the length field has been received, or fails the frame on a bad length
+  void LengthReceived();
+
+  // abandons the frame in progress and scans its bytes after the first again
+  void Rescan();
+
+  // scans the data buf bytes of an abandoned frame until they run out or complete a packet
+  void Replay();
 };
 
 #endif
@@ -15,6 +15,9 @@ void PacketSender::Begin(uint8_t id) {
 }
 
 int PacketSender::AddByte(uint8_t addbyte) {
+  if (_off >= _size) {
+    return 0;
+  }
   _buf[_off] = addbyte;
   _off++;
   _len++;
@@ -22,35 +25,51 @@ int PacketSender::AddByte(uint8_t addbyte) {
 }
 
 int PacketSender::AddBuf(const char *addbuf, int len) {
-  for (int i = 0; i < len; i++) {
-    AddByte(addbuf[i]);
+  if (len < 0 || _off + len > _size) {
+    return 0;
   }
+  memcpy(_buf + _off, addbuf, len);
+  _off += len;
+  _len += len;
   return len;
 }
 
-int PacketSender::AddShort(uint16_t addshort) {
-  return AddBuf((char *) &addshort, sizeof(uint16_t));
-}
-
-int PacketSender::AddLong(uint32_t addlong) {
-  return AddBuf((char *) &addlong, sizeof(uint32_t));
+int PacketSender::AddStr(const char *str) {
+  // truncate strings that don't fit, leaving room for the terminator
+  int len = strlen(str);
+  int room = _size - _off - 1;
+  if (len > room) {
+    len = room;
+  }
+  int added = AddBuf(str, len);
+  added += AddByte('\0');
+  return added;
 }
 
-int PacketSender::AddFloat(float addfloat) {
-  return AddBuf((char *) &addfloat, sizeof(float));
+int PacketSender::AddStr(const __FlashStringHelper *str) {
+  // as above, copied straight out of flash
+  int len = strlen_P((const char *) str);
+  int room = _size - _off - 1;
+  if (len > room) {
+    len = room;
+  }
+  if (len < 0) {
+    return 0;
+  }
+  memcpy_P(_buf + _off, (const char *) str, len);
+  _off += len;
+  _len += len;
+  return len + AddByte('\0');
 }
 
-int PacketSender::AddStr(const char *str) {
-  int added = AddBuf(str, strlen(str));
-  added += AddByte('\0');
-  return added;
+// writes sync pattern and length to buffer at the start
+uint16_t PacketSender::Finish() {
+  memcpy(_buf, &_sync, sizeof(_sync));                  // add sync pattern
+  memcpy(_buf + sizeof(_sync), &_len, sizeof(_len));    // add length
+  return sizeof(_sync) + sizeof(_len) + _len;
 }
 
-// writes length to buffer at the start, sends full packet over given serial
+// completes the packet, sends full packet over given serial
 int PacketSender::Send(AltSoftSerial& serial) {
-  *((uint32_t *) _buf) = _sync;  // add sync pattern
-  
-  *((uint16_t *) (_buf + sizeof(_sync))) = _len;  // add length
-  
-  return serial.write(_buf, sizeof(_sync) + sizeof(_len) + _len);
+  return serial.write(_buf, Finish());
 }
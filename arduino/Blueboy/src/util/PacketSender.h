@@ -20,12 +20,32 @@
  */
 class PacketSender {
  public:
+  /*!
+   * @var int BufferSize
+   * Default size in bytes of the external buffer a PacketSender builds packets in, including sync and length
+   */
+  static constexpr int BufferSize = 64;
+
+  /*!
+   * @var int HeaderSize
+   * Bytes of sync pattern, length and ID preceding the data of every packet
+   */
+  static constexpr int HeaderSize = sizeof(uint32_t) + sizeof(uint16_t) + sizeof(uint8_t);
+
+  /*!
+   * @var int MaxDataSize
+   * Largest number of data bytes a packet built in a default-sized buffer can carry
+   */
+  static constexpr int MaxDataSize = BufferSize - HeaderSize;
+
   /*!
    * @brief Initializes a PacketSender
    * @param buf An external buffer to use in building the packet
    * @param sync 32-bit sync pattern in little-endian to send before each packet
+   * @param size Size of the external buffer in bytes, BufferSize unless the sender builds larger packets
    */
-  PacketSender(char *buf, uint32_t sync): _buf(buf), _sync(sync), _len(0), _off(0), _id(0) { }
+  PacketSender(char *buf, uint32_t sync, uint16_t size = BufferSize):
+      _buf(buf), _sync(sync), _size(size), _len(0), _off(0), _id(0) { }
 
   /*!
    * @brief Prepares the PacketSender to send a new packet.
@@ -37,14 +57,49 @@ class PacketSender {
    * @brief Adds a data buffer to the packet.
    * @param addbuf Data buffer to add bytes from
    * @param len Length of the data buffer
-   * @return The number of bytes added to the packet
+   * @return The number of bytes added to the packet, 0 if the buffer would not fit
    */
   int AddBuf(const char *addbuf, int len);
+
+  /*!
+   * @brief Adds the in-memory representation of a value to the packet in a single copy.
+   * @param value Value to add, typically a payload struct laid out exactly as it is sent
+   * @return The number of bytes added to the packet, 0 if the value would not fit
+   *
+   * Values too large to ever fit in a packet are rejected at compile time.
+   */
+  template <class T>
+  int Add(const T& value) {
+    static_assert(sizeof(T) <= MaxDataSize, "value does not fit in a packet");
+    if (_off + sizeof(T) > _size) {
+      return 0;
+    }
+    memcpy(_buf + _off, &value, sizeof(T));
+    _off += sizeof(T);
+    _len += sizeof(T);
+    return sizeof(T);
+  }
+
+  /*!
+   * @brief Overwrites data already added to the packet, such as a count only known once the packet is full.
+   * @param offset Offset of the value from the start of the packet data, just after the ID
+   * @param value Value to write
+   * @return The number of bytes written, 0 if the value lies outside the data added so far
+   */
+  template <class T>
+  int Set(uint16_t offset, const T& value) {
+    uint16_t pos = HeaderSize + offset;
+    if (pos + sizeof(T) > _off) {
+      return 0;
+    }
+    memcpy(_buf + pos, &value, sizeof(T));
+    return sizeof(T);
+  }
   
   /*!
    * @brief Adds a byte to the packet
    * @param addbyte Byte to add
-   * @return The number of bytes added to the packet
+   * @return The number of bytes added to the packet, 0 if the packet is full
    */
   int AddByte(uint8_t addbyte);
   
@@ -53,29 +108,42 @@ class PacketSender {
    * @param addshort short to add
    * @return The number of bytes added to the packet
    */
-  int AddShort(uint16_t addshort);
+  int AddShort(uint16_t addshort) { return Add(addshort); }
   
   /*!
    * @brief Adds a 4-byte long to the packet
    * @param addlong long to add
    * @return The number of bytes added to the packet
    */
-  int AddLong(uint32_t addlong);
+  int AddLong(uint32_t addlong) { return Add(addlong); }
   
   /*!
    * @brief Adds a 4-byte float to the packet
    * @param addfloat float to add
    * @return The number of bytes added to the packet
    */
-  int AddFloat(float addfloat);
+  int AddFloat(float addfloat) { return Add(addfloat); }
   
   /*!
-   * @brief Adds a null-terminated string to the packet
+   * @brief Adds a null-terminated string to the packet, truncating it if it doesn't fit
    * @param str String to add
    * @return The number of bytes added to the packet
    */
   int AddStr(const char *str);
+
+  /*!
+   * @brief Adds a null-terminated string from flash to the packet, truncating it if it doesn't fit
+   * @param str String to add, as made by F()
+   * @return The number of bytes added to the packet
+   */
+  int AddStr(const __FlashStringHelper *str);
   
+  /*!
+   * @brief Completes the packet being built without sending it, for callers that write it out themselves
+   * @return The size in bytes of the complete packet, which starts at the beginning of the external buffer
+   */
+  uint16_t Finish();
+
   /*!
    * @brief Completes the packet being built and sends it over a serial stream
    * @param serial Reference to an AltSoftSerial stream to write the packet into
@@ -85,6 +153,7 @@ class PacketSender {
  private:
   char *    _buf;
   uint32_t  _sync;
+  uint16_t  _size;
   uint16_t  _len;
   uint16_t  _off;
   uint8_t   _id;
@@ -0,0 +1,75 @@
+/*!
+ * @file RingBuffer.h
+ * @author Sebastian S.
+ * @brief Declaration and implementation of the RingBuffer template
+ */
+
+#ifndef RING_BUFFER_H_
+#define RING_BUFFER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*!
+ * @class RingBuffer
+ * @brief Fixed-capacity FIFO queue of N items of type T, filled in place.
+ *
+ * Producers claim the next free slot, fill it, then commit it; consumers read the front item, then pop it.
+ * The read and write counters run freely and wrap, so N must be a power of two no greater than 128.
+ */
+template <class T, uint8_t N>
+class RingBuffer {
+  static_assert(N > 0 && (N & (N - 1)) == 0 && N <= 128, "RingBuffer capacity must be a power of two up to 128");
+ public:
+  RingBuffer() : _head(0), _tail(0) { }
+
+  /*!
+   * @return The number of items queued
+   */
+  uint8_t Count() const { return (uint8_t) (_head - _tail); }
+
+  /*!
+   * @return True if no items are queued
+   */
+  bool Empty() const { return _head == _tail; }
+
+  /*!
+   * @return True if no more items can be queued
+   */
+  bool Full() const { return Count() == N; }
+
+  /*!
+   * @return The slot the next item should be written into, or NULL if the buffer is full
+   *
+   * The item isn't queued until Commit is called, so a claimed slot may be abandoned.
+   */
+  T *Claim() { return Full() ? NULL : &_items[_head & (N - 1)]; }
+
+  /*!
+   * @brief Queues the item written into the slot returned by Claim
+   */
+  void Commit() { _head++; }
+
+  /*!
+   * @return The oldest item queued
+   * @pre !Empty()
+   */
+  T& Front() { return _items[_tail & (N - 1)]; }
+
+  /*!
+   * @brief Removes the oldest item queued
+   * @pre !Empty()
+   */
+  void Pop() { _tail++; }
+
+  /*!
+   * @brief Removes every item queued
+   */
+  void Clear() { _tail = _head; }
+ private:
+  T _items[N];
+  uint8_t _head;  // items ever committed, mod 256
+  uint8_t _tail;  // items ever popped, mod 256
+};
+
+#endif
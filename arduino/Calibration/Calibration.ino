@@ -3,6 +3,7 @@
 #include <Math.h>
 #include <Adafruit_Sensor.h>
 #include "CalibratedLIS2MDL.h"
+#include "FastTrig.h"
 
 // calibration time in milliseconds
 constexpr unsigned long CALIBRATION_TIME = 15000;
@@ -53,7 +54,7 @@ void loop() {
   Serial.print("\t");
   Serial.println();
   //*/
-  float heading = atan2(event.magnetic.y, event.magnetic.x) * 180 / PI;
+  float heading = FastAtan2(event.magnetic.y, event.magnetic.x) * 180 / PI;
   Serial.println(heading);
 
   delay(100);
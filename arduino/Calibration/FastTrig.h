@@ -0,0 +1,44 @@
+/*!
+ * @file FastTrig.h
+ * @author Sebastian S.
+ * @brief Declarations for table-driven trigonometry.
+ *
+ * Each function interpolates linearly between 65 points of a table kept in flash, in place of avr-libc's
+ * polynomial versions, which cost thousands of cycles apiece on the ATmega. Angles are in radians. Worst
+ * errors, interpolation plus the tables' rounding:
+ *  - FastAtan2, FastAsin: 3e-5 rad, under 0.002 degrees
+ *  - FastSin, FastCos: 9e-5
+ *
+ * A copy of Blueboy's src/util/FastTrig.h, as a sketch compiles only its own folder; Blueboy's host bench_trig
+ * checks both bounds against double precision.
+ */
+
+#ifndef FAST_TRIG_H_
+#define FAST_TRIG_H_
+
+/*!
+ * @param y Opposite side
+ * @param x Adjacent side
+ * @return Angle of (x, y) from the x axis, -pi to pi; 0 if both are 0
+ */
+float FastAtan2(float y, float x);
+
+/*!
+ * @param x Sine, clamped to -1 to 1
+ * @return Angle with that sine, -pi/2 to pi/2
+ */
+float FastAsin(float x);
+
+/*!
+ * @param angle Angle in radians; precision falls off with its size, as a float's does
+ * @return Sine of the angle
+ */
+float FastSin(float angle);
+
+/*!
+ * @param angle Angle in radians; precision falls off with its size, as a float's does
+ * @return Cosine of the angle
+ */
+float FastCos(float angle);
+
+#endif
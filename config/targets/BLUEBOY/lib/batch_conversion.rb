@@ -0,0 +1,37 @@
+# Blueboy Batch Conversion: batch_conversion.rb
+# Author: Sebastian S
+
+require 'cosmos/conversions/conversion'
+require 'counts_conversion'
+
+module Cosmos
+  # Picks one value of one sample out of a batched attitude packet's SAMPLES array, which holds the COUNT
+  # samples sent one after another. Samples past COUNT weren't sent, so their values read as nil.
+  class BatchConversion < Conversion
+    # @param values [Integer] Values in each sample
+    # @param sample [Integer] Index of the sample in the packet
+    # @param value [Integer] Index of the value within the sample
+    # @param counts [Array] For sensor counts, the descriptor packets, sensor and axis to convert the value as
+    #   CountsConversion does
+    def initialize(values, sample, value, *counts)
+      super()
+      @sample = Integer(sample)
+      @index = Integer(values) * @sample + Integer(value)
+      @counts = counts.empty? ? nil : CountsConversion.new(*counts)
+      @converted_type = :FLOAT
+      @converted_bit_size = 32
+    end
+
+    def call(value, packet, buffer)
+      return nil if @sample >= packet.read('COUNT', :RAW, buffer)
+      samples = packet.read('SAMPLES', :RAW, buffer)
+      return samples[@index] unless @counts
+      @counts.convert(samples[@index - @counts.axis, 3], packet.target_name)
+    end
+
+    def to_s
+      text = "SAMPLES[#{@index}] while COUNT > #{@sample}"
+      @counts ? "#{text}, then #{@counts}" : text
+    end
+  end
+end
@@ -0,0 +1,62 @@
+# Blueboy Counts Conversion: counts_conversion.rb
+# Author: Sebastian S
+
+require 'cosmos/conversions/conversion'
+
+module Cosmos
+  # Converts a sensor count from a counts attitude packet to SI units with the calibration last received in the
+  # device's counts descriptor packets, as Blueboy converts its raw data: value * scale - offset, then for the
+  # magnetometer its soft-iron matrix across the three axes, or for the accelerometer the axis's gain
+  class CountsConversion < Conversion
+    AXES = %w(X Y Z)
+
+    # @return [Integer] Index of the axis converted, 0 to 2 for X to Z
+    attr_reader :axis
+
+    # @param scale_packet [String] Name of the counts scale descriptor packet
+    # @param correction_packet [String] Name of the counts correction descriptor packet
+    # @param sensor [String] Sensor prefix of the descriptor items: MAG, ACC or GYRO
+    # @param axis [String] Axis to convert: X, Y or Z
+    def initialize(scale_packet, correction_packet, sensor, axis)
+      super()
+      @scale_packet = scale_packet.to_s.upcase
+      @correction_packet = correction_packet.to_s.upcase
+      @sensor = sensor.to_s.upcase
+      @axis = AXES.index(axis.to_s.upcase)
+      @converted_type = :FLOAT
+      @converted_bit_size = 32
+    end
+
+    def call(value, packet, buffer)
+      convert(AXES.map { |axis| packet.read("#{@sensor}#{axis}", :RAW, buffer) }, packet.target_name)
+    end
+
+    # @param counts [Array] The sensor's X, Y and Z counts from one sample
+    # @param target_name [String] Target the descriptor packets belong to
+    # @return [Float] The axis converted in SI units
+    def convert(counts, target_name)
+      scale = System.telemetry.value(target_name, @scale_packet, "#{@sensor}SCALE", :RAW)
+      field = AXES.each_with_index.map do |axis, i|
+        counts[i] * scale - System.telemetry.value(target_name, @scale_packet, "#{@sensor}#{axis}OFF", :RAW)
+      end
+
+      # until a correction arrives, its items read as zero rather than leaving the field as it is
+      return field[@axis] if System.telemetry.packet(target_name, @correction_packet).received_count == 0
+      row = AXES[@axis]
+      case @sensor
+      when 'MAG'
+        AXES.each_with_index.sum do |column, i|
+          System.telemetry.value(target_name, @correction_packet, "MAG#{row}#{column}", :RAW) * field[i]
+        end
+      when 'ACC'
+        field[@axis] * System.telemetry.value(target_name, @correction_packet, "ACC#{row}GAIN", :RAW)
+      else
+        field[@axis]
+      end
+    end
+
+    def to_s
+      "value * #{@scale_packet} #{@sensor}SCALE - #{@sensor}#{AXES[@axis]}OFF, corrected by #{@correction_packet}"
+    end
+  end
+end
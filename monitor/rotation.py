@@ -2,7 +2,6 @@ import serial
 import struct
 import time
 import numpy as np
-from ahrs.filters import Madgwick
 from cube import CubeRenderer
 
 sync = b'\xEF\xBE\xAD\xDE'
@@ -14,9 +13,10 @@ def reset(ser):
 
 def begin(ser):
   ser.write(sync)
-  ser.write(b'\x03\x00')
+  ser.write(b'\x04\x00')
   ser.write(b'\x10')
-  ser.write(b'\x32\0x00')  # 50 ms period
+  ser.write(b'\x32\x00')  # 50 ms period
+  ser.write(b'\x02')      # quaternion mode, fused on Blueboy
   
 def receive(ser):
   recognized = False
@@ -54,24 +54,15 @@ def main():
   
   begin(ser)
 
-  # q_last = np.array([0.7071, -0.7071, 0.0, 0.0])
-  q_last = np.array([1., 0., 0., 0.])
-  madgwick = Madgwick(Dt = 0.05, q0 = q_last)
-  
   renderer = CubeRenderer()
   
   while True:
     [cmd, data] = receive(ser)
-    if cmd == b'\x10':
-      raw = struct.unpack('<fffffffff', data)  # 3 float vectors, 9 floats
-      mag = raw[0:3]
-      acc = raw[3:6]
-      gyro = raw[6:9]
-      
-      # q_last = madgwick.updateMARG(q_last, gyr=gyro, acc=acc, mag=mag)
-      q_last = madgwick.updateIMU(q_last, gyr=gyro, acc=acc)
-      print(q_last)
-      renderer.render(q_last)
+    if cmd == b'\x12':
+      x, y, z, w = struct.unpack('<ffff', data[0:16])  # followed by the sample's timestamp
+      q = np.array([w, x, y, z])
+      print(q)
+      renderer.render(q)
 
 if __name__ == '__main__':
   main()
\ No newline at end of file
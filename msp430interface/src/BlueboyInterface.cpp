@@ -9,14 +9,20 @@
 
 namespace blueboy {
 
-BlueboyInterface::BlueboyInterface(I2CBus::Handle handle, uint8_t whoami) : _handle(handle), _receivingAddr(true) {
-  memset(_addressSpace, '\0', 256);
+BlueboyInterface::BlueboyInterface(I2CBus::Handle handle, uint8_t whoami) :
+    _published(0), _latched(0), _filling(1), _handle(handle), _receivingAddr(true) {
+  memset(_control, '\0', sizeof(_control));
+  memset(_banks, '\0', sizeof(_banks));
   _set<uint8_t>(WhoAmI, whoami);
 }
 
+void BlueboyInterface::OnStart() {
+  _latched = _published;
+}
+
 void BlueboyInterface::OnReceive(int bufsize) {
   // if receiving address, take first byte to be the address
-  // otherwise, write values in buffer to the address
+  // then write any values following it in the buffer to the address
   //   if incremental addressing enabled, increment address
 
   I2CBus *bus = eusci::GetI2C(_handle);
@@ -24,10 +30,16 @@ void BlueboyInterface::OnReceive(int bufsize) {
   if (_receivingAddr) {
     _reqAddr = bus->Read();
     _receivingAddr = false;
-  } else {
+  }
+
+  // data may follow the address in the same transaction, or come in one of its own after it
+  if (bus->Available()) {
     while (bus->Available()) {
       uint8_t read = bus->Read();
-      _set<uint8_t>(_reqAddr, read);
+      if (_reqAddr < RawMag) {
+        // the data registers are the 1U's to write
+        _control[_reqAddr] = read;
+      }
       _reqAddr++;
     }
     _receivingAddr = true;
@@ -40,7 +52,9 @@ void BlueboyInterface::OnRequest() {
 
   I2CBus *bus = eusci::GetI2C(_handle);
 
-  bus->Write(_get<uint8_t>(_reqAddr));
+  // data comes from the bank latched when this transaction started, so a burst is never torn by a commit
+  uint8_t address = _reqAddr;
+  bus->Write(address < RawMag ? _control[address] : _banks[_latched][address - RawMag]);
   _reqAddr++;
   _receivingAddr = true;
 }
@@ -64,7 +78,8 @@ void BlueboyInterface::UpdateSensorHealth(Sensor sensor, bool healthy) {
   // set the sensor'th bit to healthy
   uint8_t byte = _get<uint8_t>(SensorHealth);
   uint8_t mask = ~(1 << sensor);
-  byte = (byte & mask) | (byte & (healthy << sensor));
+  byte = (byte & mask) | (healthy << sensor);
+  _set<uint8_t>(SensorHealth, byte);
 }
 
 void BlueboyInterface::UpdateSensorData(Sensor sensor, const struct Vector3& data) {
@@ -110,6 +125,19 @@ void BlueboyInterface::UpdateGeneralFloatData(int index, float val) {
   _set<float>(GenFloats + index * 4, val);
 }
 
+void BlueboyInterface::Commit() {
+  // a transaction starting now latches the new bank, one under way keeps the one it has, and the next updates
+  // start from a copy of the new bank in whichever is left; a start can only latch the published bank, so it
+  // can't take the one picked here
+  _published = _filling;
+  uint8_t next = 0;
+  while (next == _published || next == _latched) {
+    next++;
+  }
+  memcpy(_banks[next], _banks[_published], DataBankSize);
+  _filling = next;
+}
+
 void BlueboyInterface::UpdateGeneralBufferData(int index, const char *buffer) {
   // copies the bytes from buffer to the index'th general buffer
   for (int i = 0; i < 16; i++) {
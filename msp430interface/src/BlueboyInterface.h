@@ -73,9 +73,28 @@ constexpr uint8_t Quaternion =    0xB0;   // 16
 constexpr uint8_t GenFloats =     0xC0;   // 16
 constexpr uint8_t GenBufs =       0xD0;   // 48
 
+/*!
+ * @var int DataBankSize
+ * Bytes in the data registers, 0x80 up, which are banked so reads see whole updates
+ */
+constexpr int DataBankSize = 256 - RawMag;
+
+/*!
+ * @var int DataBanks
+ * Banks of data registers: one published, one latched by a read under way, one being filled
+ */
+constexpr int DataBanks = 3;
+
 /*!
  * @class BlueboyInterface
  * @brief An example class that implements the Blueboy interface protocol
+ *
+ * The data registers, 0x80 up, are triple buffered so a master's burst read never mixes two updates. Update
+ * calls fill a bank of their own, which Commit publishes whole; each transaction latches the published bank at
+ * its start and is served from it to the end, however many commits land meanwhile. The third bank means Commit
+ * never has to wait for a read to finish before starting on the next update.
+ *
+ * The control and status registers below 0x80 are single bytes and aren't banked.
  */
 class BlueboyInterface {
 public:
@@ -96,6 +115,11 @@ public:
    */
   BlueboyInterface(I2CBus::Handle handle, uint8_t whoami);
 
+  /*!
+   * @brief I2C start callback, latching the published data bank for the transaction starting
+   */
+  void OnStart();
+
   /*!
    * @brief I2C data receive callback
    * @param bufsize Number of bytes available in the receive buffer of the I2C bus identified by the stored handle
@@ -158,6 +182,13 @@ public:
    */
   void UpdateGeneralFloatData(int index, float val);
 
+  /*!
+   * @brief Publishes the data updated since the last commit, all at once
+   *
+   * Transactions already under way carry on with the data they started with.
+   */
+  void Commit();
+
   /*!
    * @brief Updates a stored general buffer
    * @param index The index of the general buffer to update
@@ -167,25 +198,40 @@ public:
    */
   void UpdateGeneralBufferData(int index, const char *buffer);
 protected:
-  uint8_t _addressSpace[256];     // 256 byte address space
+  uint8_t _control[RawMag];       // control and status registers, below the data
+  uint8_t _banks[DataBanks][DataBankSize];  // data registers, in banks
+  volatile uint8_t _published;    // bank holding the latest commit
+  volatile uint8_t _latched;      // bank the current transaction is served from
+  uint8_t _filling;               // bank updates go into until the next commit
   I2CBus::Handle _handle;         // i2c bus handle to use
   uint8_t _reqAddr;               // address requested (first byte written by master)
   bool _receivingAddr;            // whether the interface is currently expecting an address
 
+  /*!
+   * @brief Locates a register as the 1U sees it, data registers in the bank being filled
+   * @param address Address of the register
+   * @return Pointer to the register
+   */
+  uint8_t *_register(uint8_t address) {
+    return address < RawMag ? &_control[address] : &_banks[_filling][address - RawMag];
+  }
+
   /*!
    * @brief Fetches a value of type T in the address space at the given address
    * @param address Lowest address of the value to read
    * @return sizeof(T) bytes containing the value at the given address as type T
    */
   template <class T>
-  T _get(uint8_t address) { return *((T *)&_addressSpace[address]); }
+  T _get(uint8_t address) { return *((T *)_register(address)); }
 
   /*!
    * @brief Writes a value of type T in the address space at the given address
    * @param address Lowest address of the value to write
+   *
+   * Data registers written aren't read by the master until the next commit.
    */
   template <class T>
-  void _set(uint8_t address, T value) { *((T *)&_addressSpace[address]) = value; }
+  void _set(uint8_t address, T value) { *((T *)_register(address)) = value; }
 };
 
 }  // namespace blueboy
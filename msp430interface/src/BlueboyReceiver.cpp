@@ -23,11 +23,13 @@ void InitializeBlueboyInterface() {
 
   bus->OnReceive(&OnBlueboyReceive);
   bus->OnRequest(&OnBlueboyRequest);
+  bus->OnStart(&OnBlueboyStart);
   
   // for testing
   Interface.UpdateSensorData(BlueboyInterface::Magnetometer,  Vector3(0.0, 1.0, 2.0));
   Interface.UpdateSensorData(BlueboyInterface::Accelerometer, Vector3(3.0, 4.0, 5.0));
   Interface.UpdateSensorData(BlueboyInterface::Gyroscope,     Vector3(6.0, 7.0, 8.0));
+  Interface.Commit();
 }
 
 void OnBlueboyReceive(int bufsize) {
@@ -38,4 +40,8 @@ void OnBlueboyRequest() {
   Interface.OnRequest();
 }
 
+void OnBlueboyStart() {
+  Interface.OnStart();
+}
+
 }  // namespace blueboy
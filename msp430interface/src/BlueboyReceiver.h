@@ -39,6 +39,11 @@ void OnBlueboyReceive(int bufsize);
  */
 void OnBlueboyRequest();
 
+/*!
+ * @brief I2C start callback
+ */
+void OnBlueboyStart();
+
 }  // namespace blueboy
 
 #endif /* SRC_BLUEBOYRECEIVER_H_ */
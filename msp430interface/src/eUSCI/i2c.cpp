@@ -134,6 +134,11 @@ void I2CBus::OnRequest(void (*onRequest)()) {
   _onRequest = onRequest;
 }
 
+// calls the given function whenever this bus is addressed as a slave, before any data moves
+void I2CBus::OnStart(void (*onStart)()) {
+  _onStart = onStart;
+}
+
 // returns the bus's current mode
 I2CMode I2CBus::GetMode() {
   return _mode;
@@ -211,6 +216,23 @@ void I2CBus::completeReadBuffer() {
   }
 }
 
+// ends the transaction a stop condition closed, delivering what the master wrote
+void I2CBus::stopReceived(struct UCBx *base) {
+  STOPS++;
+
+  // sometimes the rx interrupt just sorta doesn't fire on the last
+  // byte before a stop, shnag it here so we don't lose it
+  if (base->ifg & UCRXIFG0) {
+    receiveByte();
+  }
+
+  if (!_rbuf.Empty()) {
+    completeReadBuffer();
+  }
+
+  _started = false;
+}
+
 // interrupt service routine handler
 void I2CBus::ISRHandler() {
   struct UCBx *base = getBase();
@@ -225,6 +247,16 @@ void I2CBus::ISRHandler() {
     case USCI_I2C_UCSTTIFG:         // Start condition received
       STARTS++;
 
+      // the vector hands out a start ahead of a stop, so when the master starts
+      // again straight after stopping, both are pending and the stop has to be
+      // dealt with first. left until after, it would end this transaction
+      // instead, and its repeated start would be taken for a first one that
+      // strands the register address in the read buffer
+      if (base->ifg & UCSTPIFG) {
+        base->ifg &= ~UCSTPIFG;
+        stopReceived(base);
+      }
+
       if (!_started) {
         _started = true;
       } else if (!_rbuf.Empty()) {
@@ -233,22 +265,11 @@ void I2CBus::ISRHandler() {
         completeReadBuffer();
       }
       _requested = false;
+      _onStart();
 
       break;
     case USCI_I2C_UCSTPIFG:         // Stop condition received
-      STOPS++;
-
-      // sometimes the rx interrupt just sorta doesn't fire on the last
-      // byte before a stop, shnag it here so we don't lose it
-      if (base->ifg & UCRXIFG0) {
-        receiveByte();
-      }
-
-      if (!_rbuf.Empty()) {
-        completeReadBuffer();
-      }
-
-      _started = false;
+      stopReceived(base);
       break;
     case USCI_I2C_UCRXIFG3:         // Complete byte received in slave mode on address 3
     case USCI_I2C_UCRXIFG2:         // Complete byte received in slave mode on address 2
@@ -49,7 +49,7 @@ class I2CBus {
   I2CBus(Handle bus):
     _bus(bus), _address(0), _mode(I2CMode::Unused),
     _transmitting(false), _started(false), _requested(false),
-    _onReceive([](int size) { }), _onRequest([]() { }) { }
+    _onReceive([](int size) { }), _onRequest([]() { }), _onStart([]() { }) { }
   void Begin();                         // begin as master
   void Begin(uint8_t address);          // begin as slave
   int RequestFrom(uint8_t address,      // as master, request from slave
@@ -65,6 +65,7 @@ class I2CBus {
 
   void OnReceive(void (*_onReceive)(int size));  // calls the given function whenever this bus receives data as a slave
   void OnRequest(void (*_onRequest)());          // calls the given function whenever this bus is requested data from the master
+  void OnStart(void (*_onStart)());              // calls the given function whenever this bus is addressed as a slave, before any data moves
   I2CMode GetMode();                        // returns the bus's current mode
 
   void ISRHandler();                        // interrupt service routine handler
@@ -76,6 +77,7 @@ class I2CBus {
   Handle _bus;                          // bus handle
   void (*_onReceive)(int size);         // function called when slave receives transmitted bytes from the master
   void (*_onRequest)();                 // function called when slave receives request for transmission to master
+  void (*_onStart)();                   // function called when slave is addressed by a start or repeated start
   I2CMode _mode;                        // current I2C mode
   bool _transmitting;                   // true iff currently in a transmission
   bool _started;                        // whether an initial start condition has been received
@@ -87,6 +89,7 @@ class I2CBus {
   void gpioInit();                        // initializes gpio pins for this I2C bus
   void receiveByte();                     // receives a byte if one is available and puts it on the read buffer
   void completeReadBuffer();              // completes the read buffer and sends it to the user
+  void stopReceived(struct msp430::UCBx *base);  // ends the transaction a stop condition closed
 };
 
 // returns a pointer to the I2C bus associated with the given handle
@@ -14,6 +14,8 @@ def get_attitude_mode(text)
     return 1
   when "Quaternion"
     return 2
+  when "Counts"
+    return 3
   else
     return 0
   end
@@ -23,11 +25,16 @@ def begin_attitude(device)
   device = device.upcase
   period = get_named_widget("#{device}_PERIOD").text.to_i;
   mode = get_attitude_mode(get_named_widget("#{device}_MODE").text)
+  batch = get_named_widget("#{device}_BATCH").text.to_i;
   
   if not period.between?(0, 65535)
     return;
   end
 
+  if not batch.between?(1, 9)
+    batch = 1
+  end
+
   case device
   when "OWN"
 	id = 16
@@ -37,7 +44,7 @@ def begin_attitude(device)
     id = 0
   end
   
-  cmd("BLUEBOY BEGIN#{device}ATT with ID #{id}, PERIOD #{period}, TYPE #{mode}")
+  cmd("BLUEBOY BEGIN#{device}ATT with ID #{id}, PERIOD #{period}, TYPE #{mode}, BATCH #{batch}")
 end
 
 def begin_attitude_all()